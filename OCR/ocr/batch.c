@@ -0,0 +1,300 @@
+/*
+ * Propagation avant par lots (inférence uniquement)
+ */
+
+#include <stdlib.h>
+
+#include "batch.h"
+#include "conv.h"
+#include "fastmath.h"
+#include "half.h"
+#include "prune.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+/* Tampons de travail d'une image pour les couches convolutives: seule la
+ * sortie de Pool1 est conservée, le reste tient dans quelques lignes */
+typedef struct {
+    float *pool1;               /* [conv1_filters][after_pool1][after_pool1] */
+    ConvFusedWorkspace conv;
+} ConvScratch;
+
+/* Conv1+ReLU+Pool1 puis Conv2+ReLU+Pool2 fusionnés, Pool2 écrit
+ * directement dans le vecteur aplati; mêmes valeurs que forward() (à
+ * l'arrondi près si CONV2 passe par Winograd) */
+static void conv_features(const CNN *net, const float input[IMG_SIZE][IMG_SIZE],
+                          ConvScratch *s, float *flat) {
+    const Topology *t = &net->topo;
+    conv1_relu_pool(t, net->conv1_weights, net->conv1_bias, &input[0][0], s->pool1, &s->conv);
+    if (net->conv2_winograd) {
+        conv2_relu_pool_winograd(t, net->conv2_winograd, net->conv2_bias, s->pool1, flat,
+                                 &s->conv);
+    } else {
+        conv2_relu_pool(t, net->conv2_weights, net->conv2_bias, s->pool1, flat, &s->conv);
+    }
+}
+
+/* FC1 pour un groupe de m images: chaque bloc de BATCH_FC1_ROWS lignes de
+ * poids est relu pour les m images tant qu'il est encore en cache.
+ * simd->dot4 calcule un neurone pour 4 images à la fois (chaque poids
+ * chargé sert 4 fois) avec exactement les opérations de simd->dot, celui
+ * de forward(): le résultat est identique. */
+static void fc1_tile(const CNN *net, const float *flat, int m, float *hidden) {
+    const int in = net->topo.flatten, out = net->topo.fc1_size;
+    int r0, r, b;
+    for (r0 = 0; r0 < out; r0 += BATCH_FC1_ROWS) {
+        int r1 = r0 + BATCH_FC1_ROWS < out ? r0 + BATCH_FC1_ROWS : out;
+        for (b = 0; b + 4 <= m; b += 4) {
+            const float *x0 = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                float sums[4];
+                int k;
+                simd->dot4(net->fc1_weights + (size_t)r * in, x0, x0 + in,
+                           x0 + 2 * in, x0 + 3 * in, in, sums);
+                for (k = 0; k < 4; k++) {
+                    hidden[(size_t)(b + k) * out + r] =
+                        relu(net->fc1_bias[r] + sums[k]);
+                }
+            }
+        }
+        /* Images restantes (m non multiple de 4) */
+        for (; b < m; b++) {
+            const float *x = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                hidden[(size_t)b * out + r] =
+                    relu(net->fc1_bias[r] + simd->dot(net->fc1_weights + (size_t)r * in, x, in));
+            }
+        }
+    }
+}
+
+/* fc1_tile() sur l'index creux d'un modèle élagué: mêmes groupes, seuls
+ * les blocs non nuls de chaque ligne sont lus (résultat identique) */
+static void fc1_tile_sparse(const CNN *net, const float *flat, int m, float *hidden) {
+    const SparseFc1 *sp = net->fc1_sparse;
+    const int in = sp->n, out = sp->rows, tail = in % PRUNE_BLOCK;
+    int r0, r, b;
+    for (r0 = 0; r0 < out; r0 += BATCH_FC1_ROWS) {
+        int r1 = r0 + BATCH_FC1_ROWS < out ? r0 + BATCH_FC1_ROWS : out;
+        for (b = 0; b + 4 <= m; b += 4) {
+            const float *x0 = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                int first = sp->row_start[r], nb = sp->row_start[r + 1] - first;
+                float sums[4];
+                int k;
+                simd->dot4_sparse(sp->values + (size_t)first * PRUNE_BLOCK, sp->blocks + first,
+                                  nb, sp->tail + (size_t)r * tail, x0, x0 + in, x0 + 2 * in,
+                                  x0 + 3 * in, in, sums);
+                for (k = 0; k < 4; k++) {
+                    hidden[(size_t)(b + k) * out + r] =
+                        relu(net->fc1_bias[r] + sums[k]);
+                }
+            }
+        }
+        for (; b < m; b++) {
+            const float *x = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                int first = sp->row_start[r], nb = sp->row_start[r + 1] - first;
+                hidden[(size_t)b * out + r] =
+                    relu(net->fc1_bias[r] +
+                         simd->dot_sparse(sp->values + (size_t)first * PRUNE_BLOCK,
+                                          sp->blocks + first, nb,
+                                          sp->tail + (size_t)r * tail, x, in));
+            }
+        }
+    }
+}
+
+/* fc1_tile() avec les poids 16 bits d'un modèle model.h16, convertis
+ * dans les noyaux: chaque bloc de lignes occupe deux fois moins de cache */
+static void fc1_tile_half(const CNN *net, const float *flat, int m, float *hidden) {
+    const HalfFc *h = net->fc_half;
+    const int in = net->topo.flatten, out = net->topo.fc1_size;
+    const int bf16 = h->format == HALF_BF16;
+    float (*dot)(const uint16_t *, const float *, int) = bf16 ? simd->dot_bf16 : simd->dot_f16;
+    void (*dot4)(const uint16_t *, const float *, const float *, const float *,
+                 const float *, int, float *) = bf16 ? simd->dot4_bf16 : simd->dot4_f16;
+    int r0, r, b;
+    for (r0 = 0; r0 < out; r0 += BATCH_FC1_ROWS) {
+        int r1 = r0 + BATCH_FC1_ROWS < out ? r0 + BATCH_FC1_ROWS : out;
+        for (b = 0; b + 4 <= m; b += 4) {
+            const float *x0 = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                float sums[4];
+                int k;
+                dot4(h->fc1_weights + (size_t)r * in, x0, x0 + in, x0 + 2 * in, x0 + 3 * in,
+                     in, sums);
+                for (k = 0; k < 4; k++) {
+                    hidden[(size_t)(b + k) * out + r] =
+                        relu(net->fc1_bias[r] + sums[k]);
+                }
+            }
+        }
+        for (; b < m; b++) {
+            const float *x = flat + (size_t)b * in;
+            for (r = r0; r < r1; r++) {
+                hidden[(size_t)b * out + r] =
+                    relu(net->fc1_bias[r] + dot(h->fc1_weights + (size_t)r * in, x, in));
+            }
+        }
+    }
+}
+
+/* FC2 + softmax d'une image, comme à la fin de forward() */
+static void fc2_softmax(const CNN *net, const float *hidden, float *out) {
+    const int n = net->topo.fc1_size;
+    const HalfFc *h = net->fc_half;
+    float logits[FC2_SIZE];
+    int i;
+    for (i = 0; i < FC2_SIZE; i++) {
+        float sum;
+        if (!h) {
+            sum = simd->dot(net->fc2_weights + (size_t)i * n, hidden, n);
+        } else if (h->format == HALF_BF16) {
+            sum = simd->dot_bf16(h->fc2_weights + (size_t)i * n, hidden, n);
+        } else {
+            sum = simd->dot_f16(h->fc2_weights + (size_t)i * n, hidden, n);
+        }
+        logits[i] = net->fc2_bias[i] + sum;
+    }
+    softmax(logits, out, NUM_CLASSES);
+}
+
+struct BatchWorkspace {
+    ConvScratch scratch;
+    float *flat;                /* [BATCH_TILE][flatten] */
+    float *hidden;              /* [BATCH_TILE][fc1_size] */
+    Arena arena;
+};
+
+static void scratch_carve(ConvScratch *s, const Topology *t, Arena *a) {
+    s->pool1 = arena_alloc(a, sizeof(float) * t->conv1_filters * t->after_pool1 * t->after_pool1);
+    conv_fused_workspace_carve(&s->conv, t, a);
+}
+
+static void workspace_carve(BatchWorkspace *ws, const Topology *t, Arena *a) {
+    scratch_carve(&ws->scratch, t, a);
+    ws->flat = arena_alloc(a, sizeof(float) * BATCH_TILE * t->flatten);
+    ws->hidden = arena_alloc(a, sizeof(float) * BATCH_TILE * t->fc1_size);
+}
+
+BatchWorkspace *batch_workspace_new(const Topology *t) {
+    BatchWorkspace *ws = calloc(1, sizeof(*ws));
+    if (!ws) return NULL;
+    arena_measure(&ws->arena);
+    workspace_carve(ws, t, &ws->arena);
+    if (arena_init(&ws->arena, ws->arena.used) != 0) {
+        free(ws);
+        return NULL;
+    }
+    workspace_carve(ws, t, &ws->arena);
+    return ws;
+}
+
+void batch_workspace_free(BatchWorkspace *ws) {
+    if (!ws) return;
+    arena_free(&ws->arena);
+    free(ws);
+}
+
+size_t batch_glyph_bytes(const Topology *t) {
+    ConvScratch s;
+    Arena a;
+    arena_measure(&a);
+    scratch_carve(&s, t, &a);
+    return a.used + sizeof(float) * (t->flatten + t->fc1_size);
+}
+
+void forward_batch_ws(const CNN *net, BatchWorkspace *ws,
+                      float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                      float (*probs)[NUM_CLASSES]) {
+    int start, b;
+    for (start = 0; start < n; start += BATCH_TILE) {
+        int m = n - start < BATCH_TILE ? n - start : BATCH_TILE;
+
+        for (b = 0; b < m; b++) {
+            conv_features(net, imgs[start + b], &ws->scratch,
+                          ws->flat + (size_t)b * net->topo.flatten);
+        }
+        if (net->fc_half) {
+            fc1_tile_half(net, ws->flat, m, ws->hidden);
+        } else if (net->fc1_sparse) {
+            fc1_tile_sparse(net, ws->flat, m, ws->hidden);
+        } else {
+            fc1_tile(net, ws->flat, m, ws->hidden);
+        }
+        for (b = 0; b < m; b++) {
+            fc2_softmax(net, ws->hidden + (size_t)b * net->topo.fc1_size, probs[start + b]);
+        }
+    }
+}
+
+int forward_batch(const CNN *net, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                  float (*probs)[NUM_CLASSES]) {
+    BatchWorkspace *ws = batch_workspace_new(&net->topo);
+    if (!ws) return -1;
+    forward_batch_ws(net, ws, imgs, n, probs);
+    batch_workspace_free(ws);
+    return 0;
+}
+
+/* Découpage du lot pour les workers: une tâche = chunk images consécutives */
+typedef struct {
+    const CNN *net;
+    BatchWorkspace **ws;        /* un espace de travail par worker */
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    int n;
+    int chunk;
+    char *letters;
+    float (*probs)[NUM_CLASSES]; /* NULL: probabilités non conservées */
+} PredictJob;
+
+static void predict_task(void *ctx, int task, int worker) {
+    PredictJob *job = ctx;
+    float local[BATCH_TILE][NUM_CLASSES];
+    int start = task * job->chunk;
+    int m = job->n - start < job->chunk ? job->n - start : job->chunk;
+    float (*probs)[NUM_CLASSES] = job->probs ? job->probs + start : local;
+    int b, k;
+
+    forward_batch_ws(job->net, job->ws[worker], job->imgs + start, m, probs);
+    for (b = 0; b < m; b++) {
+        int pred = 0;
+        for (k = 1; k < NUM_CLASSES; k++) {
+            if (probs[b][k] > probs[b][pred]) pred = k;
+        }
+        job->letters[start + b] = 'A' + pred;
+    }
+}
+
+int predict_batch(const CNN *net, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                  char *letters, float (*probs)[NUM_CLASSES], int threads) {
+    int w;
+    if (threads < 1) threads = 1;
+
+    /* Des tâches plus petites qu'un groupe complet quand il y a peu d'images
+     * par thread, pour occuper tous les coeurs */
+    int chunk = (n + threads - 1) / threads;
+    if (chunk > BATCH_TILE) chunk = BATCH_TILE;
+    if (chunk < 4) chunk = 4;
+    int n_tasks = (n + chunk - 1) / chunk;
+    if (threads > n_tasks) threads = n_tasks > 0 ? n_tasks : 1;
+
+    BatchWorkspace **ws = calloc(threads, sizeof(*ws));
+    if (!ws) return -1;
+    for (w = 0; w < threads; w++) {
+        ws[w] = batch_workspace_new(&net->topo);
+        if (!ws[w]) {
+            while (w-- > 0) batch_workspace_free(ws[w]);
+            free(ws);
+            return -1;
+        }
+    }
+
+    PredictJob job = { net, ws, imgs, n, chunk, letters, probs };
+    parallel_for(n_tasks, threads, predict_task, &job);
+
+    for (w = 0; w < threads; w++) batch_workspace_free(ws[w]);
+    free(ws);
+    return 0;
+}
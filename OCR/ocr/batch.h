@@ -0,0 +1,53 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "cnn.h"
+#include "topology.h"
+
+/*
+ * Inférence par lots: toutes les lettres d'une grille passent ensemble
+ * dans le réseau. Les convolutions (poids minuscules, déjà en cache) sont
+ * faites image par image, fusionnées avec ReLU et pooling (conv.h); FC1
+ * devient un produit matrice x matrice bloqué qui relit chaque bloc de
+ * poids pour tout un groupe d'images.
+ */
+
+/* Nombre de neurones FC1 dont les poids restent en cache à la fois
+ * (8 x 3200 floats = 100 Ko avec la topologie par défaut) */
+#define BATCH_FC1_ROWS 8
+/* Nombre d'images traitées contre un même bloc de poids */
+#define BATCH_TILE 32
+
+/* Tampons de travail d'un thread (convolutions + activations FC d'un
+ * groupe), dimensionnés pour une topologie: ne servent qu'aux réseaux de
+ * cette topologie */
+typedef struct BatchWorkspace BatchWorkspace;
+
+BatchWorkspace *batch_workspace_new(const Topology *t);
+void batch_workspace_free(BatchWorkspace *ws);
+
+/* Octets réellement parcourus par image (convolutions fusionnées + FC) */
+size_t batch_glyph_bytes(const Topology *t);
+
+/* Calcule les probabilités softmax de n images. Les résultats sont
+ * identiques (bit à bit) à ceux de forward() image par image, à
+ * l'arrondi près si net->conv2_winograd est défini. Un réseau dont les
+ * poids FC sont sur 16 bits (net->fc_half, half.h) n'a que ce chemin.
+ * Le réseau n'est que lu: plusieurs threads peuvent appeler cette
+ * fonction en parallèle avec des espaces de travail différents. */
+void forward_batch_ws(const CNN *net, BatchWorkspace *ws,
+                      float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                      float (*probs)[NUM_CLASSES]);
+
+/* Idem avec un espace de travail temporaire; -1 si l'allocation échoue */
+int forward_batch(const CNN *net, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                  float (*probs)[NUM_CLASSES]);
+
+/* Lettre la plus probable pour chaque image. Des groupes d'au plus
+ * BATCH_TILE images sont répartis sur threads workers, chacun avec ses
+ * propres tampons; letters[k] correspond toujours à imgs[k]. Si probs
+ * n'est pas NULL, il reçoit aussi les probabilités softmax de chaque image. */
+int predict_batch(const CNN *net, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                  char *letters, float (*probs)[NUM_CLASSES], int threads);
+
+#endif
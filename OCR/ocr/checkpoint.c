@@ -0,0 +1,205 @@
+/*
+ * Points de reprise de l'entraînement, voir checkpoint.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "model_bin.h"
+
+_Static_assert(sizeof(CheckpointHeader) <= CHECKPOINT_HEADER_SIZE, "en-tête train.ckpt trop grand");
+
+/* Morceaux du corps, dans l'ordre du fichier */
+typedef struct {
+    void *data;
+    size_t size;
+} CheckpointPart;
+
+static int body_parts(CNN *net, CNN *best, Optimizer *opt, int *indices,
+                      TrainProgress *progress, CheckpointPart parts[6]) {
+    int n = 0;
+    size_t size = sizeof(float) * net->count;
+    parts[n].data = net->data;
+    parts[n++].size = size;
+    if (opt->m) {
+        parts[n].data = opt->m->data;
+        parts[n++].size = size;
+    }
+    if (opt->v) {
+        parts[n].data = opt->v->data;
+        parts[n++].size = size;
+    }
+    parts[n].data = indices;
+    parts[n++].size = sizeof(int) * (size_t)progress->sample_count;
+    parts[n].data = progress->held_out;
+    parts[n++].size = sizeof(progress->held_out);
+    if (progress->best_epoch > 0) {
+        parts[n].data = best->data;
+        parts[n++].size = size;
+    }
+    return n;
+}
+
+int checkpoint_save(const char *filename, const CNN *net, const CNN *best,
+                    const Optimizer *opt, const TrainProgress *progress,
+                    const int *indices) {
+    unsigned char header[CHECKPOINT_HEADER_SIZE];
+    CheckpointHeader h;
+    CheckpointPart parts[6];
+    char tmp[512];
+    int k;
+
+    /* Les morceaux ne sont que lus */
+    int n = body_parts((CNN *)net, (CNN *)best, (Optimizer *)opt, (int *)indices,
+                       (TrainProgress *)progress, parts);
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version = CHECKPOINT_VERSION;
+    h.endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h.cnn_size = sizeof(float) * net->count;
+    h.conv1_filters = (uint32_t)net->topo.conv1_filters;
+    h.conv1_size = (uint32_t)net->topo.conv1_size;
+    h.conv2_filters = (uint32_t)net->topo.conv2_filters;
+    h.conv2_size = (uint32_t)net->topo.conv2_size;
+    h.fc1_size = (uint32_t)net->topo.fc1_size;
+    h.step = opt->step;
+    h.optim_kind = (uint32_t)opt->kind;
+    h.schedule = (uint32_t)opt->schedule;
+    h.base_lr = opt->base_lr;
+    h.epoch = (uint32_t)progress->epoch;
+    h.epochs = (uint32_t)progress->epochs;
+    h.batch_size = (uint32_t)progress->batch_size;
+    h.slices = (uint32_t)progress->slices;
+    h.augment = (uint32_t)progress->augment;
+    h.sample_count = (uint32_t)progress->sample_count;
+    h.val_count = (uint32_t)progress->val_count;
+    h.seed = progress->seed;
+    h.patience = (uint32_t)progress->patience;
+    h.best_epoch = (uint32_t)progress->best_epoch;
+    h.best_loss = progress->best_loss;
+    h.checksum = model_bin_checksum(parts[0].data, parts[0].size);
+    for (k = 1; k < n; k++) {
+        h.checksum = model_bin_checksum_continue(h.checksum, parts[k].data, parts[k].size);
+    }
+    memset(header, 0, sizeof(header));
+    memcpy(header, &h, sizeof(h));
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        printf("Erreur: impossible d'écrire %s\n", tmp);
+        return -1;
+    }
+    int ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+    for (k = 0; ok && k < n; k++) {
+        ok = fwrite(parts[k].data, 1, parts[k].size, fp) == parts[k].size;
+    }
+    ok &= fclose(fp) == 0;
+    if (!ok || rename(tmp, filename) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int checkpoint_load(const char *filename, CNN *net, CNN *best, Optimizer *opt,
+                    TrainProgress *progress, int **indices) {
+    unsigned char header[CHECKPOINT_HEADER_SIZE];
+    CheckpointHeader h;
+    CheckpointPart parts[6];
+    int k;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        printf("Erreur: impossible d'ouvrir %s\n", filename);
+        return -1;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+        printf("Erreur: %s est tronqué\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    memcpy(&h, header, sizeof(h));
+    if (memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != CHECKPOINT_VERSION || h.endian_tag != MODEL_BIN_ENDIAN_TAG) {
+        printf("Erreur: %s n'est pas un point de reprise compatible\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    Topology t;
+    t.conv1_filters = (int)h.conv1_filters;
+    t.conv1_size = (int)h.conv1_size;
+    t.conv2_filters = (int)h.conv2_filters;
+    t.conv2_size = (int)h.conv2_size;
+    t.fc1_size = (int)h.fc1_size;
+    if (h.conv1_filters > TOPO_MAX_FILTERS || h.conv2_filters > TOPO_MAX_FILTERS ||
+        h.conv1_size > IMG_SIZE || h.conv2_size > IMG_SIZE || h.fc1_size > TOPO_MAX_FC1 ||
+        topology_init(&t) != 0) {
+        printf("Erreur: topologie de %s invalide\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    if (h.optim_kind > OPTIM_ADAM || h.schedule > LR_COSINE || h.sample_count == 0 ||
+        h.batch_size == 0 || h.slices == 0 || h.epoch > h.epochs || h.best_epoch > h.epoch) {
+        printf("Erreur: en-tête de %s invalide\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    int *perm = malloc(sizeof(int) * h.sample_count);
+    if (!perm || cnn_alloc(net, &t) != 0 || cnn_alloc(best, &t) != 0 ||
+        optim_init(opt, (OptimKind)h.optim_kind, (LrSchedule)h.schedule, h.base_lr, &t) != 0) {
+        printf("Erreur: mémoire insuffisante\n");
+        cnn_free(net);
+        cnn_free(best);
+        free(perm);
+        fclose(fp);
+        return -1;
+    }
+    if (h.cnn_size != sizeof(float) * net->count) {
+        printf("Erreur: en-tête de %s invalide\n", filename);
+        optim_free(opt);
+        cnn_free(net);
+        cnn_free(best);
+        free(perm);
+        fclose(fp);
+        return -1;
+    }
+    progress->sample_count = (int)h.sample_count;
+    progress->best_epoch = (int)h.best_epoch;
+    int n = body_parts(net, best, opt, perm, progress, parts);
+    uint64_t sum = 0;
+    int ok = 1;
+    for (k = 0; ok && k < n; k++) {
+        ok = fread(parts[k].data, 1, parts[k].size, fp) == parts[k].size;
+        sum = k == 0 ? model_bin_checksum(parts[k].data, parts[k].size)
+                     : model_bin_checksum_continue(sum, parts[k].data, parts[k].size);
+    }
+    fclose(fp);
+    if (!ok || sum != h.checksum) {
+        printf("Erreur: %s\n", ok ? "somme de contrôle du point de reprise invalide"
+                                   : "point de reprise tronqué");
+        optim_free(opt);
+        cnn_free(net);
+        cnn_free(best);
+        free(perm);
+        return -1;
+    }
+
+    opt->step = h.step;
+    progress->epoch = (int)h.epoch;
+    progress->epochs = (int)h.epochs;
+    progress->batch_size = (int)h.batch_size;
+    progress->slices = (int)h.slices;
+    progress->augment = (int)h.augment;
+    progress->val_count = (int)h.val_count;
+    progress->patience = (int)h.patience;
+    progress->best_loss = h.best_loss;
+    progress->seed = h.seed;
+    *indices = perm;
+    return 0;
+}
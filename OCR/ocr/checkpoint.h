@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+#include "optim.h"
+#include "topology.h"
+#include "validation.h"
+
+/*
+ * Points de reprise de l'entraînement (train.ckpt).
+ *
+ *   [ en-tête CheckpointHeader, CHECKPOINT_HEADER_SIZE octets    ]
+ *   [ poids: CNN::data (topologie décrite dans l'en-tête)        ]
+ *   [ état de l'optimiseur: 0, 1 ou 2 tableaux de forme Gradients ]
+ *   [ permutation des échantillons de la dernière époque (int)  ]
+ *   [ polices de validation: SAMPLES_PER_LETTER octets à 0 ou 1  ]
+ *   [ poids de la meilleure époque de validation (si best_epoch)  ]
+ *
+ * Avec la graine de l'en-tête (les tirages ne dépendent que d'elle, de
+ * l'époque et de l'échantillon, rng.h), c'est tout ce qu'il faut pour que
+ * l'entraînement repris donne exactement les mêmes poids qu'un
+ * entraînement ininterrompu. Le fichier est écrit à côté puis renommé:
+ * un arrêt pendant l'écriture laisse le point de reprise précédent intact.
+ */
+
+#define CHECKPOINT_MAGIC "CNNCKPT\n"
+#define CHECKPOINT_VERSION 4
+#define CHECKPOINT_HEADER_SIZE 128
+#define CHECKPOINT_FILE "train.ckpt"
+
+/* Avancement et réglages de l'entraînement, repris tels quels */
+typedef struct {
+    int epoch;                  /* époques terminées */
+    int epochs;
+    int batch_size;
+    int slices;                 /* tranches par lot (ordre des sommes) */
+    int augment;
+    int sample_count;           /* images d'entraînement */
+    int val_count;              /* images de validation */
+    int patience;               /* 0 = pas d'arrêt anticipé */
+    int best_epoch;             /* époques faites à la meilleure validation, 0 = aucune */
+    float best_loss;            /* perte de validation de best_epoch */
+    uint32_t seed;              /* graine des tirages (rng.h) */
+    uint8_t held_out[SAMPLES_PER_LETTER];  /* polices de validation */
+} TrainProgress;
+
+typedef struct {
+    char magic[8];              /* CHECKPOINT_MAGIC */
+    uint32_t version;           /* CHECKPOINT_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint64_t cnn_size;          /* octets de CNN::data (et de chaque état) */
+    uint64_t step;              /* mises à jour déjà faites */
+    uint64_t checksum;          /* FNV-1a 64 bits du corps */
+    uint32_t optim_kind, schedule;
+    float base_lr;
+    uint32_t epoch, epochs;
+    uint32_t batch_size, slices, augment;
+    uint32_t sample_count, val_count;
+    uint32_t seed, reserved;
+    uint32_t patience, best_epoch;
+    float best_loss;
+    uint32_t conv1_filters, conv1_size, conv2_filters, conv2_size, fc1_size;
+} CheckpointHeader;
+
+/* best (poids de la meilleure époque) n'est lu que si progress->best_epoch */
+int checkpoint_save(const char *filename, const CNN *net, const CNN *best,
+                    const Optimizer *opt, const TrainProgress *progress,
+                    const int *indices);
+
+/* Relit un point de reprise: net et best alloués (cnn_alloc) avec la
+ * topologie du fichier, poids dans net (et best si best_epoch), optimiseur
+ * initialisé et restauré dans opt, permutation allouée dans *indices */
+int checkpoint_load(const char *filename, CNN *net, CNN *best, Optimizer *opt,
+                    TrainProgress *progress, int **indices);
+
+#endif
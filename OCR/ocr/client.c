@@ -0,0 +1,86 @@
+/*
+ * Client du démon OCR, voir client.h
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "client.h"
+
+_Static_assert(sizeof(OcrGlyph) == 8, "OcrGlyph doit faire 8 octets");
+
+int ocr_read_full(int fd, void *buf, size_t size) {
+    char *p = buf;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+int ocr_write_full(int fd, const void *buf, size_t size) {
+    const char *p = buf;
+    while (size > 0) {
+        /* MSG_NOSIGNAL: un pair disparu donne EPIPE au lieu de SIGPIPE */
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+int ocr_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path) + 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void ocr_disconnect(int fd) {
+    if (fd >= 0) close(fd);
+}
+
+int ocr_recognize(int fd, const uint8_t *pixels, int n, char *letters, float *confidence) {
+    OcrRequest req = { OCR_REQUEST_MAGIC, (uint32_t)n };
+    OcrReply reply;
+    OcrGlyph glyphs[256];
+    int done = 0;
+
+    if (n < 0 || n > OCR_MAX_GLYPHS) return OCR_ERR_PROTOCOL;
+    if (ocr_write_full(fd, &req, sizeof(req)) != 0 ||
+        ocr_write_full(fd, pixels, (size_t)n * OCR_IMG_PIXELS) != 0 ||
+        ocr_read_full(fd, &reply, sizeof(reply)) != 0 || reply.magic != OCR_REPLY_MAGIC) {
+        return -1;
+    }
+    if (reply.status != OCR_OK) return (int)reply.status;
+    if (reply.count != (uint32_t)n) return -1;
+
+    /* Réponse lue par morceaux: pas d'allocation côté client */
+    while (done < n) {
+        int m = n - done < 256 ? n - done : 256, k;
+        if (ocr_read_full(fd, glyphs, sizeof(glyphs[0]) * m) != 0) return -1;
+        for (k = 0; k < m; k++) {
+            letters[done + k] = glyphs[k].letter;
+            if (confidence) confidence[done + k] = glyphs[k].confidence;
+        }
+        done += m;
+    }
+    return 0;
+}
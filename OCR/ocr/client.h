@@ -0,0 +1,72 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Client du démon OCR (main serve) et protocole sur le socket Unix.
+ *
+ * Le démon garde le modèle chargé: une grille coûte un aller-retour sur
+ * le socket au lieu d'un lancement de ./main 3 avec chargement du modèle.
+ * Ce fichier et client.c ne dépendent que de la libc, pour être compilés
+ * tels quels dans le solveur ou l'interface.
+ *
+ * Une connexion enchaîne des requêtes, chacune suivie de sa réponse
+ * (entiers dans l'ordre natif: le socket est local):
+ *
+ *   requête: OcrRequest, puis count images de OCR_IMG_PIXELS octets
+ *            (ligne par ligne, valeur du pixel x 255 comme dans
+ *            letters.pack: 0 = 0.0, 255 = 1.0)
+ *   réponse: OcrReply, puis count OcrGlyph si status == OCR_OK
+ *
+ * Une requête invalide (magic, count > OCR_MAX_GLYPHS) reçoit un status
+ * d'erreur; le démon ferme alors la connexion.
+ */
+
+#define OCR_IMG_SIZE 50
+#define OCR_IMG_PIXELS (OCR_IMG_SIZE * OCR_IMG_SIZE)
+#define OCR_MAX_GLYPHS 4096
+#define OCR_SOCKET "ocr.sock"
+
+#define OCR_REQUEST_MAGIC 0x5152434fu  /* "OCRQ" */
+#define OCR_REPLY_MAGIC 0x5252434fu    /* "OCRR" */
+
+enum {
+    OCR_OK = 0,
+    OCR_ERR_PROTOCOL = 1        /* magic inconnu ou count hors limites */
+};
+
+typedef struct {
+    uint32_t magic;             /* OCR_REQUEST_MAGIC */
+    uint32_t count;             /* images qui suivent */
+} OcrRequest;
+
+typedef struct {
+    uint32_t magic;             /* OCR_REPLY_MAGIC */
+    uint32_t status;            /* OCR_OK ou OCR_ERR_* */
+    uint32_t count;             /* OcrGlyph qui suivent */
+    uint32_t reserved;
+} OcrReply;
+
+typedef struct {
+    char letter;                /* 'A'..'Z' */
+    uint8_t reserved[3];
+    float confidence;           /* probabilité softmax de letter */
+} OcrGlyph;
+
+/* Lecture / écriture de exactement size octets (reprend après EINTR et
+ * les transferts partiels); -1 si la connexion est fermée ou en erreur */
+int ocr_read_full(int fd, void *buf, size_t size);
+int ocr_write_full(int fd, const void *buf, size_t size);
+
+/* Descripteur connecté au démon, -1 si personne n'écoute sur path */
+int ocr_connect(const char *path);
+void ocr_disconnect(int fd);
+
+/* Reconnaît n images (n x OCR_IMG_PIXELS octets): letters[k] et
+ * confidence[k] (peut être NULL) pour pixels[k]. 0 si tout va bien, -1 si
+ * la connexion est perdue, sinon le status d'erreur du démon. */
+int ocr_recognize(int fd, const uint8_t *pixels, int n, char *letters, float *confidence);
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef CNN_H
+#define CNN_H
+
+#include <stddef.h>
+
+/*
+ * Définitions communes du CNN de reconnaissance de lettres:
+ * dimensions des couches et structures partagées entre les modules.
+ */
+
+/* ============================================================
+ * CONSTANTES ET CONFIGURATION
+ * ============================================================ */
+
+#define IMG_SIZE 50
+#define NUM_CLASSES 26
+
+/* Architecture par défaut - VERSION AUGMENTÉE. La topologie réelle est
+ * celle du modèle chargé (Topology, voir topology.h): ces valeurs ne
+ * servent qu'à créer un nouveau réseau et aux bancs d'essai. */
+#define CONV1_FILTERS 16      /* 8 → 16 */
+#define CONV1_SIZE 5
+#define POOL1_SIZE 2          /* pooling 2x2 après chaque convolution */
+#define AFTER_POOL1 23
+
+#define CONV2_FILTERS 32      /* 16 → 32 */
+#define CONV2_SIZE 3
+#define AFTER_POOL2 10
+
+#define FC1_SIZE 256          /* 128 → 256 */
+#define FC2_SIZE NUM_CLASSES
+
+/* Taille des sorties des convolutions (avant pooling) */
+#define CONV1_OUT (IMG_SIZE - CONV1_SIZE + 1)      /* 46 */
+#define CONV2_OUT (AFTER_POOL1 - CONV2_SIZE + 1)   /* 21 */
+
+#define FLATTEN_SIZE (CONV2_FILTERS * AFTER_POOL2 * AFTER_POOL2)  /* sera 32*10*10 = 3200 */
+
+/* Hyperparamètres */
+#define LEARNING_RATE 0.0005f  /* réduire un peu car réseau plus grand */
+#define EPOCHS 20              /* peut nécessiter plus d'époques */
+#define SAMPLES_PER_LETTER 1000
+#define BATCH_SIZE 32          /* échantillons par mise à jour des poids */
+
+/* Fichiers du modèle */
+#define MODEL_TEXT_FILE "model.txt"   /* format texte CNN_MODEL_V1 */
+#define MODEL_BIN_FILE "model.bin"    /* format binaire mappable, voir model_bin.h */
+
+/* ============================================================
+ * STRUCTURE DU RÉSEAU DE NEURONES
+ * ============================================================ */
+
+/* Topologie d'un réseau: les cinq premiers champs la décrivent (en-tête
+ * du modèle), les suivants en sont déduits par topology_init() */
+typedef struct {
+    int conv1_filters, conv1_size;
+    int conv2_filters, conv2_size;
+    int fc1_size;
+
+    int conv1_out;              /* IMG_SIZE - conv1_size + 1 */
+    int after_pool1;            /* conv1_out / 2 */
+    int conv2_out;              /* after_pool1 - conv2_size + 1 */
+    int after_pool2;            /* conv2_out / 2 */
+    int flatten;                /* conv2_filters * after_pool2^2 */
+} Topology;
+
+/* Chaque bloc est aligné sur 64 octets, dans l'ordre des champs: l'arène
+ * a exactement la disposition du corps d'un fichier model.bin, qui peut
+ * donc être mappé et utilisé tel quel (cnn_bind). */
+#define CNN_BLOCK_ALIGN 64
+
+typedef struct {
+    Topology topo;
+
+    /* Couche Conv1: [conv1_filters][conv1_size][conv1_size] */
+    float *conv1_weights;
+    float *conv1_bias;
+
+    /* Couche Conv2: [conv2_filters][conv1_filters][conv2_size][conv2_size] */
+    float *conv2_weights;
+    float *conv2_bias;
+
+    /* Couche FC1: [fc1_size][flatten] */
+    float *fc1_weights;
+    float *fc1_bias;
+
+    /* Couche FC2: [NUM_CLASSES][fc1_size] */
+    float *fc2_weights;
+    float *fc2_bias;
+
+    /* Tous les blocs, alignement compris (même taille que le corps de
+     * model.bin); data == owned si l'arène appartient au réseau */
+    float *data;
+    size_t count;               /* en floats */
+    void *owned;
+
+    /* Index creux de FC1 pour l'inférence d'un modèle élagué (prune.h),
+     * NULL: FC1 dense */
+    const struct SparseFc1 *fc1_sparse;
+
+    /* Filtres de CONV2 transformés pour Winograd (conv.h), NULL: CONV2 par
+     * im2col + GEMM */
+    const struct Conv2Winograd *conv2_winograd;
+
+    /* Poids de FC1 et FC2 sur 16 bits (half.h), fc1_weights et fc2_weights
+     * étant alors NULL; NULL: poids float */
+    const struct HalfFc *fc_half;
+} CNN;
+
+/* Gradients, et état de l'optimiseur: mêmes blocs, même disposition */
+typedef CNN Gradients;
+
+/* Buffers pour la propagation avant et arrière (dimensions de la
+ * topologie, tout dans une arène: forward_cache_alloc) */
+typedef struct {
+    float input[IMG_SIZE][IMG_SIZE];
+    
+    /* Sorties Conv1: [conv1_filters][conv1_out][conv1_out] */
+    float *conv1_out;
+    float *relu1_out;
+    /* [conv1_filters][after_pool1][after_pool1] */
+    float *pool1_out;
+    int *pool1_max_i;
+    int *pool1_max_j;
+    
+    /* Sorties Conv2: [conv2_filters][conv2_out][conv2_out] */
+    float *conv2_out;
+    float *relu2_out;
+    /* [conv2_filters][after_pool2][after_pool2] */
+    float *pool2_out;
+    int *pool2_max_i;
+    int *pool2_max_j;
+    
+    /* Vecteur aplati [flatten] */
+    float *flatten;
+    
+    /* Sorties FC: [fc1_size] */
+    float *fc1_out;
+    float *relu3_out;
+    float fc2_out[FC2_SIZE];
+    float softmax_out[NUM_CLASSES];
+    
+    /* Gradients intermédiaires de la propagation arrière */
+    float *d_relu3;             /* [fc1_size], puis gradient de fc1_out */
+    float *d_flatten;           /* [flatten], donc aussi [conv2_filters][after_pool2]^2 */
+    float *d_relu2;             /* forme de conv2_out, puis gradient de conv2_out */
+    float *d_pool1;             /* forme de pool1_out */
+    float *d_relu1;             /* forme de conv1_out, puis gradient de conv1_out */
+    
+    void *arena;
+} ForwardCache;
+
+/* ============================================================
+ * FONCTIONS PARTAGÉES (définies dans main.c)
+ * ============================================================ */
+
+float relu(float x);
+double now_seconds(void);
+int read_pbm(const char *filename, float img[IMG_SIZE][IMG_SIZE]);
+
+/* Mélange de Fisher-Yates avec le flux r (rng.h) */
+struct RngStream;
+void shuffle_indices(int *indices, int n, struct RngStream *r);
+
+#endif
@@ -0,0 +1,723 @@
+/*
+ * Couches convolutives: boucles directes, im2col + GEMM et Winograd
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "conv.h"
+#include "gemm.h"
+#include "simd.h"
+
+ConvEngine conv_engine = CONV_GEMM;
+
+/* ============================================================
+ * IM2COL
+ * ============================================================ */
+
+/* col[(c*k + ki)*k + kj][i*out + j] = in[c][row0 + i + ki][j + kj] pour les
+ * nrows lignes de sortie à partir de row0: la ligne suit l'ordre [c][ki][kj]
+ * des poids, chaque colonne est une fenêtre */
+TOPO_SPECIALIZE void im2col(const float *in, int channels, int size, int k,
+                            int row0, int nrows, float *col) {
+    int out = size - k + 1;
+    int c, ki, kj, i;
+    for (c = 0; c < channels; c++) {
+        for (ki = 0; ki < k; ki++) {
+            for (kj = 0; kj < k; kj++) {
+                const float *src = in + ((size_t)c * size + row0 + ki) * size + kj;
+                for (i = 0; i < nrows; i++) {
+                    memcpy(col, src + (size_t)i * size, sizeof(float) * out);
+                    col += out;
+                }
+            }
+        }
+    }
+}
+
+/* Opération inverse en accumulant: d_in[c][i + ki][j + kj] += dcol[...] */
+TOPO_SPECIALIZE void col2im_add(const float *dcol, int channels, int size, int k,
+                                float *d_in) {
+    int out = size - k + 1;
+    int c, ki, kj, i, j;
+    for (c = 0; c < channels; c++) {
+        for (ki = 0; ki < k; ki++) {
+            for (kj = 0; kj < k; kj++) {
+                float *dst = d_in + ((size_t)c * size + ki) * size + kj;
+                for (i = 0; i < out; i++) {
+                    for (j = 0; j < out; j++) {
+                        dst[(size_t)i * size + j] += dcol[j];
+                    }
+                    dcol += out;
+                }
+            }
+        }
+    }
+}
+
+/* Initialise chaque ligne de out[filters][cols] à son biais */
+TOPO_SPECIALIZE void fill_bias(float *out, const float *bias, int filters, int cols) {
+    int f, j;
+    for (f = 0; f < filters; f++) {
+        for (j = 0; j < cols; j++) {
+            out[(size_t)f * cols + j] = bias[f];
+        }
+    }
+}
+
+/* Somme de chaque ligne de d_out[filters][cols] ajoutée au biais */
+TOPO_SPECIALIZE void add_bias_grad(const float *d_out, float *db, int filters, int cols) {
+    int f, j;
+    for (f = 0; f < filters; f++) {
+        float sum = 0.0f;
+        for (j = 0; j < cols; j++) {
+            sum += d_out[(size_t)f * cols + j];
+        }
+        db[f] += sum;
+    }
+}
+
+/* ============================================================
+ * TAMPONS
+ * ============================================================ */
+
+void conv_workspace_carve(ConvWorkspace *ws, const Topology *t, Arena *a) {
+    size_t k1 = (size_t)t->conv1_size * t->conv1_size;
+    size_t k2 = (size_t)t->conv1_filters * t->conv2_size * t->conv2_size;
+    size_t col1 = k1 * t->conv1_out * t->conv1_out;
+    size_t col2 = k2 * t->conv2_out * t->conv2_out;
+    ws->col = arena_alloc(a, sizeof(float) * (col1 > col2 ? col1 : col2));
+    ws->dcol = arena_alloc(a, sizeof(float) * col2);
+
+    size_t act1 = (size_t)t->conv1_filters * t->after_pool1 * t->after_pool1;
+    size_t act2 = (size_t)t->conv2_filters * t->after_pool2 * t->after_pool2;
+    ws->active1.start = arena_alloc(a, sizeof(int) * (t->conv1_filters + 1));
+    ws->active1.pos = arena_alloc(a, sizeof(int) * act1);
+    ws->active1.grad = arena_alloc(a, sizeof(float) * act1);
+    ws->active2.start = arena_alloc(a, sizeof(int) * (t->conv2_filters + 1));
+    ws->active2.pos = arena_alloc(a, sizeof(int) * act2);
+    ws->active2.grad = arena_alloc(a, sizeof(float) * act2);
+    ws->slot = arena_alloc(a, sizeof(int) * t->conv2_out * t->conv2_out);
+    ws->used = arena_alloc(a, sizeof(int) * t->conv2_out * t->conv2_out);
+    ws->pack = arena_alloc(a, sizeof(float) * GEMM_PACK_FLOATS);
+}
+
+void conv_fused_workspace_carve(ConvFusedWorkspace *ws, const Topology *t, Arena *a) {
+    size_t k1 = (size_t)t->conv1_size * t->conv1_size;
+    size_t k2 = (size_t)t->conv1_filters * t->conv2_size * t->conv2_size;
+    size_t cols1 = 2 * CONV_FUSED_BAND * (size_t)t->conv1_out;
+    size_t cols2 = 2 * CONV_FUSED_BAND * (size_t)t->conv2_out;
+    size_t col1 = k1 * cols1, col2 = k2 * cols2;
+    size_t rows1 = t->conv1_filters * cols1, rows2 = t->conv2_filters * cols2;
+    ws->col = arena_alloc(a, sizeof(float) * (col1 > col2 ? col1 : col2));
+    ws->rows = arena_alloc(a, sizeof(float) * (rows1 > rows2 ? rows1 : rows2));
+    ws->wino_v = ws->wino_m = NULL;
+    if (t->conv2_size == 3) {
+        size_t rows = (size_t)(t->conv2_filters + 3) & ~(size_t)3;
+        ws->wino_v = arena_alloc(a, sizeof(float) * CONV_WINO_POINTS * t->conv1_filters *
+                                    CONV_WINO_TILES);
+        ws->wino_m = arena_alloc(a, sizeof(float) * CONV_WINO_POINTS * rows * CONV_WINO_TILES);
+    }
+    ws->pack = arena_alloc(a, sizeof(float) * GEMM_PACK_FLOATS);
+}
+
+/* ============================================================
+ * MOTEUR DIRECT (boucles d'origine)
+ * ============================================================ */
+
+/* Chaque point d'entrée appelle son corps *_impl avec les constantes de la
+ * topologie par défaut quand c'est elle (version spécialisée), sinon avec
+ * les dimensions lues dans la topologie */
+#define TOPO_DISPATCH(t, call_default, call_generic) \
+    do { if (topology_is_default(t)) call_default; else call_generic; } while (0)
+
+TOPO_SPECIALIZE void conv1_forward_direct(const float *wp, const float *bias,
+                                          const float *inp, float *outp,
+                                          const int F, const int K) {
+    const int O = IMG_SIZE - K + 1;
+    const float (*w)[K][K] = (const float (*)[K][K])wp;
+    const float (*in)[IMG_SIZE] = (const float (*)[IMG_SIZE])inp;
+    float (*out)[O][O] = (float (*)[O][O])outp;
+    int f, i, j, ki, kj;
+    for (f = 0; f < F; f++) {
+        for (i = 0; i < O; i++) {
+            for (j = 0; j < O; j++) {
+                float sum = bias[f];
+                for (ki = 0; ki < K; ki++) {
+                    for (kj = 0; kj < K; kj++) {
+                        sum += in[i + ki][j + kj] * w[f][ki][kj];
+                    }
+                }
+                out[f][i][j] = sum;
+            }
+        }
+    }
+}
+
+TOPO_SPECIALIZE void conv2_forward_direct(const float *wp, const float *bias,
+                                          const float *inp, float *outp,
+                                          const int F, const int C, const int K, const int P) {
+    const int O = P - K + 1;
+    const float (*w)[C][K][K] = (const float (*)[C][K][K])wp;
+    const float (*in)[P][P] = (const float (*)[P][P])inp;
+    float (*out)[O][O] = (float (*)[O][O])outp;
+    int f, c, i, j, ki, kj;
+    for (f = 0; f < F; f++) {
+        for (i = 0; i < O; i++) {
+            for (j = 0; j < O; j++) {
+                float sum = bias[f];
+                for (c = 0; c < C; c++) {
+                    for (ki = 0; ki < K; ki++) {
+                        for (kj = 0; kj < K; kj++) {
+                            sum += in[c][i + ki][j + kj] * w[f][c][ki][kj];
+                        }
+                    }
+                }
+                out[f][i][j] = sum;
+            }
+        }
+    }
+}
+
+TOPO_SPECIALIZE void conv2_backward_direct(const float *wp, const float *inp,
+                                           const float *d_outp, float *dwp, float *db,
+                                           float *d_inp, const int F, const int C,
+                                           const int K, const int P) {
+    const int O = P - K + 1;
+    const float (*w)[C][K][K] = (const float (*)[C][K][K])wp;
+    const float (*in)[P][P] = (const float (*)[P][P])inp;
+    const float (*d_out)[O][O] = (const float (*)[O][O])d_outp;
+    float (*dw)[C][K][K] = (float (*)[C][K][K])dwp;
+    float (*d_in)[P][P] = (float (*)[P][P])d_inp;
+    int f, c, i, j, ki, kj;
+
+    for (f = 0; f < F; f++) {
+        for (i = 0; i < O; i++) {
+            for (j = 0; j < O; j++) {
+                db[f] += d_out[f][i][j];
+                for (c = 0; c < C; c++) {
+                    for (ki = 0; ki < K; ki++) {
+                        for (kj = 0; kj < K; kj++) {
+                            dw[f][c][ki][kj] += d_out[f][i][j] * in[c][i + ki][j + kj];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    memset(d_inp, 0, sizeof(float) * C * P * P);
+    for (f = 0; f < F; f++) {
+        for (i = 0; i < O; i++) {
+            for (j = 0; j < O; j++) {
+                for (c = 0; c < C; c++) {
+                    for (ki = 0; ki < K; ki++) {
+                        for (kj = 0; kj < K; kj++) {
+                            d_in[c][i + ki][j + kj] += d_out[f][i][j] * w[f][c][ki][kj];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TOPO_SPECIALIZE void conv1_backward_direct(const float *inp, const float *d_outp,
+                                           float *dwp, float *db, const int F, const int K) {
+    const int O = IMG_SIZE - K + 1;
+    const float (*in)[IMG_SIZE] = (const float (*)[IMG_SIZE])inp;
+    const float (*d_out)[O][O] = (const float (*)[O][O])d_outp;
+    float (*dw)[K][K] = (float (*)[K][K])dwp;
+    int f, i, j, ki, kj;
+    for (f = 0; f < F; f++) {
+        for (i = 0; i < O; i++) {
+            for (j = 0; j < O; j++) {
+                db[f] += d_out[f][i][j];
+                for (ki = 0; ki < K; ki++) {
+                    for (kj = 0; kj < K; kj++) {
+                        dw[f][ki][kj] += d_out[f][i][j] * in[i + ki][j + kj];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* ============================================================
+ * IM2COL + GEMM
+ * ============================================================ */
+
+/* out[16][2116] = W[16][25] x col[25][2116] (topologie par défaut) */
+TOPO_SPECIALIZE void conv1_forward_gemm(const float *w, const float *bias, const float *in,
+                                        float *out, float *col, float *pack,
+                                        const int F, const int K) {
+    const int O = IMG_SIZE - K + 1;
+    im2col(in, 1, IMG_SIZE, K, 0, O, col);
+    fill_bias(out, bias, F, O * O);
+    sgemm(0, 0, F, O * O, K * K, w, K * K, col, O * O, 1.0f, out, O * O, pack);
+}
+
+/* out[32][441] = W[32][144] x col[144][441] */
+TOPO_SPECIALIZE void conv2_forward_gemm(const float *w, const float *bias, const float *in,
+                                        float *out, float *col, float *pack, const int F,
+                                        const int C, const int K, const int P) {
+    const int O = P - K + 1;
+    im2col(in, C, P, K, 0, O, col);
+    fill_bias(out, bias, F, O * O);
+    sgemm(0, 0, F, O * O, C * K * K, w, C * K * K, col, O * O, 1.0f, out, O * O, pack);
+}
+
+TOPO_SPECIALIZE void conv2_backward_gemm(const float *w, const float *in, const float *d_out,
+                                         float *dw, float *db, float *d_in,
+                                         float *col, float *dcol, float *pack, const int F,
+                                         const int C, const int K, const int P) {
+    const int O = P - K + 1;
+    const int k = C * K * K, cols = O * O;
+
+    add_bias_grad(d_out, db, F, cols);
+
+    /* dW[32][144] += dY[32][441] x col^T */
+    im2col(in, C, P, K, 0, O, col);
+    sgemm(0, 1, F, k, cols, d_out, cols, col, cols, 1.0f, dw, k, pack);
+
+    /* dcol[144][441] = W^T x dY, puis retour sur la grille d'entrée */
+    sgemm(1, 0, k, cols, F, w, k, d_out, cols, 0.0f, dcol, cols, pack);
+    memset(d_in, 0, sizeof(float) * C * P * P);
+    col2im_add(dcol, C, P, K, d_in);
+}
+
+TOPO_SPECIALIZE void conv1_backward_gemm(const float *in, const float *d_out, float *dw,
+                                         float *db, float *col, float *pack,
+                                         const int F, const int K) {
+    const int O = IMG_SIZE - K + 1;
+
+    add_bias_grad(d_out, db, F, O * O);
+
+    /* dW[16][25] += dY[16][2116] x col^T */
+    im2col(in, 1, IMG_SIZE, K, 0, O, col);
+    sgemm(0, 1, F, K * K, O * O, d_out, O * O, col, O * O, 1.0f, dw, K * K, pack);
+}
+
+/* ============================================================
+ * PROPAGATION ARRIÈRE CREUSE
+ * ============================================================ */
+
+/* Fenêtre de la position de sortie (i, j) rangée comme une colonne
+ * d'im2col: row[(c * k + ki) * k + kj] = in[c][i + ki][j + kj] */
+TOPO_SPECIALIZE void window_to_row(const float *in, const int channels, const int size,
+                                   const int k, int i, int j, float *row) {
+    int c, ki;
+    for (c = 0; c < channels; c++) {
+        for (ki = 0; ki < k; ki++) {
+            memcpy(row, in + ((size_t)c * size + i + ki) * size + j, sizeof(float) * k);
+            row += k;
+        }
+    }
+}
+
+/* Opération inverse en accumulant: d_in[c][i + ki][j + kj] += drow[...] */
+TOPO_SPECIALIZE void row_to_window_add(const float *drow, const int channels, const int size,
+                                       const int k, int i, int j, float *d_in) {
+    int c, ki, kj;
+    for (c = 0; c < channels; c++) {
+        float *dst = d_in + ((size_t)c * size + i) * size + j;
+        for (ki = 0; ki < k; ki++) {
+            for (kj = 0; kj < k; kj++) dst[(size_t)ki * size + kj] += *drow++;
+        }
+    }
+}
+
+/* Chaque position active d'au moins un filtre reçoit une ligne (slot):
+ * sa fenêtre dans row, le gradient de sa fenêtre dans drow. Pour chaque
+ * position active d'un filtre f (gradient g): dW[f] += g * fenêtre et
+ * drow += g * W[f], deux boucles contiguës de C * K * K éléments. Les
+ * fenêtres des positions sans gradient ne sont jamais lues. */
+TOPO_SPECIALIZE void conv2_backward_act(const float *w, const float *in, const ConvActive *act,
+                                        float *dw, float *db, float *d_in,
+                                        float *row, float *drow, int *slot, int *used,
+                                        const int F, const int C, const int K, const int P) {
+    const int O = P - K + 1, KK = C * K * K;
+    int f, e, k, n_used = 0;
+    for (e = 0; e < O * O; e++) slot[e] = -1;
+    for (f = 0; f < F; f++) {
+        const float *restrict wf = w + (size_t)f * KK;
+        float *restrict dwf = dw + (size_t)f * KK;
+        float sum = 0.0f;
+        for (e = act->start[f]; e < act->start[f + 1]; e++) {
+            const int p = act->pos[e];
+            const float g = act->grad[e];
+            if (slot[p] < 0) {
+                slot[p] = n_used;
+                used[n_used] = p;
+                window_to_row(in, C, P, K, p / O, p % O, row + (size_t)n_used * KK);
+                memset(drow + (size_t)n_used * KK, 0, sizeof(float) * KK);
+                n_used++;
+            }
+            const float *restrict x = row + (size_t)slot[p] * KK;
+            float *restrict dx = drow + (size_t)slot[p] * KK;
+            sum += g;
+            for (k = 0; k < KK; k++) dwf[k] += g * x[k];
+            for (k = 0; k < KK; k++) dx[k] += g * wf[k];
+        }
+        db[f] += sum;
+    }
+    memset(d_in, 0, sizeof(float) * C * P * P);
+    for (e = 0; e < n_used; e++) {
+        row_to_window_add(drow + (size_t)e * KK, C, P, K, used[e] / O, used[e] % O, d_in);
+    }
+}
+
+TOPO_SPECIALIZE void conv1_backward_act(const float *in, const ConvActive *act, float *dw,
+                                        float *db, const int F, const int K) {
+    const int O = IMG_SIZE - K + 1;
+    int f, e, ki, kj;
+    for (f = 0; f < F; f++) {
+        float *restrict dwf = dw + (size_t)f * K * K;
+        float sum = 0.0f;
+        for (e = act->start[f]; e < act->start[f + 1]; e++) {
+            const float g = act->grad[e];
+            const float *x = in + (size_t)(act->pos[e] / O) * IMG_SIZE + act->pos[e] % O;
+            sum += g;
+            for (ki = 0; ki < K; ki++) {
+                for (kj = 0; kj < K; kj++) dwf[ki * K + kj] += g * x[ki * IMG_SIZE + kj];
+            }
+        }
+        db[f] += sum;
+    }
+}
+
+/* ============================================================
+ * CONVOLUTION + RELU + POOLING FUSIONNÉS (inférence)
+ * ============================================================ */
+
+/* Par bandes de CONV_FUSED_BAND lignes de sortie du pooling: im2col des
+ * lignes de convolution correspondantes, GEMM dans ws->rows[filters][2*nb][out],
+ * puis ReLU + max 2x2 directement vers dst[filters][pooled][pooled]. Chaque
+ * élément de la convolution est la même somme, dans le même ordre, que
+ * dans le GEMM complet: le résultat est identique au chemin séparé. */
+TOPO_SPECIALIZE void conv_relu_pool(const float *w, const float *bias, const float *in,
+                                    int filters, int channels, int size, int k, int pooled,
+                                    float *dst, ConvFusedWorkspace *ws) {
+    int out = size - k + 1;
+    int K = channels * k * k;
+    int i, f;
+    for (i = 0; i < pooled; i += CONV_FUSED_BAND) {
+        int nb = pooled - i < CONV_FUSED_BAND ? pooled - i : CONV_FUSED_BAND;
+        int cols = 2 * nb * out;
+        im2col(in, channels, size, k, 2 * i, 2 * nb, ws->col);
+        fill_bias(ws->rows, bias, filters, cols);
+        sgemm(0, 0, filters, cols, K, w, K, ws->col, cols, 1.0f, ws->rows, cols, ws->pack);
+        for (f = 0; f < filters; f++) {
+            simd->relu_pool2x2(ws->rows + (size_t)f * cols, out, nb, pooled,
+                               dst + ((size_t)f * pooled + i) * pooled);
+        }
+    }
+}
+
+/* ============================================================
+ * WINOGRAD F(2x2, 3x3) (CONV2, inférence)
+ * ============================================================ */
+
+/* U = G g G^T pour chaque filtre et chaque canal, avec
+ * G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1], rangé comme les panneaux A
+ * de simd->gemm_4x16: u[x][f / 4][c][f % 4] (filtres complétés par des 0
+ * jusqu'à un multiple de 4) */
+Conv2Winograd *conv2_winograd_build(const CNN *net) {
+    const Topology *t = &net->topo;
+    if (t->conv2_size != 3) return NULL;
+    Conv2Winograd *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->filters = t->conv2_filters;
+    w->channels = t->conv1_filters;
+    w->rows = (w->filters + 3) & ~3;
+    size_t plane = (size_t)w->rows * w->channels;
+    if (arena_init(&w->arena, sizeof(float) * CONV_WINO_POINTS * plane) != 0) {
+        free(w);
+        return NULL;
+    }
+    w->u = arena_alloc(&w->arena, sizeof(float) * CONV_WINO_POINTS * plane);
+
+    int f, c, a, b;
+    for (f = 0; f < w->filters; f++) {
+        for (c = 0; c < w->channels; c++) {
+            const float *g = net->conv2_weights + ((size_t)f * w->channels + c) * 9;
+            float gg[4][3];
+            for (b = 0; b < 3; b++) {
+                gg[0][b] = g[b];
+                gg[1][b] = 0.5f * (g[b] + g[3 + b] + g[6 + b]);
+                gg[2][b] = 0.5f * (g[b] - g[3 + b] + g[6 + b]);
+                gg[3][b] = g[6 + b];
+            }
+            float *u = w->u + ((size_t)(f / 4) * w->channels + c) * 4 + f % 4;
+            for (a = 0; a < 4; a++) {
+                u[(4 * a) * plane] = gg[a][0];
+                u[(4 * a + 1) * plane] = 0.5f * (gg[a][0] + gg[a][1] + gg[a][2]);
+                u[(4 * a + 2) * plane] = 0.5f * (gg[a][0] - gg[a][1] + gg[a][2]);
+                u[(4 * a + 3) * plane] = gg[a][2];
+            }
+        }
+    }
+    return w;
+}
+
+void conv2_winograd_free(Conv2Winograd *w) {
+    if (!w) return;
+    arena_free(&w->arena);
+    free(w);
+}
+
+/* V = B^T d B des nt tuiles à partir de la tuile t0 (tc tuiles par ligne),
+ * la tuile (i, j) lisant in[c][2i..2i+3][2j..2j+3] (0 hors de l'entrée),
+ * avec B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1]. Rangé comme les
+ * panneaux B de simd->gemm_4x16: v[x][t / 16][c][t % 16], les colonnes
+ * au-delà de nt à 0. */
+TOPO_SPECIALIZE void wino_input(const float *in, const int C, const int P, int t0, int nt,
+                                int tc, float *v) {
+    const int panels = (nt + CONV_WINO_NR - 1) / CONV_WINO_NR;
+    const size_t stride = (size_t)panels * C * CONV_WINO_NR;
+    int c, k, a, b;
+    if (nt % CONV_WINO_NR) memset(v, 0, sizeof(float) * CONV_WINO_POINTS * stride);
+    for (c = 0; c < C; c++) {
+        const float *src = in + (size_t)c * P * P;
+        for (k = 0; k < nt; k++) {
+            const int r0 = 2 * ((t0 + k) / tc), c0 = 2 * ((t0 + k) % tc);
+            float d[4][4], m[4][4];
+            if (r0 + 4 <= P && c0 + 4 <= P) {
+                for (a = 0; a < 4; a++) {
+                    for (b = 0; b < 4; b++) d[a][b] = src[(r0 + a) * P + c0 + b];
+                }
+            } else {
+                for (a = 0; a < 4; a++) {
+                    for (b = 0; b < 4; b++) {
+                        d[a][b] = r0 + a < P && c0 + b < P ? src[(r0 + a) * P + c0 + b] : 0.0f;
+                    }
+                }
+            }
+            for (b = 0; b < 4; b++) {
+                m[0][b] = d[0][b] - d[2][b];
+                m[1][b] = d[1][b] + d[2][b];
+                m[2][b] = d[2][b] - d[1][b];
+                m[3][b] = d[1][b] - d[3][b];
+            }
+            float *dst = v + ((size_t)(k / CONV_WINO_NR) * C + c) * CONV_WINO_NR +
+                         k % CONV_WINO_NR;
+            for (a = 0; a < 4; a++) {
+                dst[(4 * a) * stride] = m[a][0] - m[a][2];
+                dst[(4 * a + 1) * stride] = m[a][1] + m[a][2];
+                dst[(4 * a + 2) * stride] = m[a][2] - m[a][1];
+                dst[(4 * a + 3) * stride] = m[a][1] - m[a][3];
+            }
+        }
+    }
+}
+
+/* m[x][R][16 * panels] = u[x] x v[x] pour chacun des 16 points, directement
+ * par le micro-noyau (u et v sont déjà empaquetés) */
+TOPO_SPECIALIZE void wino_multiply(const float *u, const int R, const int C, int nt,
+                                   const float *v, float *m) {
+    const int panels = (nt + CONV_WINO_NR - 1) / CONV_WINO_NR, ldc = panels * CONV_WINO_NR;
+    int x, f, p;
+    memset(m, 0, sizeof(float) * CONV_WINO_POINTS * R * ldc);
+    for (x = 0; x < CONV_WINO_POINTS; x++) {
+        const float *ux = u + (size_t)x * R * C;
+        const float *vx = v + (size_t)x * C * ldc;
+        float *mx = m + (size_t)x * R * ldc;
+        for (f = 0; f < R; f += 4) {
+            for (p = 0; p < panels; p++) {
+                simd->gemm_4x16(C, ux + (size_t)f * C, vx + (size_t)p * C * CONV_WINO_NR,
+                                mx + (size_t)f * ldc + p * CONV_WINO_NR, ldc);
+            }
+        }
+    }
+}
+
+/* Sorties 2x2 de la tuile k du filtre f: y = A^T m A, avec
+ * A^T = [1 1 1 0; 0 1 -1 -1] */
+TOPO_SPECIALIZE void wino_output(const float *m, const int R, int ldc, int f, int k,
+                                 float y[2][2]) {
+    const float *p = m + (size_t)f * ldc + k;
+    const size_t s = (size_t)R * ldc;
+    float r[2][4];
+    int a, b;
+    for (b = 0; b < 4; b++) {
+        r[0][b] = p[b * s] + p[(4 + b) * s] + p[(8 + b) * s];
+        r[1][b] = p[(4 + b) * s] - p[(8 + b) * s] - p[(12 + b) * s];
+    }
+    for (a = 0; a < 2; a++) {
+        y[a][0] = r[a][0] + r[a][1] + r[a][2];
+        y[a][1] = r[a][1] - r[a][2] - r[a][3];
+    }
+}
+
+/* Tuiles des pooled x pooled fenêtres de Pool2 seulement, par groupes de
+ * CONV_WINO_TILES: ReLU et max 2x2 sur les sorties de chaque tuile */
+TOPO_SPECIALIZE void conv2_relu_pool_wino(const float *u, const float *bias, const float *in,
+                                          const int F, const int C, const int P,
+                                          const int pooled, float *dst,
+                                          ConvFusedWorkspace *ws) {
+    const int R = (F + 3) & ~3, total = pooled * pooled;
+    int t0, f, k;
+    for (t0 = 0; t0 < total; t0 += CONV_WINO_TILES) {
+        int nt = total - t0 < CONV_WINO_TILES ? total - t0 : CONV_WINO_TILES;
+        int ldc = (nt + CONV_WINO_NR - 1) / CONV_WINO_NR * CONV_WINO_NR;
+        wino_input(in, C, P, t0, nt, pooled, ws->wino_v);
+        wino_multiply(u, R, C, nt, ws->wino_v, ws->wino_m);
+        for (f = 0; f < F; f++) {
+            float *out = dst + (size_t)f * total + t0;
+            for (k = 0; k < nt; k++) {
+                float y[2][2];
+                wino_output(ws->wino_m, R, ldc, f, k, y);
+                float v = y[0][0];
+                if (y[0][1] > v) v = y[0][1];
+                if (y[1][0] > v) v = y[1][0];
+                if (y[1][1] > v) v = y[1][1];
+                v += bias[f];
+                out[k] = v > 0.0f ? v : 0.0f;
+            }
+        }
+    }
+}
+
+/* Sortie complète [F][O][O] (la dernière tuile d'une ligne impaire est
+ * coupée) */
+TOPO_SPECIALIZE void conv2_forward_wino(const float *u, const float *bias, const float *in,
+                                        const int F, const int C, const int P,
+                                        float *out, ConvFusedWorkspace *ws) {
+    const int O = P - 2, tc = (O + 1) / 2, total = tc * tc, R = (F + 3) & ~3;
+    int t0, f, k, a, b;
+    for (t0 = 0; t0 < total; t0 += CONV_WINO_TILES) {
+        int nt = total - t0 < CONV_WINO_TILES ? total - t0 : CONV_WINO_TILES;
+        int ldc = (nt + CONV_WINO_NR - 1) / CONV_WINO_NR * CONV_WINO_NR;
+        wino_input(in, C, P, t0, nt, tc, ws->wino_v);
+        wino_multiply(u, R, C, nt, ws->wino_v, ws->wino_m);
+        for (f = 0; f < F; f++) {
+            for (k = 0; k < nt; k++) {
+                const int i = 2 * ((t0 + k) / tc), j = 2 * ((t0 + k) % tc);
+                float y[2][2];
+                wino_output(ws->wino_m, R, ldc, f, k, y);
+                for (a = 0; a < 2 && i + a < O; a++) {
+                    for (b = 0; b < 2 && j + b < O; b++) {
+                        out[((size_t)f * O + i + a) * O + j + b] = y[a][b] + bias[f];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* ============================================================
+ * POINTS D'ENTRÉE
+ * ============================================================ */
+
+void conv1_forward(const CNN *net, const float *in, float *out, ConvWorkspace *ws) {
+    const Topology *t = &net->topo;
+    const float *w = net->conv1_weights, *b = net->conv1_bias;
+    if (conv_engine == CONV_DIRECT) {
+        TOPO_DISPATCH(t, conv1_forward_direct(w, b, in, out, CONV1_FILTERS, CONV1_SIZE),
+                      conv1_forward_direct(w, b, in, out, t->conv1_filters, t->conv1_size));
+    } else {
+        TOPO_DISPATCH(t, conv1_forward_gemm(w, b, in, out, ws->col, ws->pack, CONV1_FILTERS,
+                                            CONV1_SIZE),
+                      conv1_forward_gemm(w, b, in, out, ws->col, ws->pack, t->conv1_filters,
+                                         t->conv1_size));
+    }
+}
+
+void conv2_forward(const CNN *net, const float *in, float *out, ConvWorkspace *ws) {
+    const Topology *t = &net->topo;
+    const float *w = net->conv2_weights, *b = net->conv2_bias;
+    if (conv_engine == CONV_DIRECT) {
+        TOPO_DISPATCH(t, conv2_forward_direct(w, b, in, out, CONV2_FILTERS, CONV1_FILTERS,
+                                              CONV2_SIZE, AFTER_POOL1),
+                      conv2_forward_direct(w, b, in, out, t->conv2_filters, t->conv1_filters,
+                                           t->conv2_size, t->after_pool1));
+    } else {
+        TOPO_DISPATCH(t, conv2_forward_gemm(w, b, in, out, ws->col, ws->pack, CONV2_FILTERS,
+                                            CONV1_FILTERS, CONV2_SIZE, AFTER_POOL1),
+                      conv2_forward_gemm(w, b, in, out, ws->col, ws->pack, t->conv2_filters,
+                                         t->conv1_filters, t->conv2_size, t->after_pool1));
+    }
+}
+
+void conv1_relu_pool(const Topology *t, const float *w, const float *bias,
+                     const float *in, float *out, ConvFusedWorkspace *ws) {
+    TOPO_DISPATCH(t, conv_relu_pool(w, bias, in, CONV1_FILTERS, 1, IMG_SIZE, CONV1_SIZE,
+                                    AFTER_POOL1, out, ws),
+                  conv_relu_pool(w, bias, in, t->conv1_filters, 1, IMG_SIZE, t->conv1_size,
+                                 t->after_pool1, out, ws));
+}
+
+void conv2_relu_pool(const Topology *t, const float *w, const float *bias,
+                     const float *in, float *out, ConvFusedWorkspace *ws) {
+    TOPO_DISPATCH(t, conv_relu_pool(w, bias, in, CONV2_FILTERS, CONV1_FILTERS, AFTER_POOL1,
+                                    CONV2_SIZE, AFTER_POOL2, out, ws),
+                  conv_relu_pool(w, bias, in, t->conv2_filters, t->conv1_filters,
+                                 t->after_pool1, t->conv2_size, t->after_pool2, out, ws));
+}
+
+void conv2_relu_pool_winograd(const Topology *t, const Conv2Winograd *w, const float *bias,
+                              const float *in, float *out, ConvFusedWorkspace *ws) {
+    TOPO_DISPATCH(t, conv2_relu_pool_wino(w->u, bias, in, CONV2_FILTERS, CONV1_FILTERS,
+                                          AFTER_POOL1, AFTER_POOL2, out, ws),
+                  conv2_relu_pool_wino(w->u, bias, in, w->filters, w->channels, t->after_pool1,
+                                       t->after_pool2, out, ws));
+}
+
+void conv2_forward_winograd(const Topology *t, const Conv2Winograd *w, const float *bias,
+                            const float *in, float *out, ConvFusedWorkspace *ws) {
+    TOPO_DISPATCH(t, conv2_forward_wino(w->u, bias, in, CONV2_FILTERS, CONV1_FILTERS,
+                                        AFTER_POOL1, out, ws),
+                  conv2_forward_wino(w->u, bias, in, w->filters, w->channels, t->after_pool1,
+                                     out, ws));
+}
+
+void conv2_backward(const CNN *net, const float *in, const float *d_out,
+                    float *dw, float *db, float *d_in, ConvWorkspace *ws) {
+    const Topology *t = &net->topo;
+    const float *w = net->conv2_weights;
+    if (conv_engine == CONV_DIRECT) {
+        TOPO_DISPATCH(t, conv2_backward_direct(w, in, d_out, dw, db, d_in, CONV2_FILTERS,
+                                               CONV1_FILTERS, CONV2_SIZE, AFTER_POOL1),
+                      conv2_backward_direct(w, in, d_out, dw, db, d_in, t->conv2_filters,
+                                            t->conv1_filters, t->conv2_size, t->after_pool1));
+    } else {
+        TOPO_DISPATCH(t, conv2_backward_gemm(w, in, d_out, dw, db, d_in, ws->col, ws->dcol,
+                                             ws->pack, CONV2_FILTERS, CONV1_FILTERS, CONV2_SIZE,
+                                             AFTER_POOL1),
+                      conv2_backward_gemm(w, in, d_out, dw, db, d_in, ws->col, ws->dcol,
+                                          ws->pack, t->conv2_filters, t->conv1_filters,
+                                          t->conv2_size, t->after_pool1));
+    }
+}
+
+void conv2_backward_active(const CNN *net, const float *in, const ConvActive *act,
+                           float *dw, float *db, float *d_in, ConvWorkspace *ws) {
+    const Topology *t = &net->topo;
+    const float *w = net->conv2_weights;
+    TOPO_DISPATCH(t, conv2_backward_act(w, in, act, dw, db, d_in, ws->col, ws->dcol,
+                                        ws->slot, ws->used, CONV2_FILTERS, CONV1_FILTERS,
+                                        CONV2_SIZE, AFTER_POOL1),
+                  conv2_backward_act(w, in, act, dw, db, d_in, ws->col, ws->dcol,
+                                     ws->slot, ws->used, t->conv2_filters, t->conv1_filters,
+                                     t->conv2_size, t->after_pool1));
+}
+
+void conv1_backward_active(const Topology *t, const float *in, const ConvActive *act,
+                           float *dw, float *db) {
+    TOPO_DISPATCH(t, conv1_backward_act(in, act, dw, db, CONV1_FILTERS, CONV1_SIZE),
+                  conv1_backward_act(in, act, dw, db, t->conv1_filters, t->conv1_size));
+}
+
+void conv1_backward(const Topology *t, const float *in, const float *d_out,
+                    float *dw, float *db, ConvWorkspace *ws) {
+    if (conv_engine == CONV_DIRECT) {
+        TOPO_DISPATCH(t, conv1_backward_direct(in, d_out, dw, db, CONV1_FILTERS, CONV1_SIZE),
+                      conv1_backward_direct(in, d_out, dw, db, t->conv1_filters,
+                                            t->conv1_size));
+    } else {
+        TOPO_DISPATCH(t, conv1_backward_gemm(in, d_out, dw, db, ws->col, ws->pack, CONV1_FILTERS,
+                                             CONV1_SIZE),
+                      conv1_backward_gemm(in, d_out, dw, db, ws->col, ws->pack, t->conv1_filters,
+                                          t->conv1_size));
+    }
+}
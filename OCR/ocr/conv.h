@@ -0,0 +1,134 @@
+#ifndef CONV_H
+#define CONV_H
+
+#include "cnn.h"
+#include "topology.h"
+
+/*
+ * Couches convolutives CONV1 et CONV2 (propagation avant et arrière).
+ *
+ * Deux moteurs, choisis à l'exécution par conv_engine:
+ *  - CONV_DIRECT: boucles imbriquées d'origine;
+ *  - CONV_GEMM:   im2col (chaque fenêtre devient une colonne) puis produit
+ *                 matriciel par blocs sgemm(), partagé par l'avant et
+ *                 l'arrière.
+ * Les deux donnent les mêmes résultats à l'arrondi près. L'inférence peut
+ * en plus faire CONV2 par Winograd (filtres transformés au chargement,
+ * option --winograd), voir plus bas.
+ */
+
+typedef enum {
+    CONV_DIRECT,
+    CONV_GEMM
+} ConvEngine;
+
+extern ConvEngine conv_engine;
+
+/* Positions de la sortie d'une convolution qui reçoivent un gradient: le
+ * max de leur fenêtre de pooling, où la ReLU est active. Pour le filtre f,
+ * entrées start[f] à start[f + 1] - 1 de pos (i * out + j) et grad. */
+typedef struct {
+    int *start;                 /* [filtres + 1] */
+    int *pos;                   /* [filtres][pooled][pooled] au plus */
+    float *grad;
+} ConvActive;
+
+/* Tampons im2col d'un thread: col[K][colonnes] pour la plus grande des
+ * deux couches, dcol pour le gradient des colonnes de CONV2. Pour la
+ * propagation arrière creuse: positions actives de chaque couche, et
+ * ligne de col / dcol attribuée à chaque position de CONV2 */
+typedef struct {
+    float *col;
+    float *dcol;
+    ConvActive active1, active2;
+    int *slot;                  /* [conv2_out * conv2_out], -1: pas de ligne */
+    int *used;                  /* [conv2_out * conv2_out] position de chaque ligne */
+    float *pack;                /* [GEMM_PACK_FLOATS] tampons de sgemm() */
+} ConvWorkspace;
+
+/* Version fusionnée: nombre de lignes de sortie du pooling calculées à la
+ * fois (2 * CONV_FUSED_BAND lignes de convolution) */
+#define CONV_FUSED_BAND 4
+
+typedef struct {
+    float *col;
+    float *rows;
+    float *wino_v;              /* [16][CONV_WINO_TILES / 16][conv1_filters][16]: B^T d B */
+    float *wino_m;              /* [16][filtres arrondis à 4][CONV_WINO_TILES]: U x V */
+    float *pack;                /* [GEMM_PACK_FLOATS] tampons de sgemm() */
+} ConvFusedWorkspace;
+
+/* Winograd F(2x2, 3x3) pour CONV2 (noyaux 3x3 seulement): chaque tuile
+ * d'entrée 4x4 donne 2x2 sorties, avec 16 multiplications par canal au
+ * lieu de 36. Les filtres transformés U = G g G^T sont calculés une fois
+ * au chargement du modèle; pour chacun des 16 points de la tuile, la
+ * somme sur les canaux est un produit U[filtres][canaux] x V[canaux][tuiles]
+ * fait par simd->gemm_4x16 sur des panneaux préparés directement par les
+ * transformations (sans la recopie de sgemm(), coûteuse sur des matrices
+ * aussi petites). Une tuile 2x2 est exactement une fenêtre de Pool2:
+ * la version fusionnée ne calcule que les sorties utiles au pooling.
+ * Les transformations changent l'ordre des opérations: l'écart avec les
+ * boucles directes est de l'ordre de l'arrondi (voir bench-conv). */
+#define CONV_WINO_POINTS 16
+#define CONV_WINO_NR 16         /* colonnes d'un panneau (GEMM_NR) */
+#define CONV_WINO_TILES 32      /* tuiles transformées à la fois */
+
+typedef struct Conv2Winograd {
+    int filters, channels;
+    int rows;                   /* filters arrondi au multiple de 4 */
+    float *u;                   /* [CONV_WINO_POINTS][rows / 4][channels][4] */
+    Arena arena;
+} Conv2Winograd;
+
+/* Filtres transformés de CONV2, NULL si les noyaux ne sont pas 3x3 ou si
+ * l'allocation échoue. À refaire si les poids changent. */
+Conv2Winograd *conv2_winograd_build(const CNN *net);
+void conv2_winograd_free(Conv2Winograd *w);
+
+/* Découpe les tampons pour la topologie t dans l'arène a (voir topology.h:
+ * un premier passage sur une arène de mesure donne la taille) */
+void conv_workspace_carve(ConvWorkspace *ws, const Topology *t, Arena *a);
+void conv_fused_workspace_carve(ConvFusedWorkspace *ws, const Topology *t, Arena *a);
+
+/* out = conv(in) + biais (avant ReLU).
+ * in: [IMG_SIZE][IMG_SIZE], out: [conv1_filters][conv1_out][conv1_out] */
+void conv1_forward(const CNN *net, const float *in, float *out, ConvWorkspace *ws);
+/* in: [conv1_filters][after_pool1][after_pool1],
+ * out: [conv2_filters][conv2_out][conv2_out] */
+void conv2_forward(const CNN *net, const float *in, float *out, ConvWorkspace *ws);
+
+/* Inférence seule: convolution, ReLU et max-pooling 2x2 en une passe, sans
+ * matérialiser la sortie de la convolution ni les indices du max.
+ * Toujours par im2col + GEMM, résultat identique au moteur CONV_GEMM.
+ * conv1_relu_pool écrit [conv1_filters][after_pool1][after_pool1],
+ * conv2_relu_pool le vecteur aplati [conv2_filters][after_pool2][after_pool2]. */
+void conv1_relu_pool(const Topology *t, const float *w, const float *bias,
+                     const float *in, float *out, ConvFusedWorkspace *ws);
+void conv2_relu_pool(const Topology *t, const float *w, const float *bias,
+                     const float *in, float *out, ConvFusedWorkspace *ws);
+
+/* Mêmes sorties que conv2_relu_pool() et conv2_forward(), par Winograd */
+void conv2_relu_pool_winograd(const Topology *t, const Conv2Winograd *w, const float *bias,
+                              const float *in, float *out, ConvFusedWorkspace *ws);
+void conv2_forward_winograd(const Topology *t, const Conv2Winograd *w, const float *bias,
+                            const float *in, float *out, ConvFusedWorkspace *ws);
+
+/* Ajoute les gradients des poids/biais dans dw/db et écrit dans d_in le
+ * gradient par rapport à l'entrée (écrasé); formes de conv2_forward() */
+void conv2_backward(const CNN *net, const float *in, const float *d_out,
+                    float *dw, float *db, float *d_in, ConvWorkspace *ws);
+
+/* CONV1 est la première couche: seul le gradient des poids est utile */
+void conv1_backward(const Topology *t, const float *in, const float *d_out,
+                    float *dw, float *db, ConvWorkspace *ws);
+
+/* Propagation arrière creuse: le gradient de la sortie n'est non nul
+ * qu'aux positions de act (liste remplie par l'appelant), seules
+ * parcourues. Mêmes gradients que conv2_backward() / conv1_backward() à
+ * l'arrondi près (autre ordre d'addition). */
+void conv2_backward_active(const CNN *net, const float *in, const ConvActive *act,
+                           float *dw, float *db, float *d_in, ConvWorkspace *ws);
+void conv1_backward_active(const Topology *t, const float *in, const ConvActive *act,
+                           float *dw, float *db);
+
+#endif
@@ -0,0 +1,350 @@
+/*
+ * Jeu d'entraînement compacté et mappé en mémoire, voir dataset.h
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dataset.h"
+#include "model_bin.h"
+#include "thread_pool.h"
+
+#define IMG_PIXELS (IMG_SIZE * IMG_SIZE)
+#define BITS_STRIDE ((IMG_PIXELS + 7) / 8)
+
+_Static_assert(sizeof(DatasetHeader) <= DATASET_HEADER_SIZE, "en-tête letters.pack trop grand");
+_Static_assert(DATASET_HEADER_SIZE % 64 == 0, "les étiquettes commencent sur 64 octets");
+_Static_assert(sizeof(DATASET_MAGIC) == 9, "DATASET_MAGIC doit faire 8 octets");
+
+static size_t labels_size(size_t count) {
+    return (count + 63) & ~(size_t)63;
+}
+
+static size_t fonts_size(size_t count) {
+    return (count * sizeof(uint16_t) + 63) & ~(size_t)63;
+}
+
+/* ============================================================
+ * DOSSIER SOURCE
+ * ============================================================ */
+
+static int64_t mtime_ns(const struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+/* Chemin absolu de data_dir dans source ("" s'il ne tient pas) */
+static void source_path(const char *data_dir, char source[DATASET_SOURCE_MAX]) {
+    char path[PATH_MAX];
+    memset(source, 0, DATASET_SOURCE_MAX);
+    if (realpath(data_dir, path) && strlen(path) < DATASET_SOURCE_MAX) {
+        strcpy(source, path);
+    }
+}
+
+/* Date de modification la plus récente du dossier, de ses sous-dossiers
+ * de lettres et des images qu'ils contiennent */
+static int64_t source_newest(const char *data_dir) {
+    char path[512];
+    struct stat st;
+    int64_t newest = stat(data_dir, &st) == 0 ? mtime_ns(&st) : 0;
+    int letter, sample;
+    for (letter = 0; letter < NUM_CLASSES; letter++) {
+        snprintf(path, sizeof(path), "%s/%c", data_dir, 'A' + letter);
+        if (stat(path, &st) != 0) continue;
+        if (mtime_ns(&st) > newest) newest = mtime_ns(&st);
+        for (sample = 0; sample < SAMPLES_PER_LETTER; sample++) {
+            snprintf(path, sizeof(path), "%s/%c/%c_%03d.pbm",
+                     data_dir, 'A' + letter, 'A' + letter, sample);
+            if (stat(path, &st) == 0 && mtime_ns(&st) > newest) newest = mtime_ns(&st);
+        }
+    }
+    return newest;
+}
+
+/* ============================================================
+ * COMPACTAGE
+ * ============================================================ */
+
+typedef struct {
+    const char *data_dir;
+    uint8_t *pixels;            /* une image u8 par échantillon possible */
+    uint8_t *present;           /* 0 si absente ou illisible */
+    uint8_t *binary;            /* 1 si tous les pixels valent 0 ou 1 */
+} PackJob;
+
+static void pack_read_task(void *ctx, int idx, int worker) {
+    PackJob *job = ctx;
+    float img[IMG_SIZE][IMG_SIZE];
+    char path[512];
+    struct stat st;
+    int letter = idx / SAMPLES_PER_LETTER;
+    int sample = idx % SAMPLES_PER_LETTER;
+    int i, j;
+    (void)worker;
+
+    snprintf(path, sizeof(path), "%s/%c/%c_%03d.pbm",
+             job->data_dir, 'A' + letter, 'A' + letter, sample);
+    if (stat(path, &st) != 0 || read_pbm(path, img) != 0) return;
+
+    uint8_t *dst = job->pixels + (size_t)idx * IMG_PIXELS;
+    int binary = 1;
+    for (i = 0; i < IMG_SIZE; i++) {
+        for (j = 0; j < IMG_SIZE; j++) {
+            float v = img[i][j];
+            v = v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+            uint8_t p = (uint8_t)(v * 255.0f + 0.5f);
+            binary &= p == 0 || p == 255;
+            dst[i * IMG_SIZE + j] = p;
+        }
+    }
+    job->binary[idx] = (uint8_t)binary;
+    job->present[idx] = 1;
+}
+
+static void pack_bits(const uint8_t *src, uint8_t *dst) {
+    int p;
+    memset(dst, 0, BITS_STRIDE);
+    for (p = 0; p < IMG_PIXELS; p++) {
+        if (src[p]) dst[p >> 3] |= (uint8_t)(0x80 >> (p & 7));
+    }
+}
+
+int dataset_pack(const char *data_dir, const char *filename, int threads) {
+    int total = NUM_CLASSES * SAMPLES_PER_LETTER;
+    int idx, count = 0, binary = 1;
+    PackJob job = { data_dir, malloc((size_t)total * IMG_PIXELS),
+                    calloc(total, 1), calloc(total, 1) };
+    if (!job.pixels || !job.present || !job.binary) {
+        printf("Erreur: mémoire insuffisante\n");
+        free(job.pixels);
+        free(job.present);
+        free(job.binary);
+        return -1;
+    }
+
+    double t0 = now_seconds();
+    /* Avant la lecture: une image modifiée pendant le compactage rend le
+     * fichier périmé au lieu de passer inaperçue */
+    int64_t newest = source_newest(data_dir);
+    parallel_for(total, threads, pack_read_task, &job);
+    for (idx = 0; idx < total; idx++) {
+        if (!job.present[idx]) continue;
+        count++;
+        binary &= job.binary[idx];
+    }
+    if (count == 0) {
+        printf("Erreur: aucune image dans %s\n", data_dir);
+        free(job.pixels);
+        free(job.present);
+        free(job.binary);
+        return -1;
+    }
+
+    /* Corps complet en mémoire: étiquettes, polices puis pixels compactés */
+    size_t stride = binary ? BITS_STRIDE : IMG_PIXELS;
+    size_t lsize = labels_size((size_t)count);
+    size_t fsize = fonts_size((size_t)count);
+    size_t body = lsize + fsize + (size_t)count * stride;
+    uint8_t *buf = calloc(body, 1);
+    if (!buf) {
+        printf("Erreur: mémoire insuffisante\n");
+        free(job.pixels);
+        free(job.present);
+        free(job.binary);
+        return -1;
+    }
+    int k = 0;
+    for (idx = 0; idx < total; idx++) {
+        if (!job.present[idx]) continue;
+        const uint8_t *src = job.pixels + (size_t)idx * IMG_PIXELS;
+        uint8_t *dst = buf + lsize + fsize + (size_t)k * stride;
+        uint16_t font = (uint16_t)(idx % SAMPLES_PER_LETTER);
+        buf[k] = (uint8_t)(idx / SAMPLES_PER_LETTER);
+        memcpy(buf + lsize + (size_t)k * sizeof(font), &font, sizeof(font));
+        if (binary) {
+            pack_bits(src, dst);
+        } else {
+            memcpy(dst, src, IMG_PIXELS);
+        }
+        k++;
+    }
+    free(job.pixels);
+    free(job.present);
+    free(job.binary);
+
+    unsigned char header[DATASET_HEADER_SIZE];
+    DatasetHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DATASET_MAGIC, sizeof(h.magic));
+    h.version = DATASET_VERSION;
+    h.endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h.img_size = IMG_SIZE;
+    h.num_classes = NUM_CLASSES;
+    h.format = binary ? DATASET_BITS : DATASET_U8;
+    h.count = (uint32_t)count;
+    h.num_fonts = SAMPLES_PER_LETTER;
+    h.stride = stride;
+    h.pixels_offset = DATASET_HEADER_SIZE + lsize + fsize;
+    h.checksum = model_bin_checksum(buf, body);
+    h.source_mtime = newest;
+    source_path(data_dir, h.source);
+    memset(header, 0, sizeof(header));
+    memcpy(header, &h, sizeof(h));
+
+    /* Renommé à la fin: un entraînement qui a mappé l'ancien fichier le garde */
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        printf("Erreur: impossible d'écrire %s\n", tmp);
+        free(buf);
+        return -1;
+    }
+    int ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(buf, 1, body, fp) == body;
+    ok &= fclose(fp) == 0;
+    free(buf);
+    if (!ok || rename(tmp, filename) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        remove(tmp);
+        return -1;
+    }
+
+    printf("%d images de %s compactées dans %s (%s, %zu octets) en %.2f s\n",
+           count, data_dir, filename, binary ? "1 bit/pixel" : "1 octet/pixel",
+           sizeof(header) + body, now_seconds() - t0);
+    if (count < total) {
+        printf("Attention: %d images absentes ou illisibles ignorées\n", total - count);
+    }
+    return 0;
+}
+
+/* ============================================================
+ * LECTURE
+ * ============================================================ */
+
+int dataset_is_packed(const char *filename) {
+    DatasetHeader h;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(&h, 1, sizeof(h), fp);
+    fclose(fp);
+    if (n < sizeof(h.magic) + sizeof(h.version) ||
+        memcmp(h.magic, DATASET_MAGIC, sizeof(h.magic)) != 0) {
+        return 0;
+    }
+    return h.version > 0 ? (int)h.version : 1;
+}
+
+int dataset_is_current(const char *filename, const char *data_dir) {
+    DatasetHeader h;
+    char source[DATASET_SOURCE_MAX];
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(&h, 1, sizeof(h), fp);
+    fclose(fp);
+    if (n != sizeof(h) || memcmp(h.magic, DATASET_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != DATASET_VERSION) {
+        return 0;
+    }
+    source_path(data_dir, source);
+    return source[0] && memcmp(source, h.source, sizeof(source)) == 0 &&
+           source_newest(data_dir) == h.source_mtime;
+}
+
+int dataset_map(const char *filename, Dataset *ds) {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Erreur: impossible d'ouvrir %s\n", filename);
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < DATASET_HEADER_SIZE) {
+        printf("Erreur: %s est tronqué\n", filename);
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Erreur: mmap de %s impossible\n", filename);
+        return -1;
+    }
+
+    DatasetHeader h;
+    memcpy(&h, base, sizeof(h));
+    const char *err = NULL;
+    if (memcmp(h.magic, DATASET_MAGIC, sizeof(h.magic)) != 0) {
+        err = "n'est pas un jeu de données compacté";
+    } else if (h.version != DATASET_VERSION || h.endian_tag != MODEL_BIN_ENDIAN_TAG) {
+        err = "a une version ou un ordre d'octets non supporté";
+    } else if (h.img_size != IMG_SIZE || h.num_classes != NUM_CLASSES || h.count == 0 ||
+               h.num_fonts != SAMPLES_PER_LETTER ||
+               (h.format == DATASET_BITS ? h.stride != BITS_STRIDE :
+                h.format == DATASET_U8 ? h.stride != IMG_PIXELS : 1) ||
+               h.pixels_offset != DATASET_HEADER_SIZE + labels_size(h.count) + fonts_size(h.count)) {
+        err = "ne correspond pas au réseau compilé";
+    } else if (length != h.pixels_offset + (size_t)h.count * h.stride) {
+        err = "est tronqué";
+    } else if (model_bin_checksum((const uint8_t *)base + DATASET_HEADER_SIZE,
+                                  length - DATASET_HEADER_SIZE) != h.checksum) {
+        err = "a une somme de contrôle invalide";
+    }
+    if (err) {
+        printf("Erreur: %s %s\n", filename, err);
+        munmap(base, length);
+        return -1;
+    }
+
+    const uint8_t *labels = (const uint8_t *)base + DATASET_HEADER_SIZE;
+    const uint16_t *fonts = (const uint16_t *)(labels + labels_size(h.count));
+    uint32_t k;
+    for (k = 0; k < h.count; k++) {
+        if (labels[k] >= NUM_CLASSES || fonts[k] >= SAMPLES_PER_LETTER) {
+            printf("Erreur: %s contient une étiquette ou une police invalide\n", filename);
+            munmap(base, length);
+            return -1;
+        }
+    }
+
+    ds->base = base;
+    ds->length = length;
+    ds->count = (int)h.count;
+    ds->format = (int)h.format;
+    ds->stride = h.stride;
+    ds->labels = labels;
+    ds->fonts = fonts;
+    ds->pixels = (const uint8_t *)base + h.pixels_offset;
+    return 0;
+}
+
+void dataset_unmap(Dataset *ds) {
+    if (ds->base) {
+        munmap(ds->base, ds->length);
+    }
+    memset(ds, 0, sizeof(*ds));
+}
+
+void dataset_image(const Dataset *ds, int k, float img[IMG_SIZE][IMG_SIZE]) {
+    const uint8_t *src = ds->pixels + (size_t)k * ds->stride;
+    float *dst = &img[0][0];
+    int p;
+    if (ds->format == DATASET_BITS) {
+        for (p = 0; p < IMG_PIXELS; p++) {
+            dst[p] = (float)((src[p >> 3] >> (7 - (p & 7))) & 1);
+        }
+    } else {
+        for (p = 0; p < IMG_PIXELS; p++) {
+            dst[p] = (float)src[p] / 255.0f;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cnn.h"
+
+/*
+ * Jeu d'entraînement compacté (letters.pack).
+ *
+ * Les NUM_CLASSES x SAMPLES_PER_LETTER images PBM sont lues une seule fois
+ * et rangées dans un fichier contigu, mappé ensuite avec mmap: une époque
+ * ne fait plus aucune ouverture de fichier ni aucun fscanf.
+ *
+ *   [ en-tête DatasetHeader, DATASET_HEADER_SIZE octets           ]
+ *   [ étiquettes: count octets (0..NUM_CLASSES-1), complétés à 64 ]
+ *   [ pixels: count images de stride octets                       ]
+ *
+ * Si toutes les images sont noir et blanc (cas des PBM), chaque pixel tient
+ * sur un bit (DATASET_BITS, 313 octets par image), sinon sur un octet
+ * (DATASET_U8, valeur * 255 arrondie).
+ *
+ * L'en-tête garde le chemin absolu du dossier d'images et la date de
+ * modification la plus récente de ses images et de ses sous-dossiers
+ * (un ajout ou une suppression change celle du sous-dossier):
+ * dataset_is_current() dit si le fichier est encore à jour pour ce dossier.
+ */
+
+#define DATASET_MAGIC "CNNDATA\n"
+#define DATASET_VERSION 3
+#define DATASET_HEADER_SIZE 512
+#define DATASET_SOURCE_MAX 432
+#define DATASET_FILE "letters.pack"
+
+enum {
+    DATASET_BITS = 1,           /* 1 bit par pixel, poids fort en premier */
+    DATASET_U8 = 2              /* 1 octet par pixel */
+};
+
+typedef struct {
+    char magic[8];              /* DATASET_MAGIC */
+    uint32_t version;           /* DATASET_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint32_t img_size;
+    uint32_t num_classes;
+    uint32_t format;            /* DATASET_BITS ou DATASET_U8 */
+    uint32_t count;             /* nombre d'images */
+    uint32_t num_fonts;         /* SAMPLES_PER_LETTER */
+    uint32_t reserved;
+    uint64_t stride;            /* octets par image */
+    uint64_t pixels_offset;     /* début des pixels dans le fichier */
+    uint64_t checksum;          /* FNV-1a 64 bits de tout ce qui suit l'en-tête */
+    int64_t source_mtime;       /* date la plus récente du dossier source (ns) */
+    char source[DATASET_SOURCE_MAX]; /* chemin absolu du dossier source, "" si trop long */
+} DatasetHeader;
+
+/* Jeu de données mappé en mémoire (lecture seule) */
+typedef struct {
+    void *base;                 /* adresse renvoyée par mmap */
+    size_t length;              /* taille du mapping */
+    int count;
+    int format;
+    size_t stride;
+    const uint8_t *labels;
+    const uint16_t *fonts;      /* police de chaque image (0..SAMPLES_PER_LETTER-1) */
+    const uint8_t *pixels;
+} Dataset;
+
+/* Lit data_dir/<L>/<L>_NNN.pbm (images absentes ignorées) avec threads
+ * lecteurs et écrit le fichier compacté */
+int dataset_pack(const char *data_dir, const char *filename, int threads);
+
+/* Version du fichier s'il commence par DATASET_MAGIC, 0 sinon */
+int dataset_is_packed(const char *filename);
+
+/* 1 si filename (version courante) a été compacté depuis data_dir et
+ * qu'aucune image n'a changé depuis, 0 sinon */
+int dataset_is_current(const char *filename, const char *data_dir);
+
+int dataset_map(const char *filename, Dataset *ds);
+void dataset_unmap(Dataset *ds);
+
+/* Décode l'image k dans img (valeurs identiques à read_pbm pour les PBM) */
+void dataset_image(const Dataset *ds, int k, float img[IMG_SIZE][IMG_SIZE]);
+
+#endif
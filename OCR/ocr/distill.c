@@ -0,0 +1,30 @@
+/*
+ * Distillation d'un réseau élève, voir distill.h
+ */
+
+#include "distill.h"
+#include "fastmath.h"
+
+void distill_soft_targets(const float *probs, float temperature, float soft[NUM_CLASSES]) {
+    float sum = 0.0f;
+    int i;
+    /* probs >= 1e-7 (softmax): le logarithme est défini */
+    for (i = 0; i < NUM_CLASSES; i++) {
+        soft[i] = fast_exp(fast_log(probs[i]) / temperature);
+        sum += soft[i];
+    }
+    for (i = 0; i < NUM_CLASSES; i++) soft[i] /= sum;
+}
+
+void distill_gradient(const float *logits, const float *probs, int label,
+                      const float *soft, float temperature, float alpha,
+                      float d_logits[NUM_CLASSES]) {
+    float scaled[NUM_CLASSES], p_t[NUM_CLASSES];
+    int i;
+    for (i = 0; i < NUM_CLASSES; i++) scaled[i] = logits[i] / temperature;
+    softmax(scaled, p_t, NUM_CLASSES);
+    for (i = 0; i < NUM_CLASSES; i++) {
+        float hard = probs[i] - (i == label ? 1.0f : 0.0f);
+        d_logits[i] = (1.0f - alpha) * hard + alpha * temperature * (p_t[i] - soft[i]);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef DISTILL_H
+#define DISTILL_H
+
+#include "cnn.h"
+
+/*
+ * Distillation d'un petit réseau élève et reconnaissance en cascade.
+ *
+ * Entraînement (mode 1 avec --teacher): le réseau complet (maître, un
+ * model.bin) calcule les probabilités de chaque image du lot, augmentée
+ * comme pour l'élève. L'élève apprend à la fois la lettre et la
+ * distribution du maître adoucie par la température T:
+ *   perte = (1 - alpha) CE(y, p) + alpha T^2 CE(q_T, p_T)
+ * où p = softmax(z), p_T = softmax(z / T) pour les logits z de l'élève et
+ * q_T la distribution du maître à la température T. Le facteur T^2 garde
+ * au terme doux le même ordre de grandeur de gradient quand T change.
+ *
+ * Reconnaissance (mode 3 avec --student): l'élève passe sur tous les
+ * glyphes; seuls ceux dont la probabilité maximale est sous le seuil
+ * repassent dans le modèle complet, dont le résultat remplace celui de
+ * l'élève. './main cascade' mesure, contre les étiquettes des polices de
+ * validation, la précision et le temps par glyphe de chaque seuil.
+ */
+
+/* Élève par défaut: 4x moins de paramètres que 16x5,32x3,256. Avec FC1
+ * à 64 neurones, l'élève plafonnait vers 88 % en validation, trop peu
+ * pour que la cascade rapporte quelque chose; à 128, ~97 % */
+#define DISTILL_TOPOLOGY "8x5,16x3,128"
+#define DISTILL_TEMPERATURE 2.0f
+#define DISTILL_ALPHA 0.7f
+#define DISTILL_FILE "student.bin"
+#define DISTILL_CHECKPOINT "student.ckpt"
+
+/* Confiance minimale de l'élève pour garder sa réponse. Choisi sur la
+ * courbe de './main cascade' (élève de 'make distill', polices de
+ * validation): le seuil le plus bas dont la précision reste celle du
+ * modèle seul, avec un cran de marge */
+#define CASCADE_THRESHOLD 0.8f
+/* Seuils mesurés par './main cascade' */
+#define CASCADE_THRESHOLDS "0.5,0.7,0.8,0.9,0.95,0.99"
+
+/* Distribution du maître à la température T, depuis ses probabilités à
+ * T = 1: soft[i] proportionnel à probs[i]^(1 / T) */
+void distill_soft_targets(const float *probs, float temperature, float soft[NUM_CLASSES]);
+
+/* Gradient de la perte ci-dessus par rapport aux logits de l'élève:
+ *   (1 - alpha) (p - y) + alpha T (p_T - soft)
+ * logits et probs sont ceux de l'élève (probs = softmax(logits)) */
+void distill_gradient(const float *logits, const float *probs, int label,
+                      const float *soft, float temperature, float alpha,
+                      float d_logits[NUM_CLASSES]);
+
+#endif
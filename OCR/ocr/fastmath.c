@@ -0,0 +1,167 @@
+/*
+ * exp / log par réduction d'intervalle et polynômes, voir fastmath.h
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "fastmath.h"
+
+/* Aucune exception flottante n'est consultée: sans cela GCC refuse de
+ * convertir les bornes et la sélection finale en masques et ne vectorise
+ * pas fast_exp_vec */
+#pragma GCC optimize("no-trapping-math")
+
+#define LOG2E 1.44269504088896341f
+/* ln2 en deux parties: C1 exact sur peu de bits, n * C1 est donc exact */
+#define LN2_C1 0.693359375f
+#define LN2_C2 -2.12194440e-4f
+#define SQRT_HALF 0.707106781186547524f
+#define ROUND_MAGIC 12582912.0f
+
+static inline float bits_to_float(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static inline uint32_t float_to_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float exp_kernel(float x) {
+    /* Bornes: 2^n doit rester un float normal */
+    x = x < -87.0f ? -87.0f : x;
+    x = x > 88.0f ? 88.0f : x;
+
+    /* n = arrondi(x / ln2) par l'ajout de 1.5 * 2^23 (sans branche),
+     * r = x - n ln2 */
+    float fn = (x * LOG2E + ROUND_MAGIC) - ROUND_MAGIC;
+    int n = (int)fn;
+    float r = x - fn * LN2_C1;
+    r = r - fn * LN2_C2;
+
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+
+    /* 2^n construit directement dans l'exposant */
+    return p * bits_to_float((uint32_t)(n + 127) << 23);
+}
+
+float fast_exp(float x) {
+    float y = exp_kernel(x);
+    return x < -87.0f ? 0.0f : y;
+}
+
+void fast_exp_vec(const float *x, float *y, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        float v = exp_kernel(x[i]);
+        y[i] = x[i] < -87.0f ? 0.0f : v;
+    }
+}
+
+float fast_log(float x) {
+    if (x <= 0.0f) return -1000.0f;
+
+    /* x = m 2^e avec m dans [0.5, 1) */
+    uint32_t u = float_to_bits(x);
+    int e = (int)((u >> 23) & 0xff) - 126;
+    float m = bits_to_float((u & 0x007fffff) | 0x3f000000);
+
+    /* Recentrage sur [sqrt(1/2), sqrt(2)) */
+    if (m < SQRT_HALF) {
+        e -= 1;
+        m = m + m - 1.0f;
+    } else {
+        m = m - 1.0f;
+    }
+
+    float z = m * m;
+    float y = 7.0376836292e-2f;
+    y = y * m - 1.1514610310e-1f;
+    y = y * m + 1.1676998740e-1f;
+    y = y * m - 1.2420140846e-1f;
+    y = y * m + 1.4249322787e-1f;
+    y = y * m - 1.6668057665e-1f;
+    y = y * m + 2.0000714765e-1f;
+    y = y * m - 2.4999993993e-1f;
+    y = y * m + 3.3333331174e-1f;
+    y = y * m * z;
+
+    float fe = (float)e;
+    y += fe * LN2_C2;
+    y -= 0.5f * z;
+    return m + y + fe * LN2_C1;
+}
+
+void softmax(const float *logits, float *out, int n) {
+    int i;
+    float max_logit = logits[0];
+    for (i = 1; i < n; i++) {
+        if (logits[i] > max_logit) max_logit = logits[i];
+    }
+    for (i = 0; i < n; i++) {
+        out[i] = logits[i] - max_logit;
+    }
+    fast_exp_vec(out, out, n);
+
+    float exp_sum = 0.0f;
+    for (i = 0; i < n; i++) {
+        exp_sum += out[i];
+    }
+    float inv = 1.0f / exp_sum;
+    for (i = 0; i < n; i++) {
+        out[i] *= inv;
+        if (out[i] < 1e-7f) out[i] = 1e-7f;
+    }
+}
+
+/* ============================================================
+ * ANCIENNES VERSIONS (référence de bench-math)
+ * ============================================================ */
+
+float taylor_exp(float x) {
+    /* Approximation de e^x par série de Taylor */
+    if (x > 20.0f) return 485165195.4f;
+    if (x < -20.0f) return 0.0f;
+
+    float result = 1.0f;
+    float term = 1.0f;
+    int i;
+    for (i = 1; i <= 20; i++) {
+        term *= x / (float)i;
+        result += term;
+    }
+    return result;
+}
+
+float taylor_log(float x) {
+    /* Approximation de ln(x) */
+    if (x <= 0.0f) return -1000.0f;
+    if (x < 0.0001f) return -1000.0f;
+
+    /* Normalisation: ln(x) = ln(m * 2^e) = ln(m) + e*ln(2) */
+    float result = 0.0f;
+    while (x > 2.0f) { x /= 2.0f; result += 0.693147f; }
+    while (x < 0.5f) { x *= 2.0f; result -= 0.693147f; }
+
+    /* Série de Taylor pour ln(1+y) où y = x-1 */
+    float y = x - 1.0f;
+    float term = y;
+    float sign = 1.0f;
+    int i;
+    for (i = 1; i <= 30; i++) {
+        result += sign * term / (float)i;
+        term *= y;
+        sign = -sign;
+    }
+    return result;
+}
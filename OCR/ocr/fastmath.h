@@ -0,0 +1,44 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+/*
+ * exp / log rapides pour le softmax et la perte d'entraînement.
+ *
+ * Réduction d'intervalle puis polynôme (coefficients de Cephes):
+ *  - fast_exp: x = n ln2 + r, |r| <= ln2 / 2, e^r par un polynôme de
+ *    degré 7, puis 2^n posé directement dans l'exposant du float.
+ *    Erreur relative <= FAST_EXP_MAX_REL_ERR sur [-87, 88].
+ *  - fast_log: x = m 2^e, m dans [sqrt(1/2), sqrt(2)), ln(m) par un
+ *    polynôme de degré 9 en m - 1.
+ *    Erreur <= FAST_LOG_MAX_ERR sur les floats normaux (absolue tant
+ *    que |ln x| <= 1, relative au-delà).
+ * Sans branche ni appel: les boucles sur les 26 logits sont vectorisées
+ * par le compilateur. './main check-math' vérifie ces bornes contre libm.
+ *
+ * L'ancien my_exp (Taylor) divergeait sous -10, là où tombent les logits
+ * décalés de tout modèle sûr de lui: les prédictions du mode 3 changent
+ * aussi pour les modèles entraînés avant ce remplacement, et la perte
+ * d'entraînement affichée alors (calculée avec l'ancien my_log) n'est pas
+ * comparable à l'actuelle.
+ */
+
+#define FAST_EXP_MAX_REL_ERR 2.5e-7
+#define FAST_LOG_MAX_ERR 2.5e-7
+
+/* e^x; 0 en dessous de -87, borné à e^88 au-dessus */
+float fast_exp(float x);
+
+/* ln(x) pour x > 0 normal; -1000 si x <= 0 (comme l'ancien my_log) */
+float fast_log(float x);
+
+/* y[i] = fast_exp(x[i]) (y peut être x) */
+void fast_exp_vec(const float *x, float *y, int n);
+
+/* Softmax stable (logits décalés du maximum), probabilités bornées à 1e-7 */
+void softmax(const float *logits, float *out, int n);
+
+/* Anciennes versions par séries de Taylor, gardées pour bench-math */
+float taylor_exp(float x);
+float taylor_log(float x);
+
+#endif
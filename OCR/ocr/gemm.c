@@ -0,0 +1,110 @@
+/*
+ * GEMM simple précision par blocs, voir gemm.h
+ */
+
+#include <stddef.h>
+
+#include "gemm.h"
+#include "simd.h"
+
+/* Copie op(A)[i0..i0+mc)[k0..k0+kc) en panneaux de GEMM_MR lignes:
+ * dst[p][k][r], complétés par des zéros */
+static void pack_a(int trans_a, const float *A, int lda, int i0, int k0,
+                   int mc, int kc, float *dst) {
+    int p, k, r;
+    for (p = 0; p < mc; p += GEMM_MR) {
+        for (k = 0; k < kc; k++) {
+            for (r = 0; r < GEMM_MR; r++) {
+                int i = p + r;
+                float v = 0.0f;
+                if (i < mc) {
+                    v = trans_a ? A[(size_t)(k0 + k) * lda + i0 + i]
+                                : A[(size_t)(i0 + i) * lda + k0 + k];
+                }
+                *dst++ = v;
+            }
+        }
+    }
+}
+
+/* Copie op(B)[k0..k0+kc)[j0..j0+nc) en panneaux de GEMM_NR colonnes:
+ * dst[p][k][c], complétés par des zéros */
+static void pack_b(int trans_b, const float *B, int ldb, int k0, int j0,
+                   int kc, int nc, float *dst) {
+    int p, k, c;
+    for (p = 0; p < nc; p += GEMM_NR) {
+        int w = nc - p < GEMM_NR ? nc - p : GEMM_NR;
+        for (k = 0; k < kc; k++) {
+            if (!trans_b) {
+                const float *src = B + (size_t)(k0 + k) * ldb + j0 + p;
+                for (c = 0; c < w; c++) dst[c] = src[c];
+            } else {
+                for (c = 0; c < w; c++) {
+                    dst[c] = B[(size_t)(j0 + p + c) * ldb + k0 + k];
+                }
+            }
+            for (c = w; c < GEMM_NR; c++) dst[c] = 0.0f;
+            dst += GEMM_NR;
+        }
+    }
+}
+
+/* Tuile incomplète (bords de C): calcul dans une tuile locale */
+static void micro_kernel_edge(int kc, const float *a, const float *b,
+                              float *C, int ldc, int mr, int nr) {
+    float tile[GEMM_MR * GEMM_NR];
+    int i, j;
+    for (i = 0; i < GEMM_MR; i++) {
+        for (j = 0; j < GEMM_NR; j++) {
+            tile[i * GEMM_NR + j] = (i < mr && j < nr) ? C[(size_t)i * ldc + j] : 0.0f;
+        }
+    }
+    simd->gemm_4x16(kc, a, b, tile, GEMM_NR);
+    for (i = 0; i < mr; i++) {
+        for (j = 0; j < nr; j++) {
+            C[(size_t)i * ldc + j] = tile[i * GEMM_NR + j];
+        }
+    }
+}
+
+void sgemm(int trans_a, int trans_b, int M, int N, int K,
+           const float *A, int lda, const float *B, int ldb,
+           float beta, float *C, int ldc, float *pack) {
+    float *a_pack = pack;
+    float *b_pack = pack + GEMM_MC * GEMM_KC;
+    int i, j, i0, j0, k0;
+
+    if (beta != 1.0f) {
+        for (i = 0; i < M; i++) {
+            for (j = 0; j < N; j++) {
+                C[(size_t)i * ldc + j] = beta == 0.0f ? 0.0f : beta * C[(size_t)i * ldc + j];
+            }
+        }
+    }
+
+    for (j0 = 0; j0 < N; j0 += GEMM_NC) {
+        int nc = N - j0 < GEMM_NC ? N - j0 : GEMM_NC;
+        for (k0 = 0; k0 < K; k0 += GEMM_KC) {
+            int kc = K - k0 < GEMM_KC ? K - k0 : GEMM_KC;
+            pack_b(trans_b, B, ldb, k0, j0, kc, nc, b_pack);
+            for (i0 = 0; i0 < M; i0 += GEMM_MC) {
+                int mc = M - i0 < GEMM_MC ? M - i0 : GEMM_MC;
+                pack_a(trans_a, A, lda, i0, k0, mc, kc, a_pack);
+                for (j = 0; j < nc; j += GEMM_NR) {
+                    int nr = nc - j < GEMM_NR ? nc - j : GEMM_NR;
+                    for (i = 0; i < mc; i += GEMM_MR) {
+                        int mr = mc - i < GEMM_MR ? mc - i : GEMM_MR;
+                        float *c = C + (size_t)(i0 + i) * ldc + j0 + j;
+                        const float *ap = a_pack + (size_t)i * kc;
+                        const float *bp = b_pack + (size_t)j * kc;
+                        if (mr == GEMM_MR && nr == GEMM_NR) {
+                            simd->gemm_4x16(kc, ap, bp, c, ldc);
+                        } else {
+                            micro_kernel_edge(kc, ap, bp, c, ldc, mr, nr);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+/*
+ * Produit matriciel simple précision par blocs (stockage ligne par ligne):
+ *
+ *     C[M][N] = beta * C + op(A)[M][K] * op(B)[K][N]
+ *
+ * op(X) = X si trans_x vaut 0, sa transposée sinon (X est alors stocké
+ * [K][M] pour A, [N][K] pour B). Les blocs de A et B sont recopiés dans
+ * des tampons contigus qui tiennent en cache, puis un micro-noyau
+ * GEMM_MR x GEMM_NR accumule dans des registres.
+ *
+ * Pour un élément de C, les produits sont ajoutés dans l'ordre croissant
+ * de k: avec beta = 1 et C initialisé au biais, le résultat suit le même
+ * ordre d'accumulation que les boucles directes.
+ */
+
+#define GEMM_MR 4
+#define GEMM_NR 16
+#define GEMM_MC 64
+#define GEMM_KC 256
+#define GEMM_NC 256
+
+/* Tampons de recopie d'un appel (320 Ko): a_pack[GEMM_MC][GEMM_KC] puis
+ * b_pack[GEMM_KC][GEMM_NC]. Trop gros pour la pile d'un thread, ils sont
+ * découpés dans l'espace de travail de l'appelant (conv.h). */
+#define GEMM_PACK_FLOATS (GEMM_MC * GEMM_KC + GEMM_KC * GEMM_NC)
+
+/* pack: GEMM_PACK_FLOATS floats alignés sur 64 octets, propres au thread */
+void sgemm(int trans_a, int trans_b, int M, int N, int K,
+           const float *A, int lda, const float *B, int ldb,
+           float beta, float *C, int ldc, float *pack);
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * Cache des résultats d'inférence par glyphe, voir glyph_cache.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glyph_cache.h"
+#include "model_bin.h"
+
+_Static_assert(sizeof(GlyphCacheHeader) == 48, "GlyphCacheHeader doit faire 48 octets");
+
+struct GlyphCache {
+    uint64_t model_id;
+    GlyphEntry *entries;        /* [cap], dans l'ordre d'ajout */
+    uint64_t *hashes;           /* [cap] FNV-1a de chaque clé */
+    int count, cap;
+    int32_t *slots;             /* [n_slots] indices des entrées, -1 si libre */
+    int n_slots;                /* puissance de 2 */
+    GlyphCacheStats stats;
+};
+
+GlyphCache *glyph_cache_new(uint64_t model_id) {
+    GlyphCache *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->model_id = model_id;
+    c->n_slots = 1024;
+    c->slots = malloc(sizeof(int32_t) * c->n_slots);
+    if (!c->slots) {
+        free(c);
+        return NULL;
+    }
+    memset(c->slots, 0xff, sizeof(int32_t) * c->n_slots);
+    return c;
+}
+
+void glyph_cache_free(GlyphCache *c) {
+    if (!c) return;
+    free(c->entries);
+    free(c->hashes);
+    free(c->slots);
+    free(c);
+}
+
+/* ============================================================
+ * TABLE
+ * ============================================================ */
+
+/* Image en noir et blanc sur 1 bit par pixel, poids fort en premier;
+ * -1 si un pixel n'est ni 0 ni 1 */
+static int make_key(const float img[IMG_SIZE][IMG_SIZE], uint8_t key[GLYPH_KEY_BYTES]) {
+    const float *px = &img[0][0];
+    int p;
+    memset(key, 0, GLYPH_KEY_BYTES);
+    for (p = 0; p < IMG_SIZE * IMG_SIZE; p++) {
+        if (px[p] == 1.0f) {
+            key[p >> 3] |= (uint8_t)(0x80 >> (p & 7));
+        } else if (px[p] != 0.0f) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Emplacement de la clé dans slots: son entrée, ou l'emplacement libre où
+ * l'ajouter */
+static int find_slot(const GlyphCache *c, uint64_t h, const uint8_t *key) {
+    int mask = c->n_slots - 1;
+    int s = (int)(h & (uint64_t)mask);
+    while (c->slots[s] >= 0) {
+        int e = c->slots[s];
+        if (c->hashes[e] == h && memcmp(c->entries[e].key, key, GLYPH_KEY_BYTES) == 0) break;
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+/* Double la table d'indices (remplissage maximal 3/4) */
+static int grow_slots(GlyphCache *c) {
+    int n = c->n_slots * 2, e;
+    int32_t *slots = malloc(sizeof(int32_t) * n);
+    if (!slots) return -1;
+    memset(slots, 0xff, sizeof(int32_t) * n);
+    free(c->slots);
+    c->slots = slots;
+    c->n_slots = n;
+    for (e = 0; e < c->count; e++) {
+        c->slots[find_slot(c, c->hashes[e], c->entries[e].key)] = e;
+    }
+    return 0;
+}
+
+/* Ajoute la clé (absente) à l'emplacement libre s; -1 si plein ou mémoire */
+static int add_entry(GlyphCache *c, uint64_t h, const uint8_t *key, int s) {
+    if (c->count == GLYPH_CACHE_MAX) return -1;
+    if (c->count == c->cap) {
+        int cap = c->cap ? c->cap * 2 : 256;
+        void *entries = realloc(c->entries, sizeof(GlyphEntry) * cap);
+        if (!entries) return -1;
+        c->entries = entries;
+        void *hashes = realloc(c->hashes, sizeof(uint64_t) * cap);
+        if (!hashes) return -1;
+        c->hashes = hashes;
+        c->cap = cap;
+    }
+    if ((c->count + 1) * 4 > c->n_slots * 3) {
+        if (grow_slots(c) != 0) return -1;
+        s = find_slot(c, h, key);
+    }
+    int e = c->count++;
+    memset(&c->entries[e], 0, sizeof(c->entries[e]));
+    memcpy(c->entries[e].key, key, GLYPH_KEY_BYTES);
+    c->hashes[e] = h;
+    c->slots[s] = e;
+    return e;
+}
+
+int glyph_cache_get(GlyphCache *c, const float img[IMG_SIZE][IMG_SIZE], int *created) {
+    uint8_t key[GLYPH_KEY_BYTES];
+    *created = 0;
+    if (make_key(img, key) != 0) {
+        c->stats.uncached++;
+        return -1;
+    }
+    uint64_t h = model_bin_checksum(key, GLYPH_KEY_BYTES);
+    int s = find_slot(c, h, key);
+    if (c->slots[s] >= 0) {
+        c->stats.hits++;
+        return c->slots[s];
+    }
+    int e = add_entry(c, h, key, s);
+    if (e < 0) {
+        c->stats.uncached++;
+        return -1;
+    }
+    c->stats.misses++;
+    *created = 1;
+    return e;
+}
+
+GlyphEntry *glyph_cache_entry(GlyphCache *c, int e) {
+    return &c->entries[e];
+}
+
+void glyph_cache_stats(const GlyphCache *c, GlyphCacheStats *st) {
+    *st = c->stats;
+    st->entries = c->count;
+}
+
+/* ============================================================
+ * FICHIER
+ * ============================================================ */
+
+int glyph_cache_save(const GlyphCache *c, const char *filename) {
+    char tmp[512];
+    GlyphCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, GLYPH_CACHE_MAGIC, sizeof(h.magic));
+    h.version = GLYPH_CACHE_VERSION;
+    h.endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h.model_id = c->model_id;
+    h.count = (uint32_t)c->count;
+    h.key_bytes = GLYPH_KEY_BYTES;
+    h.num_classes = NUM_CLASSES;
+    h.checksum = model_bin_checksum(c->entries, sizeof(GlyphEntry) * c->count);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        printf("Erreur: impossible d'écrire %s\n", filename);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(c->entries, sizeof(GlyphEntry), c->count, fp) == (size_t)c->count;
+    ok &= fclose(fp) == 0;
+    if (!ok || rename(tmp, filename) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int glyph_cache_load(GlyphCache *c, const char *filename) {
+    GlyphCacheHeader h;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+
+    const char *err = NULL;
+    GlyphEntry *entries = NULL;
+    if (fread(&h, sizeof(h), 1, fp) != 1 ||
+        memcmp(h.magic, GLYPH_CACHE_MAGIC, sizeof(h.magic)) != 0) {
+        err = "n'est pas un cache de glyphes";
+    } else if (h.version != GLYPH_CACHE_VERSION || h.endian_tag != MODEL_BIN_ENDIAN_TAG ||
+               h.key_bytes != GLYPH_KEY_BYTES || h.num_classes != NUM_CLASSES) {
+        err = "a une version ou un format non supporté";
+    } else if (h.count > GLYPH_CACHE_MAX) {
+        err = "a un en-tête invalide";
+    } else if (!(entries = malloc(sizeof(GlyphEntry) * (h.count ? h.count : 1)))) {
+        err = "ne tient pas en mémoire";
+    } else if (fread(entries, sizeof(GlyphEntry), h.count, fp) != h.count || fgetc(fp) != EOF) {
+        err = "est tronqué";
+    } else if (model_bin_checksum(entries, sizeof(GlyphEntry) * h.count) != h.checksum) {
+        err = "a une somme de contrôle invalide";
+    }
+    fclose(fp);
+    if (err) {
+        printf("Erreur: %s %s\n", filename, err);
+        free(entries);
+        return -1;
+    }
+    if (h.model_id != c->model_id) {
+        printf("Cache %s ignoré: il a été rempli par un autre modèle\n", filename);
+        free(entries);
+        return 0;
+    }
+
+    uint32_t k;
+    for (k = 0; k < h.count; k++) {
+        uint64_t hash = model_bin_checksum(entries[k].key, GLYPH_KEY_BYTES);
+        int s = find_slot(c, hash, entries[k].key);
+        int e = c->slots[s] >= 0 ? c->slots[s] : add_entry(c, hash, entries[k].key, s);
+        if (e < 0) break;
+        memcpy(c->entries[e].probs, entries[k].probs, sizeof(entries[k].probs));
+        c->entries[e].letter = entries[k].letter;
+    }
+    free(entries);
+    return 0;
+}
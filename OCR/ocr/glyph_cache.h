@@ -0,0 +1,82 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+
+/*
+ * Cache des résultats d'inférence, indexé par le contenu du glyphe.
+ *
+ * Une grille de mots mêlés réutilise peu de lettres, et les glyphes
+ * normalisés en 50x50 sont souvent identiques au pixel près. La clé est
+ * l'image en noir et blanc empaquetée sur 1 bit par pixel (313 octets,
+ * même codage que letters.pack), repérée par son FNV-1a 64 bits; la
+ * valeur, les probabilités softmax et la lettre choisie par le réseau.
+ *
+ * Seules les images exactement identiques partagent une entrée (la clé
+ * complète est comparée): un résultat lu dans le cache est celui que le
+ * réseau aurait donné. Les images en niveaux de gris ne sont pas mises
+ * en cache. Le fichier persistant est lié au modèle qui l'a rempli
+ * (model_id): avec un autre modèle il est ignoré.
+ *
+ *   [ en-tête GlyphCacheHeader, 48 octets         ]
+ *   [ count x GlyphEntry                           ]
+ */
+
+#define GLYPH_KEY_BYTES ((IMG_SIZE * IMG_SIZE + 7) / 8)
+#define GLYPH_CACHE_MAX 65536   /* entrées au plus (~28 Mo) */
+#define GLYPH_CACHE_MAGIC "CNNGLYC\n"
+#define GLYPH_CACHE_VERSION 1
+
+typedef struct {
+    char magic[8];              /* GLYPH_CACHE_MAGIC */
+    uint32_t version;           /* GLYPH_CACHE_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint64_t model_id;          /* empreinte du modèle qui a rempli le cache */
+    uint32_t count;             /* entrées */
+    uint32_t key_bytes;         /* GLYPH_KEY_BYTES */
+    uint32_t num_classes;
+    uint32_t reserved;
+    uint64_t checksum;          /* FNV-1a 64 bits des entrées */
+} GlyphCacheHeader;
+
+/* Entrée telle qu'écrite dans le fichier */
+typedef struct {
+    float probs[NUM_CLASSES];
+    char letter;                /* celle de predict() / predict_batch() */
+    uint8_t key[GLYPH_KEY_BYTES];
+} GlyphEntry;
+
+typedef struct {
+    long hits;                  /* images servies par le cache */
+    long misses;                /* images passées dans le réseau puis ajoutées */
+    long uncached;              /* niveaux de gris, ou cache plein */
+    int entries;
+} GlyphCacheStats;
+
+typedef struct GlyphCache GlyphCache;
+
+/* Cache vide pour le modèle d'empreinte model_id; NULL si mémoire */
+GlyphCache *glyph_cache_new(uint64_t model_id);
+void glyph_cache_free(GlyphCache *c);
+
+/* Entrée de img: existante (*created = 0, compte un succès) ou créée
+ * (*created = 1, compte un échec: l'appelant y range ensuite les
+ * probabilités et la lettre). -1 si img n'est pas en noir et blanc ou si
+ * le cache est plein. Les indices restent valides jusqu'à
+ * glyph_cache_free(), les pointeurs jusqu'à l'ajout suivant. */
+int glyph_cache_get(GlyphCache *c, const float img[IMG_SIZE][IMG_SIZE], int *created);
+
+GlyphEntry *glyph_cache_entry(GlyphCache *c, int e);
+
+void glyph_cache_stats(const GlyphCache *c, GlyphCacheStats *st);
+
+/* Ajoute les entrées du fichier (absent: rien à faire). Un fichier d'un
+ * autre modèle est ignoré avec un message; -1 s'il est illisible. */
+int glyph_cache_load(GlyphCache *c, const char *filename);
+/* Écrit dans filename.tmp puis renomme: un lecteur ne voit jamais un
+ * cache à moitié écrit */
+int glyph_cache_save(const GlyphCache *c, const char *filename);
+
+#endif
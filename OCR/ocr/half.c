@@ -0,0 +1,245 @@
+/*
+ * Poids FC en demi-précision (float16 / bfloat16), voir half.h
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "half.h"
+#include "model_bin.h"
+
+_Static_assert(sizeof(HalfHeader) <= HALF_HEADER_SIZE, "en-tête model.h16 trop grand");
+_Static_assert(sizeof(HALF_MAGIC) == 8, "HALF_MAGIC doit faire 8 octets");
+
+/* ============================================================
+ * CONVERSIONS
+ * ============================================================ */
+
+const char *half_format_name(int format) {
+    return format == HALF_BF16 ? "bf16" : "fp16";
+}
+
+int half_parse_format(const char *name) {
+    if (strcmp(name, "fp16") == 0) return HALF_FP16;
+    if (strcmp(name, "bf16") == 0) return HALF_BF16;
+    return -1;
+}
+
+/* float16: au-delà de 65520 (milieu entre 65504 et 65536), l'infini; sous
+ * 2^-14, un sous-normal de pas 2^-24 */
+static uint16_t encode_f16(uint32_t x) {
+    uint32_t sign = (x >> 16) & 0x8000, a = x & 0x7fffffff;
+    if (a > 0x7f800000u) return (uint16_t)(sign | 0x7e00);     /* NaN */
+    if (a >= 0x477ff000u) return (uint16_t)(sign | 0x7c00);
+    if (a < 0x38800000u) {
+        /* v * 2^24 est exact; lrintf arrondit au pair le plus proche */
+        float v;
+        memcpy(&v, &a, sizeof(v));
+        return (uint16_t)(sign | (uint32_t)lrintf(v * 16777216.0f));
+    }
+    a += 0x0fff + ((a >> 13) & 1);
+    return (uint16_t)(sign | ((a - ((uint32_t)(127 - 15) << 23)) >> 13));
+}
+
+static uint16_t encode_bf16(uint32_t x) {
+    if ((x & 0x7fffffff) > 0x7f800000u) return (uint16_t)((x >> 16) | 0x40);   /* NaN */
+    x += 0x7fff + ((x >> 16) & 1);
+    return (uint16_t)(x >> 16);
+}
+
+uint16_t half_encode(float v, int format) {
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    return format == HALF_BF16 ? encode_bf16(x) : encode_f16(x);
+}
+
+/* ============================================================
+ * MODÈLE
+ * ============================================================ */
+
+/* Découpe du corps: ordre et alignement de cnn_layout() */
+static void half_carve(HalfCNN *h, const Topology *t, Arena *a) {
+    CNN *net = &h->net;
+    size_t k1 = (size_t)t->conv1_size * t->conv1_size;
+    size_t k2 = (size_t)t->conv1_filters * t->conv2_size * t->conv2_size;
+    net->topo = *t;
+    net->conv1_weights = arena_alloc(a, sizeof(float) * t->conv1_filters * k1);
+    net->conv1_bias = arena_alloc(a, sizeof(float) * t->conv1_filters);
+    net->conv2_weights = arena_alloc(a, sizeof(float) * t->conv2_filters * k2);
+    net->conv2_bias = arena_alloc(a, sizeof(float) * t->conv2_filters);
+    h->fc1_weights = arena_alloc(a, sizeof(uint16_t) * t->fc1_size * t->flatten);
+    net->fc1_bias = arena_alloc(a, sizeof(float) * t->fc1_size);
+    h->fc2_weights = arena_alloc(a, sizeof(uint16_t) * FC2_SIZE * t->fc1_size);
+    net->fc2_bias = arena_alloc(a, sizeof(float) * FC2_SIZE);
+}
+
+static size_t half_body_size(const Topology *t) {
+    HalfCNN h;
+    Arena a;
+    arena_measure(&a);
+    half_carve(&h, t, &a);
+    return a.used;
+}
+
+static HalfCNN *half_alloc(const Topology *t, int format) {
+    HalfCNN *h = calloc(1, sizeof(*h));
+    Arena a;
+    if (!h) return NULL;
+    if (arena_init(&a, half_body_size(t)) != 0) {
+        free(h);
+        return NULL;
+    }
+    half_carve(h, t, &a);
+    h->data = a.base;
+    h->size = a.size;
+    h->fc.format = format;
+    h->fc.fc1_weights = h->fc1_weights;
+    h->fc.fc2_weights = h->fc2_weights;
+    /* Le corps tient lieu d'arène du réseau (empreinte du modèle) */
+    h->net.data = (float *)a.base;
+    h->net.count = a.size / sizeof(float);
+    h->net.fc_half = &h->fc;
+    return h;
+}
+
+HalfCNN *half_from_float(const CNN *net, int format) {
+    const Topology *t = &net->topo;
+    HalfCNN *h = half_alloc(t, format);
+    size_t k, n1 = (size_t)t->fc1_size * t->flatten, n2 = (size_t)FC2_SIZE * t->fc1_size;
+    if (!h) return NULL;
+    memcpy(h->net.conv1_weights, net->conv1_weights,
+           sizeof(float) * t->conv1_filters * t->conv1_size * t->conv1_size);
+    memcpy(h->net.conv1_bias, net->conv1_bias, sizeof(float) * t->conv1_filters);
+    memcpy(h->net.conv2_weights, net->conv2_weights,
+           sizeof(float) * t->conv2_filters * t->conv1_filters * t->conv2_size * t->conv2_size);
+    memcpy(h->net.conv2_bias, net->conv2_bias, sizeof(float) * t->conv2_filters);
+    for (k = 0; k < n1; k++) h->fc1_weights[k] = half_encode(net->fc1_weights[k], format);
+    memcpy(h->net.fc1_bias, net->fc1_bias, sizeof(float) * t->fc1_size);
+    for (k = 0; k < n2; k++) h->fc2_weights[k] = half_encode(net->fc2_weights[k], format);
+    memcpy(h->net.fc2_bias, net->fc2_bias, sizeof(float) * FC2_SIZE);
+    return h;
+}
+
+void half_free(HalfCNN *h) {
+    if (!h) return;
+    free(h->data);
+    free(h);
+}
+
+/* ============================================================
+ * FICHIER model.h16
+ * ============================================================ */
+
+static void fill_header(HalfHeader *h, const Topology *t, int format) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, HALF_MAGIC, sizeof(h->magic));
+    h->version = HALF_VERSION;
+    h->endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h->header_size = HALF_HEADER_SIZE;
+    h->block_align = CNN_BLOCK_ALIGN;
+    h->payload_size = half_body_size(t);
+    h->format = (uint32_t)format;
+    h->img_size = IMG_SIZE;
+    h->num_classes = NUM_CLASSES;
+    h->fc1_in = t->flatten;
+    h->fc1_out = t->fc1_size;
+    h->fc2_out = FC2_SIZE;
+    h->conv1_filters = t->conv1_filters;
+    h->conv1_size = t->conv1_size;
+    h->conv2_filters = t->conv2_filters;
+    h->conv2_size = t->conv2_size;
+}
+
+int half_is_half(const char *filename) {
+    char magic[8];
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == sizeof(magic) && memcmp(magic, HALF_MAGIC, sizeof(magic)) == 0;
+}
+
+int half_save(const HalfCNN *h, const char *filename) {
+    unsigned char header[HALF_HEADER_SIZE];
+    HalfHeader hd;
+
+    fill_header(&hd, &h->net.topo, h->fc.format);
+    hd.checksum = model_bin_checksum(h->data, h->size);
+    memset(header, 0, sizeof(header));
+    memcpy(header, &hd, sizeof(hd));
+
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        printf("Erreur: impossible de sauvegarder dans %s\n", filename);
+        return -1;
+    }
+    int ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(h->data, 1, h->size, fp) == h->size;
+    ok &= fclose(fp) == 0;
+    if (!ok) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        return -1;
+    }
+    printf("Modèle %s sauvegardé dans %s (%zu octets)\n", half_format_name(h->fc.format),
+           filename, sizeof(header) + h->size);
+    return 0;
+}
+
+HalfCNN *half_load(const char *filename) {
+    unsigned char header[HALF_HEADER_SIZE];
+    HalfHeader hd, expected;
+    Topology t;
+    HalfCNN *h = NULL;
+    const char *err = NULL;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        printf("Erreur: impossible de charger %s\n", filename);
+        return NULL;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+        err = "est tronqué";
+    } else {
+        memcpy(&hd, header, sizeof(hd));
+        topology_default(&t);
+        t.conv1_filters = (int)hd.conv1_filters;
+        t.conv1_size = (int)hd.conv1_size;
+        t.conv2_filters = (int)hd.conv2_filters;
+        t.conv2_size = (int)hd.conv2_size;
+        t.fc1_size = (int)hd.fc1_out;
+        if (memcmp(hd.magic, HALF_MAGIC, sizeof(hd.magic)) != 0) {
+            err = "n'est pas un modèle 16 bits";
+        } else if (hd.version != HALF_VERSION || hd.endian_tag != MODEL_BIN_ENDIAN_TAG ||
+                   (hd.format != HALF_FP16 && hd.format != HALF_BF16)) {
+            err = "a une version, un ordre d'octets ou un format non supporté";
+        } else if (hd.fc1_out > TOPO_MAX_FC1 || hd.conv1_filters > TOPO_MAX_FILTERS ||
+                   hd.conv2_filters > TOPO_MAX_FILTERS || hd.conv1_size > IMG_SIZE ||
+                   hd.conv2_size > IMG_SIZE || topology_init(&t) != 0) {
+            err = "a une topologie invalide";
+        }
+    }
+    if (!err) {
+        /* Formes et taille du corps */
+        fill_header(&expected, &t, (int)hd.format);
+        if (hd.payload_size != expected.payload_size ||
+            memcmp(&hd.img_size, &expected.img_size,
+                   offsetof(HalfHeader, conv1_filters) - offsetof(HalfHeader, img_size)) != 0) {
+            err = "a une architecture non reconnue";
+        } else if (!(h = half_alloc(&t, (int)hd.format))) {
+            err = "ne tient pas en mémoire";
+        } else if (fread(h->data, 1, h->size, fp) != h->size) {
+            err = "est tronqué";
+        } else if (model_bin_checksum(h->data, h->size) != hd.checksum) {
+            err = "a une somme de contrôle invalide";
+        }
+    }
+    fclose(fp);
+    if (err) {
+        printf("Erreur: %s %s\n", filename, err);
+        half_free(h);
+        return NULL;
+    }
+    return h;
+}
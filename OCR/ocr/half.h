@@ -0,0 +1,95 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+#include "topology.h"
+
+/*
+ * Poids des couches entièrement connectées sur 16 bits (model.h16).
+ *
+ * FC1 et FC2 (99,6 % des poids) sont stockés en float16 IEEE (binary16,
+ * 10 bits de mantisse, |w| < 65504) ou en bfloat16 (les 16 bits de poids
+ * fort d'un float: même exposant, 7 bits de mantisse), arrondis au plus
+ * proche. Les noyaux simd->dot_f16 / dot_bf16 les convertissent en float
+ * à la volée (F16C en AVX2): les activations, les sommes, les
+ * convolutions et les biais restent en float. FC1 lit deux fois moins
+ * d'octets par image qu'en float32, sans calibration (contrairement à
+ * model.q8).
+ *
+ * Le modèle chargé est un CNN ordinaire (net) dont fc1_weights et
+ * fc2_weights sont NULL et fc_half désigne les poids 16 bits:
+ * forward_batch_ws() le prend en charge, donc predict(), predict_batch()
+ * et le démon aussi. forward(), l'entraînement, la quantification et
+ * l'élagage demandent le modèle float32.
+ *
+ * Format du fichier:
+ *   [ en-tête HalfHeader, HALF_HEADER_SIZE octets ]
+ *   [ corps: blocs de model.bin dans le même ordre, alignés sur
+ *     CNN_BLOCK_ALIGN, les poids de FC1 et FC2 sur 16 bits ]
+ */
+
+#define HALF_MAGIC "CNNH16\n"    /* 8 octets avec le zéro final */
+#define HALF_VERSION 1
+#define HALF_HEADER_SIZE 128
+#define HALF_FILE "model.h16"
+
+/* Codage des poids 16 bits */
+enum {
+    HALF_FP16 = 1,
+    HALF_BF16 = 2
+};
+
+/* Poids de FC1 et FC2 d'un CNN en demi-précision (CNN.fc_half) */
+typedef struct HalfFc {
+    int format;                 /* HALF_FP16 ou HALF_BF16 */
+    const uint16_t *fc1_weights;    /* [fc1_size][flatten] */
+    const uint16_t *fc2_weights;    /* [FC2_SIZE][fc1_size] */
+} HalfFc;
+
+typedef struct {
+    CNN net;                    /* vues float dans data, net.fc_half == &fc */
+    HalfFc fc;
+    uint16_t *fc1_weights;      /* mêmes blocs que fc, modifiables */
+    uint16_t *fc2_weights;
+
+    void *data;                 /* corps du fichier */
+    size_t size;
+} HalfCNN;
+
+typedef struct {
+    char magic[8];              /* HALF_MAGIC */
+    uint32_t version;           /* HALF_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint32_t header_size;
+    uint32_t block_align;
+    uint64_t payload_size;      /* taille du corps */
+    uint64_t checksum;          /* FNV-1a 64 bits du corps */
+    uint32_t format;            /* HALF_FP16 ou HALF_BF16 */
+    uint32_t img_size, num_classes;
+    uint32_t fc1_in, fc1_out, fc2_out;
+    uint32_t conv1_filters, conv1_size, conv2_filters, conv2_size;
+} HalfHeader;
+
+/* Nom du format ("fp16", "bf16"), et son code d'après ce nom (-1 si inconnu) */
+const char *half_format_name(int format);
+int half_parse_format(const char *name);
+
+/* Float -> 16 bits, arrondi au plus proche (pair en cas d'égalité) */
+uint16_t half_encode(float v, int format);
+
+/* Copie de net (même topologie) avec les poids FC dans format; NULL si
+ * l'allocation échoue */
+HalfCNN *half_from_float(const CNN *net, int format);
+
+/* Renvoie 1 si le fichier commence par HALF_MAGIC */
+int half_is_half(const char *filename);
+
+int half_save(const HalfCNN *h, const char *filename);
+
+/* Alloue et lit un modèle 16 bits; NULL en cas d'erreur */
+HalfCNN *half_load(const char *filename);
+void half_free(HalfCNN *h);
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * Chargement asynchrone et augmentation des lots d'entraînement,
+ * voir loader.h
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loader.h"
+
+/* ============================================================
+ * AUGMENTATION
+ * ============================================================ */
+
+/* Rotation autour du centre puis translation, plus proche voisin (une
+ * image noir et blanc le reste); ce qui sort du cadre devient du fond */
+static void rotate_shift(float src[IMG_SIZE][IMG_SIZE], float dst[IMG_SIZE][IMG_SIZE],
+                         float angle, int dx, int dy) {
+    const float center = (IMG_SIZE - 1) * 0.5f;
+    float c = cosf(angle), s = sinf(angle);
+    int i, j;
+    for (i = 0; i < IMG_SIZE; i++) {
+        for (j = 0; j < IMG_SIZE; j++) {
+            /* Transformation inverse: pixel de destination -> source */
+            float y = (float)(i - dy) - center;
+            float x = (float)(j - dx) - center;
+            int si = (int)floorf(c * y - s * x + center + 0.5f);
+            int sj = (int)floorf(s * y + c * x + center + 0.5f);
+            dst[i][j] = (si >= 0 && si < IMG_SIZE && sj >= 0 && sj < IMG_SIZE)
+                        ? src[si][sj] : 1.0f;
+        }
+    }
+}
+
+/* Trait plus épais d'un pixel: minimum sur la croix 3x3 (l'encre vaut 0) */
+static void thicken(float img[IMG_SIZE][IMG_SIZE], float tmp[IMG_SIZE][IMG_SIZE]) {
+    int i, j;
+    memcpy(tmp, img, sizeof(float) * IMG_SIZE * IMG_SIZE);
+    for (i = 0; i < IMG_SIZE; i++) {
+        for (j = 0; j < IMG_SIZE; j++) {
+            float v = tmp[i][j];
+            if (i > 0 && tmp[i - 1][j] < v) v = tmp[i - 1][j];
+            if (i < IMG_SIZE - 1 && tmp[i + 1][j] < v) v = tmp[i + 1][j];
+            if (j > 0 && tmp[i][j - 1] < v) v = tmp[i][j - 1];
+            if (j < IMG_SIZE - 1 && tmp[i][j + 1] < v) v = tmp[i][j + 1];
+            img[i][j] = v;
+        }
+    }
+}
+
+/* Bruit poivre et sel, puis le filtre majoritaire pondéré de reduire_bruit()
+ * (Preprocessing/cleaner.c): voisins directs 2, diagonales 1, centre 3.
+ * Il reste les petits pâtés et les bords irréguliers des vraies cellules. */
+static void clean_noise(float img[IMG_SIZE][IMG_SIZE], float tmp[IMG_SIZE][IMG_SIZE],
+                        RngStream *rng) {
+    int i, j, di, dj;
+    for (i = 0; i < IMG_SIZE; i++) {
+        for (j = 0; j < IMG_SIZE; j++) {
+            float v = img[i][j];
+            if (rng_unit(rng) < AUG_NOISE_RATE) v = 1.0f - v;
+            tmp[i][j] = v;
+        }
+    }
+    memcpy(img, tmp, sizeof(float) * IMG_SIZE * IMG_SIZE);
+    for (i = 1; i < IMG_SIZE - 1; i++) {
+        for (j = 1; j < IMG_SIZE - 1; j++) {
+            int white = 0, black = 0;
+            for (di = -1; di <= 1; di++) {
+                for (dj = -1; dj <= 1; dj++) {
+                    int weight = (di == 0 && dj == 0) ? 3 : (di == 0 || dj == 0) ? 2 : 1;
+                    if (tmp[i + di][j + dj] >= 0.5f) white += weight;
+                    else black += weight;
+                }
+            }
+            img[i][j] = white > black ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void augment_glyph(float src[IMG_SIZE][IMG_SIZE], float dst[IMG_SIZE][IMG_SIZE],
+                   RngStream *rng) {
+    float tmp[IMG_SIZE][IMG_SIZE];
+    float angle = (rng_unit(rng) * 2.0f - 1.0f) * AUG_MAX_ROTATION * 3.14159265f / 180.0f;
+    int dx = rng_below(rng, 2 * AUG_MAX_SHIFT + 1) - AUG_MAX_SHIFT;
+    int dy = rng_below(rng, 2 * AUG_MAX_SHIFT + 1) - AUG_MAX_SHIFT;
+
+    rotate_shift(src, dst, angle, dx, dy);
+    if (rng_unit(rng) < AUG_THICKEN_PROB) thicken(dst, tmp);
+    if (rng_unit(rng) < AUG_NOISE_PROB) clean_noise(dst, tmp, rng);
+}
+
+/* ============================================================
+ * ANNEAU DE LOTS
+ * ============================================================ */
+
+struct Loader {
+    const Dataset *ds;
+    int count;                  /* échantillons par époque */
+    int batch_size;
+    int first_epoch;
+    int epochs;
+    int augment;
+    uint32_t seed;
+    int *indices;
+    LoaderEpochState *states;   /* une entrée par époque produite */
+
+    LoaderBatch ring[LOADER_RING];
+    long total;                 /* lots sur toutes les époques */
+    long produced;              /* lots prêts (producteur) */
+    long consumed;              /* lots rendus (consommateur) */
+    long taken;                 /* lots obtenus par loader_next() */
+    int stop;
+    double wait_seconds;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       /* un lot de plus est prêt */
+    pthread_cond_t space;       /* un emplacement a été rendu, ou arrêt */
+    pthread_t thread;
+};
+
+static void fill_batch(Loader *l, LoaderBatch *b, int epoch, const int *idx, int n) {
+    float img[IMG_SIZE][IMG_SIZE];
+    RngStream rng;
+    int k;
+    for (k = 0; k < n; k++) {
+        b->labels[k] = l->ds->labels[idx[k]];
+        if (l->augment) {
+            rng_stream(&rng, l->seed, RNG_AUGMENT, (uint64_t)epoch << 32 | (uint32_t)idx[k]);
+            dataset_image(l->ds, idx[k], img);
+            augment_glyph(img, b->imgs[k], &rng);
+        } else {
+            dataset_image(l->ds, idx[k], b->imgs[k]);
+        }
+    }
+    b->n = n;
+}
+
+static void *loader_main(void *arg) {
+    Loader *l = arg;
+    int count = l->count;
+    int epoch, i;
+    long seq = 0;
+
+    for (epoch = l->first_epoch; epoch < l->epochs; epoch++) {
+        LoaderEpochState *st = &l->states[epoch - l->first_epoch];
+        RngStream rng;
+        rng_stream(&rng, l->seed, RNG_SHUFFLE, (uint64_t)epoch);
+        shuffle_indices(l->indices, count, &rng);
+        memcpy(st->indices, l->indices, sizeof(int) * count);
+        for (i = 0; i < count; i += l->batch_size, seq++) {
+            int n = count - i < l->batch_size ? count - i : l->batch_size;
+
+            pthread_mutex_lock(&l->lock);
+            while (seq - l->consumed >= LOADER_RING && !l->stop) {
+                pthread_cond_wait(&l->space, &l->lock);
+            }
+            int stop = l->stop;
+            pthread_mutex_unlock(&l->lock);
+            if (stop) return NULL;
+
+            /* L'emplacement n'est plus lu par le consommateur */
+            fill_batch(l, &l->ring[seq % LOADER_RING], epoch, l->indices + i, n);
+
+            pthread_mutex_lock(&l->lock);
+            l->produced = seq + 1;
+            pthread_cond_signal(&l->ready);
+            pthread_mutex_unlock(&l->lock);
+        }
+    }
+    return NULL;
+}
+
+static void loader_free(Loader *l) {
+    int k;
+    for (k = 0; k < LOADER_RING; k++) {
+        free(l->ring[k].imgs);
+        free(l->ring[k].labels);
+    }
+    for (k = 0; l->states && k < l->epochs - l->first_epoch; k++) {
+        free(l->states[k].indices);
+    }
+    free(l->states);
+    free(l->indices);
+    free(l);
+}
+
+Loader *loader_start(const Dataset *ds, const int *samples, int count, int batch_size,
+                     int first_epoch, int epochs, int augment, uint32_t seed,
+                     const LoaderEpochState *resume) {
+    int k;
+    if (first_epoch >= epochs) return NULL;
+    Loader *l = calloc(1, sizeof(*l));
+    if (!l) return NULL;
+    l->ds = ds;
+    l->count = count;
+    l->batch_size = batch_size;
+    l->first_epoch = first_epoch;
+    l->epochs = epochs;
+    l->augment = augment;
+    l->seed = seed;
+    l->total = (long)(epochs - first_epoch) * ((count + batch_size - 1) / batch_size);
+    l->indices = malloc(sizeof(int) * count);
+    l->states = calloc(epochs - first_epoch, sizeof(*l->states));
+    int ok = l->indices && l->states;
+    for (k = 0; ok && k < epochs - first_epoch; k++) {
+        l->states[k].indices = malloc(sizeof(int) * count);
+        ok = l->states[k].indices != NULL;
+    }
+    for (k = 0; k < LOADER_RING && ok; k++) {
+        l->ring[k].imgs = malloc(sizeof(*l->ring[k].imgs) * batch_size);
+        l->ring[k].labels = malloc(batch_size);
+        ok = l->ring[k].imgs && l->ring[k].labels;
+    }
+    if (!ok) {
+        loader_free(l);
+        return NULL;
+    }
+    if (resume) {
+        memcpy(l->indices, resume->indices, sizeof(int) * count);
+    } else {
+        memcpy(l->indices, samples, sizeof(int) * count);
+    }
+
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->ready, NULL);
+    pthread_cond_init(&l->space, NULL);
+    if (pthread_create(&l->thread, NULL, loader_main, l) != 0) {
+        printf("Erreur: impossible de créer le thread de chargement\n");
+        pthread_cond_destroy(&l->space);
+        pthread_cond_destroy(&l->ready);
+        pthread_mutex_destroy(&l->lock);
+        loader_free(l);
+        return NULL;
+    }
+    return l;
+}
+
+const LoaderBatch *loader_next(Loader *l) {
+    if (l->taken >= l->total) return NULL;
+    double t0 = now_seconds();
+    pthread_mutex_lock(&l->lock);
+    while (l->produced <= l->taken) {
+        pthread_cond_wait(&l->ready, &l->lock);
+    }
+    pthread_mutex_unlock(&l->lock);
+    l->wait_seconds += now_seconds() - t0;
+    return &l->ring[l->taken++ % LOADER_RING];
+}
+
+void loader_release(Loader *l) {
+    pthread_mutex_lock(&l->lock);
+    l->consumed = l->taken;
+    pthread_cond_signal(&l->space);
+    pthread_mutex_unlock(&l->lock);
+}
+
+const LoaderEpochState *loader_epoch_state(const Loader *l, int epoch) {
+    return &l->states[epoch - l->first_epoch];
+}
+
+double loader_wait_seconds(const Loader *l) {
+    return l->wait_seconds;
+}
+
+void loader_stop(Loader *l) {
+    if (!l) return;
+    pthread_mutex_lock(&l->lock);
+    l->stop = 1;
+    pthread_cond_signal(&l->space);
+    pthread_mutex_unlock(&l->lock);
+    pthread_join(l->thread, NULL);
+    pthread_cond_destroy(&l->space);
+    pthread_cond_destroy(&l->ready);
+    pthread_mutex_destroy(&l->lock);
+    loader_free(l);
+}
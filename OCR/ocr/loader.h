@@ -0,0 +1,84 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+#include "dataset.h"
+#include "rng.h"
+
+/*
+ * Chargement asynchrone des lots d'entraînement.
+ *
+ * Un thread producteur mélange les indices à chaque époque, décode les
+ * images du jeu compacté, les augmente éventuellement et range les lots
+ * prêts dans un anneau de LOADER_RING emplacements. Le thread
+ * d'entraînement prend le lot suivant (loader_next), le traite, puis rend
+ * son emplacement (loader_release): le décodage et l'augmentation du lot
+ * k+1 se font pendant le calcul du lot k.
+ *
+ * Le décodage d'un glyphe compacté et son augmentation coûtent quelques
+ * microsecondes, contre ~2 ms de forward + backward: un seul producteur
+ * suffit à garder d'avance tout l'anneau.
+ */
+
+/* Lots préparés d'avance */
+#define LOADER_RING 4
+
+/* Augmentation (fond = 1.0, encre = 0.0, comme read_pbm) */
+#define AUG_MAX_ROTATION 8.0f   /* degrés, tirage uniforme dans [-max, max] */
+#define AUG_MAX_SHIFT 3         /* pixels, sur chaque axe */
+#define AUG_THICKEN_PROB 0.3f   /* épaississement du trait d'un pixel */
+#define AUG_NOISE_PROB 0.5f     /* bruit poivre et sel puis nettoyage */
+#define AUG_NOISE_RATE 0.06f    /* proportion de pixels inversés */
+
+typedef struct {
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    uint8_t *labels;
+    int n;
+} LoaderBatch;
+
+typedef struct Loader Loader;
+
+/* Ordre des échantillons d'une époque: avec la graine, de quoi reprendre
+ * un entraînement interrompu exactement à l'époque suivante (les tirages
+ * ne dépendent que de la graine, de l'époque et de l'échantillon, rng.h) */
+typedef struct {
+    int *indices;               /* ordre des échantillons de l'époque (count) */
+} LoaderEpochState;
+
+/* Démarre le producteur pour les époques first_epoch..epochs-1 sur les
+ * count images samples[] de ds (le jeu d'entraînement sans la validation),
+ * en lots de batch_size. Chaque époque mélange l'ordre de la précédente
+ * (flux RNG_SHUFFLE de l'époque), chaque échantillon est augmenté avec le
+ * flux RNG_AUGMENT de (époque, indice dans ds). resume (NULL pour un
+ * premier départ: ordre de samples) est l'état de la fin de l'époque
+ * first_epoch - 1. NULL en cas d'erreur. */
+Loader *loader_start(const Dataset *ds, const int *samples, int count, int batch_size,
+                     int first_epoch, int epochs, int augment, uint32_t seed,
+                     const LoaderEpochState *resume);
+
+/* État de la fin de l'époque epoch; disponible dès que tous ses lots ont
+ * été obtenus par loader_next() */
+const LoaderEpochState *loader_epoch_state(const Loader *loader, int epoch);
+
+/* Prochain lot, dans l'ordre; attend qu'il soit prêt. NULL après le
+ * dernier lot de la dernière époque. */
+const LoaderBatch *loader_next(Loader *loader);
+
+/* Rend l'emplacement du lot obtenu par le dernier loader_next() */
+void loader_release(Loader *loader);
+
+/* Secondes passées par loader_next() à attendre un lot */
+double loader_wait_seconds(const Loader *loader);
+
+/* Arrête le producteur (même en cours d'époque) et libère tout */
+void loader_stop(Loader *loader);
+
+/* Version augmentée de src dans dst (fond 1.0, encre 0.0):
+ * rotation + translation, épaississement du trait, puis bruit nettoyé
+ * par le même filtre majoritaire pondéré que Preprocessing/cleaner.c */
+void augment_glyph(float src[IMG_SIZE][IMG_SIZE], float dst[IMG_SIZE][IMG_SIZE],
+                   RngStream *rng);
+
+#endif
@@ -1,88 +1,47 @@
 /*
- * CNN pour reconnaissance de lettres - Utilise uniquement stdio.h
+ * CNN pour reconnaissance de lettres
  * Architecture: Conv -> ReLU -> Pool -> Conv -> ReLU -> Pool -> FC -> FC -> Softmax
  * Images d'entrée: 50x50 pixels en niveaux de gris
  * Sortie: 26 classes (A-Z)
  */
 
-#include <stdio.h>
-
-/* ============================================================
- * CONSTANTES ET CONFIGURATION
- * ============================================================ */
-
-#define IMG_SIZE 50
-#define NUM_CLASSES 26
-
-/* Architecture du réseau - VERSION AUGMENTÉE */
-#define CONV1_FILTERS 16      /* 8 → 16 */
-#define CONV1_SIZE 5
-#define POOL1_SIZE 2
-#define AFTER_POOL1 23
-
-#define CONV2_FILTERS 32      /* 16 → 32 */
-#define CONV2_SIZE 3
-#define AFTER_POOL2 10
-
-#define FC1_SIZE 256          /* 128 → 256 */
-#define FC2_SIZE NUM_CLASSES
+#define _POSIX_C_SOURCE 199309L
 
-#define FLATTEN_SIZE (CONV2_FILTERS * AFTER_POOL2 * AFTER_POOL2)  /* sera 32*10*10 = 3200 */
-
-/* Hyperparamètres */
-#define LEARNING_RATE 0.0005f  /* réduire un peu car réseau plus grand */
-#define EPOCHS 20              /* peut nécessiter plus d'époques */
-#define SAMPLES_PER_LETTER 1000
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#include "cnn.h"
+#include "fastmath.h"
+#include "glyph_cache.h"
+#include "half.h"
+#include "model_bin.h"
+#include "batch.h"
+#include "conv.h"
+#include "dataset.h"
+#include "loader.h"
+#include "optim.h"
+#include "checkpoint.h"
+#include "distill.h"
+#include "prefilter.h"
+#include "prune.h"
+#include "validation.h"
+#include "quant.h"
+#include "rng.h"
+#include "server.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "topk.h"
+#include "topology.h"
 
 /* ============================================================
  * FONCTIONS MATHÉMATIQUES DE BASE
  * ============================================================ */
 
-static unsigned int rand_seed = 42;
-
-float my_rand(void) {
-    rand_seed = rand_seed * 1103515245 + 12345;
-    return (float)((rand_seed >> 16) & 0x7FFF) / 32767.0f;
-}
-
-float my_exp(float x) {
-    /* Approximation de e^x par série de Taylor */
-    if (x > 20.0f) return 485165195.4f;
-    if (x < -20.0f) return 0.0f;
-    
-    float result = 1.0f;
-    float term = 1.0f;
-    int i;
-    for (i = 1; i <= 20; i++) {
-        term *= x / (float)i;
-        result += term;
-    }
-    return result;
-}
-
-float my_log(float x) {
-    /* Approximation de ln(x) */
-    if (x <= 0.0f) return -1000.0f;
-    if (x < 0.0001f) return -1000.0f;
-    
-    /* Normalisation: ln(x) = ln(m * 2^e) = ln(m) + e*ln(2) */
-    float result = 0.0f;
-    while (x > 2.0f) { x /= 2.0f; result += 0.693147f; }
-    while (x < 0.5f) { x *= 2.0f; result -= 0.693147f; }
-    
-    /* Série de Taylor pour ln(1+y) où y = x-1 */
-    float y = x - 1.0f;
-    float term = y;
-    float sign = 1.0f;
-    int i;
-    for (i = 1; i <= 30; i++) {
-        result += sign * term / (float)i;
-        term *= y;
-        sign = -sign;
-    }
-    return result;
-}
-
 float my_sqrt(float x) {
     if (x <= 0.0f) return 0.0f;
     float guess = x / 2.0f;
@@ -101,123 +60,143 @@ float relu_derivative(float x) {
     return x > 0.0f ? 1.0f : 0.0f;
 }
 
-/* ============================================================
- * STRUCTURE DU RÉSEAU DE NEURONES
- * ============================================================ */
-
-typedef struct {
-    /* Couche Conv1: 8 filtres 5x5 */
-    float conv1_weights[CONV1_FILTERS][CONV1_SIZE][CONV1_SIZE];
-    float conv1_bias[CONV1_FILTERS];
-    
-    /* Couche Conv2: 16 filtres 3x3x8 */
-    float conv2_weights[CONV2_FILTERS][CONV1_FILTERS][CONV2_SIZE][CONV2_SIZE];
-    float conv2_bias[CONV2_FILTERS];
-    
-    /* Couche FC1: FLATTEN_SIZE -> FC1_SIZE */
-    float fc1_weights[FC1_SIZE][FLATTEN_SIZE];
-    float fc1_bias[FC1_SIZE];
-    
-    /* Couche FC2: FC1_SIZE -> NUM_CLASSES */
-    float fc2_weights[FC2_SIZE][FC1_SIZE];
-    float fc2_bias[FC2_SIZE];
-} CNN;
-
-/* Buffers pour la propagation avant et arrière */
-typedef struct {
-    float input[IMG_SIZE][IMG_SIZE];
-    
-    /* Sorties Conv1 */
-    float conv1_out[CONV1_FILTERS][IMG_SIZE - CONV1_SIZE + 1][IMG_SIZE - CONV1_SIZE + 1];
-    float relu1_out[CONV1_FILTERS][IMG_SIZE - CONV1_SIZE + 1][IMG_SIZE - CONV1_SIZE + 1];
-    float pool1_out[CONV1_FILTERS][AFTER_POOL1][AFTER_POOL1];
-    int pool1_max_i[CONV1_FILTERS][AFTER_POOL1][AFTER_POOL1];
-    int pool1_max_j[CONV1_FILTERS][AFTER_POOL1][AFTER_POOL1];
-    
-    /* Sorties Conv2 */
-    float conv2_out[CONV2_FILTERS][AFTER_POOL1 - CONV2_SIZE + 1][AFTER_POOL1 - CONV2_SIZE + 1];
-    float relu2_out[CONV2_FILTERS][AFTER_POOL1 - CONV2_SIZE + 1][AFTER_POOL1 - CONV2_SIZE + 1];
-    float pool2_out[CONV2_FILTERS][AFTER_POOL2][AFTER_POOL2];
-    int pool2_max_i[CONV2_FILTERS][AFTER_POOL2][AFTER_POOL2];
-    int pool2_max_j[CONV2_FILTERS][AFTER_POOL2][AFTER_POOL2];
-    
-    /* Vecteur aplati */
-    float flatten[FLATTEN_SIZE];
-    
-    /* Sorties FC */
-    float fc1_out[FC1_SIZE];
-    float relu3_out[FC1_SIZE];
-    float fc2_out[FC2_SIZE];
-    float softmax_out[NUM_CLASSES];
-} ForwardCache;
-
-/* Gradients */
-typedef struct {
-    float conv1_weights[CONV1_FILTERS][CONV1_SIZE][CONV1_SIZE];
-    float conv1_bias[CONV1_FILTERS];
-    float conv2_weights[CONV2_FILTERS][CONV1_FILTERS][CONV2_SIZE][CONV2_SIZE];
-    float conv2_bias[CONV2_FILTERS];
-    float fc1_weights[FC1_SIZE][FLATTEN_SIZE];
-    float fc1_bias[FC1_SIZE];
-    float fc2_weights[FC2_SIZE][FC1_SIZE];
-    float fc2_bias[FC2_SIZE];
-} Gradients;
-
 /* Variables globales */
-static CNN network;
+static CNN network;                /* arène propre (cnn_alloc), vide au départ */
+static CNN *net = &network;        /* &network, ou les vues d'un model.bin mappé */
+static ModelMapping net_mapping;
 static ForwardCache cache;
 static Gradients grads;
+static ConvWorkspace conv_ws;      /* tampons im2col de forward()/backward() */
+static Arena conv_arena;
+static Topology work_topo;         /* topologie de cache, grads, conv_ws et predict_ws */
+static QuantCNN *qnet = NULL;      /* modèle INT8, si c'est un model.q8 qui a été chargé */
+static QuantWorkspace *qws = NULL;
+static HalfCNN *hnet = NULL;       /* poids FC sur 16 bits (model.h16), net == &hnet->net */
+static BatchWorkspace *predict_ws = NULL;  /* chemin d'inférence fusionné de predict() */
+static int sparse_backward = 1;            /* propagation arrière creuse (conv_backward_sparse) */
+static SparseFc1 *fc1_sparse = NULL;       /* FC1 d'un modèle élagué chargé pour l'inférence */
+static GlyphCache *glyph_cache = NULL;      /* résultats par glyphe (mode 3), NULL: sans cache */
+static int use_winograd = 0;                /* CONV2 d'inférence par Winograd (--winograd) */
+static Conv2Winograd *conv2_wino = NULL;
+static ModelMapping student_mapping;        /* élève de la cascade (mode 3, --student) */
+static const CNN *student = NULL;           /* &student_mapping.net, NULL: sans cascade */
+static Conv2Winograd *student_wino = NULL;
+static float cascade_threshold = CASCADE_THRESHOLD;
+static long cascade_glyphs = 0;             /* glyphes passés dans l'élève */
+static long cascade_fallbacks = 0;          /* dont repassés dans le modèle complet */
+
+/* (Ré)alloue les tampons globaux de forward()/backward() pour la
+ * topologie de net; rien à faire si elle n'a pas changé */
+static int ensure_workspace(void) {
+    if (cache.arena && topology_equal(&work_topo, &net->topo)) return 0;
+    forward_cache_free(&cache);
+    cnn_free(&grads);
+    arena_free(&conv_arena);
+    batch_workspace_free(predict_ws);
+    predict_ws = NULL;
+
+    arena_measure(&conv_arena);
+    conv_workspace_carve(&conv_ws, &net->topo, &conv_arena);
+    if (forward_cache_alloc(&cache, &net->topo) != 0 || cnn_alloc(&grads, &net->topo) != 0 ||
+        arena_init(&conv_arena, conv_arena.used) != 0) {
+        printf("Erreur: mémoire insuffisante\n");
+        forward_cache_free(&cache);
+        cnn_free(&grads);
+        return -1;
+    }
+    conv_workspace_carve(&conv_ws, &net->topo, &conv_arena);
+    work_topo = net->topo;
+    return 0;
+}
+
+/* Revient sur le réseau propre (libère un éventuel model.bin mappé ou
+ * model.h16 chargé) */
+static void use_static_network(void) {
+    model_bin_unmap(&net_mapping);
+    half_free(hnet);
+    hnet = NULL;
+    net = &network;
+}
+
+/* Réseau propre de topologie t (paramètres à zéro si l'arène change) */
+static int reset_network(const Topology *t) {
+    use_static_network();
+    if (!network.owned || !topology_equal(&network.topo, t)) {
+        cnn_free(&network);
+        if (cnn_alloc(&network, t) != 0) {
+            printf("Erreur: mémoire insuffisante\n");
+            return -1;
+        }
+    }
+    return ensure_workspace();
+}
 
 /* ============================================================
  * INITIALISATION
  * ============================================================ */
 
-float xavier_init(int fan_in, int fan_out) {
+float xavier_init(RngStream *r, int fan_in, int fan_out) {
     /* Initialisation Xavier/Glorot */
     float limit = my_sqrt(6.0f / (float)(fan_in + fan_out));
-    return (my_rand() * 2.0f - 1.0f) * limit;
+    return (rng_unit(r) * 2.0f - 1.0f) * limit;
 }
 
-void init_network(void) {
+/* Poids initiaux tirés de la graine seed, un flux RNG_INIT par couche */
+int init_network(const Topology *t, uint32_t seed) {
+    RngStream r;
     int f, c, i, j;
     
-    /* Conv1: fan_in = 5*5 = 25, fan_out = 8 */
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < CONV1_SIZE; i++) {
-            for (j = 0; j < CONV1_SIZE; j++) {
-                network.conv1_weights[f][i][j] = xavier_init(25, CONV1_FILTERS);
+    if (reset_network(t) != 0) return -1;
+    const int K1 = t->conv1_size, F1 = t->conv1_filters;
+    const int K2 = t->conv2_size, F2 = t->conv2_filters;
+    const int H = t->fc1_size, N = t->flatten;
+    float (*conv1_w)[K1][K1] = (float (*)[K1][K1])net->conv1_weights;
+    float (*conv2_w)[F1][K2][K2] = (float (*)[F1][K2][K2])net->conv2_weights;
+    float (*fc1_w)[N] = (float (*)[N])net->fc1_weights;
+    float (*fc2_w)[H] = (float (*)[H])net->fc2_weights;
+    
+    /* Conv1: fan_in = 5*5 = 25 par défaut */
+    rng_stream(&r, seed, RNG_INIT, 0);
+    for (f = 0; f < F1; f++) {
+        for (i = 0; i < K1; i++) {
+            for (j = 0; j < K1; j++) {
+                conv1_w[f][i][j] = xavier_init(&r, K1 * K1, F1);
             }
         }
-        network.conv1_bias[f] = 0.0f;
+        net->conv1_bias[f] = 0.0f;
     }
     
-    /* Conv2: fan_in = 8*3*3 = 72, fan_out = 16 */
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (c = 0; c < CONV1_FILTERS; c++) {
-            for (i = 0; i < CONV2_SIZE; i++) {
-                for (j = 0; j < CONV2_SIZE; j++) {
-                    network.conv2_weights[f][c][i][j] = xavier_init(72, CONV2_FILTERS);
+    /* Conv2: fan_in = 16*3*3 = 144 par défaut */
+    rng_stream(&r, seed, RNG_INIT, 1);
+    for (f = 0; f < F2; f++) {
+        for (c = 0; c < F1; c++) {
+            for (i = 0; i < K2; i++) {
+                for (j = 0; j < K2; j++) {
+                    conv2_w[f][c][i][j] = xavier_init(&r, F1 * K2 * K2, F2);
                 }
             }
         }
-        network.conv2_bias[f] = 0.0f;
+        net->conv2_bias[f] = 0.0f;
     }
     
     /* FC1 */
-    for (i = 0; i < FC1_SIZE; i++) {
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            network.fc1_weights[i][j] = xavier_init(FLATTEN_SIZE, FC1_SIZE);
+    rng_stream(&r, seed, RNG_INIT, 2);
+    for (i = 0; i < H; i++) {
+        for (j = 0; j < N; j++) {
+            fc1_w[i][j] = xavier_init(&r, N, H);
         }
-        network.fc1_bias[i] = 0.0f;
+        net->fc1_bias[i] = 0.0f;
     }
     
     /* FC2 */
+    rng_stream(&r, seed, RNG_INIT, 3);
     for (i = 0; i < FC2_SIZE; i++) {
-        for (j = 0; j < FC1_SIZE; j++) {
-            network.fc2_weights[i][j] = xavier_init(FC1_SIZE, FC2_SIZE);
+        for (j = 0; j < H; j++) {
+            fc2_w[i][j] = xavier_init(&r, H, FC2_SIZE);
         }
-        network.fc2_bias[i] = 0.0f;
+        net->fc2_bias[i] = 0.0f;
     }
+    return 0;
 }
 
 /* ============================================================
@@ -380,39 +359,50 @@ int read_pbm(const char *filename, float img[IMG_SIZE][IMG_SIZE]) {
  * PROPAGATION AVANT
  * ============================================================ */
 
-void forward(float input[IMG_SIZE][IMG_SIZE]) {
-    int f, c, i, j, ki, kj, pi, pj;
+/* Corps de forward_pass(), spécialisé par topology_is_default() */
+TOPO_SPECIALIZE void forward_pass_impl(const CNN *model, ForwardCache *c, ConvWorkspace *ws,
+                                       float input[IMG_SIZE][IMG_SIZE],
+                                       const int F1, const int K1, const int F2,
+                                       const int K2, const int H) {
+    const int O1 = IMG_SIZE - K1 + 1, P1 = O1 / POOL1_SIZE;
+    const int O2 = P1 - K2 + 1, P2 = O2 / POOL1_SIZE;
+    const int N = F2 * P2 * P2;
+    float (*conv1_out)[O1][O1] = (float (*)[O1][O1])c->conv1_out;
+    float (*relu1_out)[O1][O1] = (float (*)[O1][O1])c->relu1_out;
+    float (*pool1_out)[P1][P1] = (float (*)[P1][P1])c->pool1_out;
+    int (*pool1_max_i)[P1][P1] = (int (*)[P1][P1])c->pool1_max_i;
+    int (*pool1_max_j)[P1][P1] = (int (*)[P1][P1])c->pool1_max_j;
+    float (*conv2_out)[O2][O2] = (float (*)[O2][O2])c->conv2_out;
+    float (*relu2_out)[O2][O2] = (float (*)[O2][O2])c->relu2_out;
+    float (*pool2_out)[P2][P2] = (float (*)[P2][P2])c->pool2_out;
+    int (*pool2_max_i)[P2][P2] = (int (*)[P2][P2])c->pool2_max_i;
+    int (*pool2_max_j)[P2][P2] = (int (*)[P2][P2])c->pool2_max_j;
+    int f, i, j, pi, pj;
     float sum, max_val;
     int max_i, max_j;
     
     /* Copier l'entrée */
     for (i = 0; i < IMG_SIZE; i++) {
         for (j = 0; j < IMG_SIZE; j++) {
-            cache.input[i][j] = input[i][j];
+            c->input[i][j] = input[i][j];
         }
     }
     
     /* ========== CONV1 ========== */
-    int conv1_out_size = IMG_SIZE - CONV1_SIZE + 1;
-    for (f = 0; f < CONV1_FILTERS; f++) {
+    int conv1_out_size = O1;
+    conv1_forward(model, &c->input[0][0], c->conv1_out, ws);
+    for (f = 0; f < F1; f++) {
         for (i = 0; i < conv1_out_size; i++) {
             for (j = 0; j < conv1_out_size; j++) {
-                sum = network.conv1_bias[f];
-                for (ki = 0; ki < CONV1_SIZE; ki++) {
-                    for (kj = 0; kj < CONV1_SIZE; kj++) {
-                        sum += cache.input[i + ki][j + kj] * network.conv1_weights[f][ki][kj];
-                    }
-                }
-                cache.conv1_out[f][i][j] = sum;
-                cache.relu1_out[f][i][j] = relu(sum);
+                relu1_out[f][i][j] = relu(conv1_out[f][i][j]);
             }
         }
     }
     
     /* ========== POOL1 (Max Pooling 2x2) ========== */
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL1; i++) {
-            for (j = 0; j < AFTER_POOL1; j++) {
+    for (f = 0; f < F1; f++) {
+        for (i = 0; i < P1; i++) {
+            for (j = 0; j < P1; j++) {
                 max_val = -1e10f;
                 max_i = 0;
                 max_j = 0;
@@ -421,45 +411,36 @@ void forward(float input[IMG_SIZE][IMG_SIZE]) {
                         int ii = i * POOL1_SIZE + pi;
                         int jj = j * POOL1_SIZE + pj;
                         if (ii < conv1_out_size && jj < conv1_out_size) {
-                            if (cache.relu1_out[f][ii][jj] > max_val) {
-                                max_val = cache.relu1_out[f][ii][jj];
+                            if (relu1_out[f][ii][jj] > max_val) {
+                                max_val = relu1_out[f][ii][jj];
                                 max_i = ii;
                                 max_j = jj;
                             }
                         }
                     }
                 }
-                cache.pool1_out[f][i][j] = max_val;
-                cache.pool1_max_i[f][i][j] = max_i;
-                cache.pool1_max_j[f][i][j] = max_j;
+                pool1_out[f][i][j] = max_val;
+                pool1_max_i[f][i][j] = max_i;
+                pool1_max_j[f][i][j] = max_j;
             }
         }
     }
     
     /* ========== CONV2 ========== */
-    int conv2_out_size = AFTER_POOL1 - CONV2_SIZE + 1;
-    for (f = 0; f < CONV2_FILTERS; f++) {
+    int conv2_out_size = O2;
+    conv2_forward(model, c->pool1_out, c->conv2_out, ws);
+    for (f = 0; f < F2; f++) {
         for (i = 0; i < conv2_out_size; i++) {
             for (j = 0; j < conv2_out_size; j++) {
-                sum = network.conv2_bias[f];
-                for (c = 0; c < CONV1_FILTERS; c++) {
-                    for (ki = 0; ki < CONV2_SIZE; ki++) {
-                        for (kj = 0; kj < CONV2_SIZE; kj++) {
-                            sum += cache.pool1_out[c][i + ki][j + kj] * 
-                                   network.conv2_weights[f][c][ki][kj];
-                        }
-                    }
-                }
-                cache.conv2_out[f][i][j] = sum;
-                cache.relu2_out[f][i][j] = relu(sum);
+                relu2_out[f][i][j] = relu(conv2_out[f][i][j]);
             }
         }
     }
     
     /* ========== POOL2 ========== */
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL2; i++) {
-            for (j = 0; j < AFTER_POOL2; j++) {
+    for (f = 0; f < F2; f++) {
+        for (i = 0; i < P2; i++) {
+            for (j = 0; j < P2; j++) {
                 max_val = -1e10f;
                 max_i = 0;
                 max_j = 0;
@@ -468,174 +449,218 @@ void forward(float input[IMG_SIZE][IMG_SIZE]) {
                         int ii = i * POOL1_SIZE + pi;
                         int jj = j * POOL1_SIZE + pj;
                         if (ii < conv2_out_size && jj < conv2_out_size) {
-                            if (cache.relu2_out[f][ii][jj] > max_val) {
-                                max_val = cache.relu2_out[f][ii][jj];
+                            if (relu2_out[f][ii][jj] > max_val) {
+                                max_val = relu2_out[f][ii][jj];
                                 max_i = ii;
                                 max_j = jj;
                             }
                         }
                     }
                 }
-                cache.pool2_out[f][i][j] = max_val;
-                cache.pool2_max_i[f][i][j] = max_i;
-                cache.pool2_max_j[f][i][j] = max_j;
+                pool2_out[f][i][j] = max_val;
+                pool2_max_i[f][i][j] = max_i;
+                pool2_max_j[f][i][j] = max_j;
             }
         }
     }
     
     /* ========== FLATTEN ========== */
     int idx = 0;
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL2; i++) {
-            for (j = 0; j < AFTER_POOL2; j++) {
-                cache.flatten[idx++] = cache.pool2_out[f][i][j];
+    for (f = 0; f < F2; f++) {
+        for (i = 0; i < P2; i++) {
+            for (j = 0; j < P2; j++) {
+                c->flatten[idx++] = pool2_out[f][i][j];
             }
         }
     }
     
     /* ========== FC1 ========== */
-    for (i = 0; i < FC1_SIZE; i++) {
-        sum = network.fc1_bias[i];
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            sum += cache.flatten[j] * network.fc1_weights[i][j];
-        }
-        cache.fc1_out[i] = sum;
-        cache.relu3_out[i] = relu(sum);
+    for (i = 0; i < H; i++) {
+        sum = model->fc1_bias[i] + simd->dot(model->fc1_weights + (size_t)i * N, c->flatten, N);
+        c->fc1_out[i] = sum;
+        c->relu3_out[i] = relu(sum);
     }
     
     /* ========== FC2 ========== */
     for (i = 0; i < FC2_SIZE; i++) {
-        sum = network.fc2_bias[i];
-        for (j = 0; j < FC1_SIZE; j++) {
-            sum += cache.relu3_out[j] * network.fc2_weights[i][j];
-        }
-        cache.fc2_out[i] = sum;
+        c->fc2_out[i] = model->fc2_bias[i] +
+                           simd->dot(model->fc2_weights + (size_t)i * H, c->relu3_out, H);
     }
     
     /* ========== SOFTMAX ========== */
-    float max_logit = cache.fc2_out[0];
-    for (i = 1; i < NUM_CLASSES; i++) {
-        if (cache.fc2_out[i] > max_logit) max_logit = cache.fc2_out[i];
-    }
-    
-    float exp_sum = 0.0f;
-    for (i = 0; i < NUM_CLASSES; i++) {
-        cache.softmax_out[i] = my_exp(cache.fc2_out[i] - max_logit);
-        exp_sum += cache.softmax_out[i];
-    }
-    for (i = 0; i < NUM_CLASSES; i++) {
-        cache.softmax_out[i] /= exp_sum;
-        if (cache.softmax_out[i] < 1e-7f) cache.softmax_out[i] = 1e-7f;
+    softmax(c->fc2_out, c->softmax_out, NUM_CLASSES);
+}
+
+/* Propagation avant complète de model, tenseurs intermédiaires gardés dans c
+ * pour backward_pass(). model n'est que lu: plusieurs threads peuvent
+ * l'appeler en parallèle avec des c / ws différents. c et ws sont
+ * dimensionnés pour la topologie de model. */
+static void forward_pass(const CNN *model, ForwardCache *c, ConvWorkspace *ws,
+                         float input[IMG_SIZE][IMG_SIZE]) {
+    const Topology *t = &model->topo;
+    if (topology_is_default(t)) {
+        forward_pass_impl(model, c, ws, input, CONV1_FILTERS, CONV1_SIZE, CONV2_FILTERS,
+                          CONV2_SIZE, FC1_SIZE);
+    } else {
+        forward_pass_impl(model, c, ws, input, t->conv1_filters, t->conv1_size,
+                          t->conv2_filters, t->conv2_size, t->fc1_size);
     }
 }
 
+void forward(float input[IMG_SIZE][IMG_SIZE]) {
+    forward_pass(net, &cache, &conv_ws, input);
+}
+
 /* ============================================================
  * PROPAGATION ARRIÈRE
  * ============================================================ */
 
-void zero_gradients(void) {
-    int f, c, i, j;
-    
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < CONV1_SIZE; i++) {
-            for (j = 0; j < CONV1_SIZE; j++) {
-                grads.conv1_weights[f][i][j] = 0.0f;
+static void zero_grads(Gradients *g) {
+    memset(g->data, 0, sizeof(float) * g->count);
+}
+
+/* Pool2, ReLU2, CONV2, Pool1, ReLU1 et CONV1 en arrière sans tampons
+ * denses: seul le max de chaque fenêtre de pooling reçoit un gradient, et
+ * seulement si sa ReLU est active. Ces positions sont listées filtre par
+ * filtre, puis les convolutions ne parcourent qu'elles (conv.h). Mêmes
+ * gradients que la version dense à l'arrondi près. */
+TOPO_SPECIALIZE void conv_backward_sparse(const CNN *model, ForwardCache *c, Gradients *g,
+                                          ConvWorkspace *ws, const int F1, const int K1,
+                                          const int F2, const int K2) {
+    const int O1 = IMG_SIZE - K1 + 1, P1 = O1 / POOL1_SIZE;
+    const int O2 = P1 - K2 + 1, P2 = O2 / POOL1_SIZE;
+    const float *d_pool2 = c->d_flatten;
+    const float *d_pool1 = c->d_pool1;
+    ConvActive *a2 = &ws->active2, *a1 = &ws->active1;
+    int f, k, n = 0;
+    
+    for (f = 0; f < F2; f++) {
+        a2->start[f] = n;
+        for (k = f * P2 * P2; k < (f + 1) * P2 * P2; k++) {
+            int p = c->pool2_max_i[k] * O2 + c->pool2_max_j[k];
+            if (d_pool2[k] != 0.0f && c->conv2_out[(size_t)f * O2 * O2 + p] > 0.0f) {
+                a2->pos[n] = p;
+                a2->grad[n++] = d_pool2[k];
             }
         }
-        grads.conv1_bias[f] = 0.0f;
     }
-    
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (c = 0; c < CONV1_FILTERS; c++) {
-            for (i = 0; i < CONV2_SIZE; i++) {
-                for (j = 0; j < CONV2_SIZE; j++) {
-                    grads.conv2_weights[f][c][i][j] = 0.0f;
-                }
+    a2->start[F2] = n;
+    conv2_backward_active(model, c->pool1_out, a2, g->conv2_weights, g->conv2_bias,
+                          c->d_pool1, ws);
+    
+    n = 0;
+    for (f = 0; f < F1; f++) {
+        a1->start[f] = n;
+        for (k = f * P1 * P1; k < (f + 1) * P1 * P1; k++) {
+            int p = c->pool1_max_i[k] * O1 + c->pool1_max_j[k];
+            if (d_pool1[k] != 0.0f && c->conv1_out[(size_t)f * O1 * O1 + p] > 0.0f) {
+                a1->pos[n] = p;
+                a1->grad[n++] = d_pool1[k];
             }
         }
-        grads.conv2_bias[f] = 0.0f;
-    }
-    
-    for (i = 0; i < FC1_SIZE; i++) {
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            grads.fc1_weights[i][j] = 0.0f;
-        }
-        grads.fc1_bias[i] = 0.0f;
-    }
-    
-    for (i = 0; i < FC2_SIZE; i++) {
-        for (j = 0; j < FC1_SIZE; j++) {
-            grads.fc2_weights[i][j] = 0.0f;
-        }
-        grads.fc2_bias[i] = 0.0f;
     }
+    a1->start[F1] = n;
+    conv1_backward_active(&model->topo, &c->input[0][0], a1, g->conv1_weights, g->conv1_bias);
 }
 
-void backward(int label) {
-    int f, c, i, j, ki, kj;
-    
-    /* Gradient de la loss (Cross-Entropy + Softmax) */
+/* Corps de backward_pass(), spécialisé comme forward_pass_impl() */
+TOPO_SPECIALIZE void backward_pass_impl(const CNN *model, ForwardCache *c, Gradients *g,
+                                        ConvWorkspace *ws, int label,
+                                        const float *d_logits, const int F1, const int K1, const int F2,
+                                        const int K2, const int H) {
+    const Topology *t = &model->topo;
+    const int O1 = IMG_SIZE - K1 + 1, P1 = O1 / POOL1_SIZE;
+    const int O2 = P1 - K2 + 1, P2 = O2 / POOL1_SIZE;
+    const int N = F2 * P2 * P2;
+    const float (*fc1_w)[N] = (const float (*)[N])model->fc1_weights;
+    const float (*fc2_w)[H] = (const float (*)[H])model->fc2_weights;
+    float (*g_fc1_w)[N] = (float (*)[N])g->fc1_weights;
+    float (*g_fc2_w)[H] = (float (*)[H])g->fc2_weights;
+    float (*conv1_out)[O1][O1] = (float (*)[O1][O1])c->conv1_out;
+    int (*pool1_max_i)[P1][P1] = (int (*)[P1][P1])c->pool1_max_i;
+    int (*pool1_max_j)[P1][P1] = (int (*)[P1][P1])c->pool1_max_j;
+    float (*conv2_out)[O2][O2] = (float (*)[O2][O2])c->conv2_out;
+    int (*pool2_max_i)[P2][P2] = (int (*)[P2][P2])c->pool2_max_i;
+    int (*pool2_max_j)[P2][P2] = (int (*)[P2][P2])c->pool2_max_j;
+    int f, i, j;
+    
+    /* Gradient de la loss (Cross-Entropy + Softmax), sauf s'il est fourni */
     float d_fc2_out[FC2_SIZE];
     for (i = 0; i < FC2_SIZE; i++) {
-        d_fc2_out[i] = cache.softmax_out[i];
+        if (d_logits) {
+            d_fc2_out[i] = d_logits[i];
+            continue;
+        }
+        d_fc2_out[i] = c->softmax_out[i];
         if (i == label) d_fc2_out[i] -= 1.0f;
     }
     
     /* ========== Gradients FC2 ========== */
+    const float *restrict relu3_out = c->relu3_out;
     for (i = 0; i < FC2_SIZE; i++) {
-        grads.fc2_bias[i] += d_fc2_out[i];
-        for (j = 0; j < FC1_SIZE; j++) {
-            grads.fc2_weights[i][j] += d_fc2_out[i] * cache.relu3_out[j];
+        float *restrict row = g_fc2_w[i];
+        const float d = d_fc2_out[i];
+        g->fc2_bias[i] += d;
+        for (j = 0; j < H; j++) {
+            row[j] += d * relu3_out[j];
         }
     }
     
     /* Gradient vers relu3_out */
-    float d_relu3[FC1_SIZE];
-    for (j = 0; j < FC1_SIZE; j++) {
-        d_relu3[j] = 0.0f;
+    float *restrict d_relu3 = c->d_relu3;
+    for (j = 0; j < H; j++) {
+        float sum = 0.0f;
         for (i = 0; i < FC2_SIZE; i++) {
-            d_relu3[j] += d_fc2_out[i] * network.fc2_weights[i][j];
+            sum += d_fc2_out[i] * fc2_w[i][j];
         }
-    }
-    
-    /* Gradient à travers ReLU */
-    float d_fc1_out[FC1_SIZE];
-    for (i = 0; i < FC1_SIZE; i++) {
-        d_fc1_out[i] = d_relu3[i] * relu_derivative(cache.fc1_out[i]);
-    }
-    
-    /* ========== Gradients FC1 ========== */
-    for (i = 0; i < FC1_SIZE; i++) {
-        grads.fc1_bias[i] += d_fc1_out[i];
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            grads.fc1_weights[i][j] += d_fc1_out[i] * cache.flatten[j];
+        d_relu3[j] = sum;
+    }
+    
+    /* Gradient à travers ReLU (sur place) */
+    float *restrict d_fc1_out = d_relu3;
+    for (i = 0; i < H; i++) {
+        d_fc1_out[i] = d_relu3[i] * relu_derivative(c->fc1_out[i]);
+    }
+    
+    /* ========== Gradients FC1 ==========
+     * Version creuse: un neurone dont la ReLU est inactive n'a pas de
+     * gradient, sa ligne est sautée */
+    const float *restrict flatten = c->flatten;
+    for (i = 0; i < H; i++) {
+        float *restrict row = g_fc1_w[i];
+        const float d = d_fc1_out[i];
+        if (sparse_backward && d == 0.0f) continue;
+        g->fc1_bias[i] += d;
+        for (j = 0; j < N; j++) {
+            row[j] += d * flatten[j];
         }
     }
     
-    /* Gradient vers flatten */
-    float d_flatten[FLATTEN_SIZE];
-    for (j = 0; j < FLATTEN_SIZE; j++) {
-        d_flatten[j] = 0.0f;
-        for (i = 0; i < FC1_SIZE; i++) {
-            d_flatten[j] += d_fc1_out[i] * network.fc1_weights[i][j];
+    /* Gradient vers flatten: parcours des lignes de fc1_w (contigu), même
+     * ordre de sommation pour chaque j */
+    float *restrict d_flatten = c->d_flatten;
+    for (j = 0; j < N; j++) d_flatten[j] = 0.0f;
+    for (i = 0; i < H; i++) {
+        const float *restrict row = fc1_w[i];
+        const float d = d_fc1_out[i];
+        if (sparse_backward && d == 0.0f) continue;
+        for (j = 0; j < N; j++) {
+            d_flatten[j] += d * row[j];
         }
     }
     
-    /* ========== Déflatten vers pool2_out ========== */
-    float d_pool2[CONV2_FILTERS][AFTER_POOL2][AFTER_POOL2];
-    int idx = 0;
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL2; i++) {
-            for (j = 0; j < AFTER_POOL2; j++) {
-                d_pool2[f][i][j] = d_flatten[idx++];
-            }
-        }
+    if (sparse_backward) {
+        conv_backward_sparse(model, c, g, ws, F1, K1, F2, K2);
+        return;
     }
     
+    /* ========== Déflatten vers pool2_out (même ordre en mémoire) ========== */
+    float (*d_pool2)[P2][P2] = (float (*)[P2][P2])d_flatten;
+    
     /* ========== Gradient à travers Pool2 ========== */
-    int conv2_out_size = AFTER_POOL1 - CONV2_SIZE + 1;
-    float d_relu2[CONV2_FILTERS][AFTER_POOL1 - CONV2_SIZE + 1][AFTER_POOL1 - CONV2_SIZE + 1];
-    for (f = 0; f < CONV2_FILTERS; f++) {
+    int conv2_out_size = O2;
+    float (*d_relu2)[O2][O2] = (float (*)[O2][O2])c->d_relu2;
+    for (f = 0; f < F2; f++) {
         for (i = 0; i < conv2_out_size; i++) {
             for (j = 0; j < conv2_out_size; j++) {
                 d_relu2[f][i][j] = 0.0f;
@@ -643,72 +668,35 @@ void backward(int label) {
         }
     }
     
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL2; i++) {
-            for (j = 0; j < AFTER_POOL2; j++) {
-                int mi = cache.pool2_max_i[f][i][j];
-                int mj = cache.pool2_max_j[f][i][j];
+    for (f = 0; f < F2; f++) {
+        for (i = 0; i < P2; i++) {
+            for (j = 0; j < P2; j++) {
+                int mi = pool2_max_i[f][i][j];
+                int mj = pool2_max_j[f][i][j];
                 d_relu2[f][mi][mj] += d_pool2[f][i][j];
             }
         }
     }
     
-    /* Gradient à travers ReLU2 */
-    float d_conv2[CONV2_FILTERS][AFTER_POOL1 - CONV2_SIZE + 1][AFTER_POOL1 - CONV2_SIZE + 1];
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < conv2_out_size; i++) {
-            for (j = 0; j < conv2_out_size; j++) {
-                d_conv2[f][i][j] = d_relu2[f][i][j] * relu_derivative(cache.conv2_out[f][i][j]);
-            }
-        }
-    }
-    
-    /* ========== Gradients Conv2 ========== */
-    for (f = 0; f < CONV2_FILTERS; f++) {
+    /* Gradient à travers ReLU2 (sur place) */
+    float (*d_conv2)[O2][O2] = d_relu2;
+    for (f = 0; f < F2; f++) {
         for (i = 0; i < conv2_out_size; i++) {
             for (j = 0; j < conv2_out_size; j++) {
-                grads.conv2_bias[f] += d_conv2[f][i][j];
-                for (c = 0; c < CONV1_FILTERS; c++) {
-                    for (ki = 0; ki < CONV2_SIZE; ki++) {
-                        for (kj = 0; kj < CONV2_SIZE; kj++) {
-                            grads.conv2_weights[f][c][ki][kj] += 
-                                d_conv2[f][i][j] * cache.pool1_out[c][i + ki][j + kj];
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    /* Gradient vers pool1_out */
-    float d_pool1[CONV1_FILTERS][AFTER_POOL1][AFTER_POOL1];
-    for (c = 0; c < CONV1_FILTERS; c++) {
-        for (i = 0; i < AFTER_POOL1; i++) {
-            for (j = 0; j < AFTER_POOL1; j++) {
-                d_pool1[c][i][j] = 0.0f;
+                d_conv2[f][i][j] = d_relu2[f][i][j] * relu_derivative(conv2_out[f][i][j]);
             }
         }
     }
     
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (i = 0; i < conv2_out_size; i++) {
-            for (j = 0; j < conv2_out_size; j++) {
-                for (c = 0; c < CONV1_FILTERS; c++) {
-                    for (ki = 0; ki < CONV2_SIZE; ki++) {
-                        for (kj = 0; kj < CONV2_SIZE; kj++) {
-                            d_pool1[c][i + ki][j + kj] += 
-                                d_conv2[f][i][j] * network.conv2_weights[f][c][ki][kj];
-                        }
-                    }
-                }
-            }
-        }
-    }
+    /* ========== Gradients Conv2 et gradient vers pool1_out ========== */
+    float (*d_pool1)[P1][P1] = (float (*)[P1][P1])c->d_pool1;
+    conv2_backward(model, c->pool1_out, c->d_relu2, g->conv2_weights, g->conv2_bias,
+                   c->d_pool1, ws);
     
     /* ========== Gradient à travers Pool1 ========== */
-    int conv1_out_size = IMG_SIZE - CONV1_SIZE + 1;
-    float d_relu1[CONV1_FILTERS][IMG_SIZE - CONV1_SIZE + 1][IMG_SIZE - CONV1_SIZE + 1];
-    for (f = 0; f < CONV1_FILTERS; f++) {
+    int conv1_out_size = O1;
+    float (*d_relu1)[O1][O1] = (float (*)[O1][O1])c->d_relu1;
+    for (f = 0; f < F1; f++) {
         for (i = 0; i < conv1_out_size; i++) {
             for (j = 0; j < conv1_out_size; j++) {
                 d_relu1[f][i][j] = 0.0f;
@@ -716,84 +704,78 @@ void backward(int label) {
         }
     }
     
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < AFTER_POOL1; i++) {
-            for (j = 0; j < AFTER_POOL1; j++) {
-                int mi = cache.pool1_max_i[f][i][j];
-                int mj = cache.pool1_max_j[f][i][j];
+    for (f = 0; f < F1; f++) {
+        for (i = 0; i < P1; i++) {
+            for (j = 0; j < P1; j++) {
+                int mi = pool1_max_i[f][i][j];
+                int mj = pool1_max_j[f][i][j];
                 d_relu1[f][mi][mj] += d_pool1[f][i][j];
             }
         }
     }
     
-    /* Gradient à travers ReLU1 */
-    float d_conv1[CONV1_FILTERS][IMG_SIZE - CONV1_SIZE + 1][IMG_SIZE - CONV1_SIZE + 1];
-    for (f = 0; f < CONV1_FILTERS; f++) {
+    /* Gradient à travers ReLU1 (sur place) */
+    float (*d_conv1)[O1][O1] = d_relu1;
+    for (f = 0; f < F1; f++) {
         for (i = 0; i < conv1_out_size; i++) {
             for (j = 0; j < conv1_out_size; j++) {
-                d_conv1[f][i][j] = d_relu1[f][i][j] * relu_derivative(cache.conv1_out[f][i][j]);
+                d_conv1[f][i][j] = d_relu1[f][i][j] * relu_derivative(conv1_out[f][i][j]);
             }
         }
     }
     
     /* ========== Gradients Conv1 ========== */
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < conv1_out_size; i++) {
-            for (j = 0; j < conv1_out_size; j++) {
-                grads.conv1_bias[f] += d_conv1[f][i][j];
-                for (ki = 0; ki < CONV1_SIZE; ki++) {
-                    for (kj = 0; kj < CONV1_SIZE; kj++) {
-                        grads.conv1_weights[f][ki][kj] += 
-                            d_conv1[f][i][j] * cache.input[i + ki][j + kj];
-                    }
-                }
-            }
-        }
-    }
+    conv1_backward(t, &c->input[0][0], c->d_relu1, g->conv1_weights, g->conv1_bias, ws);
 }
 
-void update_weights(float lr) {
-    int f, c, i, j;
-    
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < CONV1_SIZE; i++) {
-            for (j = 0; j < CONV1_SIZE; j++) {
-                network.conv1_weights[f][i][j] -= lr * grads.conv1_weights[f][i][j];
-            }
-        }
-        network.conv1_bias[f] -= lr * grads.conv1_bias[f];
-    }
-    
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (c = 0; c < CONV1_FILTERS; c++) {
-            for (i = 0; i < CONV2_SIZE; i++) {
-                for (j = 0; j < CONV2_SIZE; j++) {
-                    network.conv2_weights[f][c][i][j] -= lr * grads.conv2_weights[f][c][i][j];
-                }
-            }
-        }
-        network.conv2_bias[f] -= lr * grads.conv2_bias[f];
-    }
-    
-    for (i = 0; i < FC1_SIZE; i++) {
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            network.fc1_weights[i][j] -= lr * grads.fc1_weights[i][j];
-        }
-        network.fc1_bias[i] -= lr * grads.fc1_bias[i];
-    }
-    
-    for (i = 0; i < FC2_SIZE; i++) {
-        for (j = 0; j < FC1_SIZE; j++) {
-            network.fc2_weights[i][j] -= lr * grads.fc2_weights[i][j];
-        }
-        network.fc2_bias[i] -= lr * grads.fc2_bias[i];
+/* Ajoute dans g les gradients d'un échantillon dont c contient la
+ * propagation avant; les gradients intermédiaires vont dans les tampons
+ * d_* de c, réutilisés sur place d'une étape à la suivante. d_logits:
+ * gradient de la perte par rapport aux logits (distillation), NULL pour
+ * l'entropie croisée avec label. */
+static void backward_pass(const CNN *model, ForwardCache *c, Gradients *g,
+                          ConvWorkspace *ws, int label, const float *d_logits) {
+    const Topology *t = &model->topo;
+    if (topology_is_default(t)) {
+        backward_pass_impl(model, c, g, ws, label, d_logits, CONV1_FILTERS, CONV1_SIZE,
+                           CONV2_FILTERS, CONV2_SIZE, FC1_SIZE);
+    } else {
+        backward_pass_impl(model, c, g, ws, label, d_logits, t->conv1_filters,
+                           t->conv1_size, t->conv2_filters, t->conv2_size, t->fc1_size);
     }
 }
 
+void zero_gradients(void) {
+    zero_grads(&grads);
+}
+
+void backward(int label) {
+    backward_pass(net, &cache, &grads, &conv_ws, label, NULL);
+}
+
 /* ============================================================
  * SAUVEGARDE ET CHARGEMENT
  * ============================================================ */
 
+/* Couche du modèle texte: pour chaque sortie, ses poids puis son biais */
+typedef struct {
+    float *weights;
+    float *bias;
+    int rows, len;
+} TextLayer;
+
+static void text_layers(CNN *n, TextLayer layers[4]) {
+    const Topology *t = &n->topo;
+    layers[0] = (TextLayer){ n->conv1_weights, n->conv1_bias, t->conv1_filters,
+                             t->conv1_size * t->conv1_size };
+    layers[1] = (TextLayer){ n->conv2_weights, n->conv2_bias, t->conv2_filters,
+                             t->conv1_filters * t->conv2_size * t->conv2_size };
+    layers[2] = (TextLayer){ n->fc1_weights, n->fc1_bias, t->fc1_size, t->flatten };
+    layers[3] = (TextLayer){ n->fc2_weights, n->fc2_bias, FC2_SIZE, t->fc1_size };
+}
+
+/* CNN_MODEL_V1 pour la topologie par défaut (lisible par les anciennes
+ * versions), sinon CNN_MODEL_V2 suivi de la topologie */
 int save_network(const char *filename) {
     FILE *fp = fopen(filename, "w");
     if (!fp) {
@@ -801,46 +783,28 @@ int save_network(const char *filename) {
         return -1;
     }
     
-    int f, c, i, j;
-    
-    fprintf(fp, "CNN_MODEL_V1\n");
+    TextLayer layers[4];
+    Topology def;
+    char spec[64];
+    int l, r, k;
     
-    /* Conv1 */
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < CONV1_SIZE; i++) {
-            for (j = 0; j < CONV1_SIZE; j++) {
-                fprintf(fp, "%.8f\n", network.conv1_weights[f][i][j]);
-            }
-        }
-        fprintf(fp, "%.8f\n", network.conv1_bias[f]);
+    topology_default(&def);
+    if (topology_equal(&net->topo, &def)) {
+        fprintf(fp, "CNN_MODEL_V1\n");
+    } else {
+        topology_format(&net->topo, spec, sizeof(spec));
+        fprintf(fp, "CNN_MODEL_V2 %s\n", spec);
     }
     
-    /* Conv2 */
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (c = 0; c < CONV1_FILTERS; c++) {
-            for (i = 0; i < CONV2_SIZE; i++) {
-                for (j = 0; j < CONV2_SIZE; j++) {
-                    fprintf(fp, "%.8f\n", network.conv2_weights[f][c][i][j]);
-                }
+    /* Conv1, Conv2, FC1, FC2 */
+    text_layers(net, layers);
+    for (l = 0; l < 4; l++) {
+        for (r = 0; r < layers[l].rows; r++) {
+            for (k = 0; k < layers[l].len; k++) {
+                fprintf(fp, "%.8f\n", layers[l].weights[(size_t)r * layers[l].len + k]);
             }
+            fprintf(fp, "%.8f\n", layers[l].bias[r]);
         }
-        fprintf(fp, "%.8f\n", network.conv2_bias[f]);
-    }
-    
-    /* FC1 */
-    for (i = 0; i < FC1_SIZE; i++) {
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            fprintf(fp, "%.8f\n", network.fc1_weights[i][j]);
-        }
-        fprintf(fp, "%.8f\n", network.fc1_bias[i]);
-    }
-    
-    /* FC2 */
-    for (i = 0; i < FC2_SIZE; i++) {
-        for (j = 0; j < FC1_SIZE; j++) {
-            fprintf(fp, "%.8f\n", network.fc2_weights[i][j]);
-        }
-        fprintf(fp, "%.8f\n", network.fc2_bias[i]);
     }
     
     fclose(fp);
@@ -848,81 +812,51 @@ int save_network(const char *filename) {
     return 0;
 }
 
-int load_network(const char *filename) {
+int load_network_text(const char *filename) {
     FILE *fp = fopen(filename, "r");
     if (!fp) {
         printf("Erreur: impossible de charger %s\n", filename);
         return -1;
     }
     
-    char header[32];
+    char header[32], spec[64];
     if (fscanf(fp, "%31s", header) != 1) {
         fclose(fp);
         return -1;
     }
     
-    int f, c, i, j;
+    /* Topologie: par défaut pour CNN_MODEL_V1 */
+    Topology t;
+    topology_default(&t);
+    if (strcmp(header, "CNN_MODEL_V2") == 0 &&
+        (fscanf(fp, "%63s", spec) != 1 || topology_parse(spec, &t) != 0)) {
+        printf("Erreur: topologie de %s invalide\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    if (reset_network(&t) != 0) {
+        fclose(fp);
+        return -1;
+    }
     
-    /* Conv1 */
-    for (f = 0; f < CONV1_FILTERS; f++) {
-        for (i = 0; i < CONV1_SIZE; i++) {
-            for (j = 0; j < CONV1_SIZE; j++) {
-                if (fscanf(fp, "%f", &network.conv1_weights[f][i][j]) != 1) {
+    TextLayer layers[4];
+    int l, r, k;
+    
+    /* Conv1, Conv2, FC1, FC2 */
+    text_layers(net, layers);
+    for (l = 0; l < 4; l++) {
+        for (r = 0; r < layers[l].rows; r++) {
+            for (k = 0; k < layers[l].len; k++) {
+                if (fscanf(fp, "%f", &layers[l].weights[(size_t)r * layers[l].len + k]) != 1) {
                     fclose(fp);
                     return -1;
                 }
             }
-        }
-        if (fscanf(fp, "%f", &network.conv1_bias[f]) != 1) {
-            fclose(fp);
-            return -1;
-        }
-    }
-    
-    /* Conv2 */
-    for (f = 0; f < CONV2_FILTERS; f++) {
-        for (c = 0; c < CONV1_FILTERS; c++) {
-            for (i = 0; i < CONV2_SIZE; i++) {
-                for (j = 0; j < CONV2_SIZE; j++) {
-                    if (fscanf(fp, "%f", &network.conv2_weights[f][c][i][j]) != 1) {
-                        fclose(fp);
-                        return -1;
-                    }
-                }
-            }
-        }
-        if (fscanf(fp, "%f", &network.conv2_bias[f]) != 1) {
-            fclose(fp);
-            return -1;
-        }
-    }
-    
-    /* FC1 */
-    for (i = 0; i < FC1_SIZE; i++) {
-        for (j = 0; j < FLATTEN_SIZE; j++) {
-            if (fscanf(fp, "%f", &network.fc1_weights[i][j]) != 1) {
-                fclose(fp);
-                return -1;
-            }
-        }
-        if (fscanf(fp, "%f", &network.fc1_bias[i]) != 1) {
-            fclose(fp);
-            return -1;
-        }
-    }
-    
-    /* FC2 */
-    for (i = 0; i < FC2_SIZE; i++) {
-        for (j = 0; j < FC1_SIZE; j++) {
-            if (fscanf(fp, "%f", &network.fc2_weights[i][j]) != 1) {
+            if (fscanf(fp, "%f", &layers[l].bias[r]) != 1) {
                 fclose(fp);
                 return -1;
             }
         }
-        if (fscanf(fp, "%f", &network.fc2_bias[i]) != 1) {
-            fclose(fp);
-            return -1;
-        }
     }
     
     fclose(fp);
@@ -930,99 +864,752 @@ int load_network(const char *filename) {
     return 0;
 }
 
+int load_network_bin(const char *filename) {
+    ModelMapping map;
+    if (model_bin_map(filename, &map) != 0) {
+        return -1;
+    }
+    use_static_network();
+    net_mapping = map;
+    net = &net_mapping.net;
+    if (ensure_workspace() != 0) {
+        use_static_network();
+        return -1;
+    }
+    printf("Modèle binaire mappé depuis %s\n", filename);
+    return 0;
+}
+
+/* Modèle aux poids FC sur 16 bits: inférence par forward_batch_ws()
+ * seulement, predict_ws est donc alloué d'avance (predict() ne peut pas
+ * se rabattre sur forward()) */
+static int load_network_half(const char *filename) {
+    HalfCNN *h = half_load(filename);
+    if (!h) return -1;
+    use_static_network();
+    hnet = h;
+    net = &hnet->net;
+    int ok = ensure_workspace() == 0;
+    if (ok && !predict_ws) {
+        predict_ws = batch_workspace_new(&net->topo);
+        ok = predict_ws != NULL;
+        if (!ok) printf("Erreur: mémoire insuffisante\n");
+    }
+    if (!ok) {
+        use_static_network();
+        return -1;
+    }
+    printf("Modèle %s chargé depuis %s\n", half_format_name(hnet->fc.format), filename);
+    return 0;
+}
+
+/* Choisit le format d'après l'en-tête du fichier */
+int load_network(const char *filename) {
+    if (model_bin_is_binary(filename)) {
+        return load_network_bin(filename);
+    }
+    return load_network_text(filename);
+}
+
+int save_network_bin(const char *filename) {
+    return model_bin_save(net, filename);
+}
+
+/* model.bin s'il existe, sinon le modèle texte historique */
+const char *default_model_path(void) {
+    FILE *fp = fopen(MODEL_BIN_FILE, "rb");
+    if (fp) {
+        fclose(fp);
+        return MODEL_BIN_FILE;
+    }
+    return MODEL_TEXT_FILE;
+}
+
+/* Convertit un modèle texte (CNN_MODEL_V1 ou V2) en model.bin */
+int convert_model(const char *src, const char *dst) {
+    if (load_network(src) != 0) {
+        return -1;
+    }
+    return save_network_bin(dst);
+}
+
+/* Relit tout model.bin et compare sa somme de contrôle à l'en-tête (le
+ * chargement normal ne vérifie que l'en-tête et la taille) */
+int verify_model(const char *filename) {
+    ModelMapping map;
+    if (model_bin_map(filename, &map) != 0) return -1;
+    int ok = model_bin_verify(&map, filename) == 0;
+    if (ok) printf("%s: somme de contrôle correcte\n", filename);
+    model_bin_unmap(&map);
+    return ok ? 0 : -1;
+}
+
 /* ============================================================
  * ENTRAÎNEMENT
  * ============================================================ */
 
-void shuffle_indices(int *indices, int n) {
+void shuffle_indices(int *indices, int n, RngStream *r) {
     int i, j, tmp;
     for (i = n - 1; i > 0; i--) {
-        j = (int)(my_rand() * (i + 1));
-        if (j > i) j = i;
+        j = rng_below(r, i + 1);
         tmp = indices[i];
         indices[i] = indices[j];
         indices[j] = tmp;
     }
 }
 
-void train(const char *data_dir) {
-    float img[IMG_SIZE][IMG_SIZE];
-    char path[256];
-    int epoch, letter, sample, i;
-    int total_samples = NUM_CLASSES * SAMPLES_PER_LETTER;
-    int indices[NUM_CLASSES * SAMPLES_PER_LETTER];
-    
-    printf("=== ENTRAÎNEMENT DU CNN ===\n");
-    printf("Architecture: Conv(8x5x5) -> Pool(2x2) -> Conv(16x3x3) -> Pool(2x2) -> FC(128) -> FC(26)\n");
-    printf("Données: %d lettres x %d échantillons = %d images\n", NUM_CLASSES, SAMPLES_PER_LETTER, total_samples);
-    printf("Époques: %d, Learning rate: %.4f\n\n", EPOCHS, LEARNING_RATE);
-    
-    init_network();
-    
-    /* Créer les indices pour le mélange */
-    for (i = 0; i < total_samples; i++) {
-        indices[i] = i;
-    }
-    
-    for (epoch = 0; epoch < EPOCHS; epoch++) {
-        float total_loss = 0.0f;
-        int correct = 0;
-        
-        /* Mélanger les données */
-        shuffle_indices(indices, total_samples);
-        
-        for (i = 0; i < total_samples; i++) {
-            int idx = indices[i];
-            letter = idx / SAMPLES_PER_LETTER;
-            sample = idx % SAMPLES_PER_LETTER;
-            
-            /* Construire le chemin - maintenant avec .pbm */
-            sprintf(path, "%s/%c/%c_%03d.pbm", data_dir, 'A' + letter, 'A' + letter, sample);
-            
-            if (read_pbm(path, img) != 0) {
-                continue;
-            }
-            
-            /* Forward */
-            forward(img);
-            
-            /* Calculer la loss */
-            float loss = -my_log(cache.softmax_out[letter]);
-            total_loss += loss;
-            
-            /* Vérifier la prédiction */
-            int pred = 0;
-            float max_prob = cache.softmax_out[0];
-            int k;
-            for (k = 1; k < NUM_CLASSES; k++) {
-                if (cache.softmax_out[k] > max_prob) {
-                    max_prob = cache.softmax_out[k];
-                    pred = k;
-                }
-            }
-            if (pred == letter) correct++;
-            
-            /* Backward */
-            zero_gradients();
-            backward(letter);
-            update_weights(LEARNING_RATE);
-            
-            /* Affichage de progression */
-            if ((i + 1) % 200 == 0) {
-                printf("\r  Époque %d/%d: %d/%d échantillons traités...", 
-                       epoch + 1, EPOCHS, i + 1, total_samples);
-                fflush(stdout);
-            }
+/* Jeu d'entraînement: un fichier compacté tel quel, sinon letters.pack,
+ * créé depuis le dossier d'images au premier entraînement et recréé s'il
+ * a un format plus ancien, vient d'un autre dossier ou si une image du
+ * dossier a changé depuis (dataset_is_current) */
+static int open_training_set(const char *data, Dataset *ds) {
+    if (dataset_is_packed(data)) {
+        return dataset_map(data, ds);
+    }
+    int version = dataset_is_packed(DATASET_FILE);
+    if (version == DATASET_VERSION && dataset_is_current(DATASET_FILE, data)) {
+        printf("Utilisation de %s (à jour pour %s)\n", DATASET_FILE, data);
+    } else {
+        if (version == DATASET_VERSION) {
+            printf("%s ne correspond pas au contenu actuel de %s, régénération\n",
+                   DATASET_FILE, data);
+        } else if (version != 0) {
+            printf("%s est au format %d, régénération\n", DATASET_FILE, version);
         }
-        
-        float avg_loss = total_loss / (float)total_samples;
-        float accuracy = 100.0f * (float)correct / (float)total_samples;
-        printf("\r  Époque %d/%d: Loss = %.4f, Accuracy = %.2f%%                    \n", 
-               epoch + 1, EPOCHS, avg_loss, accuracy);
+        if (dataset_pack(data, DATASET_FILE, default_thread_count()) != 0) return -1;
     }
-    
-    printf("\nEntraînement terminé!\n");
-    save_network("model.txt");
+    return dataset_map(DATASET_FILE, ds);
+}
+
+/* ============================================================
+ * MINI-LOTS
+ * ============================================================ */
+
+/* Tampons d'une tranche de lot: chaque tranche accumule les gradients de
+ * ses échantillons dans son propre Gradients, sans aucun partage */
+typedef struct {
+    ForwardCache cache;
+    Gradients grads;
+    ConvWorkspace ws;
+    Arena ws_arena;
+    BatchWorkspace *teacher_ws; /* distillation: tampons du maître, sinon NULL */
+    float (*teacher_probs)[NUM_CLASSES];    /* [taille du lot] */
+    float loss;
+    int correct;
+} TrainSlot;
+
+static void slot_free(TrainSlot *s) {
+    if (!s) return;
+    forward_cache_free(&s->cache);
+    cnn_free(&s->grads);
+    arena_free(&s->ws_arena);
+    batch_workspace_free(s->teacher_ws);
+    free(s->teacher_probs);
+    free(s);
+}
+
+/* Tranche pour le réseau de topologie t; avec un maître, de quoi calculer
+ * ses probabilités sur batch_size images */
+static TrainSlot *slot_new(const Topology *t, const CNN *teacher, int batch_size) {
+    TrainSlot *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    arena_measure(&s->ws_arena);
+    conv_workspace_carve(&s->ws, t, &s->ws_arena);
+    if (forward_cache_alloc(&s->cache, t) != 0 || cnn_alloc(&s->grads, t) != 0 ||
+        arena_init(&s->ws_arena, s->ws_arena.used) != 0) {
+        slot_free(s);
+        return NULL;
+    }
+    if (teacher) {
+        s->teacher_ws = batch_workspace_new(&teacher->topo);
+        s->teacher_probs = malloc(sizeof(*s->teacher_probs) * batch_size);
+        if (!s->teacher_ws || !s->teacher_probs) {
+            slot_free(s);
+            return NULL;
+        }
+    }
+    conv_workspace_carve(&s->ws, t, &s->ws_arena);
+    return s;
+}
+
+/* Morceau de la réduction: REDUCE_CHUNK floats consécutifs de l'arène des
+ * gradients (64 Ko), alignement compris: Gradients, CNN et l'état de
+ * l'optimiseur ont la même disposition, un même décalage désigne partout
+ * le même paramètre */
+#define REDUCE_CHUNK 16384
+
+typedef struct {
+    size_t start, count;
+} ReduceChunk;
+
+typedef struct {
+    const LoaderBatch *batch;   /* lot courant, préparé par le loader */
+    TrainSlot **slots;
+    int slot_count;             /* tranches allouées */
+    int n_slots;                /* tranches du lot courant */
+    ReduceChunk *chunks;
+    int n_chunks;
+    const Optimizer *opt;
+    const uint8_t *pruned;      /* paramètres élagués (prune_mask), ou NULL */
+    const CNN *teacher;         /* distillation (distill.h), ou NULL */
+    float temperature, alpha;
+} TrainJob;
+
+/* Tranche slot du lot: gradients remis à zéro une fois, puis accumulés */
+static void train_slice_task(void *ctx, int slot, int worker) {
+    TrainJob *job = ctx;
+    TrainSlot *s = job->slots[slot];
+    int start = (int)((long)job->batch->n * slot / job->n_slots);
+    int end = (int)((long)job->batch->n * (slot + 1) / job->n_slots);
+    int i, k;
+    (void)worker;
+    
+    zero_grads(&s->grads);
+    s->loss = 0.0f;
+    s->correct = 0;
+    /* Probabilités du maître pour toute la tranche, par le chemin par lots */
+    if (job->teacher && end > start) {
+        forward_batch_ws(job->teacher, s->teacher_ws, job->batch->imgs + start, end - start,
+                         s->teacher_probs);
+    }
+    for (i = start; i < end; i++) {
+        int letter = job->batch->labels[i];
+        forward_pass(net, &s->cache, &s->ws, job->batch->imgs[i]);
+        
+        s->loss += -fast_log(s->cache.softmax_out[letter]);
+        int pred = 0;
+        for (k = 1; k < NUM_CLASSES; k++) {
+            if (s->cache.softmax_out[k] > s->cache.softmax_out[pred]) pred = k;
+        }
+        s->correct += pred == letter;
+        
+        if (job->teacher) {
+            float soft[NUM_CLASSES], d_logits[NUM_CLASSES];
+            distill_soft_targets(s->teacher_probs[i - start], job->temperature, soft);
+            distill_gradient(s->cache.fc2_out, s->cache.softmax_out, letter, soft,
+                             job->temperature, job->alpha, d_logits);
+            backward_pass(net, &s->cache, &s->grads, &s->ws, letter, d_logits);
+        } else {
+            backward_pass(net, &s->cache, &s->grads, &s->ws, letter, NULL);
+        }
+    }
+}
+
+/* Réduction en arbre d'un morceau: (g0 + g1) + (g2 + g3)... dans le
+ * tampon de la tranche 0, puis mise à jour des poids correspondants (et
+ * de l'état de l'optimiseur, de même disposition que Gradients).
+ * L'ordre des additions ne dépend que du nombre de tranches, pas de
+ * l'ordonnancement des threads. Le gradient d'un paramètre élagué est
+ * annulé: avec un optimiseur neuf, le poids reste exactement à 0. */
+static void train_reduce_task(void *ctx, int c, int worker) {
+    TrainJob *job = ctx;
+    const ReduceChunk *chunk = &job->chunks[c];
+    size_t off = chunk->start;
+    float *g0 = job->slots[0]->grads.data + off;
+    int step, s;
+    size_t i;
+    (void)worker;
+    
+    for (step = 1; step < job->n_slots; step *= 2) {
+        for (s = 0; s + step < job->n_slots; s += 2 * step) {
+            float *dst = job->slots[s]->grads.data + off;
+            const float *src = job->slots[s + step]->grads.data + off;
+            for (i = 0; i < chunk->count; i++) dst[i] += src[i];
+        }
+    }
+    if (job->pruned) {
+        const uint8_t *p = job->pruned + off;
+        for (i = 0; i < chunk->count; i++) {
+            if (p[i]) g0[i] = 0.0f;
+        }
+    }
+    
+    optim_update(job->opt, net->data + off, g0, off, chunk->count);
+}
+
+/* Découpe des count floats de l'arène des paramètres */
+static ReduceChunk *make_reduce_chunks(size_t count, int *n_chunks) {
+    int k, n = (int)((count + REDUCE_CHUNK - 1) / REDUCE_CHUNK);
+    ReduceChunk *chunks = malloc(sizeof(*chunks) * n);
+    if (!chunks) return NULL;
+    for (k = 0; k < n; k++) {
+        size_t left = count - (size_t)k * REDUCE_CHUNK;
+        chunks[k].start = (size_t)k * REDUCE_CHUNK;
+        chunks[k].count = left < REDUCE_CHUNK ? left : REDUCE_CHUNK;
+    }
+    *n_chunks = n;
+    return chunks;
+}
+
+/* ============================================================
+ * BOUCLE D'ENTRAÎNEMENT
+ * ============================================================ */
+
+/* Options du mode 1 */
+typedef struct {
+    const char *data;           /* dossier d'images ou fichier compacté */
+    int batch_size;
+    int threads;
+    int slices;                 /* tranches par lot (ordre des sommes), 0: une par thread */
+    uint32_t seed;              /* graine de l'initialisation, du mélange et de l'augmentation */
+    int augment;
+    int epochs;
+    OptimKind optim;
+    LrSchedule schedule;
+    float lr;                   /* <= 0: taux par défaut de l'optimiseur */
+    const char *checkpoint;
+    int checkpoint_every;       /* en époques, 0 = jamais */
+    int resume;
+    uint8_t held_out[SAMPLES_PER_LETTER];  /* polices de validation */
+    int patience;               /* 0 = pas d'arrêt anticipé */
+    Topology topo;              /* réseau d'un nouvel entraînement */
+    const CNN *start;           /* poids de départ (réglage fin, même topologie),
+                                   NULL: initialisation aléatoire */
+    const uint8_t *pruned;      /* paramètres gardés à zéro (prune_mask), ou NULL */
+    const char *teacher;        /* model.bin du maître (distillation), ou NULL */
+    float temperature, alpha;
+    const char *model_text;     /* modèle final, NULL: non écrit */
+    const char *model_bin;
+} TrainConfig;
+
+/* Répartition des images entre entraînement et validation */
+typedef struct {
+    int *train;
+    int n_train;
+    int *val;
+    int n_val;
+    Validator *validator;       /* NULL sans image de validation */
+    CNN *best;                  /* poids de la meilleure validation */
+} TrainSplit;
+
+/* Affiche une évaluation et retient la meilleure époque; renvoie 1 si la
+ * perte de validation stagne depuis progress->patience époques */
+static int handle_validation(const ValResult *r, TrainSplit *split, TrainProgress *progress) {
+    int improved = progress->best_epoch == 0 || r->loss < progress->best_loss - VAL_MIN_DELTA;
+    if (improved) {
+        progress->best_epoch = r->epoch;
+        progress->best_loss = r->loss;
+        cnn_copy(split->best, validator_weights(split->validator));
+    }
+    printf("  Validation %d: Loss = %.4f, Accuracy = %.2f%% (%.1f s)%s\n",
+           r->epoch, r->loss, r->accuracy, r->seconds, improved ? ", meilleure" : "");
+    return progress->patience > 0 && r->epoch - progress->best_epoch >= progress->patience;
+}
+
+/* Époques progress->epoch..epochs-1 en mini-lots fournis par le loader,
+ * avec un point de reprise toutes les cfg->checkpoint_every époques.
+ * L'évaluation de validation de l'époque e tourne pendant l'époque e + 1;
+ * son résultat est lu à la fin de celle-ci. */
+static int run_training(const TrainConfig *cfg, const Dataset *ds, TrainSplit *split,
+                        TrainJob *job, ThreadPool *pool, Optimizer *opt,
+                        TrainProgress *progress, const LoaderEpochState *resume) {
+    int total_samples = split->n_train;
+    int epochs = progress->epochs;
+    int batch_size = progress->batch_size;
+    int epoch, i;
+    ValResult vr;
+    
+    printf("=== ENTRAÎNEMENT DU CNN ===\n");
+    const Topology *t = &net->topo;
+    printf("Architecture: Conv(%dx%dx%d) -> Pool(2x2) -> Conv(%dx%dx%d) -> Pool(2x2) -> FC(%d) -> FC(%d), %zu paramètres\n",
+           t->conv1_filters, t->conv1_size, t->conv1_size, t->conv2_filters, t->conv2_size,
+           t->conv2_size, t->fc1_size, FC2_SIZE, topology_param_count(t));
+    printf("Données: %d images (%d lettres)%s\n", total_samples, NUM_CLASSES,
+           progress->augment ? ", augmentées à la volée" : "");
+    if (split->validator) {
+        printf("Validation: %d images de polices mises de côté, arrêt après %d époques sans progrès\n",
+               split->n_val, progress->patience);
+    } else {
+        printf("Validation: aucune image des polices choisies\n");
+    }
+    printf("Époques: %d, optimiseur %s, learning rate %g (%s)\n", epochs,
+           optim_kind_name(opt->kind), opt->base_lr, optim_schedule_name(opt->schedule));
+    printf("Lots de %d échantillons, %d tranches sur %d threads, graine %u\n",
+           batch_size, job->slot_count, thread_pool_size(pool), progress->seed);
+    if (job->teacher) {
+        printf("Distillation depuis %s (%zu paramètres): température %g, alpha %g\n",
+               cfg->teacher, topology_param_count(&job->teacher->topo), job->temperature,
+               job->alpha);
+    }
+    if (resume) {
+        printf("Reprise après l'époque %d (%s)\n", progress->epoch, cfg->checkpoint);
+    }
+    printf("\n");
+    
+    Loader *loader = loader_start(ds, split->train, total_samples, batch_size,
+                                  progress->epoch, epochs, progress->augment, progress->seed,
+                                  resume);
+    if (!loader) {
+        printf("Erreur: impossible de démarrer le chargement des lots\n");
+        return -1;
+    }
+    job->opt = opt;
+    
+    /* Évaluation perdue à l'interruption: celle des poids repris */
+    if (split->validator && resume) {
+        validator_start(split->validator, net, progress->epoch);
+    }
+    
+    for (epoch = progress->epoch; epoch < epochs; epoch++) {
+        float total_loss = 0.0f;
+        int correct = 0;
+        double t0 = now_seconds();
+        double wait0 = loader_wait_seconds(loader);
+        
+        for (i = 0; i < total_samples; i += batch_size) {
+            const LoaderBatch *batch = loader_next(loader);
+            int n = batch->n;
+            int s;
+            job->batch = batch;
+            job->n_slots = n < job->slot_count ? n : job->slot_count;
+            optim_begin_step(opt, (epoch + (double)i / total_samples) / epochs, epoch);
+            
+            /* Forward + backward en parallèle, puis réduction et mise à jour */
+            thread_pool_run(pool, job->n_slots, train_slice_task, job);
+            thread_pool_run(pool, job->n_chunks, train_reduce_task, job);
+            loader_release(loader);
+            
+            for (s = 0; s < job->n_slots; s++) {
+                total_loss += job->slots[s]->loss;
+                correct += job->slots[s]->correct;
+            }
+            
+            /* Affichage de progression */
+            if ((i + n) / 200 != i / 200) {
+                printf("\r  Époque %d/%d: %d/%d échantillons traités...", 
+                       epoch + 1, epochs, i + n, total_samples);
+                fflush(stdout);
+            }
+        }
+        
+        float avg_loss = total_loss / (float)total_samples;
+        float accuracy = 100.0f * (float)correct / (float)total_samples;
+        printf("\r  Époque %d/%d: Loss = %.4f, Accuracy = %.2f%%, lr %.2g (%.1f s, attente données %.2f s)\n", 
+               epoch + 1, epochs, avg_loss, accuracy, opt->lr, now_seconds() - t0,
+               loader_wait_seconds(loader) - wait0);
+        
+        /* Validation de l'époque précédente, puis de celle-ci en parallèle
+         * de la suivante */
+        progress->epoch = epoch + 1;
+        int stop = 0;
+        if (split->validator) {
+            if (validator_wait(split->validator, &vr) == 0) {
+                stop = handle_validation(&vr, split, progress);
+            }
+            validator_start(split->validator, net, progress->epoch);
+        }
+        if (stop) {
+            printf("  Arrêt anticipé: pas de progrès en validation depuis l'époque %d\n",
+                   progress->best_epoch);
+            progress->epochs = progress->epoch;
+        }
+        
+        /* Point de reprise: poids, optimiseur et ordre des échantillons */
+        if (cfg->checkpoint_every > 0 &&
+            (progress->epoch % cfg->checkpoint_every == 0 || progress->epoch == progress->epochs)) {
+            const LoaderEpochState *st = loader_epoch_state(loader, epoch);
+            if (checkpoint_save(cfg->checkpoint, net, split->best, opt, progress,
+                                st->indices) != 0) {
+                printf("Attention: point de reprise non écrit\n");
+            }
+        }
+        if (stop) break;
+    }
+    loader_stop(loader);
+    if (split->validator && validator_wait(split->validator, &vr) == 0) {
+        handle_validation(&vr, split, progress);
+    }
+    
+    printf("\nEntraînement terminé!\n");
+    if (progress->best_epoch > 0) {
+        printf("Poids de l'époque %d retenus (validation: Loss = %.4f)\n",
+               progress->best_epoch, progress->best_loss);
+        cnn_copy(net, split->best);
+    }
+    if (cfg->model_text) save_network(cfg->model_text);
+    if (cfg->model_bin) save_network_bin(cfg->model_bin);
+    return 0;
+}
+
+/* cfg->batch_size échantillons par mise à jour, répartis en --slices
+ * tranches (min(threads, batch_size) par défaut). Les gradients du lot
+ * sont sommés (pas moyennés): pour SGD, LEARNING_RATE garde le sens qu'il
+ * avait avec une mise à jour par échantillon. Tous les tirages viennent
+ * des flux rng.h de la graine: même graine et même nombre de tranches
+ * donnent les mêmes poids, quel que soit le nombre de threads. Avec
+ * --resume, les réglages (sauf le nombre de threads) et la topologie
+ * viennent du point de reprise. -1 en cas d'erreur. */
+int train(const TrainConfig *cfg) {
+    Dataset ds;
+    Optimizer opt;
+    TrainProgress progress;
+    TrainSplit split;
+    LoaderEpochState resume;
+    int *resume_indices = NULL;
+    int i;
+    int threads = cfg->threads < 1 ? 1 : cfg->threads;
+    
+    if (open_training_set(cfg->data, &ds) != 0) {
+        return -1;
+    }
+    memset(&split, 0, sizeof(split));
+    split.best = calloc(1, sizeof(CNN));
+    if (!split.best) {
+        printf("Erreur: mémoire insuffisante\n");
+        dataset_unmap(&ds);
+        return -1;
+    }
+    use_static_network();
+    if (cfg->resume) {
+        /* Réseau et meilleurs poids alloués avec la topologie du fichier */
+        cnn_free(&network);
+        if (checkpoint_load(cfg->checkpoint, &network, split.best, &opt, &progress,
+                            &resume_indices) != 0) {
+            free(split.best);
+            dataset_unmap(&ds);
+            return -1;
+        }
+        if (ensure_workspace() != 0) {
+            optim_free(&opt);
+            cnn_free(split.best);
+            free(split.best);
+            free(resume_indices);
+            dataset_unmap(&ds);
+            return -1;
+        }
+        resume.indices = resume_indices;
+    } else {
+        float lr = cfg->lr > 0.0f ? cfg->lr
+                 : cfg->optim == OPTIM_ADAM ? ADAM_LEARNING_RATE : LEARNING_RATE;
+        if (init_network(&cfg->topo, cfg->seed) != 0 || cnn_alloc(split.best, &cfg->topo) != 0 ||
+            optim_init(&opt, cfg->optim, cfg->schedule, lr, &cfg->topo) != 0) {
+            printf("Erreur: mémoire insuffisante\n");
+            cnn_free(split.best);
+            free(split.best);
+            dataset_unmap(&ds);
+            return -1;
+        }
+        if (cfg->start) cnn_copy(&network, cfg->start);
+        progress.epoch = 0;
+        progress.epochs = cfg->epochs < 1 ? 1 : cfg->epochs;
+        progress.batch_size = cfg->batch_size < 1 ? 1 : cfg->batch_size;
+        progress.slices = cfg->slices > 0 ? cfg->slices : threads;
+        if (progress.slices > progress.batch_size) progress.slices = progress.batch_size;
+        progress.seed = cfg->seed;
+        progress.augment = cfg->augment;
+        progress.patience = cfg->patience < 0 ? 0 : cfg->patience;
+        progress.best_epoch = 0;
+        progress.best_loss = 0.0f;
+        memcpy(progress.held_out, cfg->held_out, sizeof(progress.held_out));
+    }
+    
+    int ok = val_split(&ds, progress.held_out, &split.train, &split.n_train,
+                       &split.val, &split.n_val) == 0;
+    if (!ok) {
+        printf("Erreur: mémoire insuffisante\n");
+    } else if (split.n_train == 0) {
+        printf("Erreur: toutes les images sont dans les polices de validation\n");
+        ok = 0;
+    } else if (cfg->resume && (progress.sample_count != split.n_train ||
+                               progress.val_count != split.n_val)) {
+        printf("Erreur: le point de reprise a été créé avec un autre jeu de données\n");
+        ok = 0;
+    } else if (cfg->resume && progress.epoch >= progress.epochs) {
+        printf("Erreur: l'entraînement de ce point de reprise est déjà terminé\n");
+        ok = 0;
+    } else if (split.n_val > 0) {
+        split.validator = validator_new(&ds, split.val, split.n_val, &net->topo);
+        if (!split.validator) {
+            printf("Erreur: mémoire insuffisante\n");
+            ok = 0;
+        }
+    }
+    progress.sample_count = split.n_train;
+    progress.val_count = split.n_val;
+    
+    int n_slots = progress.slices;
+    TrainSlot **slots = ok ? calloc(n_slots, sizeof(*slots)) : NULL;
+    TrainJob job = { NULL, slots, n_slots, n_slots, NULL, 0, &opt, cfg->pruned,
+                     NULL, cfg->temperature, cfg->alpha };
+    ThreadPool *pool = NULL;
+    ModelMapping teacher;
+    memset(&teacher, 0, sizeof(teacher));
+    if (ok && cfg->teacher) {
+        /* Maître mappé en lecture seule, partagé par les tranches */
+        ok = model_bin_map(cfg->teacher, &teacher) == 0;
+        job.teacher = ok ? &teacher.net : NULL;
+    }
+    if (ok) {
+        job.chunks = make_reduce_chunks(net->count, &job.n_chunks);
+        pool = thread_pool_new(threads);
+        ok = slots && job.chunks && pool;
+        for (i = 0; ok && i < n_slots; i++) {
+            slots[i] = slot_new(&net->topo, job.teacher, progress.batch_size);
+            ok = slots[i] != NULL;
+        }
+        if (ok) {
+            ok = run_training(cfg, &ds, &split, &job, pool, &opt, &progress,
+                              cfg->resume ? &resume : NULL) == 0;
+        } else {
+            printf("Erreur: mémoire insuffisante\n");
+        }
+    }
+    
+    thread_pool_free(pool);
+    for (i = 0; slots && i < n_slots; i++) slot_free(slots[i]);
+    free(slots);
+    free(job.chunks);
+    model_bin_unmap(&teacher);
+    validator_free(split.validator);
+    free(split.train);
+    free(split.val);
+    cnn_free(split.best);
+    free(split.best);
+    free(resume_indices);
+    optim_free(&opt);
+    dataset_unmap(&ds);
+    return ok ? 0 : -1;
+}
+
+/* Lit les options du mode 1 (voir l'usage dans main); -1 si une option
+ * est inconnue ou invalide */
+static int parse_train_args(int argc, char *argv[], TrainConfig *cfg) {
+    int i, has_topology = 0, has_checkpoint = 0;
+    cfg->data = "letters_50x50_fonts";
+    cfg->batch_size = BATCH_SIZE;
+    cfg->threads = default_thread_count();
+    cfg->slices = 0;
+    cfg->seed = TRAIN_SEED;
+    cfg->augment = 1;
+    cfg->epochs = EPOCHS;
+    cfg->optim = OPTIM_ADAM;
+    cfg->schedule = LR_COSINE;
+    cfg->lr = 0.0f;
+    cfg->checkpoint = CHECKPOINT_FILE;
+    cfg->checkpoint_every = 1;
+    cfg->resume = 0;
+    cfg->patience = VAL_PATIENCE;
+    val_parse_fonts(VAL_FONTS, cfg->held_out);
+    topology_default(&cfg->topo);
+    cfg->start = NULL;
+    cfg->pruned = NULL;
+    cfg->teacher = NULL;
+    cfg->temperature = DISTILL_TEMPERATURE;
+    cfg->alpha = DISTILL_ALPHA;
+    cfg->model_text = MODEL_TEXT_FILE;
+    cfg->model_bin = MODEL_BIN_FILE;
+    for (i = 0; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--batch") == 0 && has_value) {
+            cfg->batch_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            cfg->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--slices") == 0 && has_value) {
+            cfg->slices = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            cfg->seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--no-augment") == 0) {
+            cfg->augment = 0;
+        } else if (strcmp(argv[i], "--augment") == 0) {
+            cfg->augment = 1;
+        } else if (strcmp(argv[i], "--epochs") == 0 && has_value) {
+            cfg->epochs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--optim") == 0 && has_value) {
+            if (optim_parse_kind(argv[++i], &cfg->optim) != 0) {
+                printf("Optimiseur inconnu: %s (sgd, momentum, adam)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--schedule") == 0 && has_value) {
+            if (optim_parse_schedule(argv[++i], &cfg->schedule) != 0) {
+                printf("Calendrier inconnu: %s (constant, step, cosine)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--lr") == 0 && has_value) {
+            cfg->lr = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && has_value) {
+            cfg->checkpoint = argv[++i];
+            has_checkpoint = 1;
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && has_value) {
+            cfg->checkpoint_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            cfg->resume = 1;
+        } else if (strcmp(argv[i], "--val-fonts") == 0 && has_value) {
+            if (val_parse_fonts(argv[++i], cfg->held_out) != 0) {
+                printf("Polices de validation invalides: %s (ex. 900-999 ou 0,5,10-19, ou none)\n",
+                       argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--patience") == 0 && has_value) {
+            cfg->patience = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--topology") == 0 && has_value) {
+            if (topology_parse(argv[++i], &cfg->topo) != 0) {
+                printf("Topologie invalide: %s (ex. 16x5,32x3,256)\n", argv[i]);
+                return -1;
+            }
+            has_topology = 1;
+        } else if (strcmp(argv[i], "--teacher") == 0 && has_value) {
+            cfg->teacher = argv[++i];
+        } else if (strcmp(argv[i], "--temperature") == 0 && has_value) {
+            cfg->temperature = (float)atof(argv[++i]);
+            if (cfg->temperature <= 0.0f) {
+                printf("Température invalide: %s (> 0)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--alpha") == 0 && has_value) {
+            cfg->alpha = (float)atof(argv[++i]);
+            if (cfg->alpha < 0.0f || cfg->alpha > 1.0f) {
+                printf("Alpha invalide: %s (entre 0 et 1)\n", argv[i]);
+                return -1;
+            }
+        } else if (argv[i][0] != '-' && i == 0) {
+            cfg->data = argv[i];
+        } else {
+            printf("Option inconnue: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (cfg->teacher) {
+        /* Élève: petite topologie, écrit à part pour ne pas écraser le maître */
+        if (!has_topology) topology_parse(DISTILL_TOPOLOGY, &cfg->topo);
+        if (!has_checkpoint) cfg->checkpoint = DISTILL_CHECKPOINT;
+        cfg->model_text = NULL;
+        cfg->model_bin = DISTILL_FILE;
+    }
+    return 0;
+}
+
+/* Écrit une image (fond 1.0, encre 0.0) en PBM ASCII */
+static int write_pbm(const char *filename, float img[IMG_SIZE][IMG_SIZE]) {
+    int i, j;
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        printf("Erreur: impossible d'écrire %s\n", filename);
+        return -1;
+    }
+    fprintf(fp, "P1\n%d %d\n", IMG_SIZE, IMG_SIZE);
+    for (i = 0; i < IMG_SIZE; i++) {
+        for (j = 0; j < IMG_SIZE; j++) {
+            fprintf(fp, "%d%c", img[i][j] < 0.5f ? 1 : 0, j == IMG_SIZE - 1 ? '\n' : ' ');
+        }
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/* Écrit n versions augmentées d'une image, pour contrôler l'augmentation */
+int augment_preview(const char *image_path, const char *out_dir, int n) {
+    float img[IMG_SIZE][IMG_SIZE], aug[IMG_SIZE][IMG_SIZE];
+    char path[512];
+    RngStream rng;
+    int k;
+    if (read_pbm(image_path, img) != 0) return -1;
+    for (k = 0; k < n; k++) {
+        rng_stream(&rng, TRAIN_SEED, RNG_AUGMENT, (uint64_t)k);
+        augment_glyph(img, aug, &rng);
+        snprintf(path, sizeof(path), "%s/aug_%03d.pbm", out_dir, k);
+        if (write_pbm(path, aug) != 0) return -1;
+    }
+    printf("%d images augmentées écrites dans %s\n", n, out_dir);
+    return 0;
 }
 
 /* ============================================================
@@ -1030,7 +1617,29 @@ void train(const char *data_dir) {
  * ============================================================ */
 
 char predict(float img[IMG_SIZE][IMG_SIZE]) {
-    forward(img);
+    int created = 0;
+    int e = glyph_cache ? glyph_cache_get(glyph_cache, img, &created) : -1;
+    if (e >= 0 && !created) {
+        GlyphEntry *hit = glyph_cache_entry(glyph_cache, e);
+        memcpy(cache.softmax_out, hit->probs, sizeof(cache.softmax_out));
+        return hit->letter;
+    }
+    
+    if (qnet) {
+        /* Modèle INT8: mêmes probabilités exposées dans cache.softmax_out */
+        float logits[NUM_CLASSES];
+        quant_forward(qnet, qws, img, logits);
+        softmax(logits, cache.softmax_out, NUM_CLASSES);
+    } else {
+        /* Inférence seule: pas besoin des tenseurs intermédiaires de forward() */
+        if (!predict_ws) predict_ws = batch_workspace_new(&net->topo);
+        if (predict_ws) {
+            forward_batch_ws(net, predict_ws, (float (*)[IMG_SIZE][IMG_SIZE])img, 1,
+                             &cache.softmax_out);
+        } else {
+            forward(img);
+        }
+    }
     
     int pred = 0;
     float max_prob = cache.softmax_out[0];
@@ -1041,15 +1650,74 @@ char predict(float img[IMG_SIZE][IMG_SIZE]) {
             pred = i;
         }
     }
+    if (e >= 0) {
+        GlyphEntry *added = glyph_cache_entry(glyph_cache, e);
+        memcpy(added->probs, cache.softmax_out, sizeof(added->probs));
+        added->letter = 'A' + pred;
+    }
     
     return 'A' + pred;
 }
 
-char test_image(const char *image_path) {
+/* ============================================================
+ * CHARGEMENT UNIQUE DU MODÈLE (mode batch)
+ * ============================================================ */
+
+/* Le modèle reste résident après le premier chargement: toutes les cellules
+ * et lettres d'un même run sont classées contre la même copie en mémoire. */
+static int model_loaded = 0;
+static int model_load_count = 0;
+static double model_load_seconds = 0.0;
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int ensure_network_loaded(const char *filename) {
+    if (model_loaded) return 0;
+    
+    double t0 = now_seconds();
+    if (quant_is_quantized(filename)) {
+        qnet = quant_load(filename);
+        qws = qnet ? quant_workspace_new(qnet) : NULL;
+        if (!qws) {
+            printf("Erreur: impossible de charger le modèle INT8 %s\n", filename);
+            quant_free(qnet);
+            qnet = NULL;
+            return -1;
+        }
+        printf("Modèle INT8 chargé depuis %s\n", filename);
+    } else if ((half_is_half(filename) ? load_network_half(filename)
+                                        : load_network(filename)) != 0) {
+        printf("Erreur: impossible de charger le modèle. Entraînez d'abord avec l'option 1.\n");
+        return -1;
+    } else {
+        if (!hnet && (fc1_sparse = sparse_fc1_build(net)) != NULL) {
+            /* Modèle élagué: FC1 lu en blocs creux par predict() et predict_batch() */
+            net->fc1_sparse = fc1_sparse;
+            printf("FC1 creux: %d blocs non nuls sur %d\n", fc1_sparse->nnz_blocks,
+                   net->topo.fc1_size * (net->topo.flatten / PRUNE_BLOCK));
+        }
+        if (use_winograd && (conv2_wino = conv2_winograd_build(net)) != NULL) {
+            net->conv2_winograd = conv2_wino;
+            printf("CONV2 par Winograd F(2x2, 3x3)\n");
+        } else if (use_winograd) {
+            printf("Winograd indisponible pour CONV2 (noyaux %dx%d): im2col + GEMM\n",
+                   net->topo.conv2_size, net->topo.conv2_size);
+        }
+    }
+    model_load_seconds += now_seconds() - t0;
+    model_load_count++;
+    model_loaded = 1;
+    return 0;
+}
+
+char test_image(const char *image_path, const char *model_path) {
     float img[IMG_SIZE][IMG_SIZE];
     
-    if (load_network("model.txt") != 0) {
-        printf("Erreur: impossible de charger le modèle. Entraînez d'abord avec l'option 1.\n");
+    if (ensure_network_loaded(model_path) != 0) {
         return '0';
     }
     
@@ -1094,154 +1762,2206 @@ int file_exists(const char *path) {
     return 0;
 }
 
-int process_cells(const char *base_path, const char *OUTPUT_PATH) {
-    char output_path[512];
-    sprintf(output_path, "%s/grid", OUTPUT_PATH);
-    FILE *output = fopen(output_path, "w");
-    if (!output) {
-        printf("Erreur: Impossible de créer le fichier de sortie %s\n", output_path);
-        return 1;
+/* ============================================================
+ * RECONNAISSANCE PAR LOTS (mode 3)
+ * ============================================================ */
+
+/* Options du mode 3 */
+typedef struct {
+    int threads;
+    const char *model;
+    int topk;                   /* candidats gardés par glyphe (0: pas de fichier candidats) */
+    int topk_text;              /* candidats.txt en plus */
+    int use_cache;              /* cache de glyphes pendant le run */
+    const char *cache_file;     /* cache persistant, NULL: aucun */
+    int winograd;               /* CONV2 par Winograd */
+    const char *student;        /* élève de la cascade (distill.h), NULL: aucun */
+    float threshold;            /* confiance minimale de l'élève */
+    int prefilter;              /* cellules vides écartées avant le réseau */
+} CellsConfig;
+
+/* Toutes les lettres d'un puzzle (grille + liste de mots), dans l'ordre
+ * des fichiers; row_len[r] donne le nombre de lettres de la ligne/du mot r */
+typedef struct {
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    char (*paths)[600];
+    char *letters;
+    float (*probs)[NUM_CLASSES]; /* softmax de chaque image (candidats) */
+    int *ok;                    /* 0 si l'image n'a pas pu être lue */
+    unsigned char *verdict;     /* prefilter_glyph() des images lues */
+    int prefilter;              /* 0: tout est PREFILTER_LETTER */
+    int count, cap;
+    int *row_len;
+    int rows, rows_cap;
+} GlyphSet;
+
+static void glyph_set_free(GlyphSet *set) {
+    free(set->imgs);
+    free(set->paths);
+    free(set->letters);
+    free(set->probs);
+    free(set->ok);
+    free(set->verdict);
+    free(set->row_len);
+    memset(set, 0, sizeof(*set));
+}
+
+static int glyph_set_push(GlyphSet *set, const char *path) {
+    if (set->count == set->cap) {
+        int cap = set->cap ? set->cap * 2 : 256;
+        void *imgs = realloc(set->imgs, sizeof(*set->imgs) * cap);
+        if (!imgs) return -1;
+        set->imgs = imgs;
+        void *paths = realloc(set->paths, sizeof(*set->paths) * cap);
+        if (!paths) return -1;
+        set->paths = paths;
+        void *letters = realloc(set->letters, cap);
+        if (!letters) return -1;
+        set->letters = letters;
+        void *probs = realloc(set->probs, sizeof(*set->probs) * cap);
+        if (!probs) return -1;
+        set->probs = probs;
+        void *ok = realloc(set->ok, sizeof(int) * cap);
+        if (!ok) return -1;
+        set->ok = ok;
+        void *verdict = realloc(set->verdict, cap);
+        if (!verdict) return -1;
+        set->verdict = verdict;
+        set->cap = cap;
+    }
+    int k = set->count++;
+    snprintf(set->paths[k], sizeof(set->paths[k]), "%s", path);
+    set->ok[k] = 0;
+    set->verdict[k] = PREFILTER_LETTER;
+    return 0;
+}
+
+/* Lecture et tri d'une image du lot (les lectures sont réparties sur les
+ * workers) */
+static void glyph_read_task(void *ctx, int k, int worker) {
+    GlyphSet *set = ctx;
+    (void)worker;
+    set->ok[k] = read_pbm(set->paths[k], set->imgs[k]) == 0;
+    if (!set->ok[k]) {
+        printf("Erreur: impossible de lire l'image %s\n", set->paths[k]);
+        memset(set->imgs[k], 0, sizeof(set->imgs[k]));
+    } else if (set->prefilter) {
+        set->verdict[k] = (unsigned char)prefilter_glyph(set->imgs[k]);
+    }
+}
+
+static void glyph_set_read(GlyphSet *set, int threads) {
+    parallel_for(set->count, threads, glyph_read_task, set);
+}
+
+static int glyph_set_end_row(GlyphSet *set, int len) {
+    if (set->rows == set->rows_cap) {
+        int cap = set->rows_cap ? set->rows_cap * 2 : 32;
+        void *rows = realloc(set->row_len, sizeof(int) * cap);
+        if (!rows) return -1;
+        set->row_len = rows;
+        set->rows_cap = cap;
     }
+    set->row_len[set->rows++] = len;
+    return 0;
+}
 
-    int line_index = 0;
-    char line_path[512];
-    char cell_path[512];
+/* Parcourt base/<dir>_00/<item>_00.pbm, <dir>_00/<item>_01.pbm, ... jusqu'au
+ * premier dossier vide. Renvoie le nombre de dossiers lus, -1 si mémoire. */
+static int collect_glyphs(const char *base_path, const char *dir, const char *item,
+                          GlyphSet *set) {
+    char folder[512];
+    char file[600];
+    int folder_index = 0;
 
-    // Parcourir les dossiers line_00, line_01, ...
     while (1) {
-        // Construire le chemin du dossier line_XX
-        sprintf(line_path, "%s/2_cells/line_%02d", base_path, line_index);
+        snprintf(folder, sizeof(folder), "%s/%s_%02d", base_path, dir, folder_index);
 
-        // Vérifier si le dossier line existe en testant si cell_00.pbm existe
-        sprintf(cell_path, "%s/cell_00.pbm", line_path);
-        if (!file_exists(cell_path)) {
-            // Le dossier line n'existe pas ou est vide, on a fini
+        // Vérifier si le dossier existe en testant si <item>_00.pbm existe
+        snprintf(file, sizeof(file), "%s/%s_00.pbm", folder, item);
+        if (!file_exists(file)) {
             break;
         }
 
-        int cell_index = 0;
-
-        // Parcourir les fichiers cell_00.pbm, cell_01.pbm, ...
+        int index = 0;
         while (1) {
-            // Construire le chemin du fichier cell_XX.pbm
-            sprintf(cell_path, "%s/cell_%02d.pbm", line_path, cell_index);
-
-            // Vérifier si le fichier cell existe
-            if (!file_exists(cell_path)) {
-                // Plus de cellules dans cette ligne
+            snprintf(file, sizeof(file), "%s/%s_%02d.pbm", folder, item, index);
+            if (!file_exists(file)) {
                 break;
             }
-
-            // Analyser l'image et récupérer le caractère
-            char c = test_image(cell_path);
-
-            // Écrire le caractère dans le fichier de sortie
-            fputc(c, output);
-
-            cell_index++;
+            if (glyph_set_push(set, file) != 0) return -1;
+            index++;
         }
+        if (glyph_set_end_row(set, index) != 0) return -1;
+        folder_index++;
+    }
+    return folder_index;
+}
 
-        // Saut de ligne après chaque dossier line
+/* Écrit les lignes [first_row, first_row + nrows) de set, une par ligne */
+static int write_glyph_rows(const char *path, const GlyphSet *set,
+                            int first_row, int nrows, int first_glyph) {
+    FILE *output = fopen(path, "w");
+    if (!output) {
+        printf("Erreur: Impossible de créer le fichier de sortie %s\n", path);
+        return -1;
+    }
+    int r, k, g = first_glyph;
+    for (r = first_row; r < first_row + nrows; r++) {
+        for (k = 0; k < set->row_len[r]; k++, g++) {
+            fputc(set->ok[g] ? set->letters[g] : '0', output);
+        }
         fputc('\n', output);
-
-        line_index++;
     }
-
     fclose(output);
-    printf("Traitement terminé. Résultat écrit dans %s\n", OUTPUT_PATH);
-    printf("Nombre de lignes traitées: %d\n", line_index);
-    
-    char output_path2[512];
-    sprintf(output_path2, "%s/mots", OUTPUT_PATH);
-    FILE *output2 = fopen(output_path2, "w");
-    if (!output2) {
-        printf("Erreur: Impossible de créer le fichier de sortie %s\n", output_path2);
-        return 1;
-    }
-
-    int word_index = 0;
-    char word_path[512];
-    char char_path[512];
-
-    // Parcourir les dossiers word_00, word_01, ...
-    while (1) {
-        // Construire le chemin du dossier word_XX
-        sprintf(word_path, "%s/3_words/word_%02d", base_path, word_index);
+    return 0;
+}
 
-        // Vérifier si le dossier word existe en testant si char_00.pbm existe
-        sprintf(char_path, "%s/char_00.pbm", word_path);
-        if (!file_exists(char_path)) {
-            // Le dossier word n'existe pas ou est vide, on a fini
-            break;
+/* Écrit les k meilleures lettres de chaque glyphe dans out/candidats, et
+ * dans out/candidats.txt si text est non nul */
+static int write_candidates(const char *out, const GlyphSet *set, int grid_rows, int k,
+                            int text) {
+    char path[512];
+    TopkFile f;
+    int g;
+    /* Cellules vides: pas de candidats, comme une image illisible */
+    int *known = malloc(sizeof(int) * (set->count > 0 ? set->count : 1));
+    if (!known) return -1;
+    for (g = 0; g < set->count; g++) {
+        known[g] = set->ok[g] && set->verdict[g] == PREFILTER_LETTER;
+    }
+    int built = topk_build(&f, k, (const float (*)[NUM_CLASSES])set->probs, known, set->count,
+                           set->row_len, grid_rows, set->rows - grid_rows) == 0;
+    free(known);
+    if (!built) return -1;
+    snprintf(path, sizeof(path), "%s/%s", out, TOPK_FILE);
+    int ok = topk_save(&f, path) == 0;
+    if (ok) printf("Candidats (top %d) écrits dans %s\n", k, path);
+    if (ok && text) {
+        snprintf(path, sizeof(path), "%s/%s", out, TOPK_TEXT_FILE);
+        FILE *fp = fopen(path, "w");
+        if (fp) {
+            topk_print(&f, fp);
+            ok = fclose(fp) == 0;
+        } else {
+            ok = 0;
         }
+        if (!ok) printf("Erreur: Impossible de créer le fichier de sortie %s\n", path);
+    }
+    topk_free(&f);
+    return ok ? 0 : -1;
+}
 
-        int char_index = 0;
-
-        // Parcourir les fichiers char_00.pbm, char_01.pbm, ...
-        while (1) {
-            // Construire le chemin du fichier char_XX.pbm
-            sprintf(char_path, "%s/char_%02d.pbm", word_path, char_index);
+/* Empreinte du modèle chargé (et de la cascade, et du choix de CONV2
+ * Winograd ou directe, qui change les scores à l'arrondi près): un cache
+ * de glyphes persistant n'est relu qu'avec le modèle qui l'a rempli */
+static uint64_t model_fingerprint(void) {
+    uint64_t h = qnet ? model_bin_checksum(qnet->data, qnet->size)
+                      : model_bin_checksum(net->data, sizeof(float) * net->count);
+    h = model_bin_checksum_continue(h, &use_winograd, sizeof(use_winograd));
+    if (student) {
+        h = model_bin_checksum_continue(h, student->data, sizeof(float) * student->count);
+        h = model_bin_checksum_continue(h, &cascade_threshold, sizeof(cascade_threshold));
+    }
+    return h;
+}
 
-            // Vérifier si le fichier char existe
-            if (!file_exists(char_path)) {
-                // Plus de caractères dans ce mot
-                break;
-            }
+/* Élève de la cascade: un model.bin mappé, CONV2 par Winograd comme le
+ * modèle complet si possible */
+static int load_student(const char *filename, float threshold) {
+    if (model_bin_map(filename, &student_mapping) != 0) return -1;
+    if (use_winograd && (student_wino = conv2_winograd_build(&student_mapping.net)) != NULL) {
+        student_mapping.net.conv2_winograd = student_wino;
+    }
+    student = &student_mapping.net;
+    cascade_threshold = threshold;
+    cascade_glyphs = 0;
+    cascade_fallbacks = 0;
+    const Topology *t = &student->topo;
+    printf("Élève %s (%dx%d,%dx%d,%d, %zu paramètres), seuil de confiance %.2f\n", filename,
+           t->conv1_filters, t->conv1_size, t->conv2_filters, t->conv2_size, t->fc1_size,
+           topology_param_count(t), threshold);
+    return 0;
+}
 
-            // Analyser l'image et récupérer le caractère
-            char c = test_image(char_path);
+static void free_student(void) {
+    student = NULL;
+    conv2_winograd_free(student_wino);
+    student_wino = NULL;
+    model_bin_unmap(&student_mapping);
+}
 
-            // Écrire le caractère dans le fichier de sortie
-            fputc(c, output2);
+/* Lettres (et probabilités si probs n'est pas NULL) de n images par le
+ * modèle chargé */
+static int predict_full(float (*imgs)[IMG_SIZE][IMG_SIZE], int n, char *letters,
+                        float (*probs)[NUM_CLASSES], int threads) {
+    return qnet ? quant_predict_batch(qnet, imgs, n, letters, probs, threads)
+                : predict_batch(net, imgs, n, letters, probs, threads);
+}
 
-            char_index++;
+/* Cascade (distill.h): l'élève reconnaît les n images, celles dont sa
+ * probabilité maximale est sous cascade_threshold repassent dans le
+ * modèle complet, qui a le dernier mot. -1 si mémoire. */
+static int predict_cascade(float (*imgs)[IMG_SIZE][IMG_SIZE], int n, char *letters,
+                           float (*probs)[NUM_CLASSES], int threads) {
+    float (*p)[NUM_CLASSES] = probs ? probs : malloc(sizeof(*p) * n);
+    int *low = malloc(sizeof(int) * n);
+    int k, i, n_low = 0;
+    int ok = p && low && predict_batch(student, imgs, n, letters, p, threads) == 0;
+    
+    for (k = 0; ok && k < n; k++) {
+        float best = p[k][0];
+        for (i = 1; i < NUM_CLASSES; i++) {
+            if (p[k][i] > best) best = p[k][i];
         }
+        if (best < cascade_threshold) low[n_low++] = k;
+    }
+    
+    /* Images peu sûres regroupées, puis résultats remis à leur place */
+    if (ok && n_low > 0) {
+        float (*low_imgs)[IMG_SIZE][IMG_SIZE] = malloc(sizeof(*low_imgs) * n_low);
+        float (*low_probs)[NUM_CLASSES] = malloc(sizeof(*low_probs) * n_low);
+        char *low_letters = malloc(n_low);
+        ok = low_imgs && low_probs && low_letters;
+        for (k = 0; ok && k < n_low; k++) memcpy(low_imgs[k], imgs[low[k]], sizeof(low_imgs[k]));
+        ok = ok && predict_full(low_imgs, n_low, low_letters, low_probs, threads) == 0;
+        for (k = 0; ok && k < n_low; k++) {
+            letters[low[k]] = low_letters[k];
+            memcpy(p[low[k]], low_probs[k], sizeof(p[low[k]]));
+        }
+        free(low_imgs);
+        free(low_probs);
+        free(low_letters);
+    }
+    if (ok) {
+        cascade_glyphs += n;
+        cascade_fallbacks += n_low;
+    }
+    
+    if (!probs) free(p);
+    free(low);
+    return ok ? 0 : -1;
+}
 
-        // Espace après chaque mot (ou \n si tu préfères un mot par ligne)
-        fputc('\n', output2);
-
-        word_index++;
+/* Lettres (et probabilités si need_probs) de toutes les images de set.
+ * Les images illisibles ou écartées par prefilter_glyph() ne passent pas
+ * dans le réseau ('0' ou PREFILTER_CHAR, probabilités nulles). Avec le
+ * cache, seules les images absentes passent dans le réseau, une seule
+ * fois même si elles se répètent; les autres sont recopiées depuis le
+ * cache. -1 si mémoire. */
+static int classify_glyphs(GlyphSet *set, int threads, int need_probs) {
+    const int n = set->count;
+    int *entry = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int *run = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int g, k, n_run = 0, ok = entry && run;
+    
+    for (g = 0; ok && g < n; g++) {
+        int created = 0;
+        entry[g] = -1;
+        if (!set->ok[g] || set->verdict[g] != PREFILTER_LETTER) {
+            set->letters[g] = set->ok[g] ? PREFILTER_CHAR : '0';
+            memset(set->probs[g], 0, sizeof(set->probs[g]));
+            continue;
+        }
+        if (glyph_cache) entry[g] = glyph_cache_get(glyph_cache, set->imgs[g], &created);
+        if (entry[g] < 0 || created) run[n_run++] = g;
+    }
+    
+    /* Images à calculer regroupées (inutile si ce sont toutes les images) */
+    float (*imgs)[IMG_SIZE][IMG_SIZE] = set->imgs;
+    float (*probs)[NUM_CLASSES] = need_probs ? set->probs : NULL;
+    char *letters = set->letters;
+    int gathered = ok && n_run < n;
+    if (gathered) {
+        imgs = malloc(sizeof(*imgs) * (n_run > 0 ? n_run : 1));
+        probs = malloc(sizeof(*probs) * (n_run > 0 ? n_run : 1));
+        letters = malloc(n_run > 0 ? n_run : 1);
+        ok = imgs && probs && letters;
+        for (k = 0; ok && k < n_run; k++) memcpy(imgs[k], set->imgs[run[k]], sizeof(imgs[k]));
+    }
+    if (ok && n_run > 0) {
+        ok = (student ? predict_cascade(imgs, n_run, letters, probs, threads)
+                      : predict_full(imgs, n_run, letters, probs, threads)) == 0;
+    }
+    
+    /* Résultats calculés: dans set et dans les nouvelles entrées du cache */
+    for (k = 0; ok && k < n_run; k++) {
+        g = run[k];
+        if (gathered) {
+            memcpy(set->probs[g], probs[k], sizeof(set->probs[g]));
+            set->letters[g] = letters[k];
+        }
+        if (entry[g] >= 0) {
+            GlyphEntry *e = glyph_cache_entry(glyph_cache, entry[g]);
+            memcpy(e->probs, set->probs[g], sizeof(e->probs));
+            e->letter = set->letters[g];
+        }
+    }
+    /* Puis les images trouvées dans le cache (y compris les répétitions
+     * d'une image calculée ci-dessus) */
+    for (g = 0, k = 0; ok && g < n; g++) {
+        if (k < n_run && run[k] == g) {
+            k++;
+            continue;
+        }
+        if (entry[g] < 0) continue;     /* écartée avant le réseau */
+        const GlyphEntry *e = glyph_cache_entry(glyph_cache, entry[g]);
+        memcpy(set->probs[g], e->probs, sizeof(set->probs[g]));
+        set->letters[g] = e->letter;
     }
+    
+    if (gathered) {
+        free(imgs);
+        free(probs);
+        free(letters);
+    }
+    free(entry);
+    free(run);
+    return ok ? 0 : -1;
+}
 
-    fclose(output2);
-    printf("Traitement terminé. Résultat écrit dans %s\n", output_path2);
-    printf("Nombre de mots traités: %d\n", word_index);
+int process_cells(const char *base_path, const char *OUTPUT_PATH, const CellsConfig *cfg) {
+    double t_start = now_seconds();
+    const int threads = cfg->threads;
+    GlyphSet set;
+    memset(&set, 0, sizeof(set));
+    
+    /* Un seul chargement du modèle pour tout le run */
+    use_winograd = cfg->winograd;
+    if (ensure_network_loaded(cfg->model) != 0) {
+        return 1;
+    }
+    if (cfg->student && load_student(cfg->student, cfg->threshold) != 0) {
+        return 1;
+    }
+    if (cfg->use_cache) {
+        glyph_cache = glyph_cache_new(model_fingerprint());
+        if (!glyph_cache ||
+            (cfg->cache_file && glyph_cache_load(glyph_cache, cfg->cache_file) != 0)) {
+            if (!glyph_cache) printf("Erreur: mémoire insuffisante\n");
+            glyph_cache_free(glyph_cache);
+            glyph_cache = NULL;
+            free_student();
+            return 1;
+        }
+    }
+    
+    /* 1. Liste de toutes les cellules puis de toutes les lettres des mots,
+     *    lues (et triées) ensuite en parallèle */
+    set.prefilter = cfg->prefilter;
+    int line_count = collect_glyphs(base_path, "2_cells/line", "cell", &set);
+    int grid_glyphs = set.count;
+    int word_count = line_count < 0 ? -1 : collect_glyphs(base_path, "3_words/word", "char", &set);
+    if (word_count < 0) {
+        printf("Erreur: mémoire insuffisante\n");
+        glyph_cache_free(glyph_cache);
+        glyph_cache = NULL;
+        free_student();
+        glyph_set_free(&set);
+        return 1;
+    }
+    glyph_set_read(&set, threads);
+    double t_read = now_seconds();
+    
+    /* 2. Un seul passage du réseau sur tout le lot (images absentes du cache) */
+    int ok = classify_glyphs(&set, threads, cfg->topk > 0 || glyph_cache != NULL) == 0;
+    if (!ok) printf("Erreur: mémoire insuffisante\n");
+    double t_infer = now_seconds();
+    
+    /* 3. Écriture de grid puis de mots, dans l'ordre des fichiers */
+    char output_path[512];
+    snprintf(output_path, sizeof(output_path), "%s/grid", OUTPUT_PATH);
+    ok = ok && write_glyph_rows(output_path, &set, 0, line_count, 0) == 0;
+    if (ok) {
+        printf("Traitement terminé. Résultat écrit dans %s\n", OUTPUT_PATH);
+        printf("Nombre de lignes traitées: %d\n", line_count);
+        snprintf(output_path, sizeof(output_path), "%s/mots", OUTPUT_PATH);
+        ok = write_glyph_rows(output_path, &set, line_count, word_count, grid_glyphs) == 0;
+    }
+    if (ok) {
+        printf("Traitement terminé. Résultat écrit dans %s\n", output_path);
+        printf("Nombre de mots traités: %d\n", word_count);
+    }
+    if (ok && cfg->topk > 0) {
+        ok = write_candidates(OUTPUT_PATH, &set, line_count, cfg->topk, cfg->topk_text) == 0;
+    }
+    
+    if (ok) {
+        /* Résumé des temps: le chargement ne doit apparaître qu'une fois */
+        double total = now_seconds() - t_start;
+        double infer = t_infer - t_read;
+        printf("\n=== RÉSUMÉ DU RUN ===\n");
+        printf("Chargements du modèle: %d (%.3f s)\n", model_load_count, model_load_seconds);
+        printf("Lecture des images: %.3f s\n", t_read - t_start - model_load_seconds);
+        const char *kind = qnet ? " [INT8]" : "";
+        if (hnet) kind = hnet->fc.format == HALF_BF16 ? " [BF16]" : " [FP16]";
+        printf("Glyphes reconnus: %d en %.3f s sur %d thread(s)%s", set.count, infer, threads,
+               kind);
+        if (set.count > 0) {
+            printf(" (%.3f ms/glyphe)", 1000.0 * infer / (double)set.count);
+        }
+        printf("\n");
+        int counts[PREFILTER_VERDICTS] = { 0 }, unreadable = 0, g;
+        for (g = 0; g < set.count; g++) {
+            if (set.ok[g]) counts[set.verdict[g]]++;
+            else unreadable++;
+        }
+        if (set.count > counts[PREFILTER_LETTER]) {
+            printf("Écartés avant le réseau: %d glyphes (%d vides, %d traits, %d pleins, %d illisibles)\n",
+                   set.count - counts[PREFILTER_LETTER], counts[PREFILTER_EMPTY],
+                   counts[PREFILTER_FLAT], counts[PREFILTER_FULL], unreadable);
+        }
+        if (student && cascade_glyphs > 0) {
+            long resolved = cascade_glyphs - cascade_fallbacks;
+            printf("Cascade: %ld glyphes sur %ld résolus par l'élève (%.1f %%), %ld par le modèle complet\n",
+                   resolved, cascade_glyphs, 100.0 * (double)resolved / (double)cascade_glyphs,
+                   cascade_fallbacks);
+        }
+        printf("Temps total: %.3f s\n", total);
+    }
+    if (ok && glyph_cache) {
+        GlyphCacheStats st;
+        glyph_cache_stats(glyph_cache, &st);
+        printf("Cache de glyphes: %ld trouvés, %ld calculés, %ld hors cache (%d entrées)\n",
+               st.hits, st.misses, st.uncached, st.entries);
+        if (cfg->cache_file) {
+            ok = glyph_cache_save(glyph_cache, cfg->cache_file) == 0;
+            if (ok) printf("Cache enregistré dans %s\n", cfg->cache_file);
+        }
+    }
     
+    glyph_cache_free(glyph_cache);
+    glyph_cache = NULL;
+    free_student();
+    glyph_set_free(&set);
+    return ok ? 0 : 1;
+}
+
+/* ============================================================
+ * DÉMON (main serve)
+ * ============================================================ */
+
+/* Charge le modèle une fois et sert les requêtes sur path jusqu'à
+ * SIGINT / SIGTERM. Un modèle réécrit pendant ce temps n'est pas relu
+ * (server.h): il faut relancer le démon. */
+int serve(const char *path, const char *model_path) {
+    sigset_t stop;
+    int sig;
+    long requests, glyphs;
+    
+    /* Bloqués avant la création des threads, qui en héritent: seul
+     * sigwait() les reçoit, et l'arrêt passe par server_stop() */
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+    
+    if (ensure_network_loaded(model_path) != 0) return -1;
+    Server *s = server_start(path, qnet ? NULL : net, qnet, SERVER_MAX_CLIENTS);
+    if (!s) return -1;
+    printf("Démon OCR à l'écoute sur %s (modèle chargé en %.3f s, Ctrl+C pour arrêter)\n",
+           path, model_load_seconds);
+    fflush(stdout);
+    
+    sigwait(&stop, &sig);
+    server_stats(s, &requests, &glyphs);
+    server_stop(s);
+    printf("\nDémon arrêté: %ld requêtes, %ld glyphes reconnus\n", requests, glyphs);
     return 0;
 }
 
 /* ============================================================
- * MAIN
+ * QUANTIFICATION INT8
  * ============================================================ */
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Usage:\n");
-        printf("  %s 1          - Entraîner le modèle\n", argv[0]);
-        printf("  %s 2          - Tester une image\n", argv[0]);
-        printf("  %s 3          - Tester un dossier\n", argv[0]);
-        return 1;
-    }
+/* Calibre les échelles d'activation sur les premiers échantillons de
+ * chaque lettre, quantifie le modèle flottant, puis compare la précision
+ * des deux modèles sur les échantillons suivants (non vus en calibration) */
+int quantize_model(const char *src, const char *dst, const char *data_dir) {
+    float img[IMG_SIZE][IMG_SIZE];
+    char path[512];
+    int letter, sample, j;
     
-    int mode = argv[1][0] - '0';
+    if (ensure_network_loaded(src) != 0) {
+        return -1;
+    }
+    if (qnet || hnet) {
+        printf("Erreur: %s est déjà quantifié\n", src);
+        return -1;
+    }
     
-    if (mode == 1) {
-        train("letters_50x50_fonts");
+    /* 1. Calibration: plus grandes activations à l'entrée de FC1 et de FC2 */
+    float flat_max = 0.0f, hidden_max = 0.0f;
+    int calib = 0;
+    for (letter = 0; letter < NUM_CLASSES; letter++) {
+        for (sample = 0; sample < QUANT_CALIB_PER_LETTER; sample++) {
+            snprintf(path, sizeof(path), "%s/%c/%c_%03d.pbm", data_dir, 'A' + letter, 'A' + letter, sample);
+            if (!file_exists(path) || read_pbm(path, img) != 0) continue;
+            forward(img);
+            for (j = 0; j < net->topo.flatten; j++) {
+                if (cache.flatten[j] > flat_max) flat_max = cache.flatten[j];
+            }
+            for (j = 0; j < net->topo.fc1_size; j++) {
+                if (cache.relu3_out[j] > hidden_max) hidden_max = cache.relu3_out[j];
+            }
+            calib++;
+        }
+    }
+    if (calib == 0) {
+        printf("Erreur: aucune image de calibration dans %s\n", data_dir);
+        return -1;
+    }
+    printf("Calibration sur %d images: max entrée FC1 = %g, max entrée FC2 = %g\n",
+           calib, flat_max, hidden_max);
+    
+    QuantCNN *q = quant_from_float(net, flat_max, hidden_max);
+    QuantWorkspace *ws = q ? quant_workspace_new(q) : NULL;
+    if (!q || !ws) {
+        printf("Erreur: mémoire insuffisante\n");
+        quant_free(q);
+        quant_workspace_free(ws);
+        return -1;
+    }
+    
+    /* 2. Précision flottant / INT8 sur les échantillons suivants; à défaut
+     *    (petit jeu de données), sur les images de calibration */
+    int first = QUANT_CALIB_PER_LETTER, last = QUANT_CALIB_PER_LETTER + QUANT_EVAL_PER_LETTER;
+    int pass, total = 0, ok_float = 0, ok_int8 = 0, agree = 0;
+    double t_float = 0.0, t_int8 = 0.0;
+    for (pass = 0; pass < 2 && total == 0; pass++) {
+        if (pass == 1) {
+            printf("Pas d'échantillons après la calibration: évaluation sur les images de calibration\n");
+            first = 0;
+            last = QUANT_CALIB_PER_LETTER;
+        }
+        for (letter = 0; letter < NUM_CLASSES; letter++) {
+            for (sample = first; sample < last; sample++) {
+                snprintf(path, sizeof(path), "%s/%c/%c_%03d.pbm", data_dir, 'A' + letter, 'A' + letter, sample);
+                if (!file_exists(path) || read_pbm(path, img) != 0) continue;
+                double t0 = now_seconds();
+                int pf = predict(img) - 'A';
+                double t1 = now_seconds();
+                int pq = quant_predict(q, ws, img);
+                double t2 = now_seconds();
+                t_float += t1 - t0;
+                t_int8 += t2 - t1;
+                ok_float += pf == letter;
+                ok_int8 += pq == letter;
+                agree += pf == pq;
+                total++;
+            }
+        }
+    }
+    
+    float acc_float = 100.0f * (float)ok_float / (float)total;
+    float acc_int8 = 100.0f * (float)ok_int8 / (float)total;
+    printf("\n=== FLOTTANT / INT8 (%d images) ===\n", total);
+    printf("Précision flottant: %.2f%%\n", acc_float);
+    printf("Précision INT8:     %.2f%% (écart %+.2f points)\n", acc_int8, acc_int8 - acc_float);
+    printf("Prédictions identiques: %.2f%%\n", 100.0f * (float)agree / (float)total);
+    printf("Temps par image: flottant %.3f ms, INT8 %.3f ms\n",
+           1000.0 * t_float / total, 1000.0 * t_int8 / total);
+    size_t fc_weights = (size_t)net->topo.fc1_size * (net->topo.flatten + FC2_SIZE);
+    printf("Taille des poids FC: %zu -> %zu octets\n", sizeof(float) * fc_weights, fc_weights);
+    
+    int ret = quant_save(q, dst);
+    quant_workspace_free(ws);
+    quant_free(q);
+    return ret;
+}
+
+/* ============================================================
+ * ÉLAGAGE DE FC1
+ * ============================================================ */
+
+#define PRUNE_MAX_LEVELS 16
+/* Images traitées au minimum pour chaque mesure de latence */
+#define PRUNE_BENCH_IMAGES 2048
+
+/* Mesures de latence: image par image (predict()) et par lots (predict_batch()) */
+static const int prune_batches[2] = {1, BATCH_TILE};
+
+/* Une ligne du compromis précision / latence */
+typedef struct {
+    float level;
+    PruneStats stats;
+    float acc_pruned;           /* avant réglage fin */
+    float acc;
+    double ms_dense[2];         /* ms par image pour chaque prune_batches[] */
+    double ms_sparse[2];        /* 0: index creux non construit */
+    float max_diff;             /* écart max des probabilités creux / dense */
+    size_t fc1_bytes;           /* octets de FC1 lus par image */
+} PruneRow;
+
+/* Images de validation décodées une fois */
+typedef struct {
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    uint8_t *labels;
+    float (*probs)[NUM_CLASSES];
+    float (*ref)[NUM_CLASSES];  /* probabilités denses, pour l'écart */
+    int n;
+    BatchWorkspace *ws;
+} PruneEval;
+
+/* Précision de m (en %) et temps par image sur un thread, par lots de
+ * batch images */
+static float prune_eval(const CNN *m, PruneEval *e, float (*probs)[NUM_CLASSES], int batch,
+                        double *ms) {
+    int reps = (PRUNE_BENCH_IMAGES + e->n - 1) / e->n;
+    int r, k, c, correct = 0;
+    double t0 = now_seconds();
+    for (r = 0; r < reps; r++) {
+        for (k = 0; k < e->n; k += batch) {
+            forward_batch_ws(m, e->ws, e->imgs + k, e->n - k < batch ? e->n - k : batch,
+                             probs + k);
+        }
+    }
+    *ms = 1000.0 * (now_seconds() - t0) / ((double)reps * e->n);
+    for (k = 0; k < e->n; k++) {
+        int pred = 0;
+        for (c = 1; c < NUM_CLASSES; c++) {
+            if (probs[k][c] > probs[k][pred]) pred = c;
+        }
+        correct += pred == e->labels[k];
+    }
+    return 100.0f * (float)correct / (float)e->n;
+}
+
+/* Écart absolu maximal entre deux tableaux */
+static float max_abs_diff(const float *a, const float *b, size_t n) {
+    float m = 0.0f;
+    size_t k;
+    for (k = 0; k < n; k++) {
+        float d = a[k] - b[k];
+        if (d < 0) d = -d;
+        if (d > m) m = d;
+    }
+    return m;
+}
+
+/* Mesures du réseau courant en dense puis avec l'index creux */
+static void prune_measure(CNN *m, PruneEval *e, PruneRow *row) {
+    int b;
+    prune_stats(m, &row->stats);
+    for (b = 0; b < 2; b++) {
+        row->acc = prune_eval(m, e, e->ref, prune_batches[b], &row->ms_dense[b]);
+        row->ms_sparse[b] = 0.0;
+    }
+    row->fc1_bytes = sizeof(float) * (size_t)m->topo.fc1_size * m->topo.flatten;
+    row->max_diff = 0.0f;
+    SparseFc1 *sp = sparse_fc1_build(m);
+    if (!sp) return;
+    m->fc1_sparse = sp;
+    for (b = 0; b < 2; b++) prune_eval(m, e, e->probs, prune_batches[b], &row->ms_sparse[b]);
+    m->fc1_sparse = NULL;
+    row->fc1_bytes = sparse_fc1_bytes(sp);
+    row->max_diff = max_abs_diff(&e->probs[0][0], &e->ref[0][0], (size_t)e->n * NUM_CLASSES);
+    sparse_fc1_free(sp);
+}
+
+static int parse_levels(const char *spec, float levels[PRUNE_MAX_LEVELS]) {
+    const char *p = spec;
+    int n = 0;
+    while (*p && n < PRUNE_MAX_LEVELS) {
+        char *end;
+        float v = strtof(p, &end);
+        if (end == p || v <= 0.0f || v >= 1.0f || (n > 0 && v <= levels[n - 1])) return -1;
+        levels[n++] = v;
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return *p ? -1 : n;
+}
+
+/* Niveaux successifs: élagage du modèle du niveau précédent, réglage fin
+ * avec les zéros figés (cfg->start == current), mesures dans rows[1..] et
+ * modèle écrit dans <out>_s<niveau>.bin */
+static int prune_levels(TrainConfig *cfg, CNN *current, PruneEval *e, const float *levels,
+                        int n_levels, float share, const char *out, PruneRow *rows) {
+    int l;
+    for (l = 0; l < n_levels; l++) {
+        PruneRow *row = &rows[l + 1];
+        double ms;
+        char path[512];
+        row->level = levels[l];
+        printf("\n=== ÉLAGAGE À %.0f %% ===\n", 100.0f * levels[l]);
+        uint8_t *mask = prune_fc1(current, levels[l], share) == 0 ? prune_mask(current) : NULL;
+        if (!mask) {
+            printf("Erreur: mémoire insuffisante\n");
+            return -1;
+        }
+        row->acc_pruned = prune_eval(current, e, e->ref, BATCH_TILE, &ms);
+        
+        cfg->pruned = mask;
+        int err = train(cfg);
+        cfg->pruned = NULL;
+        free(mask);
+        if (err != 0) return -1;
+        cnn_copy(current, net);
+        
+        prune_measure(current, e, row);
+        snprintf(path, sizeof(path), "%s_s%02.0f.bin", out, 100.0f * levels[l]);
+        if (model_bin_save(current, path) != 0) return -1;
+    }
+    return 0;
+}
+
+static void print_prune_report(const PruneRow *rows, int n_rows, int fc1_size, int images) {
+    int l, b;
+    printf("\n=== COMPROMIS PRÉCISION / LATENCE (%d images de validation, 1 thread) ===\n",
+           images);
+    printf("ms par image, dense -> creux, image par image puis par lots de %d\n",
+           prune_batches[1]);
+    printf("Élagage  Neurones  Blocs nuls  Précision (avant réglage)  FC1 lu/image"
+           "         1 image                  lots       Écart\n");
+    for (l = 0; l < n_rows; l++) {
+        const PruneRow *row = &rows[l];
+        printf("%5.0f %%  %4d/%-4d  %7.1f %%  %7.2f %% (%7.2f %%)  %9zu Ko", 100.0f * row->level,
+               row->stats.neurons, fc1_size, 100.0f * row->stats.zero_blocks,
+               row->acc, row->acc_pruned, row->fc1_bytes / 1024);
+        for (b = 0; b < 2; b++) {
+            if (row->ms_sparse[b] > 0.0) {
+                printf("  %6.3f -> %6.3f (%4.2fx)", row->ms_dense[b], row->ms_sparse[b],
+                       row->ms_dense[b] / row->ms_sparse[b]);
+            } else {
+                printf("  %6.3f                 ", row->ms_dense[b]);
+            }
+        }
+        printf("  %g\n", row->max_diff);
+    }
+}
+
+/* Outil d'élagage: modèle source, puis --levels, --neurons, --out et les
+ * options du mode 1 pour le réglage fin. Les mesures se font sur les
+ * polices de validation, jamais vues à l'entraînement. */
+int prune_model(int argc, char *argv[]) {
+    const char *src = default_model_path();
+    const char *levels_spec = PRUNE_LEVELS, *out = PRUNE_OUTPUT;
+    float share = PRUNE_NEURON_SHARE;
+    float levels[PRUNE_MAX_LEVELS];
+    char *train_argv[argc + 1];
+    int train_argc = 0, epochs_set = 0, lr_set = 0, augment_set = 0, n_levels, i = 0;
+    
+    if (argc > 0 && argv[0][0] != '-') src = argv[i++];
+    for (; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--levels") == 0 && has_value) {
+            levels_spec = argv[++i];
+        } else if (strcmp(argv[i], "--neurons") == 0 && has_value) {
+            share = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out = argv[++i];
+        } else {
+            epochs_set |= strcmp(argv[i], "--epochs") == 0;
+            lr_set |= strcmp(argv[i], "--lr") == 0;
+            augment_set |= strcmp(argv[i], "--augment") == 0 ||
+                           strcmp(argv[i], "--no-augment") == 0;
+            train_argv[train_argc++] = argv[i];
+        }
+    }
+    TrainConfig cfg;
+    if (parse_train_args(train_argc, train_argv, &cfg) != 0) return -1;
+    n_levels = parse_levels(levels_spec, levels);
+    if (n_levels <= 0) {
+        printf("Niveaux invalides: %s (fractions croissantes dans ]0, 1[, ex. %s)\n",
+               levels_spec, PRUNE_LEVELS);
+        return -1;
+    }
+    if (share < 0.0f || share > 1.0f || cfg.resume) {
+        printf("Erreur: --neurons doit être dans [0, 1], --resume n'est pas disponible\n");
+        return -1;
+    }
+    /* Réglage fin court: mêmes images que le modèle a déjà vues, pas assez
+     * d'époques pour s'adapter à l'augmentation s'il a appris sans */
+    if (!epochs_set) cfg.epochs = PRUNE_EPOCHS;
+    if (!augment_set) cfg.augment = 0;
+    if (!lr_set) {
+        cfg.lr = PRUNE_LR_SCALE * (cfg.optim == OPTIM_ADAM ? ADAM_LEARNING_RATE : LEARNING_RATE);
+    }
+    cfg.checkpoint_every = 0;
+    cfg.model_text = NULL;
+    cfg.model_bin = NULL;
+    
+    if (ensure_network_loaded(src) != 0) return -1;
+    if (qnet || hnet) {
+        printf("Erreur: %s est quantifié, l'élagage part du modèle flottant\n", src);
+        return -1;
+    }
+    
+    Dataset ds;
+    PruneEval e;
+    CNN current;
+    PruneRow rows[PRUNE_MAX_LEVELS + 1];
+    int *train_idx = NULL, *val_idx = NULL, n_train = 0;
+    if (open_training_set(cfg.data, &ds) != 0) return -1;
+    memset(&e, 0, sizeof(e));
+    memset(&current, 0, sizeof(current));
+    memset(rows, 0, sizeof(rows));
+    int ok = val_split(&ds, cfg.held_out, &train_idx, &n_train, &val_idx, &e.n) == 0 &&
+             cnn_alloc(&current, &net->topo) == 0;
+    if (ok && e.n > 0) {
+        e.imgs = malloc(sizeof(*e.imgs) * e.n);
+        e.labels = malloc(e.n);
+        e.probs = malloc(sizeof(*e.probs) * e.n);
+        e.ref = malloc(sizeof(*e.ref) * e.n);
+        e.ws = batch_workspace_new(&net->topo);
+        ok = e.imgs && e.labels && e.probs && e.ref && e.ws;
+    }
+    if (!ok) {
+        printf("Erreur: mémoire insuffisante\n");
+    } else if (e.n == 0) {
+        printf("Erreur: aucune image de validation (--val-fonts)\n");
+        ok = 0;
+    }
+    
+    if (ok) {
+        for (i = 0; i < e.n; i++) {
+            dataset_image(&ds, val_idx[i], e.imgs[i]);
+            e.labels[i] = ds.labels[val_idx[i]];
+        }
+        cnn_copy(&current, net);
+        cfg.topo = current.topo;
+        cfg.start = &current;
+        
+        prune_measure(&current, &e, &rows[0]);
+        rows[0].acc_pruned = rows[0].acc;
+        ok = prune_levels(&cfg, &current, &e, levels, n_levels, share, out, rows) == 0;
+        if (ok) print_prune_report(rows, n_levels + 1, current.topo.fc1_size, e.n);
+    }
+    
+    batch_workspace_free(e.ws);
+    free(e.imgs);
+    free(e.labels);
+    free(e.probs);
+    free(e.ref);
+    free(train_idx);
+    free(val_idx);
+    cnn_free(&current);
+    dataset_unmap(&ds);
+    return ok ? 0 : -1;
+}
+
+/* ============================================================
+ * POIDS FC SUR 16 BITS
+ * ============================================================ */
+
+/* Une ligne de la comparaison float32 / fp16 / bf16 */
+typedef struct {
+    const char *name;
+    size_t file_bytes, fc_bytes;
+    float acc;
+    double ms[2];               /* ms par image pour chaque prune_batches[] */
+    float max_diff;             /* écart max des probabilités avec float32 */
+    int agree;                  /* prédictions identiques à float32 */
+} HalfRow;
+
+/* Mesures de m sur les images de validation; e->ref reçoit les
+ * probabilités si ref est NULL (modèle float32), sinon elles servent de
+ * référence */
+static void half_measure(const CNN *m, PruneEval *e, float (*ref)[NUM_CLASSES], HalfRow *row) {
+    float (*probs)[NUM_CLASSES] = ref ? e->probs : e->ref;
+    int b, k, c;
+    for (b = 0; b < 2; b++) row->acc = prune_eval(m, e, probs, prune_batches[b], &row->ms[b]);
+    row->max_diff = 0.0f;
+    row->agree = e->n;
+    if (!ref) return;
+    row->max_diff = max_abs_diff(&probs[0][0], &ref[0][0], (size_t)e->n * NUM_CLASSES);
+    for (k = 0; k < e->n; k++) {
+        int p = 0, q = 0;
+        for (c = 1; c < NUM_CLASSES; c++) {
+            if (probs[k][c] > probs[k][p]) p = c;
+            if (ref[k][c] > ref[k][q]) q = c;
+        }
+        row->agree -= p != q;
+    }
+}
+
+/* Convertit les poids FC du modèle float32 en float16 et en bfloat16,
+ * compare les deux au float32 sur les polices de validation (taille,
+ * précision, latence sur un thread) puis écrit le format choisi.
+ * Options: --format fp16|bf16, --out fichier, puis [données] et
+ * --val-fonts comme le mode 1. */
+int half_model(int argc, char *argv[]) {
+    static const int formats[2] = { HALF_FP16, HALF_BF16 };
+    const char *src = default_model_path(), *out = HALF_FILE;
+    char *train_argv[argc + 1];
+    int train_argc = 0, format = HALF_FP16, i = 0, f;
+    
+    if (argc > 0 && argv[0][0] != '-') src = argv[i++];
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = half_parse_format(argv[++i]);
+            if (format < 0) {
+                printf("Format inconnu: %s (fp16, bf16)\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            train_argv[train_argc++] = argv[i];
+        }
+    }
+    TrainConfig cfg;
+    if (parse_train_args(train_argc, train_argv, &cfg) != 0) return -1;
+    if (ensure_network_loaded(src) != 0) return -1;
+    if (qnet || hnet) {
+        printf("Erreur: %s est déjà quantifié\n", src);
+        return -1;
+    }
+    
+    Dataset ds;
+    PruneEval e;
+    HalfRow rows[3];
+    HalfCNN *half[2] = { NULL, NULL };
+    int *train_idx = NULL, *val_idx = NULL, n_train = 0;
+    if (open_training_set(cfg.data, &ds) != 0) return -1;
+    memset(&e, 0, sizeof(e));
+    memset(rows, 0, sizeof(rows));
+    int ok = val_split(&ds, cfg.held_out, &train_idx, &n_train, &val_idx, &e.n) == 0;
+    for (f = 0; ok && f < 2; f++) ok = (half[f] = half_from_float(net, formats[f])) != NULL;
+    if (ok && e.n > 0) {
+        e.imgs = malloc(sizeof(*e.imgs) * e.n);
+        e.labels = malloc(e.n);
+        e.probs = malloc(sizeof(*e.probs) * e.n);
+        e.ref = malloc(sizeof(*e.ref) * e.n);
+        e.ws = batch_workspace_new(&net->topo);
+        ok = e.imgs && e.labels && e.probs && e.ref && e.ws;
+    }
+    if (!ok) {
+        printf("Erreur: mémoire insuffisante\n");
+    } else if (e.n == 0) {
+        printf("Erreur: aucune image de validation (--val-fonts)\n");
+        ok = 0;
+    }
+    
+    if (ok) {
+        const Topology *t = &net->topo;
+        size_t fc_weights = (size_t)t->fc1_size * (t->flatten + FC2_SIZE);
+        for (i = 0; i < e.n; i++) {
+            dataset_image(&ds, val_idx[i], e.imgs[i]);
+            e.labels[i] = ds.labels[val_idx[i]];
+        }
+        rows[0].name = "float32";
+        rows[0].file_bytes = MODEL_BIN_HEADER_SIZE + sizeof(float) * net->count;
+        rows[0].fc_bytes = sizeof(float) * fc_weights;
+        half_measure(net, &e, NULL, &rows[0]);
+        for (f = 0; f < 2; f++) {
+            rows[f + 1].name = half_format_name(formats[f]);
+            rows[f + 1].file_bytes = HALF_HEADER_SIZE + half[f]->size;
+            rows[f + 1].fc_bytes = sizeof(uint16_t) * fc_weights;
+            half_measure(&half[f]->net, &e, e.ref, &rows[f + 1]);
+        }
+        
+        printf("\n=== POIDS FC: FLOAT32 / FP16 / BF16 (%d images de validation, 1 thread, %s) ===\n",
+               e.n, simd->name);
+        printf("Format   Fichier   Poids FC  Précision  Identiques  ms/image: 1 image  lots de %d"
+               "  Écart max\n", prune_batches[1]);
+        for (i = 0; i < 3; i++) {
+            const HalfRow *row = &rows[i];
+            printf("%-7s %6zu Ko %7zu Ko  %7.2f %%  %8.2f %%  %17.3f %10.3f  %9g\n", row->name,
+                   row->file_bytes / 1024, row->fc_bytes / 1024, row->acc,
+                   100.0f * (float)row->agree / (float)e.n, row->ms[0], row->ms[1],
+                   row->max_diff);
+        }
+        ok = half_save(half[format == HALF_BF16], out) == 0;
+    }
+    
+    for (f = 0; f < 2; f++) half_free(half[f]);
+    batch_workspace_free(e.ws);
+    free(e.imgs);
+    free(e.labels);
+    free(e.probs);
+    free(e.ref);
+    free(train_idx);
+    free(val_idx);
+    dataset_unmap(&ds);
+    return ok ? 0 : -1;
+}
+
+/* ============================================================
+ * CASCADE: COURBE PRÉCISION / VITESSE
+ * ============================================================ */
+
+/* Une ligne de la courbe de la cascade */
+typedef struct {
+    const char *name;           /* NULL: ligne d'un seuil */
+    float threshold;
+    float resolved;             /* % d'images gardées par l'élève */
+    float acc;                  /* % de lettres justes */
+    int agree;                  /* prédictions identiques au modèle seul */
+    double ms;                  /* ms par image sur un thread */
+} CascadeRow;
+
+/* Images traitées au minimum pour chaque mesure: les écarts de temps
+ * entre seuils voisins sont petits */
+#define CASCADE_BENCH_IMAGES 10000
+
+/* Reconnaît les n images de validation (élève seul si only_student,
+ * modèle seul si student est NULL, sinon la cascade au seuil courant),
+ * assez de fois pour CASCADE_BENCH_IMAGES images */
+static int cascade_measure(float (*imgs)[IMG_SIZE][IMG_SIZE], const uint8_t *labels, int n,
+                           const char *ref, int only_student, char *letters, CascadeRow *row) {
+    int reps = (CASCADE_BENCH_IMAGES + n - 1) / n;
+    int r, k, ok = 1;
+    cascade_glyphs = 0;
+    cascade_fallbacks = 0;
+    double t0 = now_seconds();
+    for (r = 0; ok && r < reps; r++) {
+        ok = (only_student ? predict_batch(student, imgs, n, letters, NULL, 1)
+                           : student ? predict_cascade(imgs, n, letters, NULL, 1)
+                                     : predict_full(imgs, n, letters, NULL, 1)) == 0;
+    }
+    if (!ok) return -1;
+    row->ms = 1000.0 * (now_seconds() - t0) / ((double)reps * n);
+    row->resolved = only_student ? 100.0f : 0.0f;
+    if (student && !only_student) {
+        row->resolved = 100.0f * (float)(cascade_glyphs - cascade_fallbacks) / (float)cascade_glyphs;
+    }
+    int correct = 0;
+    row->agree = 0;
+    for (k = 0; k < n; k++) {
+        correct += letters[k] == 'A' + labels[k];
+        row->agree += !ref || letters[k] == ref[k];
+    }
+    row->acc = 100.0f * (float)correct / (float)n;
+    return 0;
+}
+
+/* Précision (contre les étiquettes des polices de validation) et temps
+ * par image du modèle seul, de l'élève seul et de la cascade pour chaque
+ * seuil, sur un thread: la courbe qui sert à choisir --threshold.
+ * Options: --student fichier, --thresholds a,b,..., puis [données] et
+ * --val-fonts comme le mode 1. */
+int cascade_curve(int argc, char *argv[]) {
+    const char *src = default_model_path(), *student_file = DISTILL_FILE;
+    const char *spec = CASCADE_THRESHOLDS;
+    float thresholds[PRUNE_MAX_LEVELS];
+    char *train_argv[argc + 1];
+    int train_argc = 0, n_thresholds, i = 0;
+    
+    if (argc > 0 && argv[0][0] != '-') src = argv[i++];
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "--student") == 0 && i + 1 < argc) {
+            student_file = argv[++i];
+        } else if (strcmp(argv[i], "--thresholds") == 0 && i + 1 < argc) {
+            spec = argv[++i];
+        } else {
+            train_argv[train_argc++] = argv[i];
+        }
+    }
+    TrainConfig cfg;
+    if (parse_train_args(train_argc, train_argv, &cfg) != 0) return -1;
+    n_thresholds = parse_levels(spec, thresholds);
+    if (n_thresholds <= 0) {
+        printf("Seuils invalides: %s (valeurs croissantes dans ]0, 1[, ex. %s)\n",
+               spec, CASCADE_THRESHOLDS);
+        return -1;
+    }
+    if (ensure_network_loaded(src) != 0) return -1;
+    if (load_student(student_file, CASCADE_THRESHOLD) != 0) return -1;
+    
+    Dataset ds;
+    CascadeRow rows[PRUNE_MAX_LEVELS + 2];
+    float (*imgs)[IMG_SIZE][IMG_SIZE] = NULL;
+    uint8_t *labels = NULL;
+    char *ref = NULL, *letters = NULL;
+    int *train_idx = NULL, *val_idx = NULL, n_train = 0, n = 0;
+    memset(rows, 0, sizeof(rows));
+    int ok = open_training_set(cfg.data, &ds) == 0;
+    if (!ok) {
+        free_student();
+        return -1;
+    }
+    ok = val_split(&ds, cfg.held_out, &train_idx, &n_train, &val_idx, &n) == 0;
+    if (ok && n > 0) {
+        imgs = malloc(sizeof(*imgs) * n);
+        labels = malloc(n);
+        ref = malloc(n);
+        letters = malloc(n);
+        ok = imgs && labels && ref && letters;
+        if (!ok) printf("Erreur: mémoire insuffisante\n");
+    } else if (ok) {
+        printf("Erreur: aucune image de validation (--val-fonts)\n");
+        ok = 0;
+    }
+    
+    if (ok) {
+        for (i = 0; i < n; i++) {
+            dataset_image(&ds, val_idx[i], imgs[i]);
+            labels[i] = ds.labels[val_idx[i]];
+        }
+        /* Modèle seul d'abord: ses lettres servent de référence */
+        const CNN *cascade = student;
+        student = NULL;
+        rows[0].name = "modèle";
+        ok = cascade_measure(imgs, labels, n, NULL, 0, ref, &rows[0]) == 0;
+        student = cascade;
+        rows[1].name = "élève ";
+        ok = ok && cascade_measure(imgs, labels, n, ref, 1, letters, &rows[1]) == 0;
+        for (i = 0; ok && i < n_thresholds; i++) {
+            cascade_threshold = rows[i + 2].threshold = thresholds[i];
+            ok = cascade_measure(imgs, labels, n, ref, 0, letters, &rows[i + 2]) == 0;
+        }
+        if (!ok) printf("Erreur: mémoire insuffisante\n");
+    }
+    
+    if (ok) {
+        printf("\n=== CASCADE ÉLÈVE -> MODÈLE (%d images de validation, 1 thread, %s) ===\n",
+               n, simd->name);
+        printf("Seuil    Élève  Précision  Identiques  ms/image\n");
+        for (i = 0; i < n_thresholds + 2; i++) {
+            const CascadeRow *row = &rows[i];
+            if (row->name) printf("%s", row->name);     /* 6 caractères, comme %-6.2f */
+            else printf("%-6.2f", row->threshold);
+            printf(" %5.1f %%  %7.2f %%  %8.2f %%  %8.3f\n", row->resolved, row->acc,
+                   100.0f * (float)row->agree / (float)n, row->ms);
+        }
+    }
+    
+    free(imgs);
+    free(labels);
+    free(ref);
+    free(letters);
+    free(train_idx);
+    free(val_idx);
+    dataset_unmap(&ds);
+    free_student();
+    return ok ? 0 : -1;
+}
+
+/* ============================================================
+ * BENCHMARKS
+ * ============================================================ */
+
+/* Débit de forward() image par image et de forward_batch() pour
+ * plusieurs tailles de lot, sur les lettres du dossier donné */
+int bench_batch(const char *base_path) {
+    static const int sizes[] = {1, 16, 64, 256};
+    const int max_n = 256;
+    GlyphSet set;
+    memset(&set, 0, sizeof(set));
+    
+    if (ensure_network_loaded(default_model_path()) != 0) {
+        return 1;
+    }
+    if (collect_glyphs(base_path, "2_cells/line", "cell", &set) < 0 ||
+        collect_glyphs(base_path, "3_words/word", "char", &set) < 0 || set.count == 0) {
+        printf("Erreur: aucune lettre trouvée dans %s\n", base_path);
+        glyph_set_free(&set);
+        return 1;
+    }
+    glyph_set_read(&set, 1);
+    
+    /* Compléter jusqu'à max_n images en réutilisant celles lues */
+    float (*imgs)[IMG_SIZE][IMG_SIZE] = malloc(sizeof(*imgs) * max_n);
+    float (*probs)[NUM_CLASSES] = malloc(sizeof(*probs) * max_n);
+    if (!imgs || !probs) {
+        free(imgs);
+        free(probs);
+        glyph_set_free(&set);
+        return 1;
+    }
+    int k, s, i;
+    for (k = 0; k < max_n; k++) {
+        memcpy(imgs[k], set.imgs[k % set.count], sizeof(imgs[k]));
+    }
+    
+    /* Vérification: le lot doit reproduire forward() exactement */
+    float max_diff = 0.0f;
+    forward_batch(net, imgs, max_n, probs);
+    for (k = 0; k < max_n; k++) {
+        forward(imgs[k]);
+        for (i = 0; i < NUM_CLASSES; i++) {
+            float d = probs[k][i] - cache.softmax_out[i];
+            if (d < 0) d = -d;
+            if (d > max_diff) max_diff = d;
+        }
+    }
+    printf("Écart max forward / forward_batch: %g\n", max_diff);
+    ConvWorkspace conv_measure;
+    Arena a;
+    arena_measure(&a);
+    conv_workspace_carve(&conv_measure, &net->topo, &a);
+    printf("Mémoire de travail par image: forward() %zu Ko, chemin fusionné %zu Ko\n\n",
+           (sizeof(ForwardCache) + forward_cache_bytes(&net->topo) + a.used) / 1024,
+           batch_glyph_bytes(&net->topo) / 1024);
+    
+    printf("%8s %16s %16s\n", "lot", "forward (g/s)", "batch (g/s)");
+    for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        int n = sizes[s];
+        int reps = (max_n / n) > 4 ? max_n / n : 4;
+        
+        double t0 = now_seconds();
+        for (i = 0; i < reps; i++) {
+            for (k = 0; k < n; k++) forward(imgs[k]);
+        }
+        double t1 = now_seconds();
+        for (i = 0; i < reps; i++) {
+            forward_batch(net, imgs, n, probs);
+        }
+        double t2 = now_seconds();
+        
+        double glyphs = (double)n * reps;
+        printf("%8d %16.1f %16.1f\n", n, glyphs / (t1 - t0), glyphs / (t2 - t1));
+    }
+    
+    free(imgs);
+    free(probs);
+    glyph_set_free(&set);
+    return 0;
+}
+
+/* Générateur de charge du démon: niveaux de concurrence et requêtes par
+ * niveau (réparties entre les clients) */
+#define BENCH_SERVE_CLIENTS "1,2,4,8"
+#define BENCH_SERVE_REQUESTS 64
+#define BENCH_SERVE_MAX_LEVELS 16
+
+/* Un client simulé: sa propre connexion, ses requêtes en série */
+typedef struct {
+    const char *path;
+    const uint8_t *pixels;      /* la même requête de n images à chaque fois */
+    int n;
+    const char *expected;       /* lettres de la première réponse */
+    int requests;
+    double *latency;            /* [requests] en ms */
+    int mismatches;             /* réponses différentes de expected */
+    int failures;
+    pthread_t thread;
+} LoadClient;
+
+static void *load_client_main(void *arg) {
+    LoadClient *c = arg;
+    char *letters = malloc(c->n > 0 ? c->n : 1);
+    int fd = ocr_connect(c->path);
+    int r;
+    for (r = 0; r < c->requests; r++) {
+        double t0 = now_seconds();
+        if (!letters || fd < 0 || ocr_recognize(fd, c->pixels, c->n, letters, NULL) != 0) {
+            c->failures += c->requests - r;
+            break;
+        }
+        c->latency[r] = 1000.0 * (now_seconds() - t0);
+        c->mismatches += memcmp(letters, c->expected, c->n) != 0;
+    }
+    ocr_disconnect(fd);
+    free(letters);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Envoie requests requêtes réparties sur clients connexions simultanées et
+ * affiche la ligne du niveau; -1 si une requête a échoué */
+static int bench_serve_level(const char *path, const uint8_t *pixels, int n,
+                             const char *expected, int clients, int requests) {
+    LoadClient *c = calloc(clients, sizeof(*c));
+    double *latency = malloc(sizeof(double) * requests);
+    int i, started = 0, failures = 0, mismatches = 0, offset = 0;
+    if (!c || !latency) {
+        free(c);
+        free(latency);
+        printf("Erreur: mémoire insuffisante\n");
+        return -1;
+    }
+    double t0 = now_seconds();
+    for (i = 0; i < clients; i++) {
+        c[i].path = path;
+        c[i].pixels = pixels;
+        c[i].n = n;
+        c[i].expected = expected;
+        c[i].requests = requests / clients + (i < requests % clients);
+        c[i].latency = latency + offset;
+        offset += c[i].requests;
+        if (pthread_create(&c[i].thread, NULL, load_client_main, &c[i]) != 0) break;
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(c[i].thread, NULL);
+        failures += c[i].failures;
+        mismatches += c[i].mismatches;
+    }
+    double wall = now_seconds() - t0;
+    for (i = started; i < clients; i++) failures += c[i].requests;
+    
+    if (failures > 0) {
+        printf("%7d  %d requêtes sur %d ont échoué\n", clients, failures, requests);
+    } else {
+        double sum = 0.0;
+        for (i = 0; i < requests; i++) sum += latency[i];
+        qsort(latency, requests, sizeof(double), cmp_double);
+        printf("%7d %9d %10.2f %10.2f %10.2f %12.0f %8d\n", clients, requests,
+               latency[(requests - 1) / 2], latency[(int)((requests - 1) * 0.99)],
+               sum / requests, (double)requests * n / wall, mismatches);
+    }
+    free(c);
+    free(latency);
+    return failures > 0 ? -1 : 0;
+}
+
+/* Latence des requêtes au démon (p50 / p99) selon le nombre de clients
+ * simultanés. Chaque requête envoie les lettres du dossier (un puzzle);
+ * sans démon à l'écoute sur le socket, un démon interne est lancé avec
+ * le modèle par défaut. */
+int bench_serve(int argc, char *argv[]) {
+    const char *base_path = "test0", *path = OCR_SOCKET, *levels = BENCH_SERVE_CLIENTS;
+    int requests = BENCH_SERVE_REQUESTS, batch = 0, n_positional = 0, i;
+    int clients[BENCH_SERVE_MAX_LEVELS], n_levels = 0;
+    for (i = 0; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--clients") == 0 && has_value) {
+            levels = argv[++i];
+        } else if (strcmp(argv[i], "--requests") == 0 && has_value) {
+            requests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && has_value) {
+            batch = atoi(argv[++i]);
+        } else if (n_positional < 2 && strncmp(argv[i], "--", 2) != 0) {
+            if (n_positional++ == 0) base_path = argv[i];
+            else path = argv[i];
+        } else {
+            printf("Option inconnue: %s\n", argv[i]);
+            return -1;
+        }
+    }
+    const char *p = levels;
+    while (*p && n_levels < BENCH_SERVE_MAX_LEVELS) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 1 || (*end != ',' && *end != '\0')) break;
+        clients[n_levels++] = (int)v;
+        p = *end ? end + 1 : end;
+    }
+    if (*p || n_levels == 0 || requests < 1 || batch < 0 || batch > OCR_MAX_GLYPHS) {
+        printf("Options invalides: --clients %s --requests %d --batch %d (max %d)\n", levels,
+               requests, batch, OCR_MAX_GLYPHS);
+        return -1;
+    }
+    
+    GlyphSet set;
+    memset(&set, 0, sizeof(set));
+    if (collect_glyphs(base_path, "2_cells/line", "cell", &set) < 0 ||
+        collect_glyphs(base_path, "3_words/word", "char", &set) < 0 || set.count == 0) {
+        printf("Erreur: aucune lettre trouvée dans %s\n", base_path);
+        glyph_set_free(&set);
+        return -1;
+    }
+    glyph_set_read(&set, 1);
+    if (batch == 0) batch = set.count < OCR_MAX_GLYPHS ? set.count : OCR_MAX_GLYPHS;
+    
+    /* Démon existant, sinon démon interne */
+    Server *internal = NULL;
+    int fd = ocr_connect(path);
+    if (fd < 0) {
+        if (ensure_network_loaded(default_model_path()) != 0) {
+            glyph_set_free(&set);
+            return -1;
+        }
+        internal = server_start(path, qnet ? NULL : net, qnet, SERVER_MAX_CLIENTS);
+        fd = internal ? ocr_connect(path) : -1;
+    }
+    
+    uint8_t *pixels = malloc((size_t)batch * OCR_IMG_PIXELS);
+    char *expected = malloc(batch);
+    int ok = fd >= 0 && pixels && expected;
+    if (ok) {
+        int k, q;
+        for (k = 0; k < batch; k++) {
+            const float *img = &set.imgs[k % set.count][0][0];
+            for (q = 0; q < OCR_IMG_PIXELS; q++) {
+                pixels[(size_t)k * OCR_IMG_PIXELS + q] = (uint8_t)lrintf(img[q] * 255.0f);
+            }
+        }
+        ok = ocr_recognize(fd, pixels, batch, expected, NULL) == 0;
+    }
+    ocr_disconnect(fd);
+    if (!ok) {
+        printf("Erreur: le démon sur %s ne répond pas\n", path);
+    } else {
+        printf("=== DÉMON OCR: %s (%s) ===\n", path, internal ? "démon interne" : "démon existant");
+        printf("%d glyphes de %s par requête, %d requêtes par niveau\n", batch, base_path,
+               requests);
+        if (internal) {
+            printf("Chargement du modèle évité à chaque requête: %.1f ms\n",
+                   1000.0 * model_load_seconds);
+        }
+        printf("\n%7s %10s %10s %10s %10s %12s %8s\n", "clients", "requêtes", "p50 (ms)",
+               "p99 (ms)", "moy. (ms)", "glyphes/s", "écarts");
+        for (i = 0; i < n_levels && ok; i++) {
+            ok = bench_serve_level(path, pixels, batch, expected, clients[i], requests) == 0;
+        }
+    }
+    
+    server_stop(internal);
+    free(pixels);
+    free(expected);
+    glyph_set_free(&set);
+    return ok ? 0 : -1;
+}
+
+/* Boucles directes contre im2col + GEMM (et Winograd pour CONV2) sur les
+ * mêmes poids: temps par couche, forward complet, forward + backward, et
+ * écart des résultats */
+int bench_conv(const char *base_path) {
+    /* Le dernier: même avant qu'im2col+gemm, propagation arrière creuse */
+    static const ConvEngine engines[] = {CONV_DIRECT, CONV_GEMM, CONV_GEMM};
+    static const int sparse[] = {0, 0, 1};
+    static const char *names[] = {"direct", "im2col+gemm", "creux"};
+    GlyphSet set;
+    memset(&set, 0, sizeof(set));
+    
+    if (ensure_network_loaded(default_model_path()) != 0) {
+        return 1;
+    }
+    const Topology *t = &net->topo;
+    size_t conv1_n = (size_t)t->conv1_filters * t->conv1_out * t->conv1_out;
+    size_t conv2_n = (size_t)t->conv2_filters * t->conv2_out * t->conv2_out;
+    size_t pool1_n = (size_t)t->conv1_filters * t->after_pool1 * t->after_pool1;
+    float *conv1_ref = malloc(sizeof(float) * conv1_n);
+    float *conv2_ref = malloc(sizeof(float) * conv2_n);
+    float *pool1 = malloc(sizeof(float) * pool1_n);
+    float *flat_sep = malloc(sizeof(float) * t->flatten);
+    float *flat_fused = malloc(sizeof(float) * t->flatten);
+    Gradients grads_ref;
+    ConvFusedWorkspace fused_ws;
+    Arena fused_arena;
+    arena_measure(&fused_arena);
+    conv_fused_workspace_carve(&fused_ws, t, &fused_arena);
+    int ok = conv1_ref && conv2_ref && pool1 && flat_sep && flat_fused &&
+             cnn_alloc(&grads_ref, t) == 0 && arena_init(&fused_arena, fused_arena.used) == 0;
+    if (!ok) {
+        printf("Erreur: mémoire insuffisante\n");
+        free(conv1_ref);
+        free(conv2_ref);
+        free(pool1);
+        free(flat_sep);
+        free(flat_fused);
+        cnn_free(&grads_ref);
+        return 1;
+    }
+    conv_fused_workspace_carve(&fused_ws, t, &fused_arena);
+    if (collect_glyphs(base_path, "2_cells/line", "cell", &set) < 0 || set.count == 0) {
+        printf("Erreur: aucune lettre trouvée dans %s\n", base_path);
+        glyph_set_free(&set);
+        return 1;
+    }
+    if (set.count > 64) set.count = 64;
+    glyph_set_read(&set, 1);
+    
+    ConvEngine saved = conv_engine;
+    int saved_sparse = sparse_backward;
+    int e, k, r;
+    const int reps = 4;
+    float diffs[3][5];
+    printf("%12s %12s %12s %14s %18s %14s\n", "moteur", "conv1 (us)", "conv2 (us)",
+           "forward (us)", "fwd+backward (us)", "backward (us)");
+    for (e = 0; e < 3; e++) {
+        conv_engine = engines[e];
+        sparse_backward = sparse[e];
+        double t0 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) {
+                conv1_forward(net, &set.imgs[k][0][0], cache.conv1_out, &conv_ws);
+            }
+        }
+        double t1 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) {
+                conv2_forward(net, cache.pool1_out, cache.conv2_out, &conv_ws);
+            }
+        }
+        double t2 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) forward(set.imgs[k]);
+        }
+        double t3 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) {
+                forward(set.imgs[k]);
+                zero_gradients();
+                backward(k % NUM_CLASSES);
+            }
+        }
+        double t4 = now_seconds();
+        
+        double per = 1e6 / (double)(reps * set.count);
+        printf("%12s %12.1f %12.1f %14.1f %18.1f %14.1f\n", names[e],
+               (t1 - t0) * per, (t2 - t1) * per, (t3 - t2) * per, (t4 - t3) * per,
+               ((t4 - t3) - (t3 - t2)) * per);
+        
+        /* Mêmes entrées pour tous les moteurs: première image, classe 0 */
+        forward(set.imgs[0]);
+        zero_gradients();
+        backward(0);
+        if (e == 0) {
+            memcpy(conv1_ref, cache.conv1_out, sizeof(float) * conv1_n);
+            memcpy(conv2_ref, cache.conv2_out, sizeof(float) * conv2_n);
+            cnn_copy(&grads_ref, &grads);
+        }
+        diffs[e][0] = max_abs_diff(conv1_ref, cache.conv1_out, conv1_n);
+        diffs[e][1] = max_abs_diff(conv2_ref, cache.conv2_out, conv2_n);
+        diffs[e][2] = max_abs_diff(grads_ref.conv1_weights, grads.conv1_weights,
+                                   (size_t)t->conv1_filters * t->conv1_size * t->conv1_size);
+        diffs[e][3] = max_abs_diff(grads_ref.conv2_weights, grads.conv2_weights,
+                                   (size_t)t->conv2_filters * t->conv1_filters *
+                                   t->conv2_size * t->conv2_size);
+        diffs[e][4] = max_abs_diff(grads_ref.fc1_weights, grads.fc1_weights,
+                                   (size_t)t->fc1_size * t->flatten);
+    }
+    conv_engine = saved;
+    sparse_backward = saved_sparse;
+    
+    /* CONV2 par Winograd (filtres transformés une fois, comme au chargement) */
+    Conv2Winograd *wino = conv2_winograd_build(net);
+    if (wino) {
+        double t0 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) {
+                conv2_forward_winograd(t, wino, net->conv2_bias, cache.pool1_out,
+                                       cache.conv2_out, &fused_ws);
+            }
+        }
+        printf("%12s %12s %12.1f\n", "winograd", "-",
+               (now_seconds() - t0) * 1e6 / (double)(reps * set.count));
+        forward(set.imgs[0]);
+    }
+    
+    static const char *diff_names[] = {"conv1_out", "conv2_out", "grad conv1 W", "grad conv2 W",
+                                       "grad fc1 W"};
+    printf("\nÉcarts max avec direct: %12s %12s\n", names[1], names[2]);
+    for (k = 0; k < 5; k++) {
+        printf("  %-21s %12g %12g\n", diff_names[k], diffs[1][k], diffs[2][k]);
+    }
+    
+    /* Winograd contre les boucles directes de forward(), même entrée */
+    if (wino) {
+        conv_engine = CONV_DIRECT;
+        conv2_forward(net, cache.pool1_out, conv2_ref, &conv_ws);
+        conv_engine = saved;
+        conv2_forward_winograd(t, wino, net->conv2_bias, cache.pool1_out, cache.conv2_out,
+                               &fused_ws);
+        float scale = 0.0f;
+        size_t n;
+        for (n = 0; n < conv2_n; n++) {
+            if (fabsf(conv2_ref[n]) > scale) scale = fabsf(conv2_ref[n]);
+        }
+        printf("Écart max direct / winograd:\n");
+        printf("  conv2_out:     %g (valeurs jusqu'à %g)\n",
+               max_abs_diff(conv2_ref, cache.conv2_out, conv2_n), scale);
+    } else {
+        printf("Winograd indisponible: noyaux de CONV2 %dx%d\n", t->conv2_size, t->conv2_size);
+    }
+    
+    /* Caractéristiques d'inférence (entrée de FC1): convolutions séparées
+     * (GEMM complet puis ReLU + pooling) contre la version fusionnée */
+    const int P1 = t->after_pool1, P2 = t->after_pool2;
+    int f;
+    conv_engine = CONV_GEMM;
+    double t0 = now_seconds();
+    for (r = 0; r < reps; r++) {
+        for (k = 0; k < set.count; k++) {
+            conv1_forward(net, &set.imgs[k][0][0], cache.conv1_out, &conv_ws);
+            for (f = 0; f < t->conv1_filters; f++) {
+                simd->relu_pool2x2(cache.conv1_out + (size_t)f * t->conv1_out * t->conv1_out,
+                                   t->conv1_out, P1, P1, pool1 + (size_t)f * P1 * P1);
+            }
+            conv2_forward(net, pool1, cache.conv2_out, &conv_ws);
+            for (f = 0; f < t->conv2_filters; f++) {
+                simd->relu_pool2x2(cache.conv2_out + (size_t)f * t->conv2_out * t->conv2_out,
+                                   t->conv2_out, P2, P2, flat_sep + (size_t)f * P2 * P2);
+            }
+        }
+    }
+    double t1 = now_seconds();
+    for (r = 0; r < reps; r++) {
+        for (k = 0; k < set.count; k++) {
+            conv1_relu_pool(t, net->conv1_weights, net->conv1_bias, &set.imgs[k][0][0], pool1,
+                            &fused_ws);
+            conv2_relu_pool(t, net->conv2_weights, net->conv2_bias, pool1, flat_fused, &fused_ws);
+        }
+    }
+    double t2 = now_seconds();
+    conv_engine = saved;
+    printf("\nConv + ReLU + pooling (inférence), par image:\n");
+    printf("  séparés:   %8.1f us\n", (t1 - t0) * 1e6 / (reps * set.count));
+    printf("  fusionnés: %8.1f us (écart %g)\n", (t2 - t1) * 1e6 / (reps * set.count),
+           max_abs_diff(flat_sep, flat_fused, t->flatten));
+    if (wino) {
+        double t3 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < set.count; k++) {
+                conv1_relu_pool(t, net->conv1_weights, net->conv1_bias, &set.imgs[k][0][0],
+                                pool1, &fused_ws);
+                conv2_relu_pool_winograd(t, wino, net->conv2_bias, pool1, flat_fused,
+                                         &fused_ws);
+            }
+        }
+        double t4 = now_seconds();
+        printf("  winograd:  %8.1f us (écart %g)\n", (t4 - t3) * 1e6 / (reps * set.count),
+               max_abs_diff(flat_sep, flat_fused, t->flatten));
+    }
+    
+    free(conv1_ref);
+    free(conv2_ref);
+    free(pool1);
+    free(flat_sep);
+    free(flat_fused);
+    cnn_free(&grads_ref);
+    arena_free(&fused_arena);
+    conv2_winograd_free(wino);
+    glyph_set_free(&set);
+    return 0;
+}
+
+/* dot_sparse / dot4_sparse contre dot / dot4 sur une ligne dont un bloc
+ * sur trois est nul, de longueur non multiple de SIMD_SPARSE_BLOCK (fin
+ * de ligne dense); renvoie 0 si les résultats sont identiques */
+static int check_sparse_kernels(const SimdKernels *kv, const float *w,
+                                float x[4][FLATTEN_SIZE]) {
+    static float row[FLATTEN_SIZE], vals[FLATTEN_SIZE];
+    static uint16_t blocks[FLATTEN_SIZE / SIMD_SPARSE_BLOCK];
+    const int n = FLATTEN_SIZE - 5, nb = n / SIMD_SPARSE_BLOCK;
+    const float *tail = row + nb * SIMD_SPARSE_BLOCK;
+    float dense[4], sparse[4];
+    int b, k, nnz = 0, diff;
+    memcpy(row, w, sizeof(float) * n);
+    for (b = 0; b < nb; b++) {
+        float *blk = row + b * SIMD_SPARSE_BLOCK;
+        if (b % 3 == 0) {
+            memset(blk, 0, sizeof(float) * SIMD_SPARSE_BLOCK);
+            continue;
+        }
+        blocks[nnz] = (uint16_t)b;
+        memcpy(vals + nnz * SIMD_SPARSE_BLOCK, blk, sizeof(float) * SIMD_SPARSE_BLOCK);
+        nnz++;
+    }
+    kv->dot4(row, x[0], x[1], x[2], x[3], n, dense);
+    kv->dot4_sparse(vals, blocks, nnz, tail, x[0], x[1], x[2], x[3], n, sparse);
+    diff = memcmp(dense, sparse, sizeof(dense)) != 0;
+    for (k = 0; k < 4; k++) {
+        diff |= kv->dot(row, x[k], n) != kv->dot_sparse(vals, blocks, nnz, tail, x[k], n);
+    }
+    return diff;
+}
+
+/* Chaque version des noyaux SIMD disponible sur ce processeur, aux tailles
+ * de la topologie par défaut: temps par appel et écart max avec la version
+ * scalaire */
+#define BENCH_CONV2_K (CONV1_FILTERS * CONV2_SIZE * CONV2_SIZE)
+
+int bench_simd(void) {
+    static float a[FC1_SIZE * FLATTEN_SIZE], x[4][FLATTEN_SIZE];
+    static float ap[BENCH_CONV2_K * 4], bp[BENCH_CONV2_K * 16];
+    static float plane[CONV1_OUT * CONV1_OUT];
+    static float ref_dot[4], ref_gemm[4 * 16], ref_pool[AFTER_POOL1 * AFTER_POOL1];
+    static int8_t aq[FC1_SIZE * FLATTEN_SIZE];
+    static uint16_t ah[FC1_SIZE * FLATTEN_SIZE];
+    static uint8_t xq[FLATTEN_SIZE];
+    int32_t ref_q = 0;
+    const SimdKernels *list[4];
+    const SimdKernels *saved = simd;
+    int n = simd_available(list, 4);
+    int v, k, r;
+    
+    srand(1234);
+    for (k = 0; k < FC1_SIZE * FLATTEN_SIZE; k++) a[k] = (float)rand() / RAND_MAX - 0.5f;
+    for (k = 0; k < 4 * FLATTEN_SIZE; k++) x[k / FLATTEN_SIZE][k % FLATTEN_SIZE] = (float)rand() / RAND_MAX;
+    for (k = 0; k < BENCH_CONV2_K * 4; k++) ap[k] = (float)rand() / RAND_MAX - 0.5f;
+    for (k = 0; k < BENCH_CONV2_K * 16; k++) bp[k] = (float)rand() / RAND_MAX;
+    for (k = 0; k < CONV1_OUT * CONV1_OUT; k++) plane[k] = (float)rand() / RAND_MAX - 0.5f;
+    for (k = 0; k < FC1_SIZE * FLATTEN_SIZE; k++) aq[k] = (int8_t)(rand() % 255 - 127);
+    for (k = 0; k < FLATTEN_SIZE; k++) xq[k] = (uint8_t)(rand() % (QUANT_ACT_MAX + 1));
+    for (k = 0; k < FC1_SIZE * FLATTEN_SIZE; k++) ah[k] = half_encode(a[k], HALF_FP16);
+    
+    printf("Noyau choisi: %s\n\n", simd->name);
+    printf("%8s %14s %14s %14s %14s %16s %14s\n", "version", "FC1 dot (us)", "FC1 dot4 (us)",
+           "FC1 int8 (us)", "FC1 fp16 (us)", "gemm 4x16 (ns)", "pool 2x2 (ns)");
+    for (v = 0; v < n; v++) {
+        const SimdKernels *kv = list[v];
+        float sums[4], d_dot, d_gemm, d_pool;
+        float tile[4 * 16], pooled[AFTER_POOL1 * AFTER_POOL1];
+        volatile float sink = 0.0f;
+        const int reps = 8, small_reps = 20000;
+        
+        /* FC1 complet d'une image (256 lignes de 3200), puis de 4 images */
+        double t0 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < FC1_SIZE; k++) sink += kv->dot(a + (size_t)k * FLATTEN_SIZE, x[0], FLATTEN_SIZE);
+        }
+        double t1 = now_seconds();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < FC1_SIZE; k++) {
+                kv->dot4(a + (size_t)k * FLATTEN_SIZE, x[0], x[1], x[2], x[3], FLATTEN_SIZE, sums);
+                sink += sums[0];
+            }
+        }
+        double t2 = now_seconds();
+        /* FC1 INT8 d'une image (voir quant.h) */
+        int32_t q_sum = 0;
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < FC1_SIZE; k++) q_sum += kv->dot_u8s8(xq, aq + (size_t)k * FLATTEN_SIZE, FLATTEN_SIZE);
+        }
+        double t2q = now_seconds();
+        /* FC1 aux poids float16 (voir half.h), par groupes de 4 images */
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < FC1_SIZE; k++) {
+                kv->dot4_f16(ah + (size_t)k * FLATTEN_SIZE, x[0], x[1], x[2], x[3], FLATTEN_SIZE,
+                             sums);
+                sink += sums[0];
+            }
+        }
+        double t2h = now_seconds();
+        /* Micro-noyau GEMM sur la profondeur de CONV2 (kc = 144) */
+        for (r = 0; r < small_reps; r++) {
+            memset(tile, 0, sizeof(tile));
+            kv->gemm_4x16(BENCH_CONV2_K, ap, bp, tile, 16);
+        }
+        double t3 = now_seconds();
+        for (r = 0; r < small_reps; r++) {
+            kv->relu_pool2x2(plane, CONV1_OUT, AFTER_POOL1, AFTER_POOL1, pooled);
+        }
+        double t4 = now_seconds();
+        
+        kv->dot4(a, x[0], x[1], x[2], x[3], FLATTEN_SIZE, sums);
+        for (k = 0; k < 4; k++) {
+            float d = kv->dot(a, x[k], FLATTEN_SIZE) - sums[k];
+            if (d != 0.0f) printf("  %s: dot4 diffère de dot (%g)\n", kv->name, d);
+        }
+        if (check_sparse_kernels(kv, a, x) != 0) {
+            printf("  %s: dot_sparse / dot4_sparse diffèrent de dot / dot4\n", kv->name);
+        }
+        kv->dot4_f16(ah, x[0], x[1], x[2], x[3], FLATTEN_SIZE, sums);
+        for (k = 0; k < 4; k++) {
+            if (kv->dot_f16(ah, x[k], FLATTEN_SIZE) != sums[k]) {
+                printf("  %s: dot4_f16 diffère de dot_f16\n", kv->name);
+            }
+        }
+        kv->dot4_bf16(ah, x[0], x[1], x[2], x[3], FLATTEN_SIZE, sums);
+        for (k = 0; k < 4; k++) {
+            if (kv->dot_bf16(ah, x[k], FLATTEN_SIZE) != sums[k]) {
+                printf("  %s: dot4_bf16 diffère de dot_bf16\n", kv->name);
+            }
+        }
+        if (v == 0) {
+            memcpy(ref_dot, sums, sizeof(ref_dot));
+            memcpy(ref_gemm, tile, sizeof(ref_gemm));
+            memcpy(ref_pool, pooled, sizeof(ref_pool));
+            ref_q = q_sum;
+        }
+        if (q_sum != ref_q) printf("  %s: dot_u8s8 diffère de la version scalaire\n", kv->name);
+        d_dot = max_abs_diff(ref_dot, sums, 4);
+        d_gemm = max_abs_diff(ref_gemm, tile, 4 * 16);
+        d_pool = max_abs_diff(ref_pool, pooled, AFTER_POOL1 * AFTER_POOL1);
+        
+        printf("%8s %14.1f %14.1f %14.1f %14.1f %16.1f %14.1f   écart/scalaire: dot %g gemm %g pool %g\n",
+               kv->name, (t1 - t0) * 1e6 / reps, (t2 - t1) * 1e6 / reps / 4,
+               (t2q - t2) * 1e6 / reps, (t2h - t2q) * 1e6 / reps / 4,
+               (t3 - t2h) * 1e9 / small_reps, (t4 - t3) * 1e9 / small_reps,
+               d_dot, d_gemm, d_pool);
+    }
+    simd = saved;
+    return 0;
+}
+
+/* Erreurs de fast_exp / fast_log contre libm (calcul en double) sur
+ * tout leur domaine; renvoie 1 si une borne de fastmath.h est dépassée */
+int check_math(void) {
+    double max_exp = 0.0, max_log = 0.0, max_taylor = 0.0;
+    float worst_exp = 0.0f, worst_log = 1.0f;
+    float xs[256], ys[256];
+    int vec_ok = 1;
+    int i, k;
+    
+    /* exp sur [-87, 88], pas de 1e-3, et en lots pour la version vectorisée */
+    for (i = 0; i <= 175000; i += 256) {
+        int n = 175001 - i < 256 ? 175001 - i : 256;
+        for (k = 0; k < n; k++) xs[k] = (float)(-87.0 + (double)(i + k) * 1e-3);
+        fast_exp_vec(xs, ys, n);
+        for (k = 0; k < n; k++) {
+            double ref = exp((double)xs[k]);
+            double err = fabs((double)ys[k] - ref) / ref;
+            if (err > max_exp) {
+                max_exp = err;
+                worst_exp = xs[k];
+            }
+            if (ys[k] != fast_exp(xs[k])) vec_ok = 0;
+        }
+    }
+    
+    /* log sur chaque octave des floats normaux, puis finement sur [1e-7, 1]
+     * (domaine des probabilités du softmax) */
+    for (k = -126; k <= 127; k++) {
+        for (i = 0; i < 1024; i++) {
+            float x = ldexpf(1.0f + (float)i / 1024.0f, k);
+            double ref = log((double)x);
+            double err = fabs((double)fast_log(x) - ref) / (fabs(ref) > 1.0 ? fabs(ref) : 1.0);
+            if (err > max_log) {
+                max_log = err;
+                worst_log = x;
+            }
+        }
+    }
+    for (i = 1; i <= 1000000; i++) {
+        float x = (float)i * 1e-6f;
+        double ref = log((double)x);
+        double err = fabs((double)fast_log(x) - ref) / (fabs(ref) > 1.0 ? fabs(ref) : 1.0);
+        if (err > max_log) {
+            max_log = err;
+            worst_log = x;
+        }
+    }
+    
+    /* Pour mémoire: l'ancienne série de Taylor sur la plage du softmax */
+    for (i = 0; i <= 20000; i++) {
+        float x = -(float)i * 1e-3f;
+        double ref = exp((double)x);
+        double err = fabs((double)taylor_exp(x) - ref) / ref;
+        if (err > max_taylor) max_taylor = err;
+    }
+    
+    int ok = max_exp <= FAST_EXP_MAX_REL_ERR && max_log <= FAST_LOG_MAX_ERR && vec_ok;
+    printf("fast_exp: erreur relative max %.3g (x = %g), borne %.3g\n",
+           max_exp, worst_exp, FAST_EXP_MAX_REL_ERR);
+    printf("fast_log: erreur max %.3g (x = %g), borne %.3g\n",
+           max_log, worst_log, FAST_LOG_MAX_ERR);
+    printf("fast_exp_vec identique à fast_exp: %s\n", vec_ok ? "oui" : "NON");
+    printf("Ancienne my_exp (Taylor) sur [-20, 0]: erreur relative max %.3g\n", max_taylor);
+    printf("%s\n", ok ? "OK" : "ÉCHEC");
+    return ok ? 0 : 1;
+}
+
+/* philox4x32() contre les vecteurs de référence de Random123 (kat_vectors),
+ * puis un flux contre les blocs calculés directement */
+int check_rng(void) {
+    static const uint32_t kat[3][10] = {
+        /* compteur (4), clé (2), sortie attendue (4) */
+        { 0, 0, 0, 0, 0, 0, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+        { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+          0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+        { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+          0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+    };
+    uint32_t out[4];
+    int k, i, ok = 1;
+    
+    for (k = 0; k < 3; k++) {
+        philox4x32(kat[k], kat[k] + 4, out);
+        int same = memcmp(out, kat[k] + 6, sizeof(out)) == 0;
+        printf("Philox4x32-10, vecteur %d: %08x %08x %08x %08x %s\n", k, out[0], out[1],
+               out[2], out[3], same ? "oui" : "NON");
+        ok &= same;
+    }
+    
+    /* Flux 7 du domaine RNG_AUGMENT: bloc b = philox({b, 0, 7, 0}, {graine, domaine}) */
+    RngStream r;
+    uint32_t ctr[4] = { 0, 0, 7, 0 }, key[2] = { TRAIN_SEED, RNG_AUGMENT };
+    int stream_ok = 1;
+    double mean = 0.0;
+    rng_stream(&r, TRAIN_SEED, RNG_AUGMENT, 7);
+    for (k = 0; k < 1000; k++) {
+        ctr[0] = (uint32_t)k;
+        philox4x32(ctr, key, out);
+        for (i = 0; i < 4; i++) stream_ok &= rng_u32(&r) == out[i];
+    }
+    rng_stream(&r, TRAIN_SEED, RNG_AUGMENT, 7);
+    for (k = 0; k < 100000; k++) mean += rng_unit(&r);
+    mean /= 100000.0;
+    ok &= stream_ok && fabs(mean - 0.5) < 0.01;
+    printf("Flux identique aux blocs du compteur: %s\n", stream_ok ? "oui" : "NON");
+    printf("Moyenne de rng_unit sur 100000 tirages: %.4f\n", mean);
+    printf("%s\n", ok ? "OK" : "ÉCHEC");
+    return ok ? 0 : 1;
+}
+
+/* Coût du softmax + perte par échantillon d'entraînement: anciennes séries
+ * de Taylor contre fastmath, sur des logits aléatoires */
+int bench_math(void) {
+    enum { SAMPLES = 20000 };
+    static float logits[SAMPLES][NUM_CLASSES];
+    static int labels[SAMPLES];
+    float probs[NUM_CLASSES];
+    volatile float sink = 0.0f;
+    int i, k;
+    
+    srand(1234);
+    for (i = 0; i < SAMPLES; i++) {
+        for (k = 0; k < NUM_CLASSES; k++) {
+            logits[i][k] = 10.0f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        labels[i] = rand() % NUM_CLASSES;
+    }
+    
+    double t0 = now_seconds();
+    for (i = 0; i < SAMPLES; i++) {
+        /* Softmax d'origine */
+        float max_logit = logits[i][0], exp_sum = 0.0f;
+        for (k = 1; k < NUM_CLASSES; k++) {
+            if (logits[i][k] > max_logit) max_logit = logits[i][k];
+        }
+        for (k = 0; k < NUM_CLASSES; k++) {
+            probs[k] = taylor_exp(logits[i][k] - max_logit);
+            exp_sum += probs[k];
+        }
+        for (k = 0; k < NUM_CLASSES; k++) {
+            probs[k] /= exp_sum;
+            if (probs[k] < 1e-7f) probs[k] = 1e-7f;
+        }
+        sink += -taylor_log(probs[labels[i]]);
+    }
+    double t1 = now_seconds();
+    for (i = 0; i < SAMPLES; i++) {
+        softmax(logits[i], probs, NUM_CLASSES);
+        sink += -fast_log(probs[labels[i]]);
+    }
+    double t2 = now_seconds();
+    
+    double old_ns = (t1 - t0) * 1e9 / SAMPLES, new_ns = (t2 - t1) * 1e9 / SAMPLES;
+    printf("Softmax + perte par échantillon:\n");
+    printf("  séries de Taylor: %8.1f ns\n", old_ns);
+    printf("  fastmath:         %8.1f ns (x%.1f)\n", new_ns, old_ns / new_ns);
+    printf("Gain par époque (%d échantillons): %.1f ms\n", NUM_CLASSES * SAMPLES_PER_LETTER,
+           (old_ns - new_ns) * NUM_CLASSES * SAMPLES_PER_LETTER * 1e-6);
+    return 0;
+}
+
+/* ============================================================
+ * MAIN
+ * ============================================================ */
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage:\n");
+        printf("  %s 1 [données] [options] - Entraîner le modèle (dossier ou letters.pack)\n", argv[0]);
+        printf("      --epochs N --batch N --threads N --no-augment|--augment\n");
+        printf("      --seed N (défaut %u) --slices N (défaut: une tranche par thread; mêmes\n"
+               "      graine et tranches = mêmes poids bit à bit, quel que soit --threads)\n",
+               TRAIN_SEED);
+        printf("      --optim sgd|momentum|adam --lr X --schedule constant|step|cosine\n");
+        printf("      --checkpoint fichier --checkpoint-every N --resume\n");
+        printf("      --val-fonts a-b,c|none (défaut %s) --patience N (0: jamais d'arrêt)\n",
+               VAL_FONTS);
+        printf("      --topology F1xK1,F2xK2,FC1 (défaut %dx%d,%dx%d,%d)\n",
+               CONV1_FILTERS, CONV1_SIZE, CONV2_FILTERS, CONV2_SIZE, FC1_SIZE);
+        printf("      --teacher model.bin (distillation d'un élève %s dans %s, reprise %s)\n",
+               DISTILL_TOPOLOGY, DISTILL_FILE, DISTILL_CHECKPOINT);
+        printf("      --temperature T (défaut %g) --alpha a (défaut %g, part du maître)\n",
+               DISTILL_TEMPERATURE, DISTILL_ALPHA);
+        printf("  %s pack [dossier] [fichier] - Compacter le jeu d'entraînement\n", argv[0]);
+        printf("  %s augment <image> <sortie> [n] - Exemples d'augmentation\n", argv[0]);
+        printf("  %s 2 [modèle] - Tester une image\n", argv[0]);
+        printf("  %s 3 <dossier> <sortie> [threads] [modèle] - Tester un dossier\n", argv[0]);
+        printf("      --topk N (N meilleures lettres par glyphe dans %s, ex. 3; défaut %d:\n"
+               "      pas de fichier) --topk-text (%s en plus)\n",
+               TOPK_FILE, TOPK_DEFAULT, TOPK_TEXT_FILE);
+        printf("      --cache fichier (cache de glyphes conservé entre les runs) --no-cache\n");
+        printf("      --winograd (CONV2 par Winograd F(2x2, 3x3), modèle float seulement)\n");
+        printf("      --student fichier (élève de 'make distill' essayé d'abord, ex. %s)\n",
+               DISTILL_FILE);
+        printf("      --threshold p (défaut %.2f: confiance de l'élève sous laquelle le modèle\n"
+               "      reprend; courbe précision / vitesse: %s cascade)\n",
+               CASCADE_THRESHOLD, argv[0]);
+        printf("      --no-prefilter (cellules vides et traits reconnus aussi, sinon '%c')\n",
+               PREFILTER_CHAR);
+        printf("  %s topk <candidats> - Afficher un fichier de candidats\n", argv[0]);
+        printf("  %s convert [src] [dst] - Convertir un modèle texte en binaire\n", argv[0]);
+        printf("  %s verify [modèle] - Vérifier la somme de contrôle d'un model.bin\n", argv[0]);
+        printf("  %s quantize [src] [dst] [données] - Créer le modèle INT8 (model.q8)\n", argv[0]);
+        printf("  %s prune [src] [données] [options] - Élaguer FC1 avec réglage fin\n", argv[0]);
+        printf("      --levels x,y,... (défaut %s) --neurons part (défaut %.2f)\n",
+               PRUNE_LEVELS, PRUNE_NEURON_SHARE);
+        printf("      --out préfixe (défaut %s) et les options du mode 1\n", PRUNE_OUTPUT);
+        printf("      (défaut --epochs %d, taux de l'optimiseur x %g, sans --augment)\n",
+               PRUNE_EPOCHS, PRUNE_LR_SCALE);
+        printf("  %s half [src] [données] [options] - Poids FC sur 16 bits (%s)\n", argv[0],
+               HALF_FILE);
+        printf("      --format fp16|bf16 (défaut fp16) --out fichier --val-fonts a-b,c\n");
+        printf("  %s cascade [modèle] [données] [options] - Précision / vitesse de la cascade\n",
+               argv[0]);
+        printf("      --student fichier (défaut %s) --thresholds a,b,... (défaut %s)\n",
+               DISTILL_FILE, CASCADE_THRESHOLDS);
+        printf("      --val-fonts a-b,c\n");
+        printf("  %s serve [socket] [modèle] - Démon OCR (défaut %s)\n", argv[0], OCR_SOCKET);
+        printf("  %s bench-batch [dossier] - Débit de l'inférence par lots\n", argv[0]);
+        printf("  %s bench-serve [dossier] [socket] - Latence du démon selon la concurrence\n",
+               argv[0]);
+        printf("      --clients a,b,... (défaut %s) --requests N (défaut %d) --batch N\n",
+               BENCH_SERVE_CLIENTS, BENCH_SERVE_REQUESTS);
+        printf("  %s bench-conv [dossier]  - Convolutions directes, im2col+GEMM, arrière creux, Winograd\n", argv[0]);
+        printf("  %s bench-simd            - Noyaux scalaires / SSE4.1 / AVX2\n", argv[0]);
+        printf("  %s check-math            - Erreur de fast_exp/fast_log contre libm\n", argv[0]);
+        printf("  %s check-rng             - Philox4x32-10 contre les vecteurs de référence\n", argv[0]);
+        printf("  %s bench-math            - Softmax + perte: Taylor contre fastmath\n", argv[0]);
+        return 1;
+    }
+    
+    simd_init();
+    
+    if (strcmp(argv[1], "serve") == 0) {
+        return serve(argc > 2 ? argv[2] : OCR_SOCKET,
+                     argc > 3 ? argv[3] : default_model_path()) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "bench-serve") == 0) {
+        return bench_serve(argc - 2, argv + 2) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "bench-batch") == 0) {
+        return bench_batch(argc > 2 ? argv[2] : "test0");
+    }
+    
+    if (strcmp(argv[1], "bench-conv") == 0) {
+        return bench_conv(argc > 2 ? argv[2] : "test0");
+    }
+    
+    if (strcmp(argv[1], "bench-simd") == 0) {
+        return bench_simd();
+    }
+    
+    if (strcmp(argv[1], "check-math") == 0) {
+        return check_math();
+    }
+    
+    if (strcmp(argv[1], "check-rng") == 0) {
+        return check_rng();
+    }
+    
+    if (strcmp(argv[1], "bench-math") == 0) {
+        return bench_math();
+    }
+    
+    if (strcmp(argv[1], "quantize") == 0) {
+        const char *src = argc > 2 ? argv[2] : default_model_path();
+        const char *dst = argc > 3 ? argv[3] : QUANT_FILE;
+        const char *data = argc > 4 ? argv[4] : "letters_50x50_fonts";
+        return quantize_model(src, dst, data) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "prune") == 0) {
+        return prune_model(argc - 2, argv + 2) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "half") == 0) {
+        return half_model(argc - 2, argv + 2) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "cascade") == 0) {
+        return cascade_curve(argc - 2, argv + 2) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "pack") == 0) {
+        const char *dir = argc > 2 ? argv[2] : "letters_50x50_fonts";
+        const char *dst = argc > 3 ? argv[3] : DATASET_FILE;
+        return dataset_pack(dir, dst, default_thread_count()) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "augment") == 0) {
+        if (argc < 4) {
+            printf("Usage: %s augment <image> <sortie> [n]\n", argv[0]);
+            return 1;
+        }
+        return augment_preview(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 16) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "topk") == 0) {
+        if (argc < 3) {
+            printf("Usage: %s topk <candidats>\n", argv[0]);
+            return 1;
+        }
+        TopkFile f;
+        if (topk_load(argv[2], &f) != 0) return 1;
+        topk_print(&f, stdout);
+        topk_free(&f);
+        return 0;
+    }
+    
+    if (strcmp(argv[1], "convert") == 0) {
+        const char *src = argc > 2 ? argv[2] : MODEL_TEXT_FILE;
+        const char *dst = argc > 3 ? argv[3] : MODEL_BIN_FILE;
+        return convert_model(src, dst) == 0 ? 0 : 1;
+    }
+    
+    if (strcmp(argv[1], "verify") == 0) {
+        return verify_model(argc > 2 ? argv[2] : MODEL_BIN_FILE) == 0 ? 0 : 1;
+    }
+    
+    int mode = argv[1][0] - '0';
+    
+    if (mode == 1) {
+        // argv[2] (optionnel) -> dossier d'images ou fichier compacté,
+        // puis les options (voir l'usage)
+        TrainConfig cfg;
+        if (parse_train_args(argc - 2, argv + 2, &cfg) != 0) return 1;
+        if (train(&cfg) != 0) return 1;
     } else if (mode == 2) {
         char path[256];
         printf("Entrez le chemin de l'image à tester: ");
         if (scanf("%255s", path) == 1) {
-            test_image(path);
+            test_image(path, argc > 2 ? argv[2] : default_model_path());
         } else {
             printf("Erreur de lecture du chemin.\n");
         }
     } 
     else if (mode == 3){
-        // argv[1] -> path du dossier a tester, argv[2] -> path du output
+        // argv[2] -> path du dossier a tester, argv[3] -> path du output,
+        // argv[4] (optionnel) -> nombre de threads (défaut: tous les coeurs)
+        // argv[5] (optionnel) -> modèle (model.bin, model.txt, model.q8 ou model.h16)
+        // puis --topk N (fichier candidats, absent par défaut), --topk-text,
+        // --cache fichier (cache persistant), --no-cache, --winograd,
+        // --student fichier et --threshold p (cascade élève -> modèle),
+        // --no-prefilter (toutes les cellules passent dans le réseau)
+        if (argc < 4) {
+            printf("Usage: %s 3 <dossier> <sortie> [threads] [modèle] [options]\n", argv[0]);
+            return 1;
+        }
         const char *base_path = argv[2];
-        //char output_path[512];
-        //sprintf(output_path, "%s/grid.txt", argv[3]);
-        return process_cells(base_path, argv[3]);
+        const char *positional[2] = { NULL, NULL };
+        CellsConfig cells = { 0, NULL, TOPK_DEFAULT, 0, 1, NULL, 0, NULL, CASCADE_THRESHOLD, 1 };
+        int has_threshold = 0;
+        int n_positional = 0, i;
+        for (i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "--topk") == 0 && i + 1 < argc) {
+                cells.topk = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--topk-text") == 0) {
+                cells.topk_text = 1;
+            } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+                cells.cache_file = argv[++i];
+            } else if (strcmp(argv[i], "--no-cache") == 0) {
+                cells.use_cache = 0;
+            } else if (strcmp(argv[i], "--winograd") == 0) {
+                cells.winograd = 1;
+            } else if (strcmp(argv[i], "--no-prefilter") == 0) {
+                cells.prefilter = 0;
+            } else if (strcmp(argv[i], "--student") == 0 && i + 1 < argc) {
+                cells.student = argv[++i];
+            } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+                cells.threshold = (float)atof(argv[++i]);
+                has_threshold = 1;
+            } else if (n_positional < 2 && strncmp(argv[i], "--", 2) != 0) {
+                positional[n_positional++] = argv[i];
+            } else {
+                printf("Option inconnue: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        cells.threads = positional[0] ? atoi(positional[0]) : default_thread_count();
+        if (cells.threads < 1) cells.threads = 1;
+        cells.model = positional[1] ? positional[1] : default_model_path();
+        if (cells.cache_file && !cells.use_cache) {
+            printf("Erreur: --cache et --no-cache sont incompatibles\n");
+            return 1;
+        }
+        if (has_threshold && !cells.student) {
+            printf("Erreur: --threshold demande --student\n");
+            return 1;
+        }
+        if (cells.threshold < 0.0f || cells.threshold > 1.0f) {
+            printf("Erreur: le seuil doit être entre 0 et 1\n");
+            return 1;
+        }
+        return process_cells(base_path, argv[3], &cells);
 
     }
     else {
@@ -0,0 +1,199 @@
+/*
+ * Lecture / écriture du modèle au format binaire mappable (model.bin)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "model_bin.h"
+#include "topology.h"
+
+_Static_assert(sizeof(ModelBinHeader) <= MODEL_BIN_HEADER_SIZE,
+               "en-tête model.bin trop grand");
+_Static_assert(MODEL_BIN_HEADER_SIZE % CNN_BLOCK_ALIGN == 0,
+               "le corps doit commencer sur une frontière de bloc");
+
+uint64_t model_bin_checksum_continue(uint64_t h, const void *data, size_t size) {
+    /* FNV-1a 64 bits */
+    const unsigned char *p = data;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t model_bin_checksum(const void *data, size_t size) {
+    return model_bin_checksum_continue(0xcbf29ce484222325ULL, data, size);
+}
+
+static void fill_header(ModelBinHeader *h, const Topology *t) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, MODEL_BIN_MAGIC, sizeof(h->magic));
+    h->version = MODEL_BIN_VERSION;
+    h->endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h->header_size = MODEL_BIN_HEADER_SIZE;
+    h->block_align = CNN_BLOCK_ALIGN;
+
+    h->img_size = IMG_SIZE;
+    h->num_classes = NUM_CLASSES;
+    h->conv1_filters = (uint32_t)t->conv1_filters;
+    h->conv1_size = (uint32_t)t->conv1_size;
+    h->conv2_filters = (uint32_t)t->conv2_filters;
+    h->conv2_size = (uint32_t)t->conv2_size;
+    h->fc1_in = (uint32_t)t->flatten;
+    h->fc1_out = (uint32_t)t->fc1_size;
+    h->fc2_in = (uint32_t)t->fc1_size;
+    h->fc2_out = FC2_SIZE;
+
+    size_t offset[MB_NUM_BLOCKS], size[MB_NUM_BLOCKS];
+    int b;
+    h->payload_size = cnn_layout(t, offset, size);
+    for (b = 0; b < MB_NUM_BLOCKS; b++) {
+        h->block_offset[b] = offset[b];
+        h->block_size[b] = size[b];
+    }
+}
+
+int model_bin_is_binary(const char *filename) {
+    char magic[8];
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == sizeof(magic) && memcmp(magic, MODEL_BIN_MAGIC, sizeof(magic)) == 0;
+}
+
+int model_bin_save(const CNN *net, const char *filename) {
+    unsigned char header[MODEL_BIN_HEADER_SIZE];
+    ModelBinHeader h;
+    char tmp[512];
+
+    fill_header(&h, &net->topo);
+    h.checksum = model_bin_checksum(net->data, h.payload_size);
+    memset(header, 0, sizeof(header));
+    memcpy(header, &h, sizeof(h));
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        printf("Erreur: impossible de sauvegarder dans %s\n", filename);
+        return -1;
+    }
+    int ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(net->data, 1, h.payload_size, fp) == h.payload_size;
+    ok &= fclose(fp) == 0;
+    if (!ok || rename(tmp, filename) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        remove(tmp);
+        return -1;
+    }
+    printf("Modèle binaire sauvegardé dans %s\n", filename);
+    return 0;
+}
+
+/* Vérifie l'en-tête et en tire la topologie: les formes doivent être
+ * possibles et la disposition des blocs celle de cnn_layout() */
+static int check_header(const ModelBinHeader *h, const char *filename, Topology *t) {
+    ModelBinHeader expected;
+
+    if (memcmp(h->magic, MODEL_BIN_MAGIC, sizeof(h->magic)) != 0) {
+        printf("Erreur: %s n'est pas un modèle binaire\n", filename);
+        return -1;
+    }
+    if (h->version != MODEL_BIN_VERSION) {
+        printf("Erreur: version de modèle %u non supportée (attendu %d)\n",
+               h->version, MODEL_BIN_VERSION);
+        return -1;
+    }
+    if (h->endian_tag != MODEL_BIN_ENDIAN_TAG) {
+        printf("Erreur: %s a été écrit avec un autre ordre d'octets\n", filename);
+        return -1;
+    }
+    memset(t, 0, sizeof(*t));
+    t->conv1_filters = (int)h->conv1_filters;
+    t->conv1_size = (int)h->conv1_size;
+    t->conv2_filters = (int)h->conv2_filters;
+    t->conv2_size = (int)h->conv2_size;
+    t->fc1_size = (int)h->fc1_out;
+    if (topology_init(t) != 0) {
+        printf("Erreur: topologie de %s invalide\n", filename);
+        return -1;
+    }
+    fill_header(&expected, t);
+
+    /* Formes et disposition des blocs (tout sauf magic/version/checksum) */
+    if (h->header_size != expected.header_size ||
+        h->block_align != expected.block_align ||
+        h->payload_size != expected.payload_size ||
+        memcmp(&h->img_size, &expected.img_size,
+               sizeof(*h) - offsetof(ModelBinHeader, img_size)) != 0) {
+        printf("Erreur: la disposition des blocs de %s est incohérente\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+int model_bin_map(const char *filename, ModelMapping *map) {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Erreur: impossible de charger %s\n", filename);
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < MODEL_BIN_HEADER_SIZE) {
+        printf("Erreur: %s est tronqué\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Erreur: mmap de %s impossible\n", filename);
+        return -1;
+    }
+
+    const ModelBinHeader *h = base;
+    Topology topo;
+    if (check_header(h, filename, &topo) != 0) {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    if ((size_t)st.st_size < h->header_size + h->payload_size) {
+        printf("Erreur: %s est tronqué\n", filename);
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    unsigned char *body = (unsigned char *)base + h->header_size;
+    map->base = base;
+    map->length = (size_t)st.st_size;
+    cnn_bind(&map->net, &topo, body);
+    return 0;
+}
+
+int model_bin_verify(const ModelMapping *map, const char *filename) {
+    const ModelBinHeader *h = map->base;
+    const unsigned char *body = (const unsigned char *)map->base + h->header_size;
+    if (model_bin_checksum(body, h->payload_size) != h->checksum) {
+        printf("Erreur: somme de contrôle invalide pour %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+void model_bin_unmap(ModelMapping *map) {
+    if (map->base) {
+        munmap(map->base, map->length);
+    }
+    memset(map, 0, sizeof(*map));
+}
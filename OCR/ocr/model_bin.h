@@ -0,0 +1,91 @@
+#ifndef MODEL_BIN_H
+#define MODEL_BIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cnn.h"
+
+/*
+ * Format binaire du modèle (model.bin)
+ *
+ *   [ en-tête ModelBinHeader, MODEL_BIN_HEADER_SIZE octets ]
+ *   [ corps: arène des paramètres du CNN (cnn_layout)      ]
+ *
+ * L'en-tête décrit la topologie (formes des couches) et la position de
+ * chaque bloc; le modèle chargé prend cette topologie, quelle que soit
+ * l'architecture par défaut du binaire. Les blocs sont alignés sur 64
+ * octets, le corps commence à un multiple de 64: le fichier peut donc
+ * être mappé avec mmap et utilisé directement (cnn_bind), sans aucune
+ * conversion.
+ */
+
+#define MODEL_BIN_MAGIC "CNNBIN\r\n"
+#define MODEL_BIN_VERSION 1
+#define MODEL_BIN_HEADER_SIZE 256
+#define MODEL_BIN_ENDIAN_TAG 0x01020304u
+
+/* Index des blocs dans la table d'offsets de l'en-tête */
+enum {
+    MB_CONV1_W, MB_CONV1_B,
+    MB_CONV2_W, MB_CONV2_B,
+    MB_FC1_W, MB_FC1_B,
+    MB_FC2_W, MB_FC2_B,
+    MB_NUM_BLOCKS
+};
+
+typedef struct {
+    char magic[8];              /* MODEL_BIN_MAGIC */
+    uint32_t version;           /* MODEL_BIN_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG (ordre natif) */
+    uint32_t header_size;       /* début du corps dans le fichier */
+    uint32_t block_align;       /* CNN_BLOCK_ALIGN */
+    uint64_t payload_size;      /* taille du corps (cnn_layout) */
+    uint64_t checksum;          /* FNV-1a 64 bits du corps */
+
+    /* Formes des couches */
+    uint32_t img_size;
+    uint32_t num_classes;
+    uint32_t conv1_filters, conv1_size;
+    uint32_t conv2_filters, conv2_size;
+    uint32_t fc1_in, fc1_out;
+    uint32_t fc2_in, fc2_out;
+
+    /* Position (dans le corps) et taille en octets de chaque bloc */
+    uint64_t block_offset[MB_NUM_BLOCKS];
+    uint64_t block_size[MB_NUM_BLOCKS];
+} ModelBinHeader;
+
+/* Modèle mappé en mémoire */
+typedef struct {
+    void *base;                 /* adresse renvoyée par mmap */
+    size_t length;              /* taille du mapping */
+    CNN net;                    /* vues dans le mapping, après l'en-tête */
+} ModelMapping;
+
+uint64_t model_bin_checksum(const void *data, size_t size);
+
+/* Suite du checksum pour un contenu en plusieurs morceaux:
+ * h = model_bin_checksum(a, na); h = model_bin_checksum_continue(h, b, nb) */
+uint64_t model_bin_checksum_continue(uint64_t h, const void *data, size_t size);
+
+/* Renvoie 1 si le fichier commence par MODEL_BIN_MAGIC */
+int model_bin_is_binary(const char *filename);
+
+/* Écrit filename.tmp puis le renomme en filename: un processus qui a
+ * mappé l'ancien fichier (serve, --student) garde l'ancien inode au lieu
+ * de voir le fichier tronqué ou réécrit sous lui */
+int model_bin_save(const CNN *net, const char *filename);
+
+/* Mappe le fichier (MAP_PRIVATE: les écritures éventuelles restent
+ * locales); map->net prend la topologie de l'en-tête. Seuls l'en-tête et
+ * la taille du fichier sont vérifiés: les pages du corps ne sont lues
+ * qu'à la première inférence */
+int model_bin_map(const char *filename, ModelMapping *map);
+
+/* Somme de contrôle du corps contre l'en-tête (lit tout le fichier,
+ * './main verify') */
+int model_bin_verify(const ModelMapping *map, const char *filename);
+void model_bin_unmap(ModelMapping *map);
+
+#endif
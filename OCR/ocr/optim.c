@@ -0,0 +1,135 @@
+/*
+ * SGD, momentum, Adam et calendriers du taux d'apprentissage, voir optim.h
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "optim.h"
+#include "topology.h"
+
+int optim_state_count(OptimKind kind) {
+    return kind == OPTIM_ADAM ? 2 : kind == OPTIM_MOMENTUM ? 1 : 0;
+}
+
+/* Tableau d'état remis à zéro, NULL si l'allocation échoue */
+static Gradients *state_new(const Topology *t) {
+    Gradients *g = malloc(sizeof(*g));
+    if (g && cnn_alloc(g, t) != 0) {
+        free(g);
+        return NULL;
+    }
+    return g;
+}
+
+static void state_free(Gradients *g) {
+    if (!g) return;
+    cnn_free(g);
+    free(g);
+}
+
+int optim_init(Optimizer *opt, OptimKind kind, LrSchedule schedule, float base_lr,
+               const Topology *t) {
+    int n = optim_state_count(kind);
+    memset(opt, 0, sizeof(*opt));
+    opt->kind = kind;
+    opt->schedule = schedule;
+    opt->base_lr = base_lr;
+    opt->lr = base_lr;
+    if (n >= 1) opt->m = state_new(t);
+    if (n >= 2) opt->v = state_new(t);
+    if ((n >= 1 && !opt->m) || (n >= 2 && !opt->v)) {
+        optim_free(opt);
+        return -1;
+    }
+    return 0;
+}
+
+void optim_free(Optimizer *opt) {
+    state_free(opt->m);
+    state_free(opt->v);
+    opt->m = NULL;
+    opt->v = NULL;
+}
+
+void optim_begin_step(Optimizer *opt, double progress, int epoch) {
+    double lr = opt->base_lr;
+    if (opt->schedule == LR_STEP) {
+        lr *= pow(LR_STEP_GAMMA, epoch / LR_STEP_EPOCHS);
+    } else if (opt->schedule == LR_COSINE) {
+        lr *= 0.5 * (1.0 + cos(M_PI * progress));
+    }
+    opt->step++;
+    opt->lr = (float)lr;
+    if (opt->kind == OPTIM_ADAM) {
+        double t = (double)opt->step;
+        opt->adam_step = (float)(lr * sqrt(1.0 - pow(ADAM_BETA2, t)) /
+                                 (1.0 - pow(ADAM_BETA1, t)));
+    }
+}
+
+void optim_update(const Optimizer *opt, float *w, const float *g, size_t offset, size_t count) {
+    size_t i;
+    if (opt->kind == OPTIM_SGD) {
+        for (i = 0; i < count; i++) {
+            w[i] -= opt->lr * g[i];
+        }
+    } else if (opt->kind == OPTIM_MOMENTUM) {
+        float *v = opt->m->data + offset;
+        for (i = 0; i < count; i++) {
+            float vi = MOMENTUM_BETA * v[i] + g[i];
+            v[i] = (vi < OPTIM_TINY && vi > -OPTIM_TINY) ? 0.0f : vi;
+            w[i] -= opt->lr * v[i];
+        }
+    } else {
+        float *m = opt->m->data + offset;
+        float *v = opt->v->data + offset;
+        for (i = 0; i < count; i++) {
+            float mi = ADAM_BETA1 * m[i] + (1.0f - ADAM_BETA1) * g[i];
+            float vi = ADAM_BETA2 * v[i] + (1.0f - ADAM_BETA2) * g[i] * g[i];
+            m[i] = (mi < OPTIM_TINY && mi > -OPTIM_TINY) ? 0.0f : mi;
+            v[i] = vi < OPTIM_TINY ? 0.0f : vi;
+            w[i] -= opt->adam_step * m[i] / (sqrtf(v[i]) + ADAM_EPS);
+        }
+    }
+}
+
+/* ============================================================
+ * NOMS
+ * ============================================================ */
+
+static const char *kind_names[] = { "sgd", "momentum", "adam" };
+static const char *schedule_names[] = { "constant", "step", "cosine" };
+
+int optim_parse_kind(const char *name, OptimKind *kind) {
+    int k;
+    for (k = 0; k < 3; k++) {
+        if (strcmp(name, kind_names[k]) == 0) {
+            *kind = (OptimKind)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int optim_parse_schedule(const char *name, LrSchedule *schedule) {
+    int k;
+    for (k = 0; k < 3; k++) {
+        if (strcmp(name, schedule_names[k]) == 0) {
+            *schedule = (LrSchedule)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *optim_kind_name(OptimKind kind) {
+    return kind_names[kind];
+}
+
+const char *optim_schedule_name(LrSchedule schedule) {
+    return schedule_names[schedule];
+}
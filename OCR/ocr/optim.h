@@ -0,0 +1,78 @@
+#ifndef OPTIM_H
+#define OPTIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cnn.h"
+
+/*
+ * Optimiseurs et calendrier du taux d'apprentissage de train().
+ *
+ * L'état (vitesse du momentum, moments d'Adam) a exactement la forme de
+ * Gradients: un morceau de la réduction du lot (même position dans
+ * Gradients::data) met à jour ses poids et son état sans rien partager
+ * avec les autres morceaux.
+ */
+
+typedef enum {
+    OPTIM_SGD,                  /* w -= lr g */
+    OPTIM_MOMENTUM,             /* v = beta v + g, w -= lr v */
+    OPTIM_ADAM                  /* moments d'ordre 1 et 2 corrigés du biais */
+} OptimKind;
+
+typedef enum {
+    LR_CONSTANT,
+    LR_STEP,                    /* x LR_STEP_GAMMA toutes les LR_STEP_EPOCHS époques */
+    LR_COSINE                   /* demi-cosinus de lr à 0 sur tout l'entraînement */
+} LrSchedule;
+
+#define MOMENTUM_BETA 0.9f
+#define ADAM_BETA1 0.9f
+#define ADAM_BETA2 0.999f
+#define ADAM_EPS 1e-8f
+#define ADAM_LEARNING_RATE 0.001f
+#define LR_STEP_EPOCHS 5
+#define LR_STEP_GAMMA 0.5f
+
+/* En dessous, un moment est remis à 0: sinon ceux des neurones morts
+ * (gradient nul) décroissent géométriquement jusqu'aux flottants
+ * dénormalisés, et chaque mise à jour devient des dizaines de fois plus lente */
+#define OPTIM_TINY 1e-30f
+
+typedef struct {
+    OptimKind kind;
+    LrSchedule schedule;
+    float base_lr;
+    uint64_t step;              /* mises à jour déjà faites */
+    Gradients *m;               /* momentum / premier moment (NULL pour SGD) */
+    Gradients *v;               /* second moment (Adam) */
+
+    /* Calculés par optim_begin_step() pour la mise à jour en cours */
+    float lr;
+    float adam_step;            /* lr corrigé du biais des deux moments */
+} Optimizer;
+
+/* État remis à zéro, de la topologie t; -1 si l'allocation échoue */
+int optim_init(Optimizer *opt, OptimKind kind, LrSchedule schedule, float base_lr,
+               const Topology *t);
+void optim_free(Optimizer *opt);
+
+/* Nombre de tableaux d'état (0, 1 ou 2), de la forme de Gradients */
+int optim_state_count(OptimKind kind);
+
+/* Prépare la mise à jour suivante; progress = part de l'entraînement déjà
+ * faite (0..1), epoch = époque courante (pour LR_STEP) */
+void optim_begin_step(Optimizer *opt, double progress, int epoch);
+
+/* Met à jour count poids w à partir de la somme des gradients g;
+ * offset = position en floats de g dans Gradients::data (donc de l'état) */
+void optim_update(const Optimizer *opt, float *w, const float *g, size_t offset, size_t count);
+
+/* Conversions nom <-> valeur pour la ligne de commande; -1 si inconnu */
+int optim_parse_kind(const char *name, OptimKind *kind);
+int optim_parse_schedule(const char *name, LrSchedule *schedule);
+const char *optim_kind_name(OptimKind kind);
+const char *optim_schedule_name(LrSchedule schedule);
+
+#endif
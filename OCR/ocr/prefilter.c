@@ -0,0 +1,21 @@
+/*
+ * Tri des glyphes avant le réseau, voir prefilter.h
+ */
+
+#include "prefilter.h"
+
+int prefilter_glyph(const float img[IMG_SIZE][IMG_SIZE]) {
+    int i, j, ink = 0, top = IMG_SIZE, bottom = -1;
+    for (i = 0; i < IMG_SIZE; i++) {
+        int row = 0;
+        for (j = 0; j < IMG_SIZE; j++) row += img[i][j] < 0.5f;
+        if (row == 0) continue;
+        ink += row;
+        if (top == IMG_SIZE) top = i;
+        bottom = i;
+    }
+    if (ink < PREFILTER_MIN_INK) return PREFILTER_EMPTY;
+    if (bottom - top + 1 < PREFILTER_MIN_HEIGHT) return PREFILTER_FLAT;
+    if (ink > PREFILTER_MAX_INK * IMG_SIZE * IMG_SIZE) return PREFILTER_FULL;
+    return PREFILTER_LETTER;
+}
@@ -0,0 +1,39 @@
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include "cnn.h"
+
+/*
+ * Tri des glyphes avant le réseau (mode 3).
+ *
+ * Une cellule que clean_cell_content() a vidée, un reste de bordure ou
+ * une tache ne sont pas des lettres: le réseau leur donnerait quand même
+ * une lettre au hasard. Un seul passage sur les 2500 pixels compte
+ * l'encre (pixels < 0.5) et sa boîte englobante:
+ *  - moins de PREFILTER_MIN_INK pixels d'encre: cellule vide;
+ *  - boîte de moins de PREFILTER_MIN_HEIGHT pixels de haut: trait
+ *    horizontal ou poussière (une majuscule normalisée en fait 15 et
+ *    plus; la largeur n'est pas testée, un I fait 2 pixels de large);
+ *  - plus de PREFILTER_MAX_INK de la surface encrée: case pleine.
+ * Ces glyphes sortent en PREFILTER_CHAR dans grid et mots, sans
+ * candidats, et ne passent ni dans le réseau ni dans le cache de glyphes
+ * (qui court-circuite ensuite les lettres déjà vues, glyph_cache.h).
+ */
+
+#define PREFILTER_MIN_INK 20
+#define PREFILTER_MIN_HEIGHT 6
+#define PREFILTER_MAX_INK 0.9f
+#define PREFILTER_CHAR '.'
+
+/* Verdict sur un glyphe */
+enum {
+    PREFILTER_LETTER = 0,       /* à reconnaître par le réseau */
+    PREFILTER_EMPTY,            /* (presque) pas d'encre */
+    PREFILTER_FLAT,             /* trait ou poussière */
+    PREFILTER_FULL,             /* case pleine */
+    PREFILTER_VERDICTS
+};
+
+int prefilter_glyph(const float img[IMG_SIZE][IMG_SIZE]);
+
+#endif
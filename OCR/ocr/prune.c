@@ -0,0 +1,222 @@
+/*
+ * Élagage structuré de FC1 et index creux, voir prune.h
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prune.h"
+
+/* ============================================================
+ * STATISTIQUES
+ * ============================================================ */
+
+static int all_zero(const float *w, int n) {
+    int j;
+    for (j = 0; j < n; j++) {
+        if (w[j] != 0.0f) return 0;
+    }
+    return 1;
+}
+
+void prune_stats(const CNN *net, PruneStats *st) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten, nb = N / PRUNE_BLOCK;
+    size_t zero_blocks = 0;
+    int r, j;
+    memset(st, 0, sizeof(*st));
+    for (r = 0; r < H; r++) {
+        const float *row = net->fc1_weights + (size_t)r * N;
+        for (j = 0; j < N; j++) st->zero_weights += row[j] == 0.0f;
+        for (j = 0; j < nb; j++) zero_blocks += all_zero(row + j * PRUNE_BLOCK, PRUNE_BLOCK);
+        st->neurons += all_zero(row, N);
+    }
+    st->sparsity = (float)st->zero_weights / ((float)H * (float)N);
+    st->zero_blocks = nb > 0 ? (float)zero_blocks / ((float)H * (float)nb) : 0.0f;
+}
+
+/* ============================================================
+ * ÉLAGAGE
+ * ============================================================ */
+
+typedef struct {
+    float score;
+    int index;
+} Ranked;
+
+/* Score croissant, puis indice: même ordre sur toutes les machines */
+static int ranked_cmp(const void *a, const void *b) {
+    const Ranked *x = a, *y = b;
+    if (x->score != y->score) return x->score < y->score ? -1 : 1;
+    return x->index - y->index;
+}
+
+static float sum_squares(const float *w, int n, int stride) {
+    float s = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) s += w[(size_t)j * stride] * w[(size_t)j * stride];
+    return s;
+}
+
+/* Neurone r de FC1 retiré: il ne reçoit ni ne transmet plus rien */
+static void kill_neuron(CNN *net, int r) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten;
+    int c;
+    memset(net->fc1_weights + (size_t)r * N, 0, sizeof(float) * N);
+    net->fc1_bias[r] = 0.0f;
+    for (c = 0; c < FC2_SIZE; c++) net->fc2_weights[(size_t)c * H + r] = 0.0f;
+}
+
+static int prune_neurons(CNN *net, int target) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten;
+    Ranked *rank = malloc(sizeof(*rank) * H);
+    int r, n = 0, dead = 0;
+    if (!rank) return -1;
+    for (r = 0; r < H; r++) {
+        const float *row = net->fc1_weights + (size_t)r * N;
+        if (all_zero(row, N)) {
+            dead++;
+            continue;
+        }
+        rank[n].score = sqrtf(sum_squares(row, N, 1)) *
+                        sqrtf(sum_squares(net->fc2_weights + r, FC2_SIZE, H));
+        rank[n].index = r;
+        n++;
+    }
+    qsort(rank, n, sizeof(*rank), ranked_cmp);
+    for (r = 0; r < n && dead < target; r++, dead++) kill_neuron(net, rank[r].index);
+    free(rank);
+    return 0;
+}
+
+/* Blocs non nuls les plus faibles jusqu'à target poids nuls */
+static int prune_blocks(CNN *net, size_t zero, size_t target) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten, nb = N / PRUNE_BLOCK;
+    Ranked *rank = malloc(sizeof(*rank) * (size_t)H * (nb > 0 ? nb : 1));
+    int r, b, n = 0, k;
+    if (!rank) return -1;
+    for (r = 0; r < H; r++) {
+        for (b = 0; b < nb; b++) {
+            const float *w = net->fc1_weights + (size_t)r * N + b * PRUNE_BLOCK;
+            if (all_zero(w, PRUNE_BLOCK)) continue;
+            rank[n].score = sum_squares(w, PRUNE_BLOCK, 1);
+            rank[n].index = r * nb + b;
+            n++;
+        }
+    }
+    qsort(rank, n, sizeof(*rank), ranked_cmp);
+    for (k = 0; k < n && zero < target; k++) {
+        r = rank[k].index / nb;
+        b = rank[k].index % nb;
+        float *w = net->fc1_weights + (size_t)r * N + b * PRUNE_BLOCK;
+        int j;
+        for (j = 0; j < PRUNE_BLOCK; j++) {
+            zero += w[j] != 0.0f;
+            w[j] = 0.0f;
+        }
+    }
+    free(rank);
+    return 0;
+}
+
+int prune_fc1(CNN *net, float sparsity, float neuron_share) {
+    const int H = net->topo.fc1_size;
+    PruneStats st;
+    if (prune_neurons(net, (int)(sparsity * neuron_share * (float)H + 0.5f)) != 0) return -1;
+    prune_stats(net, &st);
+    size_t target = (size_t)(sparsity * (float)H * (float)net->topo.flatten + 0.5f);
+    return prune_blocks(net, st.zero_weights, target);
+}
+
+uint8_t *prune_mask(const CNN *net) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten, nb = N / PRUNE_BLOCK;
+    uint8_t *mask = calloc(net->count, 1);
+    int r, b, c;
+    if (!mask) return NULL;
+    uint8_t *fc1 = mask + (net->fc1_weights - net->data);
+    uint8_t *fc1_bias = mask + (net->fc1_bias - net->data);
+    uint8_t *fc2 = mask + (net->fc2_weights - net->data);
+    for (r = 0; r < H; r++) {
+        const float *row = net->fc1_weights + (size_t)r * N;
+        if (all_zero(row, N)) {
+            memset(fc1 + (size_t)r * N, 1, N);
+            /* Neurone retiré (et pas seulement vidé par les blocs) */
+            if (net->fc1_bias[r] == 0.0f && sum_squares(net->fc2_weights + r, FC2_SIZE, H) == 0.0f) {
+                fc1_bias[r] = 1;
+                for (c = 0; c < FC2_SIZE; c++) fc2[(size_t)c * H + r] = 1;
+            }
+            continue;
+        }
+        for (b = 0; b < nb; b++) {
+            if (all_zero(row + b * PRUNE_BLOCK, PRUNE_BLOCK)) {
+                memset(fc1 + (size_t)r * N + b * PRUNE_BLOCK, 1, PRUNE_BLOCK);
+            }
+        }
+    }
+    return mask;
+}
+
+/* ============================================================
+ * INDEX CREUX
+ * ============================================================ */
+
+static void sparse_carve(SparseFc1 *s, Arena *a) {
+    s->values = arena_alloc(a, sizeof(float) * PRUNE_BLOCK * s->nnz_blocks);
+    s->tail = arena_alloc(a, sizeof(float) * s->rows * (s->n % PRUNE_BLOCK));
+    s->row_start = arena_alloc(a, sizeof(int) * (s->rows + 1));
+    s->blocks = arena_alloc(a, sizeof(uint16_t) * s->nnz_blocks);
+}
+
+SparseFc1 *sparse_fc1_build(const CNN *net) {
+    const int H = net->topo.fc1_size, N = net->topo.flatten, nb = N / PRUNE_BLOCK;
+    const int tail = N % PRUNE_BLOCK;
+    PruneStats st;
+    int r, b, k = 0;
+
+    prune_stats(net, &st);
+    if (st.zero_blocks < PRUNE_SPARSE_MIN || nb > UINT16_MAX + 1) return NULL;
+
+    SparseFc1 *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->rows = H;
+    s->n = N;
+    for (r = 0; r < H; r++) {
+        for (b = 0; b < nb; b++) {
+            s->nnz_blocks += !all_zero(net->fc1_weights + (size_t)r * N + b * PRUNE_BLOCK,
+                                       PRUNE_BLOCK);
+        }
+    }
+    arena_measure(&s->arena);
+    sparse_carve(s, &s->arena);
+    if (arena_init(&s->arena, s->arena.used) != 0) {
+        free(s);
+        return NULL;
+    }
+    sparse_carve(s, &s->arena);
+
+    for (r = 0; r < H; r++) {
+        const float *row = net->fc1_weights + (size_t)r * N;
+        s->row_start[r] = k;
+        for (b = 0; b < nb; b++) {
+            const float *w = row + b * PRUNE_BLOCK;
+            if (all_zero(w, PRUNE_BLOCK)) continue;
+            s->blocks[k] = (uint16_t)b;
+            memcpy(s->values + (size_t)k * PRUNE_BLOCK, w, sizeof(float) * PRUNE_BLOCK);
+            k++;
+        }
+        memcpy(s->tail + (size_t)r * tail, row + nb * PRUNE_BLOCK, sizeof(float) * tail);
+    }
+    s->row_start[H] = k;
+    return s;
+}
+
+void sparse_fc1_free(SparseFc1 *s) {
+    if (!s) return;
+    arena_free(&s->arena);
+    free(s);
+}
+
+size_t sparse_fc1_bytes(const SparseFc1 *s) {
+    return (sizeof(float) * PRUNE_BLOCK + sizeof(uint16_t)) * s->nnz_blocks +
+           sizeof(int) * (s->rows + 1) + sizeof(float) * s->rows * (s->n % PRUNE_BLOCK);
+}
@@ -0,0 +1,87 @@
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cnn.h"
+#include "simd.h"
+#include "topology.h"
+
+/*
+ * Élagage structuré de FC1 et inférence creuse.
+ *
+ * FC1 porte 95 % des paramètres et l'essentiel du coût de l'inférence.
+ * L'élagage par magnitude y met des structures entières à zéro:
+ *  - des neurones: ligne de FC1, biais et colonne de FC2 (score: norme de
+ *    la ligne x norme de la colonne), le neurone sort toujours 0;
+ *  - des blocs de PRUNE_BLOCK poids consécutifs d'une ligne, une ligne de
+ *    cache (score: norme du bloc).
+ * Un poids élagué vaut exactement 0, et le réglage fin (train() avec le
+ * masque de prune_mask()) les y laisse: un modèle élagué est un model.bin
+ * ordinaire.
+ *
+ * Au chargement, si assez de blocs de FC1 sont nuls, les blocs restants
+ * sont empaquetés ligne par ligne (CSR de blocs) et forward_batch() /
+ * predict() ne lisent plus qu'eux. Les noyaux creux (simd.h) font les
+ * mêmes opérations que les noyaux denses, blocs nuls en moins: les
+ * probabilités sont identiques bit à bit.
+ */
+
+#define PRUNE_BLOCK SIMD_SPARSE_BLOCK
+
+/* Proportion de blocs nuls à partir de laquelle l'index creux est utilisé */
+#define PRUNE_SPARSE_MIN 0.25f
+
+/* Outil d'élagage: niveaux (fraction des poids de FC1 à zéro), part de
+ * chaque niveau obtenue par neurones entiers, époques de réglage fin */
+#define PRUNE_LEVELS "0.5,0.7,0.8,0.9"
+#define PRUNE_NEURON_SHARE 0.25f
+#define PRUNE_EPOCHS 2
+/* Taux du réglage fin, en fraction du taux par défaut de l'optimiseur: le
+ * taux d'un entraînement complet défait ce que le modèle avait appris */
+#define PRUNE_LR_SCALE 0.1f
+#define PRUNE_OUTPUT "model_sparse"
+
+/* FC1 en CSR de blocs */
+typedef struct SparseFc1 {
+    int rows;                   /* fc1_size */
+    int n;                      /* flatten */
+    int nnz_blocks;             /* blocs non nuls */
+    int *row_start;             /* [rows + 1], en blocs */
+    uint16_t *blocks;           /* [nnz_blocks] indice du bloc dans sa ligne */
+    float *values;              /* [nnz_blocks][PRUNE_BLOCK] */
+    float *tail;                /* [rows][n % PRUNE_BLOCK]: fin de ligne dense */
+    Arena arena;
+} SparseFc1;
+
+typedef struct {
+    int neurons;                /* neurones de FC1 dont la ligne est nulle */
+    size_t zero_weights;        /* poids de FC1 nuls */
+    float sparsity;             /* zero_weights / (fc1_size * flatten) */
+    float zero_blocks;          /* proportion des blocs entiers nuls */
+} PruneStats;
+
+void prune_stats(const CNN *net, PruneStats *st);
+
+/* Met des poids de FC1 à zéro jusqu'à ce que leur proportion atteigne
+ * sparsity, dont la part neuron_share par neurones entiers (les zéros
+ * déjà présents comptent: les niveaux s'enchaînent). -1 si l'allocation
+ * échoue. */
+int prune_fc1(CNN *net, float sparsity, float neuron_share);
+
+/* Paramètres élagués, 1 octet par float de l'arène (net->count): blocs
+ * nuls de FC1, et biais et colonne de FC2 des neurones sans poids. Leurs
+ * gradients sont annulés pendant le réglage fin. NULL si l'allocation
+ * échoue. */
+uint8_t *prune_mask(const CNN *net);
+
+/* Index creux de FC1, ou NULL si moins de PRUNE_SPARSE_MIN des blocs sont
+ * nuls (ou si l'allocation échoue): l'inférence reste alors dense */
+SparseFc1 *sparse_fc1_build(const CNN *net);
+void sparse_fc1_free(SparseFc1 *s);
+
+/* Octets de FC1 lus par image avec l'index (poids + indices) */
+size_t sparse_fc1_bytes(const SparseFc1 *s);
+
+#endif
@@ -0,0 +1,402 @@
+/*
+ * Quantification INT8 et inférence entière, voir quant.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quant.h"
+#include "conv.h"
+#include "fastmath.h"
+#include "model_bin.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+_Static_assert(sizeof(QuantHeader) <= QUANT_HEADER_SIZE, "en-tête model.q8 trop grand");
+_Static_assert(sizeof(QUANT_MAGIC) == 8, "QUANT_MAGIC doit faire 8 octets");
+
+/* ============================================================
+ * QUANTIFICATION
+ * ============================================================ */
+
+/* Ligne de poids -> int8 symétrique; renvoie l'échelle */
+static float quantize_row(const float *w, int n, int8_t *dst) {
+    float max_abs = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) {
+        float a = w[j] < 0.0f ? -w[j] : w[j];
+        if (a > max_abs) max_abs = a;
+    }
+    if (max_abs == 0.0f) {
+        memset(dst, 0, (size_t)n);
+        return 1.0f;
+    }
+    float scale = max_abs / QUANT_WEIGHT_MAX;
+    for (j = 0; j < n; j++) {
+        float v = w[j] / scale;
+        dst[j] = (int8_t)(v < 0.0f ? v - 0.5f : v + 0.5f);
+    }
+    return scale;
+}
+
+/* Découpe du corps; mêmes positions que l'ancienne structure de taille
+ * fixe pour la topologie par défaut */
+static void quant_carve(QuantCNN *q, const Topology *t, Arena *a) {
+    size_t k1 = (size_t)t->conv1_size * t->conv1_size;
+    size_t k2 = (size_t)t->conv1_filters * t->conv2_size * t->conv2_size;
+    q->topo = *t;
+    q->conv1_weights = arena_alloc(a, sizeof(float) * t->conv1_filters * k1);
+    q->conv1_bias = arena_alloc(a, sizeof(float) * t->conv1_filters);
+    q->conv2_weights = arena_alloc(a, sizeof(float) * t->conv2_filters * k2);
+    q->conv2_bias = arena_alloc(a, sizeof(float) * t->conv2_filters);
+    q->fc1_weights = arena_alloc(a, (size_t)t->fc1_size * t->flatten);
+    q->fc1_scale = arena_alloc(a, sizeof(float) * t->fc1_size);
+    q->fc1_bias = arena_alloc(a, sizeof(float) * t->fc1_size);
+    q->fc2_weights = arena_alloc(a, (size_t)FC2_SIZE * t->fc1_size);
+    q->fc2_scale = arena_alloc(a, sizeof(float) * FC2_SIZE);
+    /* fc2_bias et les deux échelles forment un seul bloc */
+    q->fc2_bias = arena_alloc(a, sizeof(float) * (FC2_SIZE + 2));
+    q->flat_scale = q->fc2_bias ? q->fc2_bias + FC2_SIZE : NULL;
+    q->hidden_scale = q->fc2_bias ? q->fc2_bias + FC2_SIZE + 1 : NULL;
+}
+
+static size_t quant_body_size(const Topology *t) {
+    QuantCNN q;
+    Arena a;
+    arena_measure(&a);
+    quant_carve(&q, t, &a);
+    return a.used;
+}
+
+static QuantCNN *quant_alloc(const Topology *t) {
+    QuantCNN *q = calloc(1, sizeof(*q));
+    Arena a;
+    if (!q) return NULL;
+    if (arena_init(&a, quant_body_size(t)) != 0) {
+        free(q);
+        return NULL;
+    }
+    quant_carve(q, t, &a);
+    q->data = a.base;
+    q->size = a.size;
+    return q;
+}
+
+QuantCNN *quant_from_float(const CNN *net, float flat_max, float hidden_max) {
+    const Topology *t = &net->topo;
+    QuantCNN *q = quant_alloc(t);
+    int r;
+    if (!q) return NULL;
+    memcpy(q->conv1_weights, net->conv1_weights,
+           sizeof(float) * t->conv1_filters * t->conv1_size * t->conv1_size);
+    memcpy(q->conv1_bias, net->conv1_bias, sizeof(float) * t->conv1_filters);
+    memcpy(q->conv2_weights, net->conv2_weights,
+           sizeof(float) * t->conv2_filters * t->conv1_filters * t->conv2_size * t->conv2_size);
+    memcpy(q->conv2_bias, net->conv2_bias, sizeof(float) * t->conv2_filters);
+
+    for (r = 0; r < t->fc1_size; r++) {
+        q->fc1_scale[r] = quantize_row(net->fc1_weights + (size_t)r * t->flatten, t->flatten,
+                                       q->fc1_weights + (size_t)r * t->flatten);
+    }
+    memcpy(q->fc1_bias, net->fc1_bias, sizeof(float) * t->fc1_size);
+    for (r = 0; r < FC2_SIZE; r++) {
+        q->fc2_scale[r] = quantize_row(net->fc2_weights + (size_t)r * t->fc1_size, t->fc1_size,
+                                       q->fc2_weights + (size_t)r * t->fc1_size);
+    }
+    memcpy(q->fc2_bias, net->fc2_bias, sizeof(float) * FC2_SIZE);
+
+    *q->flat_scale = flat_max > 0.0f ? flat_max / QUANT_ACT_MAX : 1.0f;
+    *q->hidden_scale = hidden_max > 0.0f ? hidden_max / QUANT_ACT_MAX : 1.0f;
+    return q;
+}
+
+/* ============================================================
+ * FICHIER model.q8
+ * ============================================================ */
+
+static void fill_header(QuantHeader *h, const Topology *t) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, QUANT_MAGIC, sizeof(h->magic));
+    h->version = QUANT_VERSION;
+    h->endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h->header_size = QUANT_HEADER_SIZE;
+    h->block_align = CNN_BLOCK_ALIGN;
+    h->payload_size = quant_body_size(t);
+    h->img_size = IMG_SIZE;
+    h->num_classes = NUM_CLASSES;
+    h->fc1_in = t->flatten;
+    h->fc1_out = t->fc1_size;
+    h->fc2_out = FC2_SIZE;
+    h->conv1_filters = t->conv1_filters;
+    h->conv1_size = t->conv1_size;
+    h->conv2_filters = t->conv2_filters;
+    h->conv2_size = t->conv2_size;
+}
+
+int quant_is_quantized(const char *filename) {
+    char magic[8];
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == sizeof(magic) && memcmp(magic, QUANT_MAGIC, sizeof(magic)) == 0;
+}
+
+int quant_save(const QuantCNN *q, const char *filename) {
+    unsigned char header[QUANT_HEADER_SIZE];
+    QuantHeader h;
+
+    fill_header(&h, &q->topo);
+    h.checksum = model_bin_checksum(q->data, q->size);
+    memset(header, 0, sizeof(header));
+    memcpy(header, &h, sizeof(h));
+
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        printf("Erreur: impossible de sauvegarder dans %s\n", filename);
+        return -1;
+    }
+    if (fwrite(header, 1, sizeof(header), fp) != sizeof(header) ||
+        fwrite(q->data, 1, q->size, fp) != q->size) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    if (fclose(fp) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        return -1;
+    }
+    printf("Modèle INT8 sauvegardé dans %s (%zu octets)\n", filename,
+           sizeof(header) + q->size);
+    return 0;
+}
+
+QuantCNN *quant_load(const char *filename) {
+    unsigned char header[QUANT_HEADER_SIZE];
+    QuantHeader h, expected;
+    Topology t;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        printf("Erreur: impossible de charger %s\n", filename);
+        return NULL;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+        printf("Erreur: %s est tronqué\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    memcpy(&h, header, sizeof(h));
+    if (memcmp(h.magic, QUANT_MAGIC, sizeof(h.magic)) != 0) {
+        printf("Erreur: %s n'est pas un modèle INT8\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+    if (h.version != QUANT_VERSION || h.endian_tag != MODEL_BIN_ENDIAN_TAG) {
+        printf("Erreur: version ou ordre d'octets de %s non supporté\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+
+    /* Topologie décrite par l'en-tête (convolutions par défaut si absentes) */
+    topology_default(&t);
+    if (h.conv1_filters != 0) {
+        t.conv1_filters = (int)h.conv1_filters;
+        t.conv1_size = (int)h.conv1_size;
+        t.conv2_filters = (int)h.conv2_filters;
+        t.conv2_size = (int)h.conv2_size;
+    }
+    t.fc1_size = (int)h.fc1_out;
+    if (h.fc1_out > TOPO_MAX_FC1 || h.conv1_filters > TOPO_MAX_FILTERS ||
+        h.conv2_filters > TOPO_MAX_FILTERS || h.conv1_size > IMG_SIZE ||
+        h.conv2_size > IMG_SIZE || topology_init(&t) != 0) {
+        printf("Erreur: topologie de %s invalide\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+
+    /* Formes et taille du corps (tout ce qui suit le checksum) */
+    fill_header(&expected, &t);
+    if (h.payload_size != expected.payload_size ||
+        memcmp(&h.img_size, &expected.img_size,
+               offsetof(QuantHeader, conv1_filters) - offsetof(QuantHeader, img_size)) != 0) {
+        printf("Erreur: l'architecture de %s n'est pas reconnue\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+
+    QuantCNN *q = quant_alloc(&t);
+    if (!q) {
+        printf("Erreur: mémoire insuffisante\n");
+        fclose(fp);
+        return NULL;
+    }
+    if (fread(q->data, 1, q->size, fp) != q->size) {
+        printf("Erreur: %s est tronqué\n", filename);
+        quant_free(q);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    if (model_bin_checksum(q->data, q->size) != h.checksum) {
+        printf("Erreur: somme de contrôle invalide pour %s\n", filename);
+        quant_free(q);
+        return NULL;
+    }
+    return q;
+}
+
+void quant_free(QuantCNN *q) {
+    if (!q) return;
+    free(q->data);
+    free(q);
+}
+
+/* ============================================================
+ * INFÉRENCE ENTIÈRE
+ * ============================================================ */
+
+struct QuantWorkspace {
+    float *pool1;               /* [conv1_filters][after_pool1][after_pool1] */
+    ConvFusedWorkspace conv;
+    float *flat;
+    uint8_t *flat_q;
+    float *hidden;
+    uint8_t *hidden_q;
+    Arena arena;
+};
+
+static void workspace_carve(QuantWorkspace *ws, const Topology *t, Arena *a) {
+    ws->pool1 = arena_alloc(a, sizeof(float) * t->conv1_filters * t->after_pool1 * t->after_pool1);
+    conv_fused_workspace_carve(&ws->conv, t, a);
+    ws->flat = arena_alloc(a, sizeof(float) * t->flatten);
+    ws->flat_q = arena_alloc(a, t->flatten);
+    ws->hidden = arena_alloc(a, sizeof(float) * t->fc1_size);
+    ws->hidden_q = arena_alloc(a, t->fc1_size);
+}
+
+QuantWorkspace *quant_workspace_new(const QuantCNN *q) {
+    QuantWorkspace *ws = calloc(1, sizeof(*ws));
+    if (!ws) return NULL;
+    arena_measure(&ws->arena);
+    workspace_carve(ws, &q->topo, &ws->arena);
+    if (arena_init(&ws->arena, ws->arena.used) != 0) {
+        free(ws);
+        return NULL;
+    }
+    workspace_carve(ws, &q->topo, &ws->arena);
+    return ws;
+}
+
+void quant_workspace_free(QuantWorkspace *ws) {
+    if (!ws) return;
+    arena_free(&ws->arena);
+    free(ws);
+}
+
+/* x >= 0 -> round(x / scale) borné à QUANT_ACT_MAX */
+static void quantize_act(const float *x, int n, float scale, uint8_t *dst) {
+    float inv = 1.0f / scale;
+    int j;
+    for (j = 0; j < n; j++) {
+        float v = x[j] * inv + 0.5f;
+        if (v > QUANT_ACT_MAX) v = QUANT_ACT_MAX;
+        dst[j] = v > 0.0f ? (uint8_t)v : 0;
+    }
+}
+
+void quant_forward(const QuantCNN *q, QuantWorkspace *ws,
+                   float img[IMG_SIZE][IMG_SIZE], float logits[NUM_CLASSES]) {
+    const Topology *t = &q->topo;
+    const float flat_scale = *q->flat_scale, hidden_scale = *q->hidden_scale;
+    int r;
+
+    conv1_relu_pool(t, q->conv1_weights, q->conv1_bias, &img[0][0], ws->pool1, &ws->conv);
+    conv2_relu_pool(t, q->conv2_weights, q->conv2_bias, ws->pool1, ws->flat, &ws->conv);
+
+    /* FC1: somme entière, puis une seule multiplication par les deux échelles */
+    quantize_act(ws->flat, t->flatten, flat_scale, ws->flat_q);
+    for (r = 0; r < t->fc1_size; r++) {
+        int32_t acc = simd->dot_u8s8(ws->flat_q, q->fc1_weights + (size_t)r * t->flatten,
+                                     t->flatten);
+        ws->hidden[r] = relu(q->fc1_bias[r] + (float)acc * (flat_scale * q->fc1_scale[r]));
+    }
+
+    quantize_act(ws->hidden, t->fc1_size, hidden_scale, ws->hidden_q);
+    for (r = 0; r < FC2_SIZE; r++) {
+        int32_t acc = simd->dot_u8s8(ws->hidden_q, q->fc2_weights + (size_t)r * t->fc1_size,
+                                     t->fc1_size);
+        logits[r] = q->fc2_bias[r] + (float)acc * (hidden_scale * q->fc2_scale[r]);
+    }
+}
+
+int quant_predict(const QuantCNN *q, QuantWorkspace *ws, float img[IMG_SIZE][IMG_SIZE]) {
+    float logits[NUM_CLASSES];
+    int k, pred = 0;
+    quant_forward(q, ws, img, logits);
+    for (k = 1; k < NUM_CLASSES; k++) {
+        if (logits[k] > logits[pred]) pred = k;
+    }
+    return pred;
+}
+
+/* Une tâche = QUANT_CHUNK images consécutives */
+#define QUANT_CHUNK 8
+
+typedef struct {
+    const QuantCNN *q;
+    QuantWorkspace **ws;        /* un espace de travail par worker */
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    int n;
+    char *letters;
+    float (*probs)[NUM_CLASSES]; /* NULL: probabilités non conservées */
+} QuantJob;
+
+static void quant_task(void *ctx, int task, int worker) {
+    QuantJob *job = ctx;
+    int start = task * QUANT_CHUNK;
+    int end = start + QUANT_CHUNK < job->n ? start + QUANT_CHUNK : job->n;
+    int k, c;
+    for (k = start; k < end; k++) {
+        if (!job->probs) {
+            job->letters[k] = 'A' + quant_predict(job->q, job->ws[worker], job->imgs[k]);
+            continue;
+        }
+        /* Même argmax que quant_predict(), sur les logits */
+        float logits[NUM_CLASSES];
+        int pred = 0;
+        quant_forward(job->q, job->ws[worker], job->imgs[k], logits);
+        for (c = 1; c < NUM_CLASSES; c++) {
+            if (logits[c] > logits[pred]) pred = c;
+        }
+        softmax(logits, job->probs[k], NUM_CLASSES);
+        job->letters[k] = 'A' + pred;
+    }
+}
+
+int quant_predict_batch(const QuantCNN *q, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                        char *letters, float (*probs)[NUM_CLASSES], int threads) {
+    int w;
+    int n_tasks = (n + QUANT_CHUNK - 1) / QUANT_CHUNK;
+    if (threads < 1) threads = 1;
+    if (threads > n_tasks) threads = n_tasks > 0 ? n_tasks : 1;
+
+    QuantWorkspace **ws = calloc(threads, sizeof(*ws));
+    if (!ws) return -1;
+    for (w = 0; w < threads; w++) {
+        ws[w] = quant_workspace_new(q);
+        if (!ws[w]) {
+            while (w-- > 0) quant_workspace_free(ws[w]);
+            free(ws);
+            return -1;
+        }
+    }
+
+    QuantJob job = { q, ws, imgs, n, letters, probs };
+    parallel_for(n_tasks, threads, quant_task, &job);
+
+    for (w = 0; w < threads; w++) quant_workspace_free(ws[w]);
+    free(ws);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef QUANT_H
+#define QUANT_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+#include "topology.h"
+
+/*
+ * Modèle quantifié INT8 (model.q8) pour l'inférence.
+ *
+ * FC1 et FC2 (99,6 % des poids) passent en int8 avec une échelle par
+ * neurone de sortie: w ~= w_q * scale[r], |w_q| <= 127. Leurs entrées
+ * (sorties de Pool2 et de FC1 après ReLU, donc positives) sont quantifiées
+ * en [0, QUANT_ACT_MAX] avec une échelle par tenseur calibrée sur le jeu
+ * d'entraînement. Les produits scalaires se font en entiers (accumulation
+ * int32) et ne repassent en float que pour le biais et la ReLU.
+ * Les convolutions, minuscules, restent en float.
+ *
+ * Format du fichier:
+ *   [ en-tête QuantHeader, QUANT_HEADER_SIZE octets ]
+ *   [ corps: blocs de QuantCNN, voir ci-dessous ]
+ */
+
+#define QUANT_MAGIC "CNNQ8\r\n"     /* 8 octets avec le zéro final */
+#define QUANT_VERSION 1
+#define QUANT_HEADER_SIZE 128
+#define QUANT_FILE "model.q8"
+
+/* Activations limitées à 127 pour que les paires u8 x s8 de pmaddubsw ne
+ * saturent jamais en 16 bits */
+#define QUANT_ACT_MAX 127
+#define QUANT_WEIGHT_MAX 127
+
+/* Outil de quantification: les QUANT_CALIB_PER_LETTER premiers échantillons
+ * de chaque lettre servent à la calibration, les QUANT_EVAL_PER_LETTER
+ * suivants à mesurer l'écart de précision */
+#define QUANT_CALIB_PER_LETTER 100
+#define QUANT_EVAL_PER_LETTER 200
+
+/* Vues sur le corps du modèle, découpé comme model.bin: blocs alignés sur
+ * CNN_BLOCK_ALIGN dans l'ordre ci-dessous, les deux échelles d'activation
+ * accolées à fc2_bias, taille totale arrondie à CNN_BLOCK_ALIGN */
+typedef struct {
+    Topology topo;
+    float *conv1_weights;       /* [conv1_filters][conv1_size][conv1_size] */
+    float *conv1_bias;
+    float *conv2_weights;       /* [conv2_filters][conv1_filters][conv2_size][conv2_size] */
+    float *conv2_bias;
+
+    int8_t *fc1_weights;        /* [fc1_size][flatten] */
+    float *fc1_scale;
+    float *fc1_bias;
+
+    int8_t *fc2_weights;        /* [FC2_SIZE][fc1_size] */
+    float *fc2_scale;
+    float *fc2_bias;
+
+    /* Échelles des activations: x ~= x_q * scale */
+    float *flat_scale;          /* entrée de FC1 (sortie de Pool2) */
+    float *hidden_scale;        /* entrée de FC2 (FC1 après ReLU) */
+
+    void *data;                 /* corps du fichier */
+    size_t size;
+} QuantCNN;
+
+/* Les dimensions des convolutions n'existent qu'à partir de la topologie
+ * configurable; un fichier plus ancien (champs à zéro) a les valeurs par
+ * défaut, la version ne change donc pas. */
+typedef struct {
+    char magic[8];              /* QUANT_MAGIC */
+    uint32_t version;           /* QUANT_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint32_t header_size;
+    uint32_t block_align;
+    uint64_t payload_size;      /* taille du corps */
+    uint64_t checksum;          /* FNV-1a 64 bits du corps */
+    uint32_t img_size, num_classes;
+    uint32_t fc1_in, fc1_out, fc2_out;
+    uint32_t conv1_filters, conv1_size, conv2_filters, conv2_size;
+} QuantHeader;
+
+/* Quantifie les poids de net (même topologie); flat_max / hidden_max sont
+ * les plus grandes activations observées à l'entrée de FC1 et de FC2 lors
+ * de la calibration. NULL si l'allocation échoue. */
+QuantCNN *quant_from_float(const CNN *net, float flat_max, float hidden_max);
+
+/* Renvoie 1 si le fichier commence par QUANT_MAGIC */
+int quant_is_quantized(const char *filename);
+
+int quant_save(const QuantCNN *q, const char *filename);
+
+/* Alloue et lit un modèle quantifié; NULL en cas d'erreur */
+QuantCNN *quant_load(const char *filename);
+void quant_free(QuantCNN *q);
+
+/* Tampons d'inférence d'un thread, pour la topologie de q */
+typedef struct QuantWorkspace QuantWorkspace;
+
+QuantWorkspace *quant_workspace_new(const QuantCNN *q);
+void quant_workspace_free(QuantWorkspace *ws);
+
+/* Logits (avant softmax) d'une image avec le modèle quantifié */
+void quant_forward(const QuantCNN *q, QuantWorkspace *ws,
+                   float img[IMG_SIZE][IMG_SIZE], float logits[NUM_CLASSES]);
+
+/* Indice de la classe la plus probable */
+int quant_predict(const QuantCNN *q, QuantWorkspace *ws, float img[IMG_SIZE][IMG_SIZE]);
+
+/* Équivalent de predict_batch() pour le modèle quantifié */
+int quant_predict_batch(const QuantCNN *q, float (*imgs)[IMG_SIZE][IMG_SIZE], int n,
+                        char *letters, float (*probs)[NUM_CLASSES], int threads);
+
+#endif
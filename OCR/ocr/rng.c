@@ -0,0 +1,57 @@
+/*
+ * Générateur à compteur Philox4x32-10, voir rng.h
+ */
+
+#include "rng.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    int round;
+    for (round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void rng_stream(RngStream *r, uint32_t seed, uint32_t domain, uint64_t stream) {
+    r->key[0] = seed;
+    r->key[1] = domain;
+    r->ctr[0] = 0;
+    r->ctr[1] = 0;
+    r->ctr[2] = (uint32_t)stream;
+    r->ctr[3] = (uint32_t)(stream >> 32);
+    r->left = 0;
+}
+
+uint32_t rng_u32(RngStream *r) {
+    if (r->left == 0) {
+        philox4x32(r->ctr, r->key, r->out);
+        if (++r->ctr[0] == 0) r->ctr[1]++;
+        r->left = 4;
+    }
+    return r->out[4 - r->left--];
+}
+
+float rng_unit(RngStream *r) {
+    return (float)(rng_u32(r) >> 8) / 16777216.0f;
+}
+
+int rng_below(RngStream *r, int n) {
+    return (int)(((uint64_t)rng_u32(r) * (uint32_t)n) >> 32);
+}
@@ -0,0 +1,53 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Générateur à compteur Philox4x32-10 (Salmon et al., SC 2011).
+ *
+ * Un bloc de 4 mots de 32 bits est une fonction pure de la clé (graine,
+ * domaine) et d'un compteur de 128 bits (numéro de flux, numéro de bloc):
+ * il n'y a pas d'état partagé. Chaque tirage de l'entraînement a son flux:
+ *  - RNG_INIT: un flux par couche pour les poids initiaux;
+ *  - RNG_SHUFFLE: un flux par époque pour le mélange;
+ *  - RNG_AUGMENT: un flux par (époque, échantillon) pour l'augmentation.
+ * Les images augmentées ne dépendent donc ni de l'ordre de production, ni
+ * du thread qui les produit, ni de la taille des lots; avec le même
+ * découpage en tranches (ordre des sommes), une graine donne les mêmes
+ * poids bit à bit. './main check-rng' compare philox4x32() aux vecteurs
+ * de référence de Random123.
+ */
+
+#define TRAIN_SEED 42u
+
+/* Domaines de tirage (second mot de la clé) */
+enum {
+    RNG_INIT = 1,
+    RNG_SHUFFLE = 2,
+    RNG_AUGMENT = 3
+};
+
+/* Flux séquentiel sur les blocs successifs d'un compteur */
+typedef struct RngStream {
+    uint32_t key[2];            /* graine, domaine */
+    uint32_t ctr[4];            /* [0..1] numéro de bloc, [2..3] numéro de flux */
+    uint32_t out[4];            /* bloc courant */
+    int left;                   /* mots de out pas encore tirés */
+} RngStream;
+
+/* 10 tours de Philox4x32 */
+void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+/* Flux stream du domaine domain pour la graine seed, au bloc 0 */
+void rng_stream(RngStream *r, uint32_t seed, uint32_t domain, uint64_t stream);
+
+uint32_t rng_u32(RngStream *r);
+
+/* Uniforme dans [0, 1) (24 bits) */
+float rng_unit(RngStream *r);
+
+/* Entier dans [0, n), n > 0 */
+int rng_below(RngStream *r, int n);
+
+#endif
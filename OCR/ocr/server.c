@@ -0,0 +1,301 @@
+/*
+ * Démon OCR sur un socket Unix, voir server.h
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "fastmath.h"
+#include "server.h"
+
+_Static_assert(OCR_IMG_SIZE == IMG_SIZE, "client.h et cnn.h doivent avoir la même taille d'image");
+
+struct Server {
+    char path[108];
+    int listen_fd;
+    int wake[2];                /* tube: server_stop() réveille le thread d'accueil */
+    const CNN *net;
+    const QuantCNN *q;
+    pthread_t acceptor;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;     /* une connexion s'est terminée */
+    int *fds;                   /* [max_clients] connexions ouvertes, -1 si libre */
+    int max_clients;
+    int active;
+    int stopping;
+    long requests, glyphs;
+};
+
+/* Tampons d'une connexion, alloués une fois pour toutes ses requêtes */
+typedef struct {
+    Server *s;
+    int fd;
+    int slot;
+    BatchWorkspace *ws;
+    QuantWorkspace *qws;
+    uint8_t pixels[BATCH_TILE][OCR_IMG_PIXELS];
+    float imgs[BATCH_TILE][IMG_SIZE][IMG_SIZE];
+    float probs[BATCH_TILE][NUM_CLASSES];
+    OcrGlyph reply[OCR_MAX_GLYPHS];
+} Connection;
+
+/* ============================================================
+ * CONNEXIONS
+ * ============================================================ */
+
+static void infer_tile(Connection *c, int m) {
+    int k, p;
+    for (k = 0; k < m; k++) {
+        float *img = &c->imgs[k][0][0];
+        for (p = 0; p < OCR_IMG_PIXELS; p++) img[p] = (float)c->pixels[k][p] / 255.0f;
+    }
+    if (c->s->q) {
+        for (k = 0; k < m; k++) {
+            float logits[NUM_CLASSES];
+            quant_forward(c->s->q, c->qws, c->imgs[k], logits);
+            softmax(logits, c->probs[k], NUM_CLASSES);
+        }
+    } else {
+        forward_batch_ws(c->s->net, c->ws, c->imgs, m, c->probs);
+    }
+}
+
+/* Traite une requête; -1 si la connexion doit être fermée */
+static int serve_request(Connection *c) {
+    const int fd = c->fd;
+    OcrRequest req;
+    OcrReply reply = { OCR_REPLY_MAGIC, OCR_OK, 0, 0 };
+    int done, k, i;
+
+    if (ocr_read_full(fd, &req, sizeof(req)) != 0) return -1;
+    if (req.magic != OCR_REQUEST_MAGIC || req.count > OCR_MAX_GLYPHS) {
+        reply.status = OCR_ERR_PROTOCOL;
+        ocr_write_full(fd, &reply, sizeof(reply));
+        return -1;
+    }
+    int n = (int)req.count;
+    for (done = 0; done < n; done += BATCH_TILE) {
+        int m = n - done < BATCH_TILE ? n - done : BATCH_TILE;
+        if (ocr_read_full(fd, c->pixels, (size_t)m * OCR_IMG_PIXELS) != 0) return -1;
+        infer_tile(c, m);
+        for (k = 0; k < m; k++) {
+            /* Même choix que predict_batch(): première probabilité maximale */
+            int pred = 0;
+            for (i = 1; i < NUM_CLASSES; i++) {
+                if (c->probs[k][i] > c->probs[k][pred]) pred = i;
+            }
+            OcrGlyph *g = &c->reply[done + k];
+            memset(g, 0, sizeof(*g));
+            g->letter = (char)('A' + pred);
+            g->confidence = c->probs[k][pred];
+        }
+    }
+    reply.count = (uint32_t)n;
+    if (ocr_write_full(fd, &reply, sizeof(reply)) != 0 ||
+        ocr_write_full(fd, c->reply, sizeof(c->reply[0]) * n) != 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&c->s->lock);
+    c->s->requests++;
+    c->s->glyphs += n;
+    pthread_mutex_unlock(&c->s->lock);
+    return 0;
+}
+
+static void *connection_main(void *arg) {
+    Connection *c = arg;
+    Server *s = c->s;
+
+    while (serve_request(c) == 0) {}
+
+    batch_workspace_free(c->ws);
+    quant_workspace_free(c->qws);
+    pthread_mutex_lock(&s->lock);
+    close(c->fd);
+    s->fds[c->slot] = -1;
+    s->active--;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    free(c);
+    return NULL;
+}
+
+/* Lance le thread de la connexion fd dans l'emplacement slot (libre);
+ * ferme fd en cas d'échec */
+static void connection_start(Server *s, int fd, int slot) {
+    Connection *c = malloc(sizeof(*c));
+    pthread_t thread;
+    pthread_attr_t attr;
+    int ok = c != NULL;
+    if (ok) {
+        c->s = s;
+        c->fd = fd;
+        c->slot = slot;
+        c->ws = s->q ? NULL : batch_workspace_new(&s->net->topo);
+        c->qws = s->q ? quant_workspace_new(s->q) : NULL;
+        ok = c->ws || c->qws;
+    }
+    if (ok) {
+        pthread_mutex_lock(&s->lock);
+        s->fds[slot] = fd;
+        s->active++;
+        pthread_mutex_unlock(&s->lock);
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        ok = pthread_create(&thread, &attr, connection_main, c) == 0;
+        pthread_attr_destroy(&attr);
+        if (ok) return;
+        pthread_mutex_lock(&s->lock);
+        s->fds[slot] = -1;
+        s->active--;
+        pthread_mutex_unlock(&s->lock);
+    }
+    printf("Erreur: connexion refusée (mémoire ou threads insuffisants)\n");
+    if (c) {
+        batch_workspace_free(c->ws);
+        quant_workspace_free(c->qws);
+        free(c);
+    }
+    close(fd);
+}
+
+/* ============================================================
+ * ACCUEIL
+ * ============================================================ */
+
+/* Emplacement libre, en attendant qu'une connexion se termine; -1 si
+ * le démon s'arrête */
+static int wait_slot(Server *s) {
+    int slot = -1, i;
+    pthread_mutex_lock(&s->lock);
+    while (!s->stopping && s->active == s->max_clients) {
+        pthread_cond_wait(&s->changed, &s->lock);
+    }
+    for (i = 0; !s->stopping && i < s->max_clients && slot < 0; i++) {
+        if (s->fds[i] < 0) slot = i;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return slot;
+}
+
+static void *acceptor_main(void *arg) {
+    Server *s = arg;
+    struct pollfd fds[2] = { { s->listen_fd, POLLIN, 0 }, { s->wake[0], POLLIN, 0 } };
+
+    while (1) {
+        int slot = wait_slot(s);
+        if (slot < 0) break;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        connection_start(s, fd, slot);
+    }
+    return NULL;
+}
+
+static void server_free(Server *s) {
+    if (s->listen_fd >= 0) close(s->listen_fd);
+    if (s->wake[0] >= 0) close(s->wake[0]);
+    if (s->wake[1] >= 0) close(s->wake[1]);
+    pthread_cond_destroy(&s->changed);
+    pthread_mutex_destroy(&s->lock);
+    free(s->fds);
+    free(s);
+}
+
+Server *server_start(const char *path, const CNN *net, const QuantCNN *q, int max_clients) {
+    struct sockaddr_un addr;
+    int i;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Erreur: chemin de socket trop long: %s\n", path);
+        return NULL;
+    }
+    /* Un démon qui répond encore garde son socket */
+    int probe = ocr_connect(path);
+    if (probe >= 0) {
+        ocr_disconnect(probe);
+        printf("Erreur: un démon écoute déjà sur %s\n", path);
+        return NULL;
+    }
+
+    Server *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    if (max_clients < 1) max_clients = 1;
+    snprintf(s->path, sizeof(s->path), "%s", path);
+    s->net = net;
+    s->q = q;
+    s->max_clients = max_clients;
+    s->listen_fd = -1;
+    s->wake[0] = s->wake[1] = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->changed, NULL);
+    s->fds = malloc(sizeof(int) * max_clients);
+    int ok = s->fds != NULL && pipe(s->wake) == 0;
+    for (i = 0; ok && i < max_clients; i++) s->fds[i] = -1;
+
+    if (ok) {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path, strlen(path) + 1);
+        unlink(path);
+        s->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        ok = s->listen_fd >= 0 &&
+             bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+             listen(s->listen_fd, SOMAXCONN) == 0;
+        if (!ok) printf("Erreur: impossible d'écouter sur %s (%s)\n", path, strerror(errno));
+    }
+    if (ok && pthread_create(&s->acceptor, NULL, acceptor_main, s) != 0) {
+        printf("Erreur: impossible de créer le thread du démon\n");
+        unlink(path);
+        ok = 0;
+    }
+    if (!ok) {
+        server_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void server_stop(Server *s) {
+    int i;
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    s->stopping = 1;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    /* Un seul octet dans un tube vide: l'écriture ne peut pas échouer */
+    ssize_t woken = write(s->wake[1], "", 1);
+    (void)woken;
+    pthread_join(s->acceptor, NULL);
+
+    /* Les threads des connexions sortent de read() et se terminent */
+    pthread_mutex_lock(&s->lock);
+    for (i = 0; i < s->max_clients; i++) {
+        if (s->fds[i] >= 0) shutdown(s->fds[i], SHUT_RDWR);
+    }
+    while (s->active > 0) pthread_cond_wait(&s->changed, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+
+    unlink(s->path);
+    server_free(s);
+}
+
+void server_stats(Server *s, long *requests, long *glyphs) {
+    pthread_mutex_lock(&s->lock);
+    *requests = s->requests;
+    *glyphs = s->glyphs;
+    pthread_mutex_unlock(&s->lock);
+}
@@ -0,0 +1,43 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "client.h"
+#include "cnn.h"
+#include "quant.h"
+
+/*
+ * Démon OCR sur un socket Unix (protocole: client.h).
+ *
+ * Le modèle est chargé une fois par l'appelant; chaque connexion est
+ * servie par son propre thread, avec ses tampons d'inférence alloués à
+ * la connexion: une requête ne fait aucune allocation. Les images d'une
+ * requête passent par groupes de BATCH_TILE dans forward_batch_ws(), les
+ * réponses sont donc identiques à celles de predict_batch().
+ * Au-delà de max_clients connexions, les suivantes attendent dans la file
+ * du socket.
+ *
+ * Le démon sert le modèle chargé au démarrage jusqu'à son arrêt. Un
+ * model.bin est mappé (MAP_PRIVATE); les modes 1, prune et convert le
+ * remplacent par renommage (model_bin_save), le mapping garde donc
+ * l'ancien fichier: pour servir le nouveau modèle, relancer le démon.
+ * Une connexion dont les tampons ne peuvent pas être alloués est fermée
+ * tout de suite (ocr_recognize() renvoie -1).
+ */
+
+#define SERVER_MAX_CLIENTS 64
+
+typedef struct Server Server;
+
+/* Écoute sur path avec le modèle q (INT8) s'il n'est pas NULL, sinon net.
+ * Le modèle doit rester valide jusqu'à server_stop(). Un socket laissé par
+ * un démon arrêté est remplacé; NULL si un démon écoute déjà sur path ou
+ * en cas d'erreur. */
+Server *server_start(const char *path, const CNN *net, const QuantCNN *q, int max_clients);
+
+/* Ferme les connexions, attend leurs threads et supprime le socket */
+void server_stop(Server *s);
+
+/* Requêtes et glyphes traités depuis server_start() */
+void server_stats(Server *s, long *requests, long *glyphs);
+
+#endif
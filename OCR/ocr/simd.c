@@ -0,0 +1,849 @@
+/*
+ * Noyaux SIMD (scalaire / SSE4.1 / AVX2+FMA+F16C) et choix à l'exécution
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/* ============================================================
+ * VERSION SCALAIRE (toutes machines)
+ * ============================================================ */
+
+static float dot_scalar(const float *a, const float *b, int n) {
+    float s = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) {
+        s += a[j] * b[j];
+    }
+    return s;
+}
+
+static void dot4_scalar(const float *w, const float *x0, const float *x1,
+                        const float *x2, const float *x3, int n, float out[4]) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) {
+        s0 += w[j] * x0[j];
+        s1 += w[j] * x1[j];
+        s2 += w[j] * x2[j];
+        s3 += w[j] * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+static void gemm_4x16_scalar(int kc, const float *a, const float *b, float *c, int ldc) {
+    float acc[4][16];
+    int i, j, k;
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 16; j++) acc[i][j] = c[(size_t)i * ldc + j];
+    }
+    for (k = 0; k < kc; k++) {
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 16; j++) acc[i][j] += a[i] * b[j];
+        }
+        a += 4;
+        b += 16;
+    }
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 16; j++) c[(size_t)i * ldc + j] = acc[i][j];
+    }
+}
+
+static void relu_pool2x2_scalar(const float *src, int size, int rows, int cols, float *dst) {
+    int i, j;
+    for (i = 0; i < rows; i++) {
+        const float *r0 = src + (size_t)(2 * i) * size;
+        const float *r1 = r0 + size;
+        for (j = 0; j < cols; j++) {
+            float m = 0.0f;             /* ReLU: le max part de 0 */
+            if (r0[2 * j] > m) m = r0[2 * j];
+            if (r0[2 * j + 1] > m) m = r0[2 * j + 1];
+            if (r1[2 * j] > m) m = r1[2 * j];
+            if (r1[2 * j + 1] > m) m = r1[2 * j + 1];
+            dst[i * cols + j] = m;
+        }
+    }
+}
+
+static int32_t dot_u8s8_scalar(const uint8_t *x, const int8_t *w, int n) {
+    int32_t s = 0;
+    int j;
+    for (j = 0; j < n; j++) {
+        s += (int32_t)x[j] * w[j];
+    }
+    return s;
+}
+
+/* Début de la fin de ligne dense des noyaux creux */
+#define SPARSE_TAIL(n) ((n) & ~(SIMD_SPARSE_BLOCK - 1))
+
+static float dot_sparse_scalar(const float *vals, const uint16_t *blocks, int nb,
+                               const float *tail, const float *x, int n) {
+    float s = 0.0f;
+    int b, j, t = SPARSE_TAIL(n);
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        const float *xb = x + (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        for (j = 0; j < SIMD_SPARSE_BLOCK; j++) s += vals[j] * xb[j];
+    }
+    for (j = t; j < n; j++) s += tail[j - t] * x[j];
+    return s;
+}
+
+static void dot4_sparse_scalar(const float *vals, const uint16_t *blocks, int nb,
+                               const float *tail, const float *x0, const float *x1,
+                               const float *x2, const float *x3, int n, float out[4]) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int b, j, t = SPARSE_TAIL(n);
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        size_t o = (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        for (j = 0; j < SIMD_SPARSE_BLOCK; j++) {
+            s0 += vals[j] * x0[o + j];
+            s1 += vals[j] * x1[o + j];
+            s2 += vals[j] * x2[o + j];
+            s3 += vals[j] * x3[o + j];
+        }
+    }
+    for (j = t; j < n; j++) {
+        s0 += tail[j - t] * x0[j];
+        s1 += tail[j - t] * x1[j];
+        s2 += tail[j - t] * x2[j];
+        s3 += tail[j - t] * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+/* Poids sur 16 bits -> float, conversions exactes. float16: le champ
+ * exposant est recentré de 15 à 127; les sous-normaux (exposant nul)
+ * passent par 2^-14 + m * 2^-24, dont on retranche 2^-14. */
+static inline float f16_to_float(uint16_t h) {
+    uint32_t o = (uint32_t)(h & 0x7fff) << 13, e = o & 0x0f800000u;
+    float f, sub = 0.0f;
+    o += (uint32_t)(127 - 15) << 23;
+    if (e == 0x0f800000u) {
+        o += (uint32_t)(128 - 16) << 23;        /* infini, NaN */
+    } else if (e == 0) {
+        o += 1u << 23;                          /* zéro, sous-normaux */
+        sub = 6.103515625e-05f;                 /* 2^-14 */
+    }
+    memcpy(&f, &o, sizeof(f));
+    f -= sub;
+    return (h & 0x8000) ? -f : f;
+}
+
+static inline float bf16_to_float(uint16_t h) {
+    uint32_t o = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &o, sizeof(f));
+    return f;
+}
+
+static inline float h16_to_float(uint16_t h, int bf16) {
+    return bf16 ? bf16_to_float(h) : f16_to_float(h);
+}
+
+static inline float dot_h16_scalar(const uint16_t *w, const float *x, int n, int bf16) {
+    float s = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) {
+        s += h16_to_float(w[j], bf16) * x[j];
+    }
+    return s;
+}
+
+static inline void dot4_h16_scalar(const uint16_t *w, const float *x0, const float *x1,
+                                   const float *x2, const float *x3, int n, float out[4],
+                                   int bf16) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int j;
+    for (j = 0; j < n; j++) {
+        float wj = h16_to_float(w[j], bf16);
+        s0 += wj * x0[j];
+        s1 += wj * x1[j];
+        s2 += wj * x2[j];
+        s3 += wj * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+static float dot_f16_scalar(const uint16_t *w, const float *x, int n) {
+    return dot_h16_scalar(w, x, n, 0);
+}
+
+static void dot4_f16_scalar(const uint16_t *w, const float *x0, const float *x1,
+                            const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_scalar(w, x0, x1, x2, x3, n, out, 0);
+}
+
+static float dot_bf16_scalar(const uint16_t *w, const float *x, int n) {
+    return dot_h16_scalar(w, x, n, 1);
+}
+
+static void dot4_bf16_scalar(const uint16_t *w, const float *x0, const float *x1,
+                             const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_scalar(w, x0, x1, x2, x3, n, out, 1);
+}
+
+static const SimdKernels kernels_scalar = {
+    "scalar", dot_scalar, dot4_scalar, gemm_4x16_scalar, relu_pool2x2_scalar,
+    dot_u8s8_scalar, dot_sparse_scalar, dot4_sparse_scalar,
+    dot_f16_scalar, dot4_f16_scalar, dot_bf16_scalar, dot4_bf16_scalar
+};
+
+#ifdef SIMD_X86
+
+/* ============================================================
+ * VERSION SSE4.1 (vecteurs de 4 floats)
+ * ============================================================ */
+
+#define TARGET_SSE __attribute__((target("sse4.1")))
+
+TARGET_SSE static inline float hsum128(__m128 v) {
+    __m128 hi = _mm_movehl_ps(v, v);
+    v = _mm_add_ps(v, hi);
+    hi = _mm_shuffle_ps(v, v, 1);
+    return _mm_cvtss_f32(_mm_add_ss(v, hi));
+}
+
+TARGET_SSE static float dot_sse(const float *a, const float *b, int n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(b + j + 4)));
+    }
+    float s = hsum128(_mm_add_ps(s0, s1));
+    for (; j < n; j++) s += a[j] * b[j];
+    return s;
+}
+
+TARGET_SSE static void dot4_sse(const float *w, const float *x0, const float *x1,
+                                const float *x2, const float *x3, int n, float out[4]) {
+    __m128 a0 = _mm_setzero_ps(), b0 = _mm_setzero_ps();
+    __m128 a1 = _mm_setzero_ps(), b1 = _mm_setzero_ps();
+    __m128 a2 = _mm_setzero_ps(), b2 = _mm_setzero_ps();
+    __m128 a3 = _mm_setzero_ps(), b3 = _mm_setzero_ps();
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m128 wl = _mm_loadu_ps(w + j), wh = _mm_loadu_ps(w + j + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(wl, _mm_loadu_ps(x0 + j)));
+        b0 = _mm_add_ps(b0, _mm_mul_ps(wh, _mm_loadu_ps(x0 + j + 4)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(wl, _mm_loadu_ps(x1 + j)));
+        b1 = _mm_add_ps(b1, _mm_mul_ps(wh, _mm_loadu_ps(x1 + j + 4)));
+        a2 = _mm_add_ps(a2, _mm_mul_ps(wl, _mm_loadu_ps(x2 + j)));
+        b2 = _mm_add_ps(b2, _mm_mul_ps(wh, _mm_loadu_ps(x2 + j + 4)));
+        a3 = _mm_add_ps(a3, _mm_mul_ps(wl, _mm_loadu_ps(x3 + j)));
+        b3 = _mm_add_ps(b3, _mm_mul_ps(wh, _mm_loadu_ps(x3 + j + 4)));
+    }
+    float s0 = hsum128(_mm_add_ps(a0, b0));
+    float s1 = hsum128(_mm_add_ps(a1, b1));
+    float s2 = hsum128(_mm_add_ps(a2, b2));
+    float s3 = hsum128(_mm_add_ps(a3, b3));
+    for (; j < n; j++) {
+        s0 += w[j] * x0[j];
+        s1 += w[j] * x1[j];
+        s2 += w[j] * x2[j];
+        s3 += w[j] * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+/* 16 accumulateurs ne tiennent pas dans les registres SSE: la tuile est
+ * calculée en deux moitiés de 8 colonnes */
+TARGET_SSE static void gemm_4x16_sse(int kc, const float *a, const float *b,
+                                     float *c, int ldc) {
+    int half, k;
+    for (half = 0; half < 16; half += 8) {
+        float *c0 = c + half, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+        __m128 r00 = _mm_loadu_ps(c0), r01 = _mm_loadu_ps(c0 + 4);
+        __m128 r10 = _mm_loadu_ps(c1), r11 = _mm_loadu_ps(c1 + 4);
+        __m128 r20 = _mm_loadu_ps(c2), r21 = _mm_loadu_ps(c2 + 4);
+        __m128 r30 = _mm_loadu_ps(c3), r31 = _mm_loadu_ps(c3 + 4);
+        const float *ap = a, *bp = b + half;
+        for (k = 0; k < kc; k++) {
+            __m128 b0 = _mm_loadu_ps(bp), b1 = _mm_loadu_ps(bp + 4);
+            __m128 av = _mm_set1_ps(ap[0]);
+            r00 = _mm_add_ps(r00, _mm_mul_ps(av, b0));
+            r01 = _mm_add_ps(r01, _mm_mul_ps(av, b1));
+            av = _mm_set1_ps(ap[1]);
+            r10 = _mm_add_ps(r10, _mm_mul_ps(av, b0));
+            r11 = _mm_add_ps(r11, _mm_mul_ps(av, b1));
+            av = _mm_set1_ps(ap[2]);
+            r20 = _mm_add_ps(r20, _mm_mul_ps(av, b0));
+            r21 = _mm_add_ps(r21, _mm_mul_ps(av, b1));
+            av = _mm_set1_ps(ap[3]);
+            r30 = _mm_add_ps(r30, _mm_mul_ps(av, b0));
+            r31 = _mm_add_ps(r31, _mm_mul_ps(av, b1));
+            ap += 4;
+            bp += 16;
+        }
+        _mm_storeu_ps(c0, r00); _mm_storeu_ps(c0 + 4, r01);
+        _mm_storeu_ps(c1, r10); _mm_storeu_ps(c1 + 4, r11);
+        _mm_storeu_ps(c2, r20); _mm_storeu_ps(c2 + 4, r21);
+        _mm_storeu_ps(c3, r30); _mm_storeu_ps(c3 + 4, r31);
+    }
+}
+
+TARGET_SSE static void relu_pool2x2_sse(const float *src, int size, int rows, int cols, float *dst) {
+    const __m128 zero = _mm_setzero_ps();
+    int i, j;
+    if (cols < 4) {
+        relu_pool2x2_scalar(src, size, rows, cols, dst);
+        return;
+    }
+    for (i = 0; i < rows; i++) {
+        const float *r0 = src + (size_t)(2 * i) * size;
+        const float *r1 = r0 + size;
+        float *out = dst + i * cols;
+        for (j = 0; j < cols; j += 4) {
+            /* 8 colonnes d'entrée -> 4 sorties, dernier bloc recalé */
+            if (j + 4 > cols) j = cols - 4;
+            __m128 lo = _mm_max_ps(_mm_loadu_ps(r0 + 2 * j), _mm_loadu_ps(r1 + 2 * j));
+            __m128 hi = _mm_max_ps(_mm_loadu_ps(r0 + 2 * j + 4), _mm_loadu_ps(r1 + 2 * j + 4));
+            __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + j, _mm_max_ps(_mm_max_ps(even, odd), zero));
+        }
+    }
+}
+
+/* pmaddubsw: u8 x s8 -> paires sommées en 16 bits. Avec x <= 127 une
+ * paire vaut au plus 2 * 127 * 127 = 32258: pas de saturation. */
+TARGET_SSE static int32_t dot_u8s8_sse(const uint8_t *x, const int8_t *w, int n) {
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i s0 = _mm_setzero_si128(), s1 = _mm_setzero_si128();
+    int j = 0;
+    for (; j + 32 <= n; j += 32) {
+        __m128i p0 = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(x + j)),
+                                       _mm_loadu_si128((const __m128i *)(w + j)));
+        __m128i p1 = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(x + j + 16)),
+                                       _mm_loadu_si128((const __m128i *)(w + j + 16)));
+        s0 = _mm_add_epi32(s0, _mm_madd_epi16(p0, ones));
+        s1 = _mm_add_epi32(s1, _mm_madd_epi16(p1, ones));
+    }
+    s0 = _mm_add_epi32(s0, s1);
+    s0 = _mm_add_epi32(s0, _mm_shuffle_epi32(s0, _MM_SHUFFLE(1, 0, 3, 2)));
+    s0 = _mm_add_epi32(s0, _mm_shuffle_epi32(s0, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t s = _mm_cvtsi128_si32(s0);
+    for (; j < n; j++) s += (int32_t)x[j] * w[j];
+    return s;
+}
+
+/* Un bloc = deux pas de 8 de dot_sse(); la fin de ligne reprend ses
+ * derniers pas vectoriels puis sa boucle scalaire */
+TARGET_SSE static float dot_sparse_sse(const float *vals, const uint16_t *blocks, int nb,
+                                       const float *tail, const float *x, int n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    int b, k, t = SPARSE_TAIL(n), j = t;
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        const float *xb = x + (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        for (k = 0; k < SIMD_SPARSE_BLOCK; k += 8) {
+            s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(vals + k), _mm_loadu_ps(xb + k)));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(vals + k + 4), _mm_loadu_ps(xb + k + 4)));
+        }
+    }
+    for (; j + 8 <= n; j += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(tail + (j - t)), _mm_loadu_ps(x + j)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(tail + (j - t) + 4), _mm_loadu_ps(x + j + 4)));
+    }
+    float s = hsum128(_mm_add_ps(s0, s1));
+    for (; j < n; j++) s += tail[j - t] * x[j];
+    return s;
+}
+
+TARGET_SSE static void dot4_sparse_sse(const float *vals, const uint16_t *blocks, int nb,
+                                       const float *tail, const float *x0, const float *x1,
+                                       const float *x2, const float *x3, int n, float out[4]) {
+    __m128 a0 = _mm_setzero_ps(), b0 = _mm_setzero_ps();
+    __m128 a1 = _mm_setzero_ps(), b1 = _mm_setzero_ps();
+    __m128 a2 = _mm_setzero_ps(), b2 = _mm_setzero_ps();
+    __m128 a3 = _mm_setzero_ps(), b3 = _mm_setzero_ps();
+    int b, k, t = SPARSE_TAIL(n), j = t;
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        size_t o = (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        for (k = 0; k < SIMD_SPARSE_BLOCK; k += 8) {
+            __m128 wl = _mm_loadu_ps(vals + k), wh = _mm_loadu_ps(vals + k + 4);
+            size_t p = o + k;
+            a0 = _mm_add_ps(a0, _mm_mul_ps(wl, _mm_loadu_ps(x0 + p)));
+            b0 = _mm_add_ps(b0, _mm_mul_ps(wh, _mm_loadu_ps(x0 + p + 4)));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(wl, _mm_loadu_ps(x1 + p)));
+            b1 = _mm_add_ps(b1, _mm_mul_ps(wh, _mm_loadu_ps(x1 + p + 4)));
+            a2 = _mm_add_ps(a2, _mm_mul_ps(wl, _mm_loadu_ps(x2 + p)));
+            b2 = _mm_add_ps(b2, _mm_mul_ps(wh, _mm_loadu_ps(x2 + p + 4)));
+            a3 = _mm_add_ps(a3, _mm_mul_ps(wl, _mm_loadu_ps(x3 + p)));
+            b3 = _mm_add_ps(b3, _mm_mul_ps(wh, _mm_loadu_ps(x3 + p + 4)));
+        }
+    }
+    for (; j + 8 <= n; j += 8) {
+        __m128 wl = _mm_loadu_ps(tail + (j - t)), wh = _mm_loadu_ps(tail + (j - t) + 4);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(wl, _mm_loadu_ps(x0 + j)));
+        b0 = _mm_add_ps(b0, _mm_mul_ps(wh, _mm_loadu_ps(x0 + j + 4)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(wl, _mm_loadu_ps(x1 + j)));
+        b1 = _mm_add_ps(b1, _mm_mul_ps(wh, _mm_loadu_ps(x1 + j + 4)));
+        a2 = _mm_add_ps(a2, _mm_mul_ps(wl, _mm_loadu_ps(x2 + j)));
+        b2 = _mm_add_ps(b2, _mm_mul_ps(wh, _mm_loadu_ps(x2 + j + 4)));
+        a3 = _mm_add_ps(a3, _mm_mul_ps(wl, _mm_loadu_ps(x3 + j)));
+        b3 = _mm_add_ps(b3, _mm_mul_ps(wh, _mm_loadu_ps(x3 + j + 4)));
+    }
+    float s0 = hsum128(_mm_add_ps(a0, b0));
+    float s1 = hsum128(_mm_add_ps(a1, b1));
+    float s2 = hsum128(_mm_add_ps(a2, b2));
+    float s3 = hsum128(_mm_add_ps(a3, b3));
+    for (; j < n; j++) {
+        s0 += tail[j - t] * x0[j];
+        s1 += tail[j - t] * x1[j];
+        s2 += tail[j - t] * x2[j];
+        s3 += tail[j - t] * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+/* 4 valeurs float16 (une par entier 32 bits) -> 4 floats, mêmes
+ * opérations que f16_to_float() */
+TARGET_SSE static inline __m128 f16x4_sse(__m128i h) {
+    const __m128i exp_mask = _mm_set1_epi32(0x0f800000);
+    __m128i o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+    __m128i e = _mm_and_si128(o, exp_mask);
+    __m128i inf = _mm_cmpeq_epi32(e, exp_mask);
+    __m128i sub = _mm_cmpeq_epi32(e, _mm_setzero_si128());
+    o = _mm_add_epi32(o, _mm_set1_epi32((127 - 15) << 23));
+    o = _mm_add_epi32(o, _mm_and_si128(inf, _mm_set1_epi32((128 - 16) << 23)));
+    o = _mm_add_epi32(o, _mm_and_si128(sub, _mm_set1_epi32(1 << 23)));
+    __m128 f = _mm_sub_ps(_mm_castsi128_ps(o),
+                          _mm_and_ps(_mm_castsi128_ps(sub), _mm_set1_ps(6.103515625e-05f)));
+    __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+    return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+/* 8 poids 16 bits -> deux vecteurs de 4 floats */
+TARGET_SSE static inline void load8_h16_sse(const uint16_t *w, int bf16, __m128 *lo, __m128 *hi) {
+    __m128i v = _mm_loadu_si128((const __m128i *)w);
+    if (bf16) {
+        *lo = _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), v));
+        *hi = _mm_castsi128_ps(_mm_unpackhi_epi16(_mm_setzero_si128(), v));
+    } else {
+        *lo = f16x4_sse(_mm_cvtepu16_epi32(v));
+        *hi = f16x4_sse(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+    }
+}
+
+TARGET_SSE static inline float dot_h16_sse(const uint16_t *w, const float *x, int n, int bf16) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m128 wl, wh;
+        load8_h16_sse(w + j, bf16, &wl, &wh);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(wl, _mm_loadu_ps(x + j)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(wh, _mm_loadu_ps(x + j + 4)));
+    }
+    float s = hsum128(_mm_add_ps(s0, s1));
+    for (; j < n; j++) s += h16_to_float(w[j], bf16) * x[j];
+    return s;
+}
+
+TARGET_SSE static inline void dot4_h16_sse(const uint16_t *w, const float *x0, const float *x1,
+                                           const float *x2, const float *x3, int n,
+                                           float out[4], int bf16) {
+    __m128 a0 = _mm_setzero_ps(), b0 = _mm_setzero_ps();
+    __m128 a1 = _mm_setzero_ps(), b1 = _mm_setzero_ps();
+    __m128 a2 = _mm_setzero_ps(), b2 = _mm_setzero_ps();
+    __m128 a3 = _mm_setzero_ps(), b3 = _mm_setzero_ps();
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m128 wl, wh;
+        load8_h16_sse(w + j, bf16, &wl, &wh);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(wl, _mm_loadu_ps(x0 + j)));
+        b0 = _mm_add_ps(b0, _mm_mul_ps(wh, _mm_loadu_ps(x0 + j + 4)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(wl, _mm_loadu_ps(x1 + j)));
+        b1 = _mm_add_ps(b1, _mm_mul_ps(wh, _mm_loadu_ps(x1 + j + 4)));
+        a2 = _mm_add_ps(a2, _mm_mul_ps(wl, _mm_loadu_ps(x2 + j)));
+        b2 = _mm_add_ps(b2, _mm_mul_ps(wh, _mm_loadu_ps(x2 + j + 4)));
+        a3 = _mm_add_ps(a3, _mm_mul_ps(wl, _mm_loadu_ps(x3 + j)));
+        b3 = _mm_add_ps(b3, _mm_mul_ps(wh, _mm_loadu_ps(x3 + j + 4)));
+    }
+    float s0 = hsum128(_mm_add_ps(a0, b0));
+    float s1 = hsum128(_mm_add_ps(a1, b1));
+    float s2 = hsum128(_mm_add_ps(a2, b2));
+    float s3 = hsum128(_mm_add_ps(a3, b3));
+    for (; j < n; j++) {
+        float wj = h16_to_float(w[j], bf16);
+        s0 += wj * x0[j];
+        s1 += wj * x1[j];
+        s2 += wj * x2[j];
+        s3 += wj * x3[j];
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+TARGET_SSE static float dot_f16_sse(const uint16_t *w, const float *x, int n) {
+    return dot_h16_sse(w, x, n, 0);
+}
+
+TARGET_SSE static void dot4_f16_sse(const uint16_t *w, const float *x0, const float *x1,
+                                    const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_sse(w, x0, x1, x2, x3, n, out, 0);
+}
+
+TARGET_SSE static float dot_bf16_sse(const uint16_t *w, const float *x, int n) {
+    return dot_h16_sse(w, x, n, 1);
+}
+
+TARGET_SSE static void dot4_bf16_sse(const uint16_t *w, const float *x0, const float *x1,
+                                     const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_sse(w, x0, x1, x2, x3, n, out, 1);
+}
+
+static const SimdKernels kernels_sse = {
+    "sse4.1", dot_sse, dot4_sse, gemm_4x16_sse, relu_pool2x2_sse,
+    dot_u8s8_sse, dot_sparse_sse, dot4_sparse_sse,
+    dot_f16_sse, dot4_f16_sse, dot_bf16_sse, dot4_bf16_sse
+};
+
+/* ============================================================
+ * VERSION AVX2 + FMA + F16C (vecteurs de 8 floats)
+ * ============================================================ */
+
+/* F16C (conversions float16) accompagne AVX2 sur tous les processeurs qui
+ * l'ont; elle est tout de même vérifiée par simd_available() */
+#define TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+
+TARGET_AVX2 static inline float hsum256(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 hi = _mm_movehl_ps(s, s);
+    s = _mm_add_ps(s, hi);
+    hi = _mm_shuffle_ps(s, s, 1);
+    return _mm_cvtss_f32(_mm_add_ss(s, hi));
+}
+
+/* s + a * b avec une FMA explicite, pour que dot et dot4 arrondissent pareil */
+TARGET_AVX2 static inline float fma_ss(float a, float b, float s) {
+    return _mm_cvtss_f32(_mm_fmadd_ss(_mm_set_ss(a), _mm_set_ss(b), _mm_set_ss(s)));
+}
+
+TARGET_AVX2 static float dot_avx2(const float *a, const float *b, int n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(b + j + 8), s1);
+    }
+    float s = hsum256(_mm256_add_ps(s0, s1));
+    for (; j < n; j++) s = fma_ss(a[j], b[j], s);
+    return s;
+}
+
+TARGET_AVX2 static void dot4_avx2(const float *w, const float *x0, const float *x1,
+                                  const float *x2, const float *x3, int n, float out[4]) {
+    __m256 a0 = _mm256_setzero_ps(), b0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps(), b1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), b2 = _mm256_setzero_ps();
+    __m256 a3 = _mm256_setzero_ps(), b3 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m256 wl = _mm256_loadu_ps(w + j), wh = _mm256_loadu_ps(w + j + 8);
+        a0 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x0 + j), a0);
+        b0 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x0 + j + 8), b0);
+        a1 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x1 + j), a1);
+        b1 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x1 + j + 8), b1);
+        a2 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x2 + j), a2);
+        b2 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x2 + j + 8), b2);
+        a3 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x3 + j), a3);
+        b3 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x3 + j + 8), b3);
+    }
+    float s0 = hsum256(_mm256_add_ps(a0, b0));
+    float s1 = hsum256(_mm256_add_ps(a1, b1));
+    float s2 = hsum256(_mm256_add_ps(a2, b2));
+    float s3 = hsum256(_mm256_add_ps(a3, b3));
+    for (; j < n; j++) {
+        s0 = fma_ss(w[j], x0[j], s0);
+        s1 = fma_ss(w[j], x1[j], s1);
+        s2 = fma_ss(w[j], x2[j], s2);
+        s3 = fma_ss(w[j], x3[j], s3);
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+TARGET_AVX2 static void gemm_4x16_avx2(int kc, const float *a, const float *b,
+                                       float *c, int ldc) {
+    float *c0 = c, *c1 = c0 + ldc, *c2 = c1 + ldc, *c3 = c2 + ldc;
+    __m256 r00 = _mm256_loadu_ps(c0), r01 = _mm256_loadu_ps(c0 + 8);
+    __m256 r10 = _mm256_loadu_ps(c1), r11 = _mm256_loadu_ps(c1 + 8);
+    __m256 r20 = _mm256_loadu_ps(c2), r21 = _mm256_loadu_ps(c2 + 8);
+    __m256 r30 = _mm256_loadu_ps(c3), r31 = _mm256_loadu_ps(c3 + 8);
+    int k;
+    for (k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+        __m256 av = _mm256_broadcast_ss(a);
+        r00 = _mm256_fmadd_ps(av, b0, r00);
+        r01 = _mm256_fmadd_ps(av, b1, r01);
+        av = _mm256_broadcast_ss(a + 1);
+        r10 = _mm256_fmadd_ps(av, b0, r10);
+        r11 = _mm256_fmadd_ps(av, b1, r11);
+        av = _mm256_broadcast_ss(a + 2);
+        r20 = _mm256_fmadd_ps(av, b0, r20);
+        r21 = _mm256_fmadd_ps(av, b1, r21);
+        av = _mm256_broadcast_ss(a + 3);
+        r30 = _mm256_fmadd_ps(av, b0, r30);
+        r31 = _mm256_fmadd_ps(av, b1, r31);
+        a += 4;
+        b += 16;
+    }
+    _mm256_storeu_ps(c0, r00); _mm256_storeu_ps(c0 + 8, r01);
+    _mm256_storeu_ps(c1, r10); _mm256_storeu_ps(c1 + 8, r11);
+    _mm256_storeu_ps(c2, r20); _mm256_storeu_ps(c2 + 8, r21);
+    _mm256_storeu_ps(c3, r30); _mm256_storeu_ps(c3 + 8, r31);
+}
+
+TARGET_AVX2 static void relu_pool2x2_avx2(const float *src, int size, int rows, int cols, float *dst) {
+    const __m256 zero = _mm256_setzero_ps();
+    int i, j;
+    if (cols < 8) {
+        relu_pool2x2_sse(src, size, rows, cols, dst);
+        return;
+    }
+    for (i = 0; i < rows; i++) {
+        const float *r0 = src + (size_t)(2 * i) * size;
+        const float *r1 = r0 + size;
+        float *out = dst + i * cols;
+        for (j = 0; j < cols; j += 8) {
+            /* 16 colonnes d'entrée -> 8 sorties; le dernier bloc est recalé
+             * sur la fin de la ligne (recouvrement) plutôt que fini en scalaire */
+            if (j + 8 > cols) j = cols - 8;
+            __m256 lo = _mm256_max_ps(_mm256_loadu_ps(r0 + 2 * j), _mm256_loadu_ps(r1 + 2 * j));
+            __m256 hi = _mm256_max_ps(_mm256_loadu_ps(r0 + 2 * j + 8),
+                                      _mm256_loadu_ps(r1 + 2 * j + 8));
+            /* shuffle_ps travaille par moitiés de 128 bits: on remet les
+             * blocs de 64 bits dans l'ordre ensuite */
+            __m256 even = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 odd = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+            __m256 m = _mm256_max_ps(_mm256_max_ps(even, odd), zero);
+            m = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+            _mm256_storeu_ps(out + j, m);
+        }
+    }
+}
+
+TARGET_AVX2 static int32_t dot_u8s8_avx2(const uint8_t *x, const int8_t *w, int n) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    int j = 0;
+    for (; j + 64 <= n; j += 64) {
+        __m256i p0 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(x + j)),
+                                          _mm256_loadu_si256((const __m256i *)(w + j)));
+        __m256i p1 = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(x + j + 32)),
+                                          _mm256_loadu_si256((const __m256i *)(w + j + 32)));
+        s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(p0, ones));
+        s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(p1, ones));
+    }
+    s0 = _mm256_add_epi32(s0, s1);
+    __m128i h = _mm_add_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t s = _mm_cvtsi128_si32(h);
+    for (; j < n; j++) s += (int32_t)x[j] * w[j];
+    return s;
+}
+
+/* Un bloc = un pas de 16 de dot_avx2(), fin de ligne en FMA scalaires */
+TARGET_AVX2 static float dot_sparse_avx2(const float *vals, const uint16_t *blocks, int nb,
+                                         const float *tail, const float *x, int n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    int b, j, t = SPARSE_TAIL(n);
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        const float *xb = x + (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(vals), _mm256_loadu_ps(xb), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(vals + 8), _mm256_loadu_ps(xb + 8), s1);
+    }
+    float s = hsum256(_mm256_add_ps(s0, s1));
+    for (j = t; j < n; j++) s = fma_ss(tail[j - t], x[j], s);
+    return s;
+}
+
+TARGET_AVX2 static void dot4_sparse_avx2(const float *vals, const uint16_t *blocks, int nb,
+                                         const float *tail, const float *x0, const float *x1,
+                                         const float *x2, const float *x3, int n, float out[4]) {
+    __m256 a0 = _mm256_setzero_ps(), b0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps(), b1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), b2 = _mm256_setzero_ps();
+    __m256 a3 = _mm256_setzero_ps(), b3 = _mm256_setzero_ps();
+    int b, j, t = SPARSE_TAIL(n);
+    for (b = 0; b < nb; b++, vals += SIMD_SPARSE_BLOCK) {
+        size_t o = (size_t)blocks[b] * SIMD_SPARSE_BLOCK;
+        __m256 wl = _mm256_loadu_ps(vals), wh = _mm256_loadu_ps(vals + 8);
+        a0 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x0 + o), a0);
+        b0 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x0 + o + 8), b0);
+        a1 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x1 + o), a1);
+        b1 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x1 + o + 8), b1);
+        a2 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x2 + o), a2);
+        b2 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x2 + o + 8), b2);
+        a3 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x3 + o), a3);
+        b3 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x3 + o + 8), b3);
+    }
+    float s0 = hsum256(_mm256_add_ps(a0, b0));
+    float s1 = hsum256(_mm256_add_ps(a1, b1));
+    float s2 = hsum256(_mm256_add_ps(a2, b2));
+    float s3 = hsum256(_mm256_add_ps(a3, b3));
+    for (j = t; j < n; j++) {
+        s0 = fma_ss(tail[j - t], x0[j], s0);
+        s1 = fma_ss(tail[j - t], x1[j], s1);
+        s2 = fma_ss(tail[j - t], x2[j], s2);
+        s3 = fma_ss(tail[j - t], x3[j], s3);
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+/* 8 poids 16 bits -> 8 floats: vcvtph2ps (F16C) pour float16, décalage
+ * de 16 bits pour bfloat16 */
+TARGET_AVX2 static inline __m256 load8_h16_avx2(const uint16_t *w, int bf16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)w);
+    if (bf16) return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(v), 16));
+    return _mm256_cvtph_ps(v);
+}
+
+TARGET_AVX2 static inline float dot_h16_avx2(const uint16_t *w, const float *x, int n, int bf16) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        s0 = _mm256_fmadd_ps(load8_h16_avx2(w + j, bf16), _mm256_loadu_ps(x + j), s0);
+        s1 = _mm256_fmadd_ps(load8_h16_avx2(w + j + 8, bf16), _mm256_loadu_ps(x + j + 8), s1);
+    }
+    float s = hsum256(_mm256_add_ps(s0, s1));
+    for (; j < n; j++) s = fma_ss(h16_to_float(w[j], bf16), x[j], s);
+    return s;
+}
+
+TARGET_AVX2 static inline void dot4_h16_avx2(const uint16_t *w, const float *x0, const float *x1,
+                                             const float *x2, const float *x3, int n,
+                                             float out[4], int bf16) {
+    __m256 a0 = _mm256_setzero_ps(), b0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps(), b1 = _mm256_setzero_ps();
+    __m256 a2 = _mm256_setzero_ps(), b2 = _mm256_setzero_ps();
+    __m256 a3 = _mm256_setzero_ps(), b3 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m256 wl = load8_h16_avx2(w + j, bf16), wh = load8_h16_avx2(w + j + 8, bf16);
+        a0 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x0 + j), a0);
+        b0 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x0 + j + 8), b0);
+        a1 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x1 + j), a1);
+        b1 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x1 + j + 8), b1);
+        a2 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x2 + j), a2);
+        b2 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x2 + j + 8), b2);
+        a3 = _mm256_fmadd_ps(wl, _mm256_loadu_ps(x3 + j), a3);
+        b3 = _mm256_fmadd_ps(wh, _mm256_loadu_ps(x3 + j + 8), b3);
+    }
+    float s0 = hsum256(_mm256_add_ps(a0, b0));
+    float s1 = hsum256(_mm256_add_ps(a1, b1));
+    float s2 = hsum256(_mm256_add_ps(a2, b2));
+    float s3 = hsum256(_mm256_add_ps(a3, b3));
+    for (; j < n; j++) {
+        float wj = h16_to_float(w[j], bf16);
+        s0 = fma_ss(wj, x0[j], s0);
+        s1 = fma_ss(wj, x1[j], s1);
+        s2 = fma_ss(wj, x2[j], s2);
+        s3 = fma_ss(wj, x3[j], s3);
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+TARGET_AVX2 static float dot_f16_avx2(const uint16_t *w, const float *x, int n) {
+    return dot_h16_avx2(w, x, n, 0);
+}
+
+TARGET_AVX2 static void dot4_f16_avx2(const uint16_t *w, const float *x0, const float *x1,
+                                      const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_avx2(w, x0, x1, x2, x3, n, out, 0);
+}
+
+TARGET_AVX2 static float dot_bf16_avx2(const uint16_t *w, const float *x, int n) {
+    return dot_h16_avx2(w, x, n, 1);
+}
+
+TARGET_AVX2 static void dot4_bf16_avx2(const uint16_t *w, const float *x0, const float *x1,
+                                       const float *x2, const float *x3, int n, float out[4]) {
+    dot4_h16_avx2(w, x0, x1, x2, x3, n, out, 1);
+}
+
+static const SimdKernels kernels_avx2 = {
+    "avx2", dot_avx2, dot4_avx2, gemm_4x16_avx2, relu_pool2x2_avx2,
+    dot_u8s8_avx2, dot_sparse_avx2, dot4_sparse_avx2,
+    dot_f16_avx2, dot4_f16_avx2, dot_bf16_avx2, dot4_bf16_avx2
+};
+
+#endif /* SIMD_X86 */
+
+/* ============================================================
+ * CHOIX À L'EXÉCUTION
+ * ============================================================ */
+
+const SimdKernels *simd = &kernels_scalar;
+
+int simd_available(const SimdKernels **list, int max) {
+    int n = 0;
+    if (n < max) list[n++] = &kernels_scalar;
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("sse4.1")) list[n++] = &kernels_sse;
+    if (n < max && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c")) {
+        list[n++] = &kernels_avx2;
+    }
+#endif
+    return n;
+}
+
+int simd_select(const char *name) {
+    const SimdKernels *list[4];
+    int n = simd_available(list, 4);
+    int i;
+    for (i = 0; i < n; i++) {
+        if (strcmp(list[i]->name, name) == 0) {
+            simd = list[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void simd_init(void) {
+    const SimdKernels *list[4];
+    const char *forced = getenv("OCR_SIMD");
+    if (forced && simd_select(forced) == 0) {
+        return;
+    }
+    /* La dernière version disponible est la plus rapide */
+    int n = simd_available(list, 4);
+    simd = list[n - 1];
+}
@@ -0,0 +1,87 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/*
+ * Noyaux de calcul vectorisés avec choix à l'exécution.
+ *
+ * Le programme est compilé pour le x86-64 de base; chaque noyau existe en
+ * version scalaire, SSE4.1 et AVX2/FMA/F16C (attributs target de GCC), et
+ * simd_init() choisit la meilleure version supportée par le processeur
+ * (CPUID via __builtin_cpu_supports). Un même binaire tourne ainsi sur
+ * toutes les machines.
+ *
+ * Pour une version donnée, dot() et dot4() font exactement les mêmes
+ * opérations pour une sortie: leurs résultats sont identiques bit à bit.
+ * D'une version à l'autre, l'ordre des additions change (écart d'arrondi).
+ */
+
+typedef struct {
+    const char *name;
+
+    /* Somme des a[j] * b[j], j < n */
+    float (*dot)(const float *a, const float *b, int n);
+
+    /* out[k] = dot(w, x[k], n) pour 4 vecteurs: chaque poids chargé sert 4 fois */
+    void (*dot4)(const float *w, const float *x0, const float *x1,
+                 const float *x2, const float *x3, int n, float out[4]);
+
+    /* Micro-noyau GEMM: C[4][16] (pas ldc) += Ap[kc][4] * Bp[kc][16]
+     * (panneaux empaquetés par gemm.c) */
+    void (*gemm_4x16)(int kc, const float *a, const float *b, float *c, int ldc);
+
+    /* ReLU + max-pooling 2x2: rows x cols sorties (pas cols) à partir des
+     * 2 * rows premières lignes d'un plan de largeur size */
+    void (*relu_pool2x2)(const float *src, int size, int rows, int cols, float *dst);
+
+    /* Produit scalaire entier (inférence INT8): x[j] dans [0, 127],
+     * w[j] dans [-127, 127], accumulation sur 32 bits. Exact, donc
+     * identique dans toutes les versions. */
+    int32_t (*dot_u8s8)(const uint8_t *x, const int8_t *w, int n);
+
+    /* dot() d'une ligne creuse de n poids découpée en blocs de
+     * SIMD_SPARSE_BLOCK: les nb blocs non nuls sont empaquetés dans vals,
+     * blocks[] donne leurs indices (croissants, blocs entiers seulement) et
+     * tail les n % SIMD_SPARSE_BLOCK derniers poids. Les blocs absents
+     * étant nuls, le résultat est identique à dot() sur la ligne dense. */
+    float (*dot_sparse)(const float *vals, const uint16_t *blocks, int nb,
+                        const float *tail, const float *x, int n);
+
+    /* Idem pour 4 vecteurs, identique à dot4() */
+    void (*dot4_sparse)(const float *vals, const uint16_t *blocks, int nb,
+                        const float *tail, const float *x0, const float *x1,
+                        const float *x2, const float *x3, int n, float out[4]);
+
+    /* dot() et dot4() avec des poids sur 16 bits, float16 IEEE (f16) ou
+     * bfloat16 (bf16), convertis en float à la volée. La conversion est
+     * exacte: seul l'ordre des additions change d'une version à l'autre,
+     * et dot4_*() reste identique à dot_*() bit à bit. */
+    float (*dot_f16)(const uint16_t *w, const float *x, int n);
+    void (*dot4_f16)(const uint16_t *w, const float *x0, const float *x1,
+                     const float *x2, const float *x3, int n, float out[4]);
+    float (*dot_bf16)(const uint16_t *w, const float *x, int n);
+    void (*dot4_bf16)(const uint16_t *w, const float *x0, const float *x1,
+                      const float *x2, const float *x3, int n, float out[4]);
+} SimdKernels;
+
+/* Blocs des noyaux creux: une ligne de cache, et un multiple du pas des
+ * boucles de dot() dans toutes les versions (les accumulateurs voient les
+ * mêmes produits dans le même ordre, blocs nuls en moins) */
+#define SIMD_SPARSE_BLOCK 16
+
+/* Noyaux utilisés par le reste du programme (scalaires tant que
+ * simd_init() n'a pas été appelé) */
+extern const SimdKernels *simd;
+
+/* Choisit automatiquement la meilleure version. La variable d'environnement
+ * OCR_SIMD (scalar, sse4.1, avx2) permet d'en imposer une. */
+void simd_init(void);
+
+/* Version par nom; -1 si inconnue ou non supportée par ce processeur */
+int simd_select(const char *name);
+
+/* Versions disponibles sur ce processeur (la scalaire en premier) */
+int simd_available(const SimdKernels **list, int max);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Pool de threads minimal pour les boucles parallèles
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+#define MAX_THREADS 256
+
+typedef struct {
+    ParallelTask fn;
+    void *ctx;
+    int n_tasks;
+    int next_task;
+    pthread_mutex_t lock;
+} PoolState;
+
+typedef struct {
+    PoolState *state;
+    int worker;
+} WorkerArg;
+
+int default_thread_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_THREADS) return MAX_THREADS;
+    return (int)n;
+}
+
+static void *worker_main(void *arg) {
+    WorkerArg *w = arg;
+    PoolState *st = w->state;
+    while (1) {
+        pthread_mutex_lock(&st->lock);
+        int task = st->next_task++;
+        pthread_mutex_unlock(&st->lock);
+        if (task >= st->n_tasks) break;
+        st->fn(st->ctx, task, w->worker);
+    }
+    return NULL;
+}
+
+void parallel_for(int n_tasks, int n_threads, ParallelTask fn, void *ctx) {
+    int i;
+    if (n_threads > n_tasks) n_threads = n_tasks;
+    if (n_threads > MAX_THREADS) n_threads = MAX_THREADS;
+    if (n_threads <= 1) {
+        for (i = 0; i < n_tasks; i++) fn(ctx, i, 0);
+        return;
+    }
+
+    PoolState st;
+    st.fn = fn;
+    st.ctx = ctx;
+    st.n_tasks = n_tasks;
+    st.next_task = 0;
+    pthread_mutex_init(&st.lock, NULL);
+
+    pthread_t threads[MAX_THREADS];
+    WorkerArg args[MAX_THREADS];
+    int started = 0;
+    /* Le thread appelant est le worker 0 */
+    for (i = 1; i < n_threads; i++) {
+        args[i].state = &st;
+        args[i].worker = i;
+        if (pthread_create(&threads[i], NULL, worker_main, &args[i]) != 0) break;
+        started++;
+    }
+    args[0].state = &st;
+    args[0].worker = 0;
+    worker_main(&args[0]);
+
+    for (i = 1; i <= started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&st.lock);
+}
+
+/* ============================================================
+ * POOL PERSISTANT
+ * ============================================================ */
+
+typedef struct {
+    ThreadPool *pool;
+    int worker;
+} PoolWorkerArg;
+
+struct ThreadPool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* nouvelle génération de tâches ou arrêt */
+    pthread_cond_t done;        /* tous les workers ont fini la génération */
+    ParallelTask fn;
+    void *ctx;
+    int n_tasks;
+    int next_task;
+    int generation;
+    int busy;                   /* workers (hors appelant) encore actifs */
+    int stop;
+    int started;
+    pthread_t threads[MAX_THREADS];
+    PoolWorkerArg args[MAX_THREADS];
+};
+
+/* Exécute les tâches restantes; appelé verrou pris, rend le verrou pris */
+static void pool_drain(ThreadPool *pool, int worker) {
+    while (pool->next_task < pool->n_tasks) {
+        int task = pool->next_task++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->fn(pool->ctx, task, worker);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static void *pool_worker_main(void *arg) {
+    PoolWorkerArg *w = arg;
+    ThreadPool *pool = w->pool;
+    int seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->generation == seen && !pool->stop) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop) break;
+        seen = pool->generation;
+        pool_drain(pool, w->worker);
+        if (--pool->busy == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool *thread_pool_new(int n_threads) {
+    int i;
+    ThreadPool *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+    if (n_threads > MAX_THREADS) n_threads = MAX_THREADS;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (i = 1; i < n_threads; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].worker = i;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker_main, &pool->args[i]) != 0) break;
+        pool->started++;
+    }
+    return pool;
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    int i;
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 1; i <= pool->started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool->started + 1;
+}
+
+void thread_pool_run(ThreadPool *pool, int n_tasks, ParallelTask fn, void *ctx) {
+    int i;
+    if (pool->started == 0 || n_tasks <= 1) {
+        for (i = 0; i < n_tasks; i++) fn(ctx, i, 0);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->n_tasks = n_tasks;
+    pool->next_task = 0;
+    pool->busy = pool->started;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work);
+    /* Le thread appelant est le worker 0 */
+    pool_drain(pool, 0);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,38 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * Répartition de tâches indépendantes sur plusieurs threads.
+ * Les tâches 0..n_tasks-1 sont distribuées dynamiquement: chaque worker
+ * prend la suivante dès qu'il a fini la précédente. worker (0..n_threads-1)
+ * permet à la tâche d'utiliser les tampons propres à son thread.
+ */
+
+typedef void (*ParallelTask)(void *ctx, int task, int worker);
+
+/* Nombre de coeurs disponibles (au moins 1) */
+int default_thread_count(void);
+
+/* Exécute fn(ctx, task, worker) pour chaque tâche et attend la fin de toutes.
+ * Le thread appelant sert de worker 0; avec n_threads <= 1 tout s'exécute
+ * dans ce thread. Si un thread ne peut pas être créé, les autres workers
+ * prennent ses tâches. */
+void parallel_for(int n_tasks, int n_threads, ParallelTask fn, void *ctx);
+
+/* Pool persistant, pour les boucles parallèles courtes et très fréquentes
+ * (un lot d'entraînement): les threads sont créés une fois et attendent
+ * le travail suivant au lieu d'être recréés à chaque appel. */
+typedef struct ThreadPool ThreadPool;
+
+/* n_threads workers au total, dont le thread appelant; NULL si l'allocation
+ * échoue. Les threads qui ne peuvent pas être créés sont simplement absents. */
+ThreadPool *thread_pool_new(int n_threads);
+void thread_pool_free(ThreadPool *pool);
+
+/* Nombre de workers réellement disponibles (au moins 1) */
+int thread_pool_size(const ThreadPool *pool);
+
+/* Même contrat que parallel_for() avec les workers du pool */
+void thread_pool_run(ThreadPool *pool, int n_tasks, ParallelTask fn, void *ctx);
+
+#endif
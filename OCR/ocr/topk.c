@@ -0,0 +1,203 @@
+/*
+ * Candidats (top-k) des glyphes reconnus, voir topk.h
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "model_bin.h"
+#include "topk.h"
+
+_Static_assert(sizeof(TopkHeader) == 40, "TopkHeader doit faire 40 octets");
+
+static void topk_carve(TopkFile *f, Arena *a) {
+    size_t entries = (size_t)f->glyphs * f->k;
+    f->row_len = arena_alloc(a, sizeof(uint32_t) * (f->grid_rows + f->word_rows));
+    f->probs = arena_alloc(a, sizeof(uint16_t) * entries);
+    f->letters = arena_alloc(a, entries);
+}
+
+/* Tailles lues depuis un en-tête ou passées à topk_build() */
+static int topk_alloc(TopkFile *f, int k, int glyphs, int grid_rows, int word_rows) {
+    memset(f, 0, sizeof(*f));
+    f->k = k;
+    f->glyphs = glyphs;
+    f->grid_rows = grid_rows;
+    f->word_rows = word_rows;
+    arena_measure(&f->arena);
+    topk_carve(f, &f->arena);
+    if (arena_init(&f->arena, f->arena.used) != 0) return -1;
+    topk_carve(f, &f->arena);
+    return 0;
+}
+
+void topk_free(TopkFile *f) {
+    arena_free(&f->arena);
+    memset(f, 0, sizeof(*f));
+}
+
+/* ============================================================
+ * SÉLECTION
+ * ============================================================ */
+
+/* Tri par insertion des k meilleures classes: k est petit et l'ordre à
+ * égalité (classe la plus petite d'abord) reste celui de predict() */
+static void select_topk(const float *p, int k, int *best) {
+    int c, n = 0, j;
+    for (c = 0; c < NUM_CLASSES; c++) {
+        if (n == k && p[c] <= p[best[k - 1]]) continue;
+        j = n < k ? n++ : k - 1;
+        while (j > 0 && p[c] > p[best[j - 1]]) {
+            best[j] = best[j - 1];
+            j--;
+        }
+        best[j] = c;
+    }
+}
+
+int topk_build(TopkFile *f, int k, const float (*probs)[NUM_CLASSES], const int *ok, int n,
+               const int *row_len, int grid_rows, int word_rows) {
+    int best[NUM_CLASSES];
+    int g, j;
+    if (k < 1 || k > NUM_CLASSES) {
+        printf("Erreur: le nombre de candidats doit être entre 1 et %d\n", NUM_CLASSES);
+        return -1;
+    }
+    if (topk_alloc(f, k, n, grid_rows, word_rows) != 0) {
+        printf("Erreur: mémoire insuffisante\n");
+        return -1;
+    }
+    for (j = 0; j < grid_rows + word_rows; j++) f->row_len[j] = (uint32_t)row_len[j];
+    for (g = 0; g < n; g++) {
+        uint16_t *prob = f->probs + (size_t)g * k;
+        char *letter = f->letters + (size_t)g * k;
+        if (!ok[g]) {
+            memset(letter, '0', k);
+            continue;
+        }
+        select_topk(probs[g], k, best);
+        for (j = 0; j < k; j++) {
+            letter[j] = (char)('A' + best[j]);
+            prob[j] = (uint16_t)lrintf(probs[g][best[j]] * (float)TOPK_PROB_ONE);
+        }
+    }
+    return 0;
+}
+
+/* ============================================================
+ * FICHIER BINAIRE
+ * ============================================================ */
+
+/* Somme de contrôle des trois sections (non contiguës dans l'arène) */
+static uint64_t topk_checksum(const TopkFile *f) {
+    size_t entries = (size_t)f->glyphs * f->k;
+    uint64_t h = model_bin_checksum(f->row_len, sizeof(uint32_t) * (f->grid_rows + f->word_rows));
+    h = model_bin_checksum_continue(h, f->probs, sizeof(uint16_t) * entries);
+    return model_bin_checksum_continue(h, f->letters, entries);
+}
+
+/* Les lignes doivent couvrir exactement tous les glyphes */
+static int rows_match(const TopkFile *f) {
+    uint64_t total = 0;
+    int r;
+    for (r = 0; r < f->grid_rows + f->word_rows; r++) total += f->row_len[r];
+    return total == (uint64_t)f->glyphs;
+}
+
+int topk_save(const TopkFile *f, const char *filename) {
+    char tmp[512];
+    size_t rows = sizeof(uint32_t) * (f->grid_rows + f->word_rows);
+    size_t entries = (size_t)f->glyphs * f->k;
+    TopkHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TOPK_MAGIC, sizeof(h.magic));
+    h.version = TOPK_VERSION;
+    h.endian_tag = MODEL_BIN_ENDIAN_TAG;
+    h.k = (uint32_t)f->k;
+    h.glyphs = (uint32_t)f->glyphs;
+    h.grid_rows = (uint32_t)f->grid_rows;
+    h.word_rows = (uint32_t)f->word_rows;
+    h.checksum = topk_checksum(f);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        printf("Erreur: impossible d'écrire %s\n", filename);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             fwrite(f->row_len, 1, rows, fp) == rows &&
+             fwrite(f->probs, sizeof(uint16_t), entries, fp) == entries &&
+             fwrite(f->letters, 1, entries, fp) == entries;
+    ok &= fclose(fp) == 0;
+    if (!ok || rename(tmp, filename) != 0) {
+        printf("Erreur: écriture incomplète de %s\n", filename);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Lit les sections dans l'arène de f; le fichier doit s'arrêter juste après */
+static int read_body(FILE *fp, TopkFile *f) {
+    size_t rows = (size_t)f->grid_rows + f->word_rows;
+    size_t entries = (size_t)f->glyphs * f->k;
+    return fread(f->row_len, sizeof(uint32_t), rows, fp) == rows &&
+           fread(f->probs, sizeof(uint16_t), entries, fp) == entries &&
+           fread(f->letters, 1, entries, fp) == entries && fgetc(fp) == EOF ? 0 : -1;
+}
+
+int topk_load(const char *filename, TopkFile *f) {
+    TopkHeader h;
+    memset(f, 0, sizeof(*f));
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        printf("Erreur: impossible d'ouvrir %s\n", filename);
+        return -1;
+    }
+    const char *err = NULL;
+    if (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, TOPK_MAGIC, sizeof(h.magic)) != 0) {
+        err = "n'est pas un fichier de candidats";
+    } else if (h.version != TOPK_VERSION || h.endian_tag != MODEL_BIN_ENDIAN_TAG) {
+        err = "a une version ou un ordre d'octets non supporté";
+    } else if (h.k < 1 || h.k > NUM_CLASSES || h.glyphs > INT32_MAX / NUM_CLASSES ||
+               h.grid_rows > (uint32_t)INT32_MAX - h.word_rows) {
+        err = "a un en-tête invalide";
+    } else if (topk_alloc(f, (int)h.k, (int)h.glyphs, (int)h.grid_rows, (int)h.word_rows) != 0) {
+        err = "ne tient pas en mémoire";
+    } else if (read_body(fp, f) != 0) {
+        err = "est tronqué";
+    } else if (topk_checksum(f) != h.checksum) {
+        err = "a une somme de contrôle invalide";
+    } else if (!rows_match(f)) {
+        err = "a des longueurs de lignes incohérentes";
+    }
+    fclose(fp);
+    if (err) {
+        printf("Erreur: %s %s\n", filename, err);
+        topk_free(f);
+        return -1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * VERSION TEXTE
+ * ============================================================ */
+
+void topk_print(const TopkFile *f, FILE *out) {
+    int r, i, j, g = 0;
+    for (r = 0; r < f->grid_rows + f->word_rows; r++) {
+        const char *part = r < f->grid_rows ? "grid" : "mots";
+        int row = r < f->grid_rows ? r : r - f->grid_rows;
+        for (i = 0; i < (int)f->row_len[r] && g < f->glyphs; i++, g++) {
+            fprintf(out, "%s %02d %02d", part, row, i);
+            for (j = 0; j < f->k; j++) {
+                fprintf(out, " %c %.4f", f->letters[(size_t)g * f->k + j],
+                        (double)f->probs[(size_t)g * f->k + j] / TOPK_PROB_ONE);
+            }
+            fputc('\n', out);
+        }
+    }
+}
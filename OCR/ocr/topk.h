@@ -0,0 +1,72 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cnn.h"
+#include "topology.h"
+
+/*
+ * Candidats de chaque glyphe reconnu (fichier "candidats" du mode 3 avec
+ * --topk N).
+ *
+ * grid et mots ne gardent que la lettre la plus probable; ce fichier
+ * garde les k meilleures lettres et leurs probabilités pour chaque
+ * glyphe, dans l'ordre de grid puis de mots, pour que la suite (solveur)
+ * puisse trancher les lettres ambiguës sans relancer le réseau.
+ *
+ *   [ en-tête TopkHeader, 40 octets                              ]
+ *   [ longueurs des lignes: grid_rows + word_rows x uint32       ]
+ *   [ probabilités: glyphs x k x uint16 (p x TOPK_PROB_ONE)      ]
+ *   [ lettres: glyphs x k octets ('A'..'Z', '0' si image illisible) ]
+ *
+ * Candidats par probabilité décroissante (à égalité, ordre alphabétique).
+ * 9 octets par glyphe avec k = 3, contre 104 pour les 26 floats.
+ */
+
+#define TOPK_MAGIC "CNNTOPK\n"
+#define TOPK_VERSION 1
+#define TOPK_FILE "candidats"
+#define TOPK_TEXT_FILE "candidats.txt"
+/* Fichier optionnel (--topk N, 3 suffit): le mode 3 écrit dans le dossier
+ * de sortie, qui est celui du solveur dans display/pipeline_run.c */
+#define TOPK_DEFAULT 0
+#define TOPK_PROB_ONE 65535
+
+typedef struct {
+    char magic[8];              /* TOPK_MAGIC */
+    uint32_t version;           /* TOPK_VERSION */
+    uint32_t endian_tag;        /* MODEL_BIN_ENDIAN_TAG */
+    uint32_t k;
+    uint32_t glyphs;
+    uint32_t grid_rows;         /* lignes de grid */
+    uint32_t word_rows;         /* lignes de mots */
+    uint64_t checksum;          /* FNV-1a 64 bits de tout ce qui suit l'en-tête */
+} TopkHeader;
+
+/* Contenu du fichier en mémoire */
+typedef struct {
+    int k, glyphs, grid_rows, word_rows;
+    uint32_t *row_len;          /* [grid_rows + word_rows] */
+    uint16_t *probs;            /* [glyphs][k] */
+    char *letters;              /* [glyphs][k] */
+    Arena arena;
+} TopkFile;
+
+/* Candidats de n glyphes à partir de leurs probabilités softmax; ok[g] == 0
+ * marque une image illisible (ou vide, prefilter.h). row_len: longueurs
+ * des lignes de grid puis de mots. -1 si k est hors de [1, NUM_CLASSES] ou si l'allocation échoue. */
+int topk_build(TopkFile *f, int k, const float (*probs)[NUM_CLASSES], const int *ok, int n,
+               const int *row_len, int grid_rows, int word_rows);
+
+/* Écrit dans filename.tmp puis renomme, comme model_bin_save */
+int topk_save(const TopkFile *f, const char *filename);
+int topk_load(const char *filename, TopkFile *f);
+void topk_free(TopkFile *f);
+
+/* Version texte: une ligne par glyphe, "grid|mots ligne position" puis les
+ * candidats "lettre probabilité" */
+void topk_print(const TopkFile *f, FILE *out);
+
+#endif
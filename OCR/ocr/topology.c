@@ -0,0 +1,225 @@
+/*
+ * Topologie choisie à l'exécution et arènes des tenseurs, voir topology.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topology.h"
+#include "model_bin.h"
+
+/* ============================================================
+ * TOPOLOGIE
+ * ============================================================ */
+
+void topology_default(Topology *t) {
+    memset(t, 0, sizeof(*t));
+    t->conv1_filters = CONV1_FILTERS;
+    t->conv1_size = CONV1_SIZE;
+    t->conv2_filters = CONV2_FILTERS;
+    t->conv2_size = CONV2_SIZE;
+    t->fc1_size = FC1_SIZE;
+    topology_init(t);
+}
+
+int topology_init(Topology *t) {
+    if (t->conv1_filters < 1 || t->conv1_filters > TOPO_MAX_FILTERS ||
+        t->conv2_filters < 1 || t->conv2_filters > TOPO_MAX_FILTERS ||
+        t->fc1_size < 1 || t->fc1_size > TOPO_MAX_FC1 ||
+        t->conv1_size < 1 || t->conv1_size > IMG_SIZE || t->conv2_size < 1) {
+        printf("Erreur: topologie hors des bornes\n");
+        return -1;
+    }
+    t->conv1_out = IMG_SIZE - t->conv1_size + 1;
+    t->after_pool1 = t->conv1_out / POOL1_SIZE;
+    t->conv2_out = t->after_pool1 - t->conv2_size + 1;
+    t->after_pool2 = t->conv2_out / POOL1_SIZE;
+    if (t->after_pool1 < 1 || t->conv2_out < 1 || t->after_pool2 < 1) {
+        printf("Erreur: noyaux trop grands pour des images %dx%d\n", IMG_SIZE, IMG_SIZE);
+        return -1;
+    }
+    t->flatten = t->conv2_filters * t->after_pool2 * t->after_pool2;
+    return 0;
+}
+
+int topology_parse(const char *spec, Topology *t) {
+    char end;
+    memset(t, 0, sizeof(*t));
+    if (sscanf(spec, "%dx%d,%dx%d,%d%c", &t->conv1_filters, &t->conv1_size,
+               &t->conv2_filters, &t->conv2_size, &t->fc1_size, &end) != 5) {
+        return -1;
+    }
+    return topology_init(t);
+}
+
+void topology_format(const Topology *t, char *buf, size_t size) {
+    snprintf(buf, size, "%dx%d,%dx%d,%d", t->conv1_filters, t->conv1_size,
+             t->conv2_filters, t->conv2_size, t->fc1_size);
+}
+
+int topology_equal(const Topology *a, const Topology *b) {
+    return a->conv1_filters == b->conv1_filters && a->conv1_size == b->conv1_size &&
+           a->conv2_filters == b->conv2_filters && a->conv2_size == b->conv2_size &&
+           a->fc1_size == b->fc1_size;
+}
+
+size_t topology_param_count(const Topology *t) {
+    size_t offset[MB_NUM_BLOCKS], size[MB_NUM_BLOCKS], n = 0;
+    int b;
+    cnn_layout(t, offset, size);
+    for (b = 0; b < MB_NUM_BLOCKS; b++) n += size[b] / sizeof(float);
+    return n;
+}
+
+/* ============================================================
+ * ARÈNE
+ * ============================================================ */
+
+static size_t align_up(size_t n) {
+    return (n + CNN_BLOCK_ALIGN - 1) & ~(size_t)(CNN_BLOCK_ALIGN - 1);
+}
+
+void arena_measure(Arena *a) {
+    a->base = NULL;
+    a->size = 0;
+    a->used = 0;
+}
+
+int arena_init(Arena *a, size_t size) {
+    size = align_up(size > 0 ? size : 1);
+    a->base = aligned_alloc(CNN_BLOCK_ALIGN, size);
+    a->size = size;
+    a->used = 0;
+    if (!a->base) return -1;
+    memset(a->base, 0, size);
+    return 0;
+}
+
+void arena_free(Arena *a) {
+    free(a->base);
+    arena_measure(a);
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    size_t start = a->used;
+    a->used = align_up(start + size);
+    return a->base ? a->base + start : NULL;
+}
+
+/* ============================================================
+ * PARAMÈTRES
+ * ============================================================ */
+
+size_t cnn_layout(const Topology *t, size_t offset[], size_t size[]) {
+    size_t pos = 0;
+    int b;
+    size[MB_CONV1_W] = sizeof(float) * t->conv1_filters * t->conv1_size * t->conv1_size;
+    size[MB_CONV1_B] = sizeof(float) * t->conv1_filters;
+    size[MB_CONV2_W] = sizeof(float) * t->conv2_filters * t->conv1_filters *
+                       t->conv2_size * t->conv2_size;
+    size[MB_CONV2_B] = sizeof(float) * t->conv2_filters;
+    size[MB_FC1_W] = sizeof(float) * t->fc1_size * (size_t)t->flatten;
+    size[MB_FC1_B] = sizeof(float) * t->fc1_size;
+    size[MB_FC2_W] = sizeof(float) * FC2_SIZE * t->fc1_size;
+    size[MB_FC2_B] = sizeof(float) * FC2_SIZE;
+    for (b = 0; b < MB_NUM_BLOCKS; b++) {
+        offset[b] = pos;
+        pos = align_up(pos + size[b]);
+    }
+    return pos;
+}
+
+void cnn_bind(CNN *net, const Topology *t, void *body) {
+    size_t offset[MB_NUM_BLOCKS], size[MB_NUM_BLOCKS];
+    size_t total = cnn_layout(t, offset, size);
+    char *base = body;
+    net->topo = *t;
+    net->conv1_weights = (float *)(base + offset[MB_CONV1_W]);
+    net->conv1_bias = (float *)(base + offset[MB_CONV1_B]);
+    net->conv2_weights = (float *)(base + offset[MB_CONV2_W]);
+    net->conv2_bias = (float *)(base + offset[MB_CONV2_B]);
+    net->fc1_weights = (float *)(base + offset[MB_FC1_W]);
+    net->fc1_bias = (float *)(base + offset[MB_FC1_B]);
+    net->fc2_weights = (float *)(base + offset[MB_FC2_W]);
+    net->fc2_bias = (float *)(base + offset[MB_FC2_B]);
+    net->data = (float *)base;
+    net->count = total / sizeof(float);
+    net->owned = NULL;
+    net->fc1_sparse = NULL;
+    net->conv2_winograd = NULL;
+    net->fc_half = NULL;
+}
+
+int cnn_alloc(CNN *net, const Topology *t) {
+    size_t offset[MB_NUM_BLOCKS], size[MB_NUM_BLOCKS];
+    Arena a;
+    memset(net, 0, sizeof(*net));
+    if (arena_init(&a, cnn_layout(t, offset, size)) != 0) return -1;
+    cnn_bind(net, t, a.base);
+    net->owned = a.base;
+    return 0;
+}
+
+void cnn_free(CNN *net) {
+    free(net->owned);
+    memset(net, 0, sizeof(*net));
+}
+
+void cnn_copy(CNN *dst, const CNN *src) {
+    memcpy(dst->data, src->data, sizeof(float) * src->count);
+}
+
+/* ============================================================
+ * CACHE DE LA PROPAGATION
+ * ============================================================ */
+
+static void cache_carve(ForwardCache *c, const Topology *t, Arena *a) {
+    size_t conv1 = (size_t)t->conv1_filters * t->conv1_out * t->conv1_out;
+    size_t pool1 = (size_t)t->conv1_filters * t->after_pool1 * t->after_pool1;
+    size_t conv2 = (size_t)t->conv2_filters * t->conv2_out * t->conv2_out;
+    size_t pool2 = (size_t)t->flatten;
+
+    c->conv1_out = arena_alloc(a, sizeof(float) * conv1);
+    c->relu1_out = arena_alloc(a, sizeof(float) * conv1);
+    c->pool1_out = arena_alloc(a, sizeof(float) * pool1);
+    c->pool1_max_i = arena_alloc(a, sizeof(int) * pool1);
+    c->pool1_max_j = arena_alloc(a, sizeof(int) * pool1);
+    c->conv2_out = arena_alloc(a, sizeof(float) * conv2);
+    c->relu2_out = arena_alloc(a, sizeof(float) * conv2);
+    c->pool2_out = arena_alloc(a, sizeof(float) * pool2);
+    c->pool2_max_i = arena_alloc(a, sizeof(int) * pool2);
+    c->pool2_max_j = arena_alloc(a, sizeof(int) * pool2);
+    c->flatten = arena_alloc(a, sizeof(float) * pool2);
+    c->fc1_out = arena_alloc(a, sizeof(float) * t->fc1_size);
+    c->relu3_out = arena_alloc(a, sizeof(float) * t->fc1_size);
+    c->d_relu3 = arena_alloc(a, sizeof(float) * t->fc1_size);
+    c->d_flatten = arena_alloc(a, sizeof(float) * pool2);
+    c->d_relu2 = arena_alloc(a, sizeof(float) * conv2);
+    c->d_pool1 = arena_alloc(a, sizeof(float) * pool1);
+    c->d_relu1 = arena_alloc(a, sizeof(float) * conv1);
+}
+
+int forward_cache_alloc(ForwardCache *c, const Topology *t) {
+    Arena a;
+    memset(c, 0, sizeof(*c));
+    arena_measure(&a);
+    cache_carve(c, t, &a);
+    if (arena_init(&a, a.used) != 0) return -1;
+    cache_carve(c, t, &a);
+    c->arena = a.base;
+    return 0;
+}
+
+size_t forward_cache_bytes(const Topology *t) {
+    ForwardCache c;
+    Arena a;
+    arena_measure(&a);
+    cache_carve(&c, t, &a);
+    return a.used;
+}
+
+void forward_cache_free(ForwardCache *c) {
+    free(c->arena);
+    memset(c, 0, sizeof(*c));
+}
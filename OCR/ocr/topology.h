@@ -0,0 +1,113 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stddef.h>
+
+#include "cnn.h"
+
+/*
+ * Topologie du réseau choisie à l'exécution.
+ *
+ * Le graphe est toujours Conv -> ReLU -> Pool 2x2 -> Conv -> ReLU ->
+ * Pool 2x2 -> FC -> ReLU -> FC -> softmax; le nombre de filtres, la taille
+ * des noyaux et la largeur de FC1 viennent de l'en-tête du modèle chargé
+ * (ou de --topology pour un nouvel entraînement). Un petit modèle rapide
+ * pour les scans propres et un plus gros pour les photos bruitées
+ * tournent ainsi avec le même binaire.
+ *
+ * Tous les tenseurs d'un réseau (poids, gradients, cache de la propagation
+ * avant, tampons de travail) sont découpés dans une arène unique dont la
+ * taille est calculée au chargement.
+ */
+
+/* Bornes acceptées pour une topologie lue dans un fichier */
+#define TOPO_MAX_FILTERS 256
+#define TOPO_MAX_FC1 4096
+
+/* Remplit les valeurs par défaut (CONV1_FILTERS...) et les dimensions
+ * déduites */
+void topology_default(Topology *t);
+
+/* Calcule les dimensions déduites; -1 (avec un message) si la topologie
+ * est impossible ou hors des bornes */
+int topology_init(Topology *t);
+
+/* "16x5,32x3,256": filtres x noyau de CONV1, de CONV2, puis largeur de FC1;
+ * -1 si la description est invalide */
+int topology_parse(const char *spec, Topology *t);
+
+/* Écrit la description lue par topology_parse() */
+void topology_format(const Topology *t, char *buf, size_t size);
+
+int topology_equal(const Topology *a, const Topology *b);
+
+/* Topologie par défaut? Les boucles chaudes ont une version compilée avec
+ * ses dimensions constantes (déroulée et vectorisée par le compilateur),
+ * les autres topologies passent par la version générique. */
+static inline int topology_is_default(const Topology *t) {
+    return t->conv1_filters == CONV1_FILTERS && t->conv1_size == CONV1_SIZE &&
+           t->conv2_filters == CONV2_FILTERS && t->conv2_size == CONV2_SIZE &&
+           t->fc1_size == FC1_SIZE;
+}
+
+/* Corps de fonction à spécialiser: toujours inliné, pour que chaque appel
+ * avec des dimensions constantes produise sa propre version */
+#define TOPO_SPECIALIZE static inline __attribute__((always_inline))
+
+/* Nombre de paramètres réels (sans l'alignement des blocs) */
+size_t topology_param_count(const Topology *t);
+
+/* ============================================================
+ * ARÈNE
+ * ============================================================ */
+
+/* Zone découpée en blocs alignés sur CNN_BLOCK_ALIGN. Avec base == NULL,
+ * arena_alloc() ne fait que compter: la même fonction de découpage sert à
+ * mesurer puis à répartir. */
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+/* Arène de mesure (rien n'est alloué) */
+void arena_measure(Arena *a);
+
+/* Alloue size octets (remis à zéro); -1 si l'allocation échoue */
+int arena_init(Arena *a, size_t size);
+void arena_free(Arena *a);
+
+/* Bloc suivant de size octets (NULL pendant une mesure) */
+void *arena_alloc(Arena *a, size_t size);
+
+/* ============================================================
+ * PARAMÈTRES (CNN, Gradients, état de l'optimiseur)
+ * ============================================================ */
+
+/* Position et taille en octets de chaque bloc dans le corps de model.bin
+ * (ordre MB_CONV1_W...); renvoie la taille du corps */
+size_t cnn_layout(const Topology *t, size_t offset[], size_t size[]);
+
+/* Arène propre remise à zéro; -1 si l'allocation échoue */
+int cnn_alloc(CNN *net, const Topology *t);
+
+/* Vues sur un corps existant (model.bin mappé), sans allocation */
+void cnn_bind(CNN *net, const Topology *t, void *body);
+
+/* Libère l'arène (rien pour un réseau lié par cnn_bind) */
+void cnn_free(CNN *net);
+
+/* Copie les paramètres (même topologie) */
+void cnn_copy(CNN *dst, const CNN *src);
+
+/* ============================================================
+ * CACHE DE LA PROPAGATION
+ * ============================================================ */
+
+int forward_cache_alloc(ForwardCache *c, const Topology *t);
+void forward_cache_free(ForwardCache *c);
+
+/* Taille de l'arène d'un cache (en plus de sizeof(ForwardCache)) */
+size_t forward_cache_bytes(const Topology *t);
+
+#endif
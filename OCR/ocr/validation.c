@@ -0,0 +1,163 @@
+/*
+ * Validation concurrente de l'entraînement, voir validation.h
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "validation.h"
+#include "batch.h"
+#include "fastmath.h"
+
+/* ============================================================
+ * POLICES MISES DE CÔTÉ
+ * ============================================================ */
+
+int val_parse_fonts(const char *spec, uint8_t held_out[SAMPLES_PER_LETTER]) {
+    const char *p = spec;
+    memset(held_out, 0, SAMPLES_PER_LETTER);
+    if (strcmp(spec, "none") == 0) return 0;
+
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p) return -1;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1) return -1;
+            p = end;
+        }
+        if (first < 0 || last >= SAMPLES_PER_LETTER || first > last) return -1;
+        memset(held_out + first, 1, (size_t)(last - first + 1));
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return 0;
+}
+
+int val_split(const Dataset *ds, const uint8_t held_out[SAMPLES_PER_LETTER],
+              int **train, int *n_train, int **val, int *n_val) {
+    int k;
+    *train = malloc(sizeof(int) * ds->count);
+    *val = malloc(sizeof(int) * ds->count);
+    if (!*train || !*val) {
+        free(*train);
+        free(*val);
+        *train = *val = NULL;
+        return -1;
+    }
+    *n_train = *n_val = 0;
+    for (k = 0; k < ds->count; k++) {
+        if (held_out[ds->fonts[k]]) (*val)[(*n_val)++] = k;
+        else (*train)[(*n_train)++] = k;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * ÉVALUATION SUR UN THREAD
+ * ============================================================ */
+
+struct Validator {
+    const Dataset *ds;
+    const int *samples;
+    int count;
+    CNN *weights;               /* instantané des poids */
+    BatchWorkspace *ws;
+    float (*imgs)[IMG_SIZE][IMG_SIZE];
+    float (*probs)[NUM_CLASSES];
+    ValResult result;
+    int running;
+    pthread_t thread;
+};
+
+static void *validator_main(void *arg) {
+    Validator *v = arg;
+    double t0 = now_seconds();
+    double loss = 0.0;
+    int correct = 0;
+    int i, k, c;
+
+    for (i = 0; i < v->count; i += BATCH_TILE) {
+        int n = v->count - i < BATCH_TILE ? v->count - i : BATCH_TILE;
+        for (k = 0; k < n; k++) {
+            dataset_image(v->ds, v->samples[i + k], v->imgs[k]);
+        }
+        forward_batch_ws(v->weights, v->ws, v->imgs, n, v->probs);
+        for (k = 0; k < n; k++) {
+            int letter = v->ds->labels[v->samples[i + k]];
+            int pred = 0;
+            for (c = 1; c < NUM_CLASSES; c++) {
+                if (v->probs[k][c] > v->probs[k][pred]) pred = c;
+            }
+            correct += pred == letter;
+            loss += -fast_log(v->probs[k][letter]);
+        }
+    }
+    v->result.loss = (float)(loss / v->count);
+    v->result.accuracy = 100.0f * (float)correct / (float)v->count;
+    v->result.seconds = now_seconds() - t0;
+    return NULL;
+}
+
+Validator *validator_new(const Dataset *ds, const int *samples, int count,
+                         const Topology *t) {
+    if (count <= 0) return NULL;
+    Validator *v = calloc(1, sizeof(*v));
+    if (!v) return NULL;
+    v->ds = ds;
+    v->samples = samples;
+    v->count = count;
+    v->weights = malloc(sizeof(CNN));
+    if (v->weights && cnn_alloc(v->weights, t) != 0) {
+        free(v->weights);
+        v->weights = NULL;
+    }
+    v->ws = batch_workspace_new(t);
+    v->imgs = malloc(sizeof(*v->imgs) * BATCH_TILE);
+    v->probs = malloc(sizeof(*v->probs) * BATCH_TILE);
+    if (!v->weights || !v->ws || !v->imgs || !v->probs) {
+        validator_free(v);
+        return NULL;
+    }
+    return v;
+}
+
+void validator_free(Validator *v) {
+    if (!v) return;
+    if (v->running) pthread_join(v->thread, NULL);
+    if (v->weights) cnn_free(v->weights);
+    free(v->weights);
+    batch_workspace_free(v->ws);
+    free(v->imgs);
+    free(v->probs);
+    free(v);
+}
+
+int validator_start(Validator *v, const CNN *weights, int epoch) {
+    if (v->running) return -1;
+    cnn_copy(v->weights, weights);
+    v->result.epoch = epoch;
+    if (pthread_create(&v->thread, NULL, validator_main, v) != 0) {
+        printf("Erreur: impossible de créer le thread de validation\n");
+        return -1;
+    }
+    v->running = 1;
+    return 0;
+}
+
+int validator_wait(Validator *v, ValResult *res) {
+    if (!v->running) return -1;
+    pthread_join(v->thread, NULL);
+    v->running = 0;
+    *res = v->result;
+    return 0;
+}
+
+const CNN *validator_weights(const Validator *v) {
+    return v->weights;
+}
@@ -0,0 +1,67 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <stdint.h>
+
+#include "cnn.h"
+#include "dataset.h"
+#include "topology.h"
+
+/*
+ * Validation sur des polices mises de côté.
+ *
+ * Les polices choisies (le NNN des fichiers <L>_NNN.pbm) ne servent jamais
+ * à l'entraînement: la précision mesurée est celle de polices inconnues du
+ * réseau. À la fin de chaque époque, les poids sont copiés dans un
+ * instantané qu'un thread dédié évalue (inférence par lots, sans
+ * augmentation) pendant que l'époque suivante s'entraîne déjà.
+ *
+ * train() arrête l'entraînement quand la perte de validation n'a plus
+ * baissé d'au moins VAL_MIN_DELTA depuis patience époques, et enregistre
+ * les poids de la meilleure époque.
+ */
+
+#define VAL_FONTS "900-999"     /* polices de validation par défaut (10 %) */
+#define VAL_PATIENCE 3          /* époques sans amélioration avant l'arrêt */
+#define VAL_MIN_DELTA 1e-3f     /* baisse de perte comptée comme amélioration */
+
+typedef struct {
+    int epoch;                  /* époques terminées lors de l'instantané */
+    float loss;                 /* entropie croisée moyenne */
+    float accuracy;             /* en % */
+    double seconds;             /* durée de l'évaluation */
+} ValResult;
+
+typedef struct Validator Validator;
+
+/* Lit une liste de polices "a-b,c,..." ("none": aucune) dans held_out
+ * (SAMPLES_PER_LETTER entrées à 0 ou 1); -1 si la liste est invalide */
+int val_parse_fonts(const char *spec, uint8_t held_out[SAMPLES_PER_LETTER]);
+
+/* Indices (dans ds) des images d'entraînement et de validation, alloués
+ * dans *train et *val; -1 si l'allocation échoue */
+int val_split(const Dataset *ds, const uint8_t held_out[SAMPLES_PER_LETTER],
+              int **train, int *n_train, int **val, int *n_val);
+
+/* Évaluateur des count images samples[] de ds (non copiées) pour des
+ * réseaux de topologie t; NULL en cas d'erreur */
+Validator *validator_new(const Dataset *ds, const int *samples, int count,
+                         const Topology *t);
+
+/* Attend l'évaluation en cours puis libère tout */
+void validator_free(Validator *v);
+
+/* Copie weights dans l'instantané et lance son évaluation sur un thread;
+ * epoch est recopié dans le résultat. Une seule évaluation à la fois:
+ * la précédente doit avoir été attendue. -1 si le thread n'a pas pu être
+ * créé. */
+int validator_start(Validator *v, const CNN *weights, int epoch);
+
+/* Attend l'évaluation en cours et range son résultat dans *res; -1 s'il
+ * n'y en a pas */
+int validator_wait(Validator *v, ValResult *res);
+
+/* Instantané de la dernière évaluation lancée */
+const CNN *validator_weights(const Validator *v);
+
+#endif